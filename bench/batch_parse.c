@@ -0,0 +1,86 @@
+#include "bench.h"
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+An xargs-style command line: one option followed by 100k file paths, half of them after "--". Parses it
+once with ARG_POSITIONAL, which runs the state machine once per path, and once with ARG_POSITIONAL_BATCH.
+*/
+
+#define BATCH_PATHS 100000
+#define BATCH_ITERATIONS 100
+
+static char** make_argv(int* pargc) {
+	static char names[BATCH_PATHS][16];
+	int argc = BATCH_PATHS + 3;
+	char** argv = calloc((size_t)argc + 1, sizeof(*argv));
+	int n = 0;
+	
+	argv[n++] = "bench";
+	argv[n++] = "-v";
+	for(int i = 0; i < BATCH_PATHS; i++) {
+		if(i == BATCH_PATHS / 2) {
+			argv[n++] = "--";
+		}
+		snprintf(names[i], sizeof(names[i]), "file%d.json", i);
+		argv[n++] = names[i];
+	}
+	
+	*pargc = argc;
+	return argv;
+}
+
+static long parse_single(int argc, char** argv) {
+	long total = 0;
+	
+	ARGPARSE(argc, argv) {
+		ARGPARSE_CONFIG_STREAM(NULL);
+		
+		ARG('v', "verbose", "Enable verbose logging") {}
+		
+		ARG_POSITIONAL("file...", path) {
+			total += path[0];
+		}
+	}
+	
+	return total;
+}
+
+static long parse_batch(int argc, char** argv) {
+	long total = 0;
+	
+	ARGPARSE(argc, argv) {
+		ARGPARSE_CONFIG_STREAM(NULL);
+		
+		ARG('v', "verbose", "Enable verbose logging") {}
+		
+		ARG_POSITIONAL_BATCH("file...", paths) {
+			for(int i = 0; i < paths.count; i++) {
+				total += paths.args[i][0];
+			}
+		}
+	}
+	
+	return total;
+}
+
+int main(void) {
+	int argc = 0;
+	char** argv = make_argv(&argc);
+	long single = 0, batch = 0;
+	
+	uint64_t start = bench_now();
+	for(int i = 0; i < BATCH_ITERATIONS; i++) {
+		single += parse_single(argc, argv);
+	}
+	bench_report("ARG_POSITIONAL x100k", bench_now() - start, BATCH_ITERATIONS);
+	
+	start = bench_now();
+	for(int i = 0; i < BATCH_ITERATIONS; i++) {
+		batch += parse_batch(argc, argv);
+	}
+	bench_report("ARG_POSITIONAL_BATCH x100k", bench_now() - start, BATCH_ITERATIONS);
+	
+	free(argv);
+	return single == batch && single == (long)'f' * BATCH_PATHS * BATCH_ITERATIONS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,59 @@
+//
+//  bench.h
+//
+//  Created by Kevin Colley on 10/18/26.
+//  Copyright © 2026 Kevin Colley. All rights reserved.
+//
+
+#ifndef KJC_ARGPARSE_BENCH_H
+#define KJC_ARGPARSE_BENCH_H
+
+/* Timing helpers shared by the benchmark programs, which are built and run by `make bench` */
+
+#if !defined(_POSIX_C_SOURCE) && !defined(__cplusplus)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_ITERATIONS 1000000
+
+/* Typical command line parsed by the benchmarks: flags, ints, a double, an enum name, and positionals */
+static const char* const bench_args[] = {
+	"bench", "-v", "--base-url", "http://example.com", "-j", "8", "--max-bytes=65536",
+	"--timeout", "2.5", "--format", "json", "a.json", "b.json",
+};
+
+#define BENCH_ARGC ((int)(sizeof(bench_args) / sizeof(bench_args[0])))
+
+/* Writable copy of bench_args, because argv is a char** */
+static inline char** bench_argv(void) {
+	static char storage[256];
+	static char* argv[BENCH_ARGC + 1];
+	size_t used = 0;
+	int i;
+	
+	for(i = 0; i < BENCH_ARGC; i++) {
+		size_t len = strlen(bench_args[i]) + 1;
+		argv[i] = (char*)memcpy(storage + used, bench_args[i], len);
+		used += len;
+	}
+	argv[BENCH_ARGC] = NULL;
+	return argv;
+}
+
+/* Monotonic clock in nanoseconds */
+static inline uint64_t bench_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline void bench_report(const char* name, uint64_t elapsed_ns, unsigned long iterations) {
+	printf("%-32s %9.1f ns/iteration\n", name, (double)elapsed_ns / (double)iterations);
+}
+
+#endif /* KJC_ARGPARSE_BENCH_H */
@@ -0,0 +1,67 @@
+#include <cstdlib>
+#include <string_view>
+#include "bench.h"
+#include "kjc_argparse.hpp"
+
+/*
+The options from macro_parse.c, bound to struct members with kjc::bind() and filled by kjc::parse_into().
+*/
+
+enum class log_format {
+	text,
+	json,
+};
+
+struct options {
+	bool verbose = false;
+	std::string_view base_url{};
+	int job_count = 1;
+	long max_bytes = 0;
+	double timeout = 30.0;
+	log_format format = log_format::text;
+};
+
+static constexpr kjc::enum_name<log_format> log_formats[] = {
+	{"text", log_format::text},
+	{"json", log_format::json},
+};
+
+static constexpr kjc::config make_config() {
+	kjc::config cfg;
+	cfg.quiet = true;
+	cfg.positional_usage = "input1.json {inputN.json...}";
+	return cfg;
+}
+
+static constexpr auto binding = kjc::make_binding(
+	make_config(),
+	kjc::bind('v', "verbose", "Enable verbose logging", &options::verbose),
+	kjc::bind('u', "base-url", "Base URL for resources", "url", &options::base_url),
+	kjc::bind('j', "jobs", "Number of jobs to run in parallel", "jobs", &options::job_count),
+	kjc::bind('m', "max-bytes", "Maximum number of bytes to download", "bytes", &options::max_bytes),
+	kjc::bind('t', "timeout", "Seconds to wait for each request", "seconds", &options::timeout),
+	kjc::bind('f', "format", "Log format (text or json)", "format", &options::format, log_formats)
+);
+
+int main() {
+	char** argv = bench_argv();
+	int argc = BENCH_ARGC;
+	unsigned long checksum = 0;
+	
+	std::uint64_t start = bench_now();
+	for(unsigned long i = 0; i < BENCH_ITERATIONS; i++) {
+		options opts;
+		std::size_t input_count = 0;
+		kjc::parse_result result = kjc::parse_into(binding, opts, argc, argv, [&](std::string_view) {
+			input_count++;
+		});
+		if(result != kjc::parse_result::ok) {
+			std::fprintf(stderr, "Failed to parse the benchmark arguments\n");
+			return EXIT_FAILURE;
+		}
+		checksum += (unsigned long)opts.job_count + input_count;
+	}
+	bench_report("kjc::parse_into (C++ binding)", bench_now() - start, BENCH_ITERATIONS);
+	
+	return checksum == 10ul * BENCH_ITERATIONS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,97 @@
+#include "bench.h"
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+Matching the values of an option with hundreds of choices, like instance type names. ARG_CHOICE looks each value up
+in the perfect hash table built when the option is registered, while the baseline takes an ARG_STRING and compares
+it against every choice in turn, the way handlers did before. Every parse includes building that table, so the
+command line repeats the option enough times for the lookups to dominate.
+*/
+
+#define CHOICE_COUNT 512
+#define CHOICE_ARGS 256
+#define CHOICE_ITERATIONS 2000
+
+static const char* const families[] = {"c", "m", "r", "t", "x", "g", "p", "i"};
+static const char* const sizes[] = {
+	"nano", "micro", "small", "medium", "large", "xlarge", "2xlarge", "4xlarge",
+	"8xlarge", "12xlarge", "16xlarge", "24xlarge", "32xlarge", "48xlarge", "56xlarge", "metal",
+};
+
+static char names[CHOICE_COUNT][24];
+static const char* choices[CHOICE_COUNT];
+
+static long parse_choice(int argc, char** argv) {
+	long total = 0;
+	
+	ARGPARSE(argc, argv) {
+		ARGPARSE_CONFIG_STREAM(NULL);
+		
+		ARG_CHOICE('t', "type", "Instance type", choices, type) {
+			total += type;
+		}
+	}
+	
+	return total;
+}
+
+static long parse_strcmp(int argc, char** argv) {
+	long total = 0;
+	
+	ARGPARSE(argc, argv) {
+		ARGPARSE_CONFIG_STREAM(NULL);
+		
+		ARG_STRING('t', "type", "Instance type", name) {
+			for(int i = 0; i < CHOICE_COUNT; i++) {
+				if(strcmp(name, choices[i]) == 0) {
+					total += i;
+					break;
+				}
+			}
+		}
+	}
+	
+	return total;
+}
+
+int main(void) {
+	for(int i = 0; i < CHOICE_COUNT; i++) {
+		snprintf(
+			names[i], sizeof(names[i]), "%s%d.%s",
+			families[i % 8], 1 + (i / 8) % 4, sizes[(i / 32) % 16]
+		);
+		choices[i] = names[i];
+	}
+	
+	/* Spread the values over the whole list of choices */
+	char* argv[CHOICE_ARGS * 2 + 2];
+	argv[0] = "bench";
+	for(int i = 0; i < CHOICE_ARGS; i++) {
+		argv[i * 2 + 1] = "-t";
+		argv[i * 2 + 2] = names[(i * 2654435761u) % CHOICE_COUNT];
+	}
+	argv[CHOICE_ARGS * 2 + 1] = NULL;
+	int argc = CHOICE_ARGS * 2 + 1;
+	
+	long expected = parse_strcmp(argc, argv);
+	if(parse_choice(argc, argv) != expected) {
+		fprintf(stderr, "ARG_CHOICE and strcmp() disagree\n");
+		return EXIT_FAILURE;
+	}
+	
+	long sink = 0;
+	uint64_t start = bench_now();
+	for(int i = 0; i < CHOICE_ITERATIONS; i++) {
+		sink += parse_choice(argc, argv);
+	}
+	bench_report("ARG_CHOICE (512 choices)", (bench_now() - start) / CHOICE_ARGS, CHOICE_ITERATIONS);
+	
+	start = bench_now();
+	for(int i = 0; i < CHOICE_ITERATIONS; i++) {
+		sink += parse_strcmp(argc, argv);
+	}
+	bench_report("ARG_STRING + strcmp() chain", (bench_now() - start) / CHOICE_ARGS, CHOICE_ITERATIONS);
+	
+	return sink == expected * CHOICE_ITERATIONS * 2 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,429 @@
+/* getopt_long() and argp are GNU extensions */
+#define _GNU_SOURCE
+
+#include "../bench.h"
+#include <argp.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+Compares kjc_argparse against glibc's getopt_long() and argp on identical schemas and command lines. Each
+schema is measured three ways:
+
+- startup: build the parser for the schema and parse an empty command line
+- per-arg: time to parse the command line minus the empty parse, divided by the number of options in it
+- help:    render the help text (getopt_long() has no help output, so it's skipped)
+
+getopt_long() tables are normally static, so its startup only builds the short option string from them.
+argp has no separate setup step, so it rebuilds its internal tables during every argp_parse() call.
+
+Built and run by `make bench-compare`, which needs glibc.
+*/
+
+#define COMPARE_ARGS 64
+#define COMPARE_WORK 4000000u
+
+/* Option ids at and above this don't have a short name */
+#define LONG_ONLY_KEY 256
+
+/* Schema in the form each parser wants it */
+struct schema {
+	const char* title;
+	size_t count;
+	struct kjc_argparse_option* kjc_options;
+	struct option* getopt_options;
+	struct argp_option* argp_options;
+	bool positional;
+	bool owns_names;
+};
+
+/* Command line parsed with each schema */
+struct cmdline {
+	int argc;
+	int options;
+	char** argv;
+};
+
+static const char* const words[] = {
+	"output", "input", "format", "file", "max", "min", "enable", "disable",
+	"log", "cache", "thread", "timeout", "retry", "color", "debug", "level",
+};
+
+#define WORD_COUNT (sizeof(words) / sizeof(words[0]))
+
+static FILE* devnull;
+static volatile long sink;
+
+
+static void schema_alloc(struct schema* schema, const char* title, size_t count) {
+	schema->title = title;
+	schema->count = count;
+	schema->kjc_options = calloc(count, sizeof(*schema->kjc_options));
+	schema->getopt_options = calloc(count + 1, sizeof(*schema->getopt_options));
+	schema->argp_options = calloc(count + 1, sizeof(*schema->argp_options));
+	schema->positional = false;
+	schema->owns_names = false;
+}
+
+/* Fill in option i of each schema representation */
+static void schema_set(struct schema* schema, size_t i, char short_name, const char* long_name, bool has_value) {
+	int key = short_name ? short_name : LONG_ONLY_KEY + (int)i;
+	
+	struct kjc_argparse_option* kopt = &schema->kjc_options[i];
+	kopt->id = key;
+	kopt->short_name = short_name;
+	kopt->type = has_value ? KJC_ARGPARSE_TYPE_STRING : KJC_ARGPARSE_TYPE_VOID;
+	kopt->long_name = long_name;
+	kopt->description = "Generated option for benchmarking";
+	kopt->var_name = has_value ? "VALUE" : NULL;
+	
+	struct option* gopt = &schema->getopt_options[i];
+	gopt->name = long_name;
+	gopt->has_arg = has_value ? required_argument : no_argument;
+	gopt->val = key;
+	
+	struct argp_option* aopt = &schema->argp_options[i];
+	aopt->name = long_name;
+	aopt->key = key;
+	aopt->arg = has_value ? "VALUE" : NULL;
+	aopt->doc = "Generated option for benchmarking";
+}
+
+static void schema_free(struct schema* schema) {
+	if(schema->owns_names) {
+		for(size_t i = 0; i < schema->count; i++) {
+			free((char*)schema->kjc_options[i].long_name);
+		}
+	}
+	free(schema->kjc_options);
+	free(schema->getopt_options);
+	free(schema->argp_options);
+}
+
+/* Options of bench_args */
+static void realistic_schema(struct schema* schema) {
+	schema_alloc(schema, "realistic", 6);
+	schema_set(schema, 0, 'v', "verbose", false);
+	schema_set(schema, 1, 'u', "base-url", true);
+	schema_set(schema, 2, 'j', "jobs", true);
+	schema_set(schema, 3, 'm', "max-bytes", true);
+	schema_set(schema, 4, 't', "timeout", true);
+	schema_set(schema, 5, 'f', "format", true);
+	schema->positional = true;
+}
+
+/* Options named from a word list, every other one taking a value, the first 26 with a short name too */
+static void synthetic_schema(struct schema* schema, const char* title, size_t count) {
+	schema_alloc(schema, title, count);
+	schema->owns_names = true;
+	for(size_t i = 0; i < count; i++) {
+		char* name = malloc(48);
+		snprintf(
+			name, 48, "%s-%s-%zu",
+			words[i % WORD_COUNT], words[(i / WORD_COUNT) % WORD_COUNT], i / (WORD_COUNT * WORD_COUNT)
+		);
+		schema_set(schema, i, i < 26 ? (char)('a' + i) : '\0', name, i % 2 == 1);
+	}
+}
+
+/* COMPARE_ARGS options spread over the schema: mostly long ones (half using "=value"), and some short ones */
+static void synthetic_cmdline(struct cmdline* cmdline, const struct schema* schema) {
+	cmdline->argv = calloc(2 * COMPARE_ARGS + 2, sizeof(char*));
+	cmdline->argv[0] = "bench";
+	cmdline->argc = 1;
+	cmdline->options = COMPARE_ARGS;
+	
+	for(unsigned k = 0; k < COMPARE_ARGS; k++) {
+		char* arg = malloc(64);
+		if(k % 4 == 3) {
+			size_t i = (k * 7) % (schema->count < 26 ? schema->count : 26);
+			const struct kjc_argparse_option* opt = &schema->kjc_options[i];
+			snprintf(arg, 64, "-%c", opt->short_name);
+			cmdline->argv[cmdline->argc++] = arg;
+			if(opt->var_name) {
+				cmdline->argv[cmdline->argc++] = "value";
+			}
+		}
+		else {
+			size_t i = (k * 2654435761u) % schema->count;
+			const struct kjc_argparse_option* opt = &schema->kjc_options[i];
+			snprintf(arg, 64, "--%s%s", opt->long_name, opt->var_name ? "=value" : "");
+			cmdline->argv[cmdline->argc++] = arg;
+		}
+	}
+	cmdline->argv[cmdline->argc] = NULL;
+}
+
+static void cmdline_free(struct cmdline* cmdline, bool synthetic) {
+	if(synthetic) {
+		/* Only the options were allocated, separate values are string literals */
+		for(int i = 1; i < cmdline->argc; i++) {
+			if(cmdline->argv[i][0] == '-') {
+				free(cmdline->argv[i]);
+			}
+		}
+		free(cmdline->argv);
+	}
+}
+
+
+/* kjc_argparse, through the pull API since the schemas are only known at runtime */
+static struct kjc_argparse_schema* kjc_build(const struct schema* schema) {
+	struct kjc_argparse_config config;
+	kjc_argparse_config_init(&config);
+	config.stream = devnull;
+	config.flags |= KJC_ARGPARSE_USE_VARNAMES;
+	if(schema->positional) {
+		config.positional_usage = "FILE...";
+	}
+	return kjc_argparse_schema_new(&config, schema->kjc_options, schema->count);
+}
+
+static long kjc_parse(const struct kjc_argparse_schema* compiled, int argc, char** argv) {
+	struct kjc_argparse ctx;
+	struct kjc_argparse_event ev;
+	long hits = 0;
+	
+	kjc_argparse_begin(&ctx, compiled, argc, argv);
+	while(kjc_argparse_next(&ctx, &ev)) {
+		hits += ev.kind == KJC_ARGPARSE_EVENT_OPTION;
+	}
+	return hits;
+}
+
+static void kjc_help(const struct kjc_argparse_schema* compiled) {
+	char arg0[] = "bench";
+	char* argv[] = {arg0, NULL};
+	struct kjc_argparse ctx;
+	
+	kjc_argparse_begin(&ctx, compiled, 1, argv);
+	kjc_argparse_help(&ctx);
+}
+
+
+/* getopt_long(), optind = 0 makes glibc fully reinitialize its state for the next parse */
+static char* getopt_build(const struct schema* schema) {
+	char* shortopts = malloc(2 * schema->count + 2);
+	size_t len = 0;
+	
+	/* Leading '+' stops at the first positional like the other parsers, instead of permuting argv */
+	shortopts[len++] = '+';
+	for(size_t i = 0; i < schema->count; i++) {
+		char short_name = schema->kjc_options[i].short_name;
+		if(short_name) {
+			shortopts[len++] = short_name;
+			if(schema->getopt_options[i].has_arg) {
+				shortopts[len++] = ':';
+			}
+		}
+	}
+	shortopts[len] = '\0';
+	return shortopts;
+}
+
+static long getopt_parse(const struct schema* schema, const char* shortopts, int argc, char** argv) {
+	long hits = 0;
+	
+	optind = 0;
+	opterr = 0;
+	while(getopt_long(argc, argv, shortopts, schema->getopt_options, NULL) != -1) {
+		hits++;
+	}
+	return hits;
+}
+
+
+/* argp */
+static error_t argp_bench_parser(int key, char* arg, struct argp_state* state) {
+	(void)arg;
+	long* hits = state->input;
+	
+	if(key == ARGP_KEY_ARG) {
+		return 0;
+	}
+	if(key < ARGP_KEY_END) {
+		++*hits;
+		return 0;
+	}
+	return ARGP_ERR_UNKNOWN;
+}
+
+static struct argp argp_build(const struct schema* schema) {
+	struct argp argp = {0};
+	argp.options = schema->argp_options;
+	argp.parser = argp_bench_parser;
+	argp.args_doc = schema->positional ? "FILE..." : NULL;
+	argp.doc = "Benchmark program";
+	return argp;
+}
+
+static long argp_run(const struct argp* argp, int argc, char** argv) {
+	long hits = 0;
+	argp_parse(argp, argc, argv, ARGP_NO_EXIT | ARGP_SILENT, NULL, &hits);
+	return hits;
+}
+
+
+/* Times to print for one parser on one schema, negative for not available */
+struct result {
+	double startup;
+	double per_arg;
+	double help;
+};
+
+static void print_result(const char* parser, const struct result* result) {
+	printf("  %-14s", parser);
+	const double values[] = {result->startup, result->per_arg, result->help};
+	for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+		if(values[i] < 0) {
+			printf(" %12s", "n/a");
+		}
+		else {
+			printf(" %9.1f ns", values[i]);
+		}
+	}
+	printf("\n");
+}
+
+static double elapsed_per(uint64_t start, unsigned long iterations) {
+	return (double)(bench_now() - start) / (double)iterations;
+}
+
+static void compare(const struct schema* schema, const struct cmdline* cmdline) {
+	char arg0[] = "bench";
+	char* empty_argv[] = {arg0, NULL};
+	unsigned long iterations = COMPARE_WORK / (schema->count + COMPARE_ARGS);
+	unsigned long help_iterations = iterations / 8 + 1;
+	long hits = 0;
+	uint64_t start;
+	
+	/* Make sure every parser actually sees every option before timing them */
+	struct kjc_argparse_schema* compiled = kjc_build(schema);
+	char* shortopts = getopt_build(schema);
+	struct argp argp = argp_build(schema);
+	long kjc_hits = kjc_parse(compiled, cmdline->argc, cmdline->argv);
+	long getopt_hits = getopt_parse(schema, shortopts, cmdline->argc, cmdline->argv);
+	long argp_hits = argp_run(&argp, cmdline->argc, cmdline->argv);
+	if(kjc_hits != cmdline->options || getopt_hits != cmdline->options || argp_hits != cmdline->options) {
+		fprintf(
+			stderr, "%s: expected %d options, kjc_argparse saw %ld, getopt_long %ld, argp %ld\n",
+			schema->title, cmdline->options, kjc_hits, getopt_hits, argp_hits
+		);
+		exit(EXIT_FAILURE);
+	}
+	
+	printf("%s (%zu options, %d on the command line)\n", schema->title, schema->count, cmdline->options);
+	printf("  %-14s %12s %12s %12s\n", "", "startup", "per-arg", "help");
+	
+	/* kjc_argparse */
+	struct result kjc;
+	start = bench_now();
+	for(unsigned long i = 0; i < iterations; i++) {
+		struct kjc_argparse_schema* compiled = kjc_build(schema);
+		hits += kjc_parse(compiled, 1, empty_argv);
+		kjc_argparse_schema_free(compiled);
+	}
+	kjc.startup = elapsed_per(start, iterations);
+	
+	start = bench_now();
+	for(unsigned long i = 0; i < iterations; i++) {
+		hits += kjc_parse(compiled, 1, empty_argv);
+	}
+	double empty = elapsed_per(start, iterations);
+	
+	start = bench_now();
+	for(unsigned long i = 0; i < iterations; i++) {
+		hits += kjc_parse(compiled, cmdline->argc, cmdline->argv);
+	}
+	kjc.per_arg = (elapsed_per(start, iterations) - empty) / cmdline->options;
+	
+	start = bench_now();
+	for(unsigned long i = 0; i < help_iterations; i++) {
+		kjc_help(compiled);
+	}
+	kjc.help = elapsed_per(start, help_iterations);
+	kjc_argparse_schema_free(compiled);
+	print_result("kjc_argparse", &kjc);
+	
+	/* getopt_long() */
+	struct result gnu = {0, 0, -1};
+	start = bench_now();
+	for(unsigned long i = 0; i < iterations; i++) {
+		char* shortopts = getopt_build(schema);
+		hits += getopt_parse(schema, shortopts, 1, empty_argv);
+		free(shortopts);
+	}
+	gnu.startup = elapsed_per(start, iterations);
+	
+	start = bench_now();
+	for(unsigned long i = 0; i < iterations; i++) {
+		hits += getopt_parse(schema, shortopts, 1, empty_argv);
+	}
+	empty = elapsed_per(start, iterations);
+	
+	start = bench_now();
+	for(unsigned long i = 0; i < iterations; i++) {
+		hits += getopt_parse(schema, shortopts, cmdline->argc, cmdline->argv);
+	}
+	gnu.per_arg = (elapsed_per(start, iterations) - empty) / cmdline->options;
+	free(shortopts);
+	print_result("getopt_long", &gnu);
+	
+	/* argp */
+	struct result argp_result;
+	start = bench_now();
+	for(unsigned long i = 0; i < iterations; i++) {
+		hits += argp_run(&argp, 1, empty_argv);
+	}
+	argp_result.startup = elapsed_per(start, iterations);
+	
+	start = bench_now();
+	for(unsigned long i = 0; i < iterations; i++) {
+		hits += argp_run(&argp, cmdline->argc, cmdline->argv);
+	}
+	argp_result.per_arg = (elapsed_per(start, iterations) - argp_result.startup) / cmdline->options;
+	
+	start = bench_now();
+	for(unsigned long i = 0; i < help_iterations; i++) {
+		argp_help(&argp, devnull, ARGP_HELP_STD_HELP, "bench");
+	}
+	argp_result.help = elapsed_per(start, help_iterations);
+	print_result("argp", &argp_result);
+	
+	printf("\n");
+	sink = hits;
+}
+
+int main(void) {
+	devnull = fopen("/dev/null", "w");
+	if(!devnull) {
+		perror("/dev/null");
+		return EXIT_FAILURE;
+	}
+	
+	struct schema schema;
+	struct cmdline cmdline;
+	
+	realistic_schema(&schema);
+	cmdline.argv = bench_argv();
+	cmdline.argc = BENCH_ARGC;
+	cmdline.options = 6;
+	compare(&schema, &cmdline);
+	cmdline_free(&cmdline, false);
+	schema_free(&schema);
+	
+	static const size_t sizes[] = {16, 128, 1024};
+	static const char* const titles[] = {"synthetic-16", "synthetic-128", "synthetic-1024"};
+	for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		synthetic_schema(&schema, titles[i], sizes[i]);
+		synthetic_cmdline(&cmdline, &schema);
+		compare(&schema, &cmdline);
+		cmdline_free(&cmdline, true);
+		schema_free(&schema);
+	}
+	
+	fclose(devnull);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+#!/bin/bash
+
+# Compile time and code size of a generated CLI with a very large number of options, built with the default
+# ARG*() expansion, with KJC_ARGPARSE_LEAN, and with the handler timing of KJC_ARGPARSE_PROFILE. Run by
+# `make bench-compile`, OPTIONS sets the number of options.
+
+script_dir="${BASH_SOURCE%/*}"
+root_dir="$script_dir/.."
+CC="${CC:-cc}"
+OPTIONS="${OPTIONS:-2000}"
+
+work_dir="$(mktemp -d)"
+trap 'rm -rf "$work_dir"' EXIT
+generated="$work_dir/generated_cli.c"
+
+# One third each of ARG, ARG_INT and ARG_STRING, all with trivial handlers
+{
+	echo '#include <stdio.h>'
+	echo '#include "kjc_argparse.h"'
+	echo
+	echo 'int main(int argc, char** argv) {'
+	echo '	long total = 0;'
+	echo '	'
+	echo '	ARGPARSE(argc, argv) {'
+	for ((i = 0; i < OPTIONS; i++)); do
+		case $((i % 3)) in
+			0) printf '\t\tARG(0, "option-%d", "Flag option %d") { total++; }\n' $i $i ;;
+			1) printf '\t\tARG_INT(0, "option-%d", "Integer option %d", value) { total += value; }\n' $i $i ;;
+			2) printf '\t\tARG_STRING(0, "option-%d", "String option %d", value) { total += value[0]; }\n' $i $i ;;
+		esac
+	done
+	echo '	}'
+	echo '	'
+	echo '	printf("%ld\n", total);'
+	echo '	return 0;'
+	echo '}'
+} > "$generated"
+
+# measure label [compiler flags...]
+measure() {
+	local label="$1"
+	shift
+
+	local seconds
+	seconds=$(
+		TIMEFORMAT=%R
+		{ time "$CC" -std=c99 -O2 -I"$root_dir" "$@" -c -o "$work_dir/cli.o" "$generated"; } 2>&1
+	) || { echo "$seconds"; exit 1; }
+
+	local text
+	text=$(size "$work_dir/cli.o" | awk 'NR == 2 { print $1 }')
+	printf '%-32s %8s s compile %9d bytes of code\n' "$label" "$seconds" "$text"
+}
+
+echo "Generated CLI with $OPTIONS options, compiled with $CC -O2"
+measure "Default expansion"
+measure "KJC_ARGPARSE_LEAN" -DKJC_ARGPARSE_LEAN
+measure "KJC_ARGPARSE_PROFILE" -DKJC_ARGPARSE_PROFILE
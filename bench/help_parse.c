@@ -0,0 +1,85 @@
+#include "bench.h"
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+Help output of a schema with thousands of options in groups, written to /dev/null. The full help message formats
+every option, while "--help=<group>" and "--help=<pattern>" only format the options they select. A pattern is looked
+up in a trigram index of the help text, which the schema builds for the first pattern and keeps for the next ones.
+*/
+
+#define HELP_OPTIONS 4096
+#define HELP_ITERATIONS 200
+
+static const char* const words[] = {
+	"output", "input", "format", "file", "max", "min", "enable", "disable",
+	"log", "cache", "thread", "timeout", "retry", "color", "debug", "level",
+};
+
+#define WORD_COUNT (sizeof(words) / sizeof(words[0]))
+
+static char names[HELP_OPTIONS][48];
+static char descriptions[HELP_OPTIONS][80];
+static struct kjc_argparse_option options[HELP_OPTIONS];
+
+static void print_help(const struct kjc_argparse_schema* schema, const char* arg) {
+	char* argv[] = {"bench", (char*)arg, NULL};
+	struct kjc_argparse ctx;
+	struct kjc_argparse_event ev;
+	
+	kjc_argparse_begin(&ctx, schema, 2, argv);
+	while(kjc_argparse_next(&ctx, &ev)) {
+		if(ev.kind == KJC_ARGPARSE_EVENT_HELP) {
+			kjc_argparse_help(&ctx);
+		}
+	}
+}
+
+static void bench_help(const struct kjc_argparse_schema* schema, const char* arg) {
+	uint64_t start = bench_now();
+	for(int i = 0; i < HELP_ITERATIONS; i++) {
+		print_help(schema, arg);
+	}
+	bench_report(arg, bench_now() - start, HELP_ITERATIONS);
+}
+
+int main(void) {
+	FILE* devnull = fopen("/dev/null", "w");
+	if(!devnull) {
+		return EXIT_FAILURE;
+	}
+	
+	struct kjc_argparse_config config;
+	kjc_argparse_config_init(&config);
+	config.stream = devnull;
+	struct kjc_argparse_builder* builder = kjc_argparse_builder_new(&config);
+	
+	/* One group for each first word, like "Cache" for all of the "--cache-*" options */
+	static char titles[WORD_COUNT][16];
+	for(size_t group = 0; group < WORD_COUNT; group++) {
+		snprintf(titles[group], sizeof(titles[group]), "%s", words[group]);
+		titles[group][0] = (char)(titles[group][0] - 'a' + 'A');
+		kjc_argparse_builder_group(builder, titles[group]);
+		
+		for(size_t i = group; i < HELP_OPTIONS; i += WORD_COUNT) {
+			const char* second = words[(i / WORD_COUNT) % WORD_COUNT];
+			const char* third = words[i / (WORD_COUNT * WORD_COUNT)];
+			snprintf(names[i], sizeof(names[i]), "%s-%s-%s", words[group], second, third);
+			snprintf(descriptions[i], sizeof(descriptions[i]), "Set the %s %s of the %s", second, third, words[group]);
+			options[i].id = (int)i;
+			options[i].type = i % 3 == 0 ? KJC_ARGPARSE_TYPE_STRING : KJC_ARGPARSE_TYPE_VOID;
+			options[i].long_name = names[i];
+			options[i].description = descriptions[i];
+			kjc_argparse_builder_add(builder, &options[i], 1);
+		}
+	}
+	struct kjc_argparse_schema* schema = kjc_argparse_builder_freeze(builder);
+	
+	bench_help(schema, "--help");
+	bench_help(schema, "--help=cache");
+	bench_help(schema, "--help=timeout-retry");
+	
+	kjc_argparse_schema_free(schema);
+	fclose(devnull);
+	return EXIT_SUCCESS;
+}
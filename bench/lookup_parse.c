@@ -0,0 +1,66 @@
+#include "bench.h"
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+Long option lookup in a large schema. The schema is compiled once through the pull API, so each iteration
+only pays for finding its options in the sorted tables. Names are built from a small word list, so many of
+them share long common prefixes the way real option sets do ("--output-format", "--output-file", ...).
+*/
+
+#define LOOKUP_OPTIONS 4096
+#define LOOKUP_ARGS 64
+#define LOOKUP_ITERATIONS 200000
+
+static const char* const words[] = {
+	"output", "input", "format", "file", "max", "min", "enable", "disable",
+	"log", "cache", "thread", "timeout", "retry", "color", "debug", "level",
+};
+
+#define WORD_COUNT (sizeof(words) / sizeof(words[0]))
+
+static char names[LOOKUP_OPTIONS][48];
+static struct kjc_argparse_option options[LOOKUP_OPTIONS];
+
+int main(void) {
+	for(int i = 0; i < LOOKUP_OPTIONS; i++) {
+		snprintf(
+			names[i], sizeof(names[i]), "%s-%s-%s",
+			words[i % WORD_COUNT], words[(i / WORD_COUNT) % WORD_COUNT], words[i / (WORD_COUNT * WORD_COUNT)]
+		);
+		options[i].id = i;
+		options[i].type = KJC_ARGPARSE_TYPE_VOID;
+		options[i].long_name = names[i];
+	}
+	
+	struct kjc_argparse_config config;
+	kjc_argparse_config_init(&config);
+	config.stream = NULL;
+	struct kjc_argparse_schema* schema = kjc_argparse_schema_new(&config, options, LOOKUP_OPTIONS);
+	
+	/* Spread the looked up options over the whole table */
+	static char storage[LOOKUP_ARGS][52];
+	char* argv[LOOKUP_ARGS + 2];
+	argv[0] = "bench";
+	for(int i = 0; i < LOOKUP_ARGS; i++) {
+		snprintf(storage[i], sizeof(storage[i]), "--%s", names[(i * 2654435761u) % LOOKUP_OPTIONS]);
+		argv[i + 1] = storage[i];
+	}
+	argv[LOOKUP_ARGS + 1] = NULL;
+	
+	struct kjc_argparse ctx;
+	struct kjc_argparse_event ev;
+	long hits = 0;
+	
+	uint64_t start = bench_now();
+	for(int i = 0; i < LOOKUP_ITERATIONS; i++) {
+		kjc_argparse_begin(&ctx, schema, LOOKUP_ARGS + 1, argv);
+		while(kjc_argparse_next(&ctx, &ev)) {
+			hits += ev.kind == KJC_ARGPARSE_EVENT_OPTION;
+		}
+	}
+	bench_report("Long lookup (4096 options)", (bench_now() - start) / LOOKUP_ARGS, LOOKUP_ITERATIONS);
+	
+	kjc_argparse_schema_free(schema);
+	return hits == (long)LOOKUP_ITERATIONS * LOOKUP_ARGS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,99 @@
+#include "bench.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "kjc_argparse.h"
+
+/*
+Baseline for bind_parse.cpp: the same options parsed with the ARGPARSE macros, where every handler
+just stores its value in a struct field.
+*/
+
+enum log_format {
+	LOG_TEXT,
+	LOG_JSON,
+};
+
+struct options {
+	bool verbose;
+	const char* base_url;
+	int job_count;
+	long max_bytes;
+	double timeout;
+	enum log_format format;
+	size_t input_count;
+};
+
+static bool parse_options(int argc, char** argv, struct options* opts) {
+	bool success = false;
+	
+	ARGPARSE(argc, argv) {
+		ARGPARSE_CONFIG_STREAM(NULL);
+		
+		ARG('v', "verbose", "Enable verbose logging") {
+			opts->verbose = true;
+		}
+		
+		ARG_STRING('u', "base-url", "Base URL for resources", url) {
+			opts->base_url = url;
+		}
+		
+		ARG_INT('j', "jobs", "Number of jobs to run in parallel", jobs) {
+			opts->job_count = jobs;
+		}
+		
+		ARG_LONG('m', "max-bytes", "Maximum number of bytes to download", bytes) {
+			opts->max_bytes = bytes;
+		}
+		
+		ARG_STRING('t', "timeout", "Seconds to wait for each request", seconds) {
+			char* end = NULL;
+			opts->timeout = strtod(seconds, &end);
+			if(*seconds == '\0' || *end != '\0') {
+				break;
+			}
+		}
+		
+		ARG_STRING('f', "format", "Log format (text or json)", format) {
+			if(strcmp(format, "text") == 0) {
+				opts->format = LOG_TEXT;
+			}
+			else if(strcmp(format, "json") == 0) {
+				opts->format = LOG_JSON;
+			}
+			else {
+				break;
+			}
+		}
+		
+		ARG_POSITIONAL("input1.json {inputN.json...}", arg) {
+			(void)arg;
+			opts->input_count++;
+		}
+		
+		ARG_END {
+			success = true;
+		}
+	}
+	
+	return success;
+}
+
+int main(void) {
+	char** argv = bench_argv();
+	int argc = BENCH_ARGC;
+	unsigned long checksum = 0;
+	
+	uint64_t start = bench_now();
+	for(unsigned long i = 0; i < BENCH_ITERATIONS; i++) {
+		struct options opts = {0};
+		if(!parse_options(argc, argv, &opts)) {
+			fprintf(stderr, "Failed to parse the benchmark arguments\n");
+			return EXIT_FAILURE;
+		}
+		checksum += (unsigned long)opts.job_count + opts.input_count;
+	}
+	bench_report("ARGPARSE macros", bench_now() - start, BENCH_ITERATIONS);
+	
+	return checksum == 10ul * BENCH_ITERATIONS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,69 @@
+#define KJC_ARGPARSE_PROFILE
+
+#include "bench.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+Cost of timing each handler with ARGPARSE_CONFIG_PROFILE(), on a long command line whose handlers do next to
+nothing. Built with KJC_ARGPARSE_PROFILE, a block without a profile only pays for two calls per handler, while
+one with a profile reads the clock twice and records each run for the trace.
+*/
+
+#define PROFILE_ARGS 4096
+#define PROFILE_ITERATIONS 500
+
+static const char* args[PROFILE_ARGS + 2];
+
+static long parse(struct kjc_argprofile* profile) {
+	long hits = 0;
+	
+	ARGPARSE(PROFILE_ARGS + 1, (char**)args) {
+		ARGPARSE_CONFIG_STREAM(NULL);
+		ARGPARSE_CONFIG_PROFILE(profile);
+		
+		ARG('v', "verbose", "Enable verbose logging") {
+			hits++;
+		}
+		
+		ARG_LONG('j', "jobs", "Number of jobs", jobs) {
+			hits += jobs > 0;
+		}
+		
+		ARG_POSITIONAL("<file>...", file) {
+			hits += file[0] != '\0';
+		}
+	}
+	
+	return hits;
+}
+
+int main(void) {
+	/* Three handler runs in every four arguments, as -j takes the next argument as its value */
+	static const char* const pattern[] = {"-v", "-j", "8", "input.txt"};
+	args[0] = "bench";
+	for(int i = 0; i < PROFILE_ARGS; i++) {
+		args[i + 1] = pattern[i % 4];
+	}
+	args[PROFILE_ARGS + 1] = NULL;
+	
+	long sink = 0;
+	uint64_t start = bench_now();
+	for(int i = 0; i < PROFILE_ITERATIONS; i++) {
+		sink += parse(NULL);
+	}
+	bench_report("Handlers without a profile", (bench_now() - start) / PROFILE_ARGS, PROFILE_ITERATIONS);
+	
+	struct kjc_argprofile profile = {0};
+	start = bench_now();
+	for(int i = 0; i < PROFILE_ITERATIONS; i++) {
+		sink += parse(&profile);
+	}
+	bench_report("Handlers with a profile", (bench_now() - start) / PROFILE_ARGS, PROFILE_ITERATIONS);
+	
+	long runs = (long)PROFILE_ARGS * 3 / 4 * PROFILE_ITERATIONS;
+	bool recorded = profile.spans_count == (size_t)runs;
+	kjc_argprofile_free(&profile);
+	return sink == runs * 2 && recorded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,134 @@
+#include "bench.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "kjc_argparse.h"
+
+/*
+The options from macro_parse.c, parsed with the pull API. The schema is compiled once up front and
+reused for every parse, so each iteration only runs the argument matching.
+*/
+
+enum {
+	OPT_VERBOSE,
+	OPT_BASE_URL,
+	OPT_JOBS,
+	OPT_MAX_BYTES,
+	OPT_TIMEOUT,
+	OPT_FORMAT,
+};
+
+enum log_format {
+	LOG_TEXT,
+	LOG_JSON,
+};
+
+struct options {
+	bool verbose;
+	const char* base_url;
+	int job_count;
+	long max_bytes;
+	double timeout;
+	enum log_format format;
+	size_t input_count;
+};
+
+static const struct kjc_argparse_option option_table[] = {
+	{OPT_VERBOSE, 'v', KJC_ARGPARSE_TYPE_VOID, "verbose", "Enable verbose logging", NULL},
+	{OPT_BASE_URL, 'u', KJC_ARGPARSE_TYPE_STRING, "base-url", "Base URL for resources", "url"},
+	{OPT_JOBS, 'j', KJC_ARGPARSE_TYPE_LONG, "jobs", "Number of jobs to run in parallel", "jobs"},
+	{OPT_MAX_BYTES, 'm', KJC_ARGPARSE_TYPE_LONG, "max-bytes", "Maximum number of bytes to download", "bytes"},
+	{OPT_TIMEOUT, 't', KJC_ARGPARSE_TYPE_STRING, "timeout", "Seconds to wait for each request", "seconds"},
+	{OPT_FORMAT, 'f', KJC_ARGPARSE_TYPE_STRING, "format", "Log format (text or json)", "format"},
+};
+
+static bool parse_options(const struct kjc_argparse_schema* schema, int argc, char** argv, struct options* opts) {
+	struct kjc_argparse ctx;
+	struct kjc_argparse_event ev;
+	
+	kjc_argparse_begin(&ctx, schema, argc, argv);
+	while(kjc_argparse_next(&ctx, &ev)) {
+		switch(ev.kind) {
+			case KJC_ARGPARSE_EVENT_OPTION:
+				switch(ev.id) {
+					case OPT_VERBOSE:
+						opts->verbose = true;
+						break;
+					
+					case OPT_BASE_URL:
+						opts->base_url = ev.value;
+						break;
+					
+					case OPT_JOBS:
+						opts->job_count = (int)ev.value_long;
+						break;
+					
+					case OPT_MAX_BYTES:
+						opts->max_bytes = ev.value_long;
+						break;
+					
+					case OPT_TIMEOUT: {
+						char* end = NULL;
+						opts->timeout = strtod(ev.value, &end);
+						if(ev.value_len == 0 || *end != '\0') {
+							return false;
+						}
+						break;
+					}
+					
+					case OPT_FORMAT:
+						if(strcmp(ev.value, "text") == 0) {
+							opts->format = LOG_TEXT;
+						}
+						else if(strcmp(ev.value, "json") == 0) {
+							opts->format = LOG_JSON;
+						}
+						else {
+							return false;
+						}
+						break;
+				}
+				break;
+			
+			case KJC_ARGPARSE_EVENT_POSITIONAL:
+				opts->input_count++;
+				break;
+			
+			case KJC_ARGPARSE_EVENT_END:
+				return true;
+			
+			default:
+				return false;
+		}
+	}
+	
+	return false;
+}
+
+int main(void) {
+	char** argv = bench_argv();
+	int argc = BENCH_ARGC;
+	unsigned long checksum = 0;
+	
+	struct kjc_argparse_config config;
+	kjc_argparse_config_init(&config);
+	config.stream = NULL;
+	config.positional_usage = "input1.json {inputN.json...}";
+	struct kjc_argparse_schema* schema = kjc_argparse_schema_new(
+		&config, option_table, sizeof(option_table) / sizeof(option_table[0])
+	);
+	
+	uint64_t start = bench_now();
+	for(unsigned long i = 0; i < BENCH_ITERATIONS; i++) {
+		struct options opts = {0};
+		if(!parse_options(schema, argc, argv, &opts)) {
+			fprintf(stderr, "Failed to parse the benchmark arguments\n");
+			return EXIT_FAILURE;
+		}
+		checksum += (unsigned long)opts.job_count + opts.input_count;
+	}
+	bench_report("kjc_argparse_next (pull API)", bench_now() - start, BENCH_ITERATIONS);
+	
+	kjc_argparse_schema_free(schema);
+	return checksum == 10ul * BENCH_ITERATIONS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
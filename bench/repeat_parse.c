@@ -0,0 +1,120 @@
+/*
+ * `make bench` also builds this as bench/repeat_parse_nocache, with KJC_BENCH_NO_HOT_CACHE defined. That compiles the
+ * parser into the program in single header mode with KJC_ARGPARSE_NO_HOT_CACHE, which turns off the cache of recently
+ * matched options, so both command lines search the tables for every option.
+ */
+#ifdef KJC_BENCH_NO_HOT_CACHE
+#define KJC_ARGPARSE_IMPLEMENTATION
+#define KJC_ARGPARSE_NO_HOT_CACHE
+#endif /* KJC_BENCH_NO_HOT_CACHE */
+
+#include "bench.h"
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+Compiler driver style command lines, where a few options like -I, -L and --define are repeated thousands of times.
+Those are found among the most recently matched options without searching the tables, so the repeated command
+line is compared with one of the same length that cycles through many different options, where every lookup
+misses and searches the tables. The schema is as big as a real compiler driver's.
+*/
+
+#define REPEAT_OPTIONS 512
+#define REPEAT_ARGS 4096
+#define REPEAT_ITERATIONS 500
+
+#ifdef KJC_BENCH_NO_HOT_CACHE
+#define BENCH_SUFFIX ", no cache"
+#else
+#define BENCH_SUFFIX ""
+#endif
+
+static const char* const words[] = {
+	"warn", "opt", "debug", "link", "include", "define", "target", "arch",
+	"profile", "sanitize", "emit", "dump", "print", "save", "load", "trace",
+};
+
+#define WORD_COUNT (sizeof(words) / sizeof(words[0]))
+
+static char names[REPEAT_OPTIONS][32];
+static struct kjc_argparse_option options[REPEAT_OPTIONS + 4];
+
+static const char* repeated_args[REPEAT_ARGS + 2];
+static const char* distinct_args[REPEAT_ARGS + 2];
+static char distinct_storage[REPEAT_ARGS][40];
+
+static long parse(const struct kjc_argparse_schema* schema, const char** argv) {
+	struct kjc_argparse ctx;
+	struct kjc_argparse_event ev;
+	long hits = 0;
+	
+	kjc_argparse_begin(&ctx, schema, REPEAT_ARGS + 1, (char**)argv);
+	while(kjc_argparse_next(&ctx, &ev)) {
+		hits += ev.kind == KJC_ARGPARSE_EVENT_OPTION;
+	}
+	
+	return hits;
+}
+
+int main(void) {
+	for(int i = 0; i < REPEAT_OPTIONS; i++) {
+		snprintf(
+			names[i], sizeof(names[i]), "%s-%s-%s",
+			words[i % WORD_COUNT], words[(i / WORD_COUNT) % WORD_COUNT], words[i / (WORD_COUNT * WORD_COUNT)]
+		);
+		options[i].id = i;
+		options[i].type = KJC_ARGPARSE_TYPE_VOID;
+		options[i].long_name = names[i];
+	}
+	
+	/* The options that get repeated */
+	const struct kjc_argparse_option repeated[] = {
+		{REPEAT_OPTIONS + 0, 'I', KJC_ARGPARSE_TYPE_STRING, "include-dir", NULL, "dir"},
+		{REPEAT_OPTIONS + 1, 'L', KJC_ARGPARSE_TYPE_STRING, "library-dir", NULL, "dir"},
+		{REPEAT_OPTIONS + 2, 'D', KJC_ARGPARSE_TYPE_STRING, "define", NULL, "macro"},
+		{REPEAT_OPTIONS + 3, 'W', KJC_ARGPARSE_TYPE_VOID, "warn-all", NULL, NULL},
+	};
+	memcpy(&options[REPEAT_OPTIONS], repeated, sizeof(repeated));
+	
+	struct kjc_argparse_config config;
+	kjc_argparse_config_init(&config);
+	config.stream = NULL;
+	struct kjc_argparse_schema* schema = kjc_argparse_schema_new(&config, options, REPEAT_OPTIONS + 4);
+	
+	/* Five options in every eight arguments, as -I and -L take the next argument as their value */
+	static const char* const pattern[] = {
+		"-I", "/usr/include", "-L", "/usr/lib", "--define=NDEBUG", "-W", "-I", "src",
+	};
+	repeated_args[0] = distinct_args[0] = "bench";
+	for(int i = 0; i < REPEAT_ARGS; i++) {
+		repeated_args[i + 1] = pattern[i % 8];
+		
+		/* Every argument of the other command line is an option, spread over the whole table */
+		const char* name = names[(i * 2654435761u) % REPEAT_OPTIONS];
+		snprintf(distinct_storage[i], sizeof(distinct_storage[i]), "--%s", name);
+		distinct_args[i + 1] = distinct_storage[i];
+	}
+	repeated_args[REPEAT_ARGS + 1] = distinct_args[REPEAT_ARGS + 1] = NULL;
+	
+	long expected_repeated = (long)REPEAT_ARGS * 5 / 8;
+	if(parse(schema, repeated_args) != expected_repeated || parse(schema, distinct_args) != REPEAT_ARGS) {
+		fprintf(stderr, "Wrong number of options parsed\n");
+		return EXIT_FAILURE;
+	}
+	
+	long sink = 0;
+	uint64_t start = bench_now();
+	for(int i = 0; i < REPEAT_ITERATIONS; i++) {
+		sink += parse(schema, repeated_args);
+	}
+	bench_report("Repeated options (-I, -L, -D, -W)" BENCH_SUFFIX, (bench_now() - start) / REPEAT_ARGS, REPEAT_ITERATIONS);
+	
+	start = bench_now();
+	for(int i = 0; i < REPEAT_ITERATIONS; i++) {
+		sink += parse(schema, distinct_args);
+	}
+	bench_report("Distinct options (516 options)" BENCH_SUFFIX, (bench_now() - start) / REPEAT_ARGS, REPEAT_ITERATIONS);
+	
+	kjc_argparse_schema_free(schema);
+	return sink == (expected_repeated + REPEAT_ARGS) * REPEAT_ITERATIONS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+/*
+ * `make bench` also builds this with KJC_BENCH_SHARED defined, calling into libkjc_argparse.so instead, and with
+ * KJC_BENCH_FIXED defined, which fixes the configuration flags at compile time with KJC_ARGPARSE_FIXED_FLAGS
+ */
+#ifndef KJC_BENCH_SHARED
+#define KJC_ARGPARSE_IMPLEMENTATION
+#endif /* KJC_BENCH_SHARED */
+#ifdef KJC_BENCH_FIXED
+#define KJC_ARGPARSE_FIXED_FLAGS
+#endif /* KJC_BENCH_FIXED */
+
+#include "bench.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "kjc_argparse.h"
+
+/*
+Same options and handlers as macro_parse.c, comparing the single header mode (where the parser is compiled
+into this program and can be inlined into parse_options()) with calls into the shared library. With fixed flags,
+the branches on the configuration flags are compiled out as well.
+*/
+
+#if defined(KJC_BENCH_SHARED)
+#define BENCH_NAME "ARGPARSE shared library"
+#elif defined(KJC_BENCH_FIXED)
+#define BENCH_NAME "ARGPARSE single header, fixed flags"
+#else
+#define BENCH_NAME "ARGPARSE single header"
+#endif
+
+enum log_format {
+	LOG_TEXT,
+	LOG_JSON,
+};
+
+struct options {
+	bool verbose;
+	const char* base_url;
+	int job_count;
+	long max_bytes;
+	double timeout;
+	enum log_format format;
+	size_t input_count;
+};
+
+static bool parse_options(int argc, char** argv, struct options* opts) {
+	bool success = false;
+	
+	ARGPARSE(argc, argv) {
+		ARGPARSE_CONFIG_STREAM(NULL);
+		
+		ARG('v', "verbose", "Enable verbose logging") {
+			opts->verbose = true;
+		}
+		
+		ARG_STRING('u', "base-url", "Base URL for resources", url) {
+			opts->base_url = url;
+		}
+		
+		ARG_INT('j', "jobs", "Number of jobs to run in parallel", jobs) {
+			opts->job_count = jobs;
+		}
+		
+		ARG_LONG('m', "max-bytes", "Maximum number of bytes to download", bytes) {
+			opts->max_bytes = bytes;
+		}
+		
+		ARG_STRING('t', "timeout", "Seconds to wait for each request", seconds) {
+			char* end = NULL;
+			opts->timeout = strtod(seconds, &end);
+			if(*seconds == '\0' || *end != '\0') {
+				break;
+			}
+		}
+		
+		ARG_STRING('f', "format", "Log format (text or json)", format) {
+			if(strcmp(format, "text") == 0) {
+				opts->format = LOG_TEXT;
+			}
+			else if(strcmp(format, "json") == 0) {
+				opts->format = LOG_JSON;
+			}
+			else {
+				break;
+			}
+		}
+		
+		ARG_POSITIONAL("input1.json {inputN.json...}", arg) {
+			(void)arg;
+			opts->input_count++;
+		}
+		
+		ARG_END {
+			success = true;
+		}
+	}
+	
+	return success;
+}
+
+int main(void) {
+	char** argv = bench_argv();
+	int argc = BENCH_ARGC;
+	unsigned long checksum = 0;
+	
+	uint64_t start = bench_now();
+	for(unsigned long i = 0; i < BENCH_ITERATIONS; i++) {
+		struct options opts = {0};
+		if(!parse_options(argc, argv, &opts)) {
+			fprintf(stderr, "Failed to parse the benchmark arguments\n");
+			return EXIT_FAILURE;
+		}
+		checksum += (unsigned long)opts.job_count + opts.input_count;
+	}
+	bench_report(BENCH_NAME, bench_now() - start, BENCH_ITERATIONS);
+	
+	return checksum == 10ul * BENCH_ITERATIONS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,88 @@
+#include "bench.h"
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+Startup cost of an ARGPARSE block with a large number of ARG() sites, where the command line only uses
+one or two of them. Nearly all of the time goes into registering the options and building the lookup tables.
+With no arguments or a single one, the tables aren't sorted, and the argument is compared with each option instead.
+The names still go into a hash table, to catch duplicates.
+The same options in a KJC_ARGPARSE_STATIC_SCHEMA() skip all of that, as the compiler already built the tables.
+*/
+
+#define STARTUP_ITERATIONS 20000
+
+/* Generates 4^4 = 256 options, named "option-10000" through "option-13333" */
+#define OPT(n) ARG(0, "option-" #n, "Generated option " #n) { hits++; }
+#define OPT4(n) OPT(n##0) OPT(n##1) OPT(n##2) OPT(n##3)
+#define OPT16(n) OPT4(n##0) OPT4(n##1) OPT4(n##2) OPT4(n##3)
+#define OPT64(n) OPT16(n##0) OPT16(n##1) OPT16(n##2) OPT16(n##3)
+#define OPT256(n) OPT64(n##0) OPT64(n##1) OPT64(n##2) OPT64(n##3)
+
+/* The same options as an X-macro list, which comes out sorted as the names only differ in their digits */
+#define STATIC_OPT(X, n) X(OPT_##n, 0, VOID, "option-" #n, "Generated option " #n, "")
+#define STATIC_OPT4(X, n) STATIC_OPT(X, n##0) STATIC_OPT(X, n##1) STATIC_OPT(X, n##2) STATIC_OPT(X, n##3)
+#define STATIC_OPT16(X, n) STATIC_OPT4(X, n##0) STATIC_OPT4(X, n##1) STATIC_OPT4(X, n##2) STATIC_OPT4(X, n##3)
+#define STATIC_OPT64(X, n) STATIC_OPT16(X, n##0) STATIC_OPT16(X, n##1) STATIC_OPT16(X, n##2) STATIC_OPT16(X, n##3)
+#define STATIC_OPTIONS(X) STATIC_OPT64(X, 10) STATIC_OPT64(X, 11) STATIC_OPT64(X, 12) STATIC_OPT64(X, 13)
+
+KJC_ARGPARSE_STATIC_SCHEMA(static_schema, STATIC_OPTIONS, NULL, KJC_ARGPARSE_DEFAULT_FLAGS)
+
+static int parse_many(int argc, char** argv) {
+	int hits = 0;
+	
+	ARGPARSE(argc, argv) {
+		ARGPARSE_CONFIG_STREAM(NULL);
+		
+		OPT256(1)
+	}
+	
+	return hits;
+}
+
+static int parse_static(int argc, char** argv) {
+	struct kjc_argparse ctx;
+	struct kjc_argparse_event ev;
+	int hits = 0;
+	
+	kjc_argparse_begin(&ctx, static_schema(), argc, argv);
+	while(kjc_argparse_next(&ctx, &ev)) {
+		hits += ev.kind == KJC_ARGPARSE_EVENT_OPTION && ev.id == OPT_12321;
+	}
+	
+	return hits;
+}
+
+int main(void) {
+	char arg0[] = "bench";
+	char arg1[] = "--option-12321";
+	char arg2[] = "--option-10000";
+	char* argv[] = {arg0, arg1, arg2, NULL};
+	long hits = 0;
+	
+	uint64_t start = bench_now();
+	for(int i = 0; i < STARTUP_ITERATIONS; i++) {
+		hits += parse_many(1, argv);
+	}
+	bench_report("ARGPARSE startup, no arguments", bench_now() - start, STARTUP_ITERATIONS);
+	
+	start = bench_now();
+	for(int i = 0; i < STARTUP_ITERATIONS; i++) {
+		hits += parse_many(2, argv);
+	}
+	bench_report("ARGPARSE startup, one argument", bench_now() - start, STARTUP_ITERATIONS);
+	
+	start = bench_now();
+	for(int i = 0; i < STARTUP_ITERATIONS; i++) {
+		hits += parse_many(3, argv) - 1;
+	}
+	bench_report("ARGPARSE startup, two arguments", bench_now() - start, STARTUP_ITERATIONS);
+	
+	start = bench_now();
+	for(int i = 0; i < STARTUP_ITERATIONS; i++) {
+		hits += parse_static(2, argv);
+	}
+	bench_report("Static schema startup (256 options)", bench_now() - start, STARTUP_ITERATIONS);
+	
+	return hits == STARTUP_ITERATIONS * 3 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+Meant to be run like "find . -name '*.json' | xargs batch_example", where there may be many thousands of
+file names. ARG_POSITIONAL_BATCH gets each run of consecutive file names in one call instead of one call
+per file, and everything after "--" arrives as a single run without being looked at.
+*/
+
+int main(int argc, char** argv) {
+	bool verbose = false;
+	int total = 0;
+	
+	ARGPARSE(argc, argv) {
+		ARG('v', "verbose", "List every file in each batch") {
+			verbose = true;
+		}
+		
+		ARG_COMMAND("stats", "Print statistics and stop") {
+			printf("Got %d file(s) so far\n", total);
+			break;
+		}
+		
+		ARG_POSITIONAL_BATCH("file...", files) {
+			printf("Batch of %d file(s) starting at argument %d\n", files.count, (int)(files.args - argv));
+			if(verbose) {
+				for(int i = 0; i < files.count; i++) {
+					printf("  \"%s\"\n", files.args[i]);
+				}
+			}
+			
+			total += files.count;
+		}
+		
+		ARG_END {
+			printf("%d file(s) in total\n", total);
+		}
+	}
+	
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+#include "kjc_argparse.hpp"
+
+/*
+Options bound directly to the members of a struct. There are no handlers at all: the type of each
+member decides how its option's value is parsed, and parse_into() assigns it.
+*/
+
+enum class log_format {
+	text,
+	json,
+};
+
+struct options {
+	bool verbose = false;
+	std::string_view base_url{};
+	int job_count = 1;
+	long max_bytes = 0;
+	double timeout = 30.0;
+	log_format format = log_format::text;
+};
+
+static constexpr kjc::enum_name<log_format> log_formats[] = {
+	{"text", log_format::text},
+	{"json", log_format::json},
+};
+
+static constexpr kjc::config make_config() {
+	kjc::config cfg;
+	cfg.positional_usage = "input1.json {inputN.json...}";
+	return cfg;
+}
+
+static constexpr auto binding = kjc::make_binding(
+	make_config(),
+	kjc::bind('v', "verbose", "Enable verbose logging", &options::verbose),
+	kjc::bind('u', "base-url", "Base URL for resources", "url", &options::base_url),
+	kjc::bind('j', "jobs", "Number of jobs to run in parallel", "jobs", &options::job_count),
+	kjc::bind('m', "max-bytes", "Maximum number of bytes to download", "bytes", &options::max_bytes),
+	kjc::bind('t', "timeout", "Seconds to wait for each request", "seconds", &options::timeout),
+	kjc::bind('f', "format", "Log format (text or json)", "format", &options::format, log_formats)
+);
+
+int main(int argc, char** argv) {
+	options opts;
+	const char* json_inputs[10] = {0};
+	size_t json_count = 0;
+	bool too_many = false;
+	
+	kjc::parse_result result = kjc::parse_into(binding, opts, argc, argv, [&](std::string_view arg) {
+		if(json_count >= sizeof(json_inputs) / sizeof(json_inputs[0])) {
+			too_many = true;
+			return;
+		}
+		
+		/* Positional arguments come straight from argv, so they are NUL-terminated */
+		json_inputs[json_count++] = arg.data();
+	});
+	
+	if(result == kjc::parse_result::help) {
+		return EXIT_SUCCESS;
+	}
+	if(result == kjc::parse_result::error) {
+		return EXIT_FAILURE;
+	}
+	if(too_many) {
+		printf("Too many JSON files!\n");
+		return EXIT_FAILURE;
+	}
+	
+	printf("verbose: %s\n", opts.verbose ? "true" : "false");
+	printf("base_url: %.*s\n", (int)opts.base_url.size(), opts.base_url.data());
+	printf("job_count: %d\n", opts.job_count);
+	printf("max_bytes: %ld\n", opts.max_bytes);
+	printf("timeout: %g\n", opts.timeout);
+	printf("format: %s\n", opts.format == log_format::json ? "json" : "text");
+	for(size_t i = 0; i < json_count; i++) {
+		printf("input: %s\n", json_inputs[i]);
+	}
+	
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+ARG_CHOICE takes an array of names and passes the handler the index of the one that was given, so there's no
+chain of strcmp() calls in the handler. Invalid values are rejected with the list of valid choices, which are
+also listed in the help output.
+*/
+
+enum mode {
+	MODE_FAST,
+	MODE_SAFE,
+	MODE_PARANOID,
+};
+
+static const char* const modes[] = {"fast", "safe", "paranoid"};
+
+static const char* const regions[] = {
+	"us-east-1", "us-east-2", "us-west-1", "us-west-2", "ca-central-1", "ca-west-1", "sa-east-1", "mx-central-1",
+	"eu-central-1", "eu-central-2", "eu-west-1", "eu-west-2", "eu-west-3", "eu-south-1", "eu-south-2",
+	"eu-north-1", "il-central-1", "me-south-1", "me-central-1", "af-south-1", "ap-east-1", "ap-south-1",
+	"ap-south-2", "ap-northeast-1", "ap-northeast-2", "ap-northeast-3", "ap-southeast-1", "ap-southeast-2",
+	"ap-southeast-3", "ap-southeast-4", "ap-southeast-5", "ap-southeast-7",
+};
+
+int main(int argc, char** argv) {
+	enum mode mode = MODE_SAFE;
+	int region = 0;
+	
+	ARGPARSE(argc, argv) {
+		ARG_CHOICE('m', "mode", "How carefully to deploy", modes, choice) {
+			mode = (enum mode)choice;
+		}
+		
+		ARG_CHOICE('r', "region", "Region to deploy to", regions, choice) {
+			region = choice;
+		}
+		
+		ARG_END {
+			printf("Deploying to %s", regions[region]);
+			switch(mode) {
+				case MODE_FAST:
+					printf(" without any checks\n");
+					break;
+				
+				case MODE_SAFE:
+					printf(" after running the tests\n");
+					break;
+				
+				case MODE_PARANOID:
+					printf(" after running the tests, with a canary\n");
+					break;
+			}
+		}
+	}
+	
+	return 0;
+}
@@ -1,3 +1,6 @@
+/* Built in single header mode, so this program has its own copy of the parser */
+#define KJC_ARGPARSE_IMPLEMENTATION
+
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -0,0 +1,114 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+#include "kjc_argparse.hpp"
+
+/*
+Pulls parsed options one at a time from the kjc::events() coroutine (needs C++20). Work on each
+--input file starts as soon as its option is parsed, before the rest of argv has been looked at, so
+a mistake later on the command line only stops the inputs that come after it.
+*/
+
+enum {
+	OPT_INPUT,
+	OPT_JOBS,
+	OPT_VERBOSE,
+	OPT_CONVERT,
+};
+
+static constexpr kjc::config make_config() {
+	kjc::config cfg;
+	cfg.positional_usage = "[input...]";
+	return cfg;
+}
+
+static constexpr auto schema = kjc::make_schema(
+	make_config(),
+	kjc::arg_string(OPT_INPUT, 'i', "input", "Start processing this file right away", "file"),
+	kjc::arg_int(OPT_JOBS, 'j', "jobs", "Number of jobs for the inputs after this option", "jobs"),
+	kjc::arg(OPT_VERBOSE, 'v', "verbose", "Enable verbose logging"),
+	kjc::arg_command(OPT_CONVERT, "convert", "Convert the inputs to another format")
+);
+
+static constexpr auto convert_schema = kjc::make_schema(
+	kjc::arg_string(0, 'f', "format", "Output format", "format")
+);
+
+static void start_work(std::string_view input, int jobs) {
+	printf("Started %.*s with %d job(s)\n", (int)input.size(), input.data(), jobs);
+}
+
+int main(int argc, char** argv) {
+	int jobs = 1;
+	bool verbose = false;
+	int started = 0;
+	
+	kjc::parser p(schema, argc, argv);
+	for(const kjc::event& ev : kjc::events(p)) {
+		if(verbose) {
+			printf("Event for argument %d\n", ev.index);
+		}
+		
+		switch(ev.kind) {
+			case kjc::event_kind::option:
+				switch(ev.id) {
+					case OPT_INPUT:
+						start_work(ev.value, jobs);
+						started++;
+						break;
+					
+					case OPT_JOBS:
+						jobs = (int)ev.integer;
+						break;
+					
+					case OPT_VERBOSE:
+						verbose = true;
+						break;
+				}
+				break;
+			
+			case kjc::event_kind::positional:
+				start_work(ev.value, jobs);
+				started++;
+				break;
+			
+			case kjc::event_kind::command: {
+				/* The subcommand gets its own parser, which continues right after the command's name */
+				kjc::parser sub(convert_schema, p);
+				for(const kjc::event& sub_ev : kjc::events(sub)) {
+					if(sub_ev.kind == kjc::event_kind::option) {
+						printf("Converting %d input(s) to %.*s\n", started,
+							(int)sub_ev.value.size(), sub_ev.value.data()
+						);
+					}
+					else if(sub_ev.kind == kjc::event_kind::help) {
+						sub.help();
+						return EXIT_SUCCESS;
+					}
+					else if(sub_ev.kind == kjc::event_kind::error) {
+						sub.print_error(sub_ev);
+						return EXIT_FAILURE;
+					}
+				}
+				break;
+			}
+			
+			case kjc::event_kind::help:
+				p.help();
+				return EXIT_SUCCESS;
+			
+			case kjc::event_kind::error:
+				p.print_error(ev);
+				printf("Stopped after starting %d input(s)\n", started);
+				return EXIT_FAILURE;
+			
+			case kjc::event_kind::other:
+			case kjc::event_kind::end:
+				break;
+		}
+	}
+	
+	printf("Started %d input(s) in total\n", started);
+	return EXIT_SUCCESS;
+}
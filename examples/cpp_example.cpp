@@ -0,0 +1,149 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+#include "kjc_argparse.hpp"
+
+/*
+C++ port of full_example.c using the header-only kjc_argparse.hpp front end. It accepts exactly the
+same arguments and produces the same output, but the option tables are all built at compile time.
+*/
+
+enum {
+	OPT_USAGE,
+	OPT_TEST,
+	OPT_HELLO,
+	OPT_HELLO_CAPS,
+	OPT_FLAG,
+	OPT_ONCE,
+	OPT_INT,
+	OPT_NAME,
+	OPT_LONG,
+};
+
+static constexpr kjc::config make_config() {
+	kjc::config cfg;
+	cfg.use_varnames = true;
+	cfg.type_hints = true;
+	cfg.description_column = 35;
+	cfg.indent = 4;
+	cfg.positional_usage = "[extra args...]";
+	cfg.catchall = true;
+	return cfg;
+}
+
+// Every option is checked at compile time: declaring "--flag" twice would fail to compile
+static constexpr auto schema = kjc::make_schema(
+	make_config(),
+	kjc::arg(OPT_USAGE, 0, "usage", kjc::none),
+	kjc::arg(OPT_TEST, 't', "test", "This is a test lol"),
+	kjc::arg(OPT_HELLO, 0, "hello", "Say hello!"),
+	kjc::arg(OPT_HELLO_CAPS, 'H', kjc::none, "Hello but in caps"),
+	kjc::arg(OPT_FLAG, 'f', "flag", "Turns this flag on"),
+	kjc::arg(OPT_ONCE, 'o', "once", "This flag may only be set once"),
+	kjc::arg_int(OPT_INT, 'i', "int-argument", "This argument expects an integer value", "NUMBER"),
+	kjc::arg_string(OPT_NAME, 'n', "set-name", "This argument expects a string value", "NAME"),
+	kjc::arg(OPT_LONG, 'l', "long-like-really-extremely-long-argument", "This argument is really long")
+);
+
+int main(int argc, char** argv) {
+	bool flag = false, once = false;
+	int ret = EXIT_FAILURE;
+	
+	kjc::parser p(schema, argc, argv);
+	for(kjc::event ev; p.next(ev); ) {
+		bool stop = false;
+		
+		switch(ev.kind) {
+			case kjc::event_kind::option:
+				switch(ev.id) {
+					case OPT_USAGE:
+						p.help();
+						stop = true;
+						break;
+					
+					case OPT_TEST:
+						printf("Test:");
+						for(int i = 1; i <= 10; i++) {
+							printf(" %d", i);
+						}
+						printf("\n");
+						break;
+					
+					case OPT_HELLO:
+						printf("Hello!\n");
+						break;
+					
+					case OPT_HELLO_CAPS:
+						printf("HELLO\n");
+						break;
+					
+					case OPT_FLAG:
+						flag = true;
+						break;
+					
+					case OPT_ONCE:
+						if(once) {
+							printf("Flag --once given multiple times!\n");
+							ret = -1;
+							stop = true;
+							break;
+						}
+						once = true;
+						break;
+					
+					case OPT_INT:
+						printf("--int-argument %d\n", (int)ev.integer);
+						break;
+					
+					case OPT_NAME:
+						printf("--set-name %.*s\n", (int)ev.value.size(), ev.value.data());
+						if(ev.value == "@ADMIN") {
+							printf("Error: Illegal to set name to @ADMIN!\n");
+							stop = true;
+						}
+						break;
+				}
+				break;
+			
+			case kjc::event_kind::positional:
+				printf("ARG_POSITIONAL: %.*s\n", (int)ev.value.size(), ev.value.data());
+				break;
+			
+			case kjc::event_kind::other:
+				printf("ARG_OTHER: %.*s\n", (int)ev.value.size(), ev.value.data());
+				printf("Index: %d\n", p.index());
+				ret = -1;
+				stop = true;
+				break;
+			
+			case kjc::event_kind::help:
+				p.help();
+				stop = true;
+				break;
+			
+			case kjc::event_kind::error:
+				p.print_error(ev);
+				break;
+			
+			case kjc::event_kind::end:
+				printf("All done with argument parsing!\n");
+				if(!flag) {
+					printf("ERROR: --flag is required!\n");
+					p.help();
+					exit(EXIT_FAILURE);
+				}
+				ret = 0;
+				break;
+			
+			case kjc::event_kind::command:
+				break;
+		}
+		
+		if(stop) {
+			break;
+		}
+	}
+	
+	return ret;
+}
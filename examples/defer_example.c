@@ -0,0 +1,112 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "kjc_argparse.h"
+
+/*
+Slow work like resolving host names doesn't have to hold up argument parsing. The --resolve handler
+only queues a lookup with ARGPARSE_DEFER(), and all lookups run in parallel once the arguments have
+been parsed. Migrations have to be applied in order, so they're queued with ARGPARSE_DEFER_ORDERED()
+in a group of their own. ARG_END runs after everything queued has finished.
+*/
+
+#define MAX_JOBS 16
+
+struct lookup {
+	const char* host;
+	const char* address;
+	char error[64];
+};
+
+struct migration {
+	const char* name;
+	int* applied;
+};
+
+static const char* const known_hosts[][2] = {
+	{"localhost", "127.0.0.1"},
+	{"example.com", "93.184.215.14"},
+	{"router", "192.168.1.1"},
+};
+
+static void pretend_to_work(int ms) {
+	struct timespec ts = {0, ms * 1000000L};
+	nanosleep(&ts, NULL);
+}
+
+static const char* resolve(void* arg) {
+	struct lookup* lookup = arg;
+	
+	/* Finish in the opposite order from the command line, to show that errors are still reported in order */
+	pretend_to_work(40 - 10 * (int)(strlen(lookup->host) % 4));
+	
+	for(size_t i = 0; i < sizeof(known_hosts) / sizeof(known_hosts[0]); i++) {
+		if(strcmp(known_hosts[i][0], lookup->host) == 0) {
+			lookup->address = known_hosts[i][1];
+			return NULL;
+		}
+	}
+	
+	snprintf(lookup->error, sizeof(lookup->error), "Can't resolve \"%s\"", lookup->host);
+	return lookup->error;
+}
+
+static const char* migrate(void* arg) {
+	struct migration* migration = arg;
+	
+	pretend_to_work(5);
+	if(strcmp(migration->name, "broken") == 0) {
+		return "Migration \"broken\" failed";
+	}
+	
+	printf("Applied migration %s\n", migration->name);
+	++*migration->applied;
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	static struct lookup lookups[MAX_JOBS];
+	static struct migration migrations[MAX_JOBS];
+	int lookup_count = 0, migration_count = 0, applied = 0;
+	bool parse_success = false;
+	
+	ARGPARSE(argc, argv) {
+		ARGPARSE_CONFIG_THREADS(4);
+		
+		ARG_STRING('r', "resolve", "Resolve this host name", host) {
+			if(lookup_count >= MAX_JOBS) {
+				printf("Too many hosts!\n");
+				break;
+			}
+			
+			struct lookup* lookup = &lookups[lookup_count++];
+			lookup->host = host;
+			ARGPARSE_DEFER(resolve, lookup);
+		}
+		
+		ARG_STRING('m', "migrate", "Apply this migration, in order", name) {
+			if(migration_count >= MAX_JOBS) {
+				printf("Too many migrations!\n");
+				break;
+			}
+			
+			struct migration* migration = &migrations[migration_count++];
+			migration->name = name;
+			migration->applied = &applied;
+			ARGPARSE_DEFER_ORDERED(1, migrate, migration);
+		}
+		
+		ARG_END {
+			for(int i = 0; i < lookup_count; i++) {
+				printf("%s is %s\n", lookups[i].host, lookups[i].address);
+			}
+			printf("Applied %d migration(s)\n", applied);
+			parse_success = true;
+		}
+	}
+	
+	return parse_success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
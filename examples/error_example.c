@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+Reports parse errors itself instead of letting argparse print them, like a server that parses commands sent by
+its clients would. ARG_ERROR and ARG_OTHER get the error as a struct kjc_argerror, and the message is only
+formatted when it's actually wanted.
+*/
+
+int main(int argc, char** argv) {
+	bool quiet = false;
+	int jobs = 1;
+	int status = EXIT_SUCCESS;
+	
+	ARGPARSE(argc, argv) {
+		ARGPARSE_REQUIRE("output");
+		ARGPARSE_EXCLUSIVE("verbosity", "quiet", "verbose");
+		
+		ARG('q', "quiet", "Only print the error code when arguments are invalid") {
+			quiet = true;
+		}
+		
+		ARG('v', "verbose", "Print each step of the work") {
+			printf("Verbose output enabled\n");
+		}
+		
+		ARG_INT('j', "jobs", "Number of jobs to run at once", count) {
+			jobs = count;
+		}
+		
+		ARG_STRING('o', "output", "File to write the results to", path) {
+			printf("Writing results to %s\n", path);
+		}
+		
+		ARG_OTHER(arg) {
+			/* Unknown arguments aren't fatal, the error says what was wrong with them */
+			const struct kjc_argerror* error = ARGPARSE_ERROR();
+			printf("Ignoring \"%s\": error %d at offset %d\n", arg, error->code, error->offset);
+		}
+		
+		ARG_ERROR(error) {
+			if(quiet) {
+				printf("Failed with error %d\n", error->code);
+			}
+			else {
+				char message[256];
+				ARGPARSE_FORMAT_ERROR(message, sizeof(message));
+				fprintf(stderr, "[argument %d, offset %d] %s", error->index, error->offset, message);
+			}
+			
+			status = EXIT_FAILURE;
+		}
+		
+		ARG_END {
+			printf("Running %d job(s)\n", jobs);
+		}
+	}
+	
+	return status;
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+Options like --verbose and --config that apply to the whole program are wrapped in ARG_GLOBAL once, at the root.
+They're then also accepted after any subcommand, however deeply nested, and their handlers run before the
+subcommand's handler does. The subcommands don't have to declare them again, and the help output of every command
+lists them once under "Global options". A global option right after one of a subcommand's own options, like the "-v"
+in "commit -m -v", may be that option's value, so it's left to the subcommand: there it's the commit message.
+*/
+
+static bool verbose = false;
+static bool quiet = false;
+static const char* config = "~/.vcsrc";
+
+static void report(const char* what) {
+	if(!quiet) {
+		printf("%s (config %s%s)\n", what, config, verbose ? ", verbose" : "");
+	}
+}
+
+static void remote_add(struct kjc_argparse* context) {
+	const char* name = NULL;
+	const char* url = NULL;
+	
+	ARGPARSE_RESUME(context) {
+		ARG(0, "fetch", "Fetch from the remote after adding it") {
+			report("Fetching after adding");
+		}
+		
+		ARG_POSITIONAL("<name> <url>", arg) {
+			if(!name) {
+				name = arg;
+			}
+			else {
+				url = arg;
+			}
+		}
+		
+		ARG_END {
+			printf("Adding remote %s at %s\n", name ? name : "(none)", url ? url : "(none)");
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	argv[0] = "vcs";
+	
+	ARGPARSE(argc, argv) {
+		ARG_GLOBAL(ARG('v', "verbose", "Print what's happening")) {
+			verbose = true;
+		}
+		
+		ARG_GLOBAL(ARG('q', "quiet", "Don't print anything")) {
+			quiet = true;
+		}
+		
+		ARG_GLOBAL(ARG_STRING('C', "config", "Configuration file to use", path)) {
+			config = path;
+		}
+		
+		ARG_COMMAND("status", "Show the working tree status") {
+			ARGPARSE_NESTED {
+				ARG('s', "short", "Give the output in the short format") {
+					report("Short format");
+				}
+				
+				ARG_POSITIONAL("[<path>...]", path) {
+					printf("Status of %s\n", path);
+				}
+				
+				ARG_END {
+					report("Showed the status");
+				}
+			}
+			break;
+		}
+		
+		ARG_COMMAND("commit", "Record changes to the repository") {
+			ARGPARSE_NESTED {
+				ARG_STRING('m', "message", "Use this as the commit message", message) {
+					printf("Message: %s\n", message);
+				}
+				
+				ARG(0, "amend", "Replace the last commit") {
+					report("Amending");
+				}
+				
+				ARG_END {
+					report("Committed");
+				}
+			}
+			break;
+		}
+		
+		ARG_COMMAND("remote", "Manage tracked repositories") {
+			ARGPARSE_NESTED {
+				ARG_COMMAND("add", "Add a remote") {
+					remote_add(ARGPARSE_GET_CONTEXT());
+					break;
+				}
+				
+				ARG_END {
+					report("Listed the remotes");
+				}
+			}
+			break;
+		}
+		
+		ARG_END {
+			ARGPARSE_HELP();
+		}
+	}
+	
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+A compiler driver whose options are split into groups with ARGPARSE_GROUP(), each listed under its own heading in the
+help output. Programs like this have too many options to read through, so "--help=<group>" only lists one group, like
+"--help=warnings", and "--help=<pattern>" only lists the options whose name or description contains the pattern, like
+"--help=debug". Matching ignores case.
+*/
+
+int main(int argc, char** argv) {
+	const char* output = "a.out";
+	long level = 0;
+	bool verbose = false;
+	
+	argv[0] = "cc";
+	
+	ARGPARSE(argc, argv) {
+		ARG_GLOBAL(ARG('v', "verbose", "Print the commands that are run")) {
+			verbose = true;
+		}
+		
+		ARG_STRING('o', "output", "Write the output to this file", path) {
+			output = path;
+		}
+		
+		ARG('c', "compile-only", "Compile and assemble, but don't link") {
+			printf("Not linking\n");
+		}
+		
+		ARGPARSE_GROUP("Optimization");
+		
+		ARG_LONG('O', "optimize", "Optimization level, from 0 to 3", n) {
+			level = n;
+		}
+		
+		ARG(0, "inline-functions", "Inline functions that aren't declared inline") {
+			printf("Inlining functions\n");
+		}
+		
+		ARG(0, "unroll-loops", "Unroll loops whose number of iterations is known") {
+			printf("Unrolling loops\n");
+		}
+		
+		ARGPARSE_GROUP("Warnings");
+		
+		ARG(0, "warn-all", "Enable the warnings about questionable code") {
+			printf("Warning about everything\n");
+		}
+		
+		ARG(0, "warn-error", "Turn all warnings into errors") {
+			printf("Warnings are errors\n");
+		}
+		
+		ARG(0, "warn-shadow", "Warn when a variable shadows another one") {
+			printf("Warning about shadowing\n");
+		}
+		
+		ARGPARSE_GROUP("Debugging");
+		
+		ARG('g', "debug-info", "Produce debugging information") {
+			printf("Producing debug info\n");
+		}
+		
+		ARG(0, "sanitize-address", "Detect memory errors at runtime, a debugging aid") {
+			printf("Sanitizing addresses\n");
+		}
+		
+		/* Options after ARGPARSE_GROUP(NULL) go back to the "Options" heading */
+		ARGPARSE_GROUP(NULL);
+		
+		ARG_STRING('I', "include-dir", "Add a directory to the header search path", dir) {
+			printf("Searching %s for headers\n", dir);
+		}
+		
+		ARG_COMMAND("preprocess", "Only run the preprocessor") {
+			ARGPARSE_NESTED {
+				ARG('P', "no-line-markers", "Don't write line markers") {
+					printf("No line markers\n");
+				}
+				
+				ARG_POSITIONAL("<file>", file) {
+					printf("Preprocessing %s\n", file);
+				}
+			}
+			break;
+		}
+		
+		ARG_POSITIONAL("<file>...", file) {
+			printf("Compiling %s\n", file);
+		}
+		
+		ARG_END {
+			printf("Output %s at -O%ld%s\n", output, level, verbose ? ", verbose" : "");
+		}
+	}
+	
+	return 0;
+}
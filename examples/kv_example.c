@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+Repeated key=value options, like -D in compilers and JVMs. ARG_KV splits each value at the first '=' without
+copying and collects the pairs into a struct kjc_argmap, which is still there to look keys up in once parsing is
+done. Properties can be overridden by giving them again, but a label can only be given once.
+*/
+
+int main(int argc, char** argv) {
+	struct kjc_argmap properties = KJC_ARGMAP_INIT(KJC_ARGMAP_LAST_WINS);
+	struct kjc_argmap labels = KJC_ARGMAP_INIT(KJC_ARGMAP_UNIQUE);
+	int status = EXIT_FAILURE;
+	
+	ARGPARSE(argc, argv) {
+		ARG_KV('D', "define", "Set a property, overriding any earlier value", &properties, property) {
+			printf("Property %.*s = \"%s\"\n", (int)property.key_len, property.key, property.value);
+		}
+		
+		ARG_KV('L', "label", "Attach a label, each one only once", &labels, label) {
+			(void)label;
+		}
+		
+		ARG_END {
+			status = EXIT_SUCCESS;
+		}
+	}
+	
+	if(status == EXIT_SUCCESS) {
+		const struct kjc_argkv* level = kjc_argmap_get(&properties, "log.level");
+		printf("Log level: %s\n", level ? level->value : "info");
+		
+		printf("%u propert%s:\n", properties.count, properties.count == 1 ? "y" : "ies");
+		for(unsigned i = 0; i < properties.count; i++) {
+			const struct kjc_argkv* kv = &properties.entries[i];
+			printf("  %.*s=%s (argument %d)\n", (int)kv->key_len, kv->key, kv->value, kv->index);
+		}
+		
+		for(unsigned i = 0; i < labels.count; i++) {
+			printf("Label %.*s: %s\n", (int)labels.entries[i].key_len, labels.entries[i].key, labels.entries[i].value);
+		}
+	}
+	
+	kjc_argmap_free(&properties);
+	kjc_argmap_free(&labels);
+	return status;
+}
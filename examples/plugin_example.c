@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "kjc_argparse.h"
+
+/*
+Options that are only known at runtime, such as the ones contributed by plugins, can't be written
+as ARG_*() macros. Here each "plugin" registers its options with a kjc_argparse_builder, and the
+program freezes the result into a schema once every plugin has been loaded.
+*/
+
+enum {
+	/* Core options */
+	OPT_VERBOSE,
+	OPT_PLUGINS,
+	
+	/* Options from the compression plugin */
+	OPT_LEVEL,
+	OPT_FAST,
+	
+	/* Options from the upload plugin */
+	OPT_UPLOAD,
+	OPT_UPLOAD_URL,
+	OPT_UPLOAD_RETRIES,
+};
+
+struct plugin {
+	const char* name;
+	void (*register_options)(struct kjc_argparse_builder* builder);
+};
+
+static void compress_register(struct kjc_argparse_builder* builder) {
+	static const struct kjc_argparse_option options[] = {
+		{OPT_LEVEL, 'l', KJC_ARGPARSE_TYPE_LONG, "level", "Compression level", "level"},
+		{OPT_FAST, 0, KJC_ARGPARSE_TYPE_VOID, "fast", "Compress quickly instead of well", NULL},
+	};
+	static const struct kjc_argparse_constraint constraints[] = {
+		{KJC_ARGPARSE_EXCLUSIVE, "level", "compression"},
+		{KJC_ARGPARSE_EXCLUSIVE, "fast", "compression"},
+	};
+	
+	kjc_argparse_builder_add(builder, options, sizeof(options) / sizeof(options[0]));
+	kjc_argparse_builder_constrain(builder, constraints, sizeof(constraints) / sizeof(constraints[0]));
+}
+
+static void upload_register(struct kjc_argparse_builder* builder) {
+	static const struct kjc_argparse_option options[] = {
+		{OPT_UPLOAD_URL, 'u', KJC_ARGPARSE_TYPE_STRING, "url", "Where to upload the output", "url"},
+		{OPT_UPLOAD_RETRIES, 'r', KJC_ARGPARSE_TYPE_LONG, "retries", "Number of times to retry", "count"},
+	};
+	static const struct kjc_argparse_constraint constraints[] = {
+		{KJC_ARGPARSE_REQUIRED, "url", NULL},
+	};
+	
+	struct kjc_argparse_builder* upload = kjc_argparse_builder_command(
+		builder, OPT_UPLOAD, "upload", "Upload the output somewhere", NULL
+	);
+	kjc_argparse_builder_add(upload, options, sizeof(options) / sizeof(options[0]));
+	kjc_argparse_builder_constrain(upload, constraints, sizeof(constraints) / sizeof(constraints[0]));
+}
+
+static const struct plugin plugins[] = {
+	{"compress", compress_register},
+	{"upload", upload_register},
+};
+
+static int parse_upload(const struct kjc_argparse_schema* schema, struct kjc_argparse* parent) {
+	struct kjc_argparse ctx;
+	struct kjc_argparse_event ev;
+	const char* url = NULL;
+	long retries = 0;
+	
+	kjc_argparse_begin_command(&ctx, schema, parent);
+	while(kjc_argparse_next(&ctx, &ev)) {
+		switch(ev.kind) {
+			case KJC_ARGPARSE_EVENT_OPTION:
+				if(ev.id == OPT_UPLOAD_URL) {
+					url = ev.value;
+				}
+				else if(ev.id == OPT_UPLOAD_RETRIES) {
+					retries = ev.value_long;
+				}
+				break;
+			
+			case KJC_ARGPARSE_EVENT_HELP:
+				kjc_argparse_help(&ctx);
+				return EXIT_SUCCESS;
+			
+			case KJC_ARGPARSE_EVENT_ERROR:
+				return EXIT_FAILURE;
+			
+			case KJC_ARGPARSE_EVENT_END:
+				/* The schema requires --url, so it's always set here */
+				printf("Uploading to %s with %ld retries\n", url, retries);
+				break;
+		}
+	}
+	
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+	static const struct kjc_argparse_option core_options[] = {
+		{OPT_VERBOSE, 'v', KJC_ARGPARSE_TYPE_VOID, "verbose", "Enable verbose logging", NULL},
+		{OPT_PLUGINS, 0, KJC_ARGPARSE_TYPE_VOID, "plugins", "List the loaded plugins", NULL},
+	};
+	
+	struct kjc_argparse_builder* builder = kjc_argparse_builder_new(NULL);
+	kjc_argparse_builder_add(builder, core_options, sizeof(core_options) / sizeof(core_options[0]));
+	for(size_t i = 0; i < sizeof(plugins) / sizeof(plugins[0]); i++) {
+		plugins[i].register_options(builder);
+	}
+	struct kjc_argparse_schema* schema = kjc_argparse_builder_freeze(builder);
+	
+	struct kjc_argparse ctx;
+	struct kjc_argparse_event ev;
+	int ret = EXIT_SUCCESS;
+	bool stop = false;
+	
+	kjc_argparse_begin(&ctx, schema, argc, argv);
+	while(!stop && kjc_argparse_next(&ctx, &ev)) {
+		switch(ev.kind) {
+			case KJC_ARGPARSE_EVENT_OPTION:
+				switch(ev.id) {
+					case OPT_VERBOSE:
+						printf("Verbose logging enabled\n");
+						break;
+					
+					case OPT_PLUGINS:
+						for(size_t i = 0; i < sizeof(plugins) / sizeof(plugins[0]); i++) {
+							printf("Plugin: %s\n", plugins[i].name);
+						}
+						break;
+					
+					case OPT_LEVEL:
+						printf("Compression level %ld\n", ev.value_long);
+						break;
+					
+					case OPT_FAST:
+						printf("Fast compression\n");
+						break;
+				}
+				break;
+			
+			case KJC_ARGPARSE_EVENT_COMMAND:
+				ret = parse_upload(kjc_argparse_schema_command(schema, ev.id), &ctx);
+				stop = true;
+				break;
+			
+			case KJC_ARGPARSE_EVENT_HELP:
+				kjc_argparse_help(&ctx);
+				stop = true;
+				break;
+			
+			case KJC_ARGPARSE_EVENT_ERROR:
+				ret = EXIT_FAILURE;
+				break;
+		}
+	}
+	
+	kjc_argparse_schema_free(schema);
+	return ret;
+}
@@ -0,0 +1,109 @@
+/* Handlers are only timed in translation units built with this defined */
+#define KJC_ARGPARSE_PROFILE
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "kjc_argparse.h"
+
+/*
+A service launcher whose startup time goes into what its handlers do, like loading the configuration file and
+plugins. ARGPARSE_CONFIG_PROFILE() times each handler, and afterwards the program finds the slowest one from the
+profile's stats. "--timings" prints all of them, and "--trace <path>" writes every handler run to a Chrome trace
+event file, which chrome://tracing or Perfetto can open to see the handlers of the "migrate" subcommand nested
+within it.
+*/
+
+/* Stands in for real work, like parsing a file */
+static void work(unsigned long iterations) {
+	volatile unsigned long sum = 0;
+	for(unsigned long i = 0; i < iterations; i++) {
+		sum += i ^ (sum >> 3);
+	}
+}
+
+int main(int argc, char** argv) {
+	struct kjc_argprofile profile = {0};
+	const char* trace_path = NULL;
+	bool timings = false;
+	
+	argv[0] = "launcher";
+	
+	ARGPARSE(argc, argv) {
+		ARGPARSE_CONFIG_PROFILE(&profile);
+		
+		ARG_STRING('c', "config", "Load the configuration from this file", path) {
+			work(4000000);
+			printf("Loaded config %s\n", path);
+		}
+		
+		ARG_STRING('p', "plugin", "Load a plugin, can be repeated", name) {
+			work(200000);
+			printf("Loaded plugin %s\n", name);
+		}
+		
+		ARG('v', "verbose", "Log more details") {
+			printf("Verbose logging\n");
+		}
+		
+		ARG_STRING(0, "trace", "Write the handler times to this file as a Chrome trace", path) {
+			trace_path = path;
+		}
+		
+		ARG(0, "timings", "Print the time spent in each handler") {
+			timings = true;
+		}
+		
+		ARG_COMMAND("migrate", "Migrate the database before starting") {
+			ARGPARSE_NESTED {
+				ARG('n', "dry-run", "Only print the migrations") {
+					printf("Dry run\n");
+				}
+				
+				ARG_END {
+					work(400000);
+					printf("Migrated\n");
+				}
+			}
+			break;
+		}
+		
+		ARG_END {
+			printf("Started\n");
+		}
+	}
+	
+	/* The stats are in the order each handler first ran */
+	const struct kjc_argprofile_stat* slowest = NULL;
+	for(size_t i = 0; i < profile.stats_count; i++) {
+		const struct kjc_argprofile_stat* stat = &profile.stats[i];
+		printf("%s ran %lu time%s\n", stat->name, stat->count, stat->count == 1 ? "" : "s");
+		
+		/* A subcommand's time includes its own handlers, so only the root's handlers are compared */
+		if(stat->parent < 0 && (slowest == NULL || stat->total_ns > slowest->total_ns)) {
+			slowest = stat;
+		}
+	}
+	if(slowest != NULL) {
+		printf("Slowest handler: %s\n", slowest->name);
+	}
+	
+	if(timings) {
+		kjc_argprofile_print(&profile, stderr);
+	}
+	
+	int status = EXIT_SUCCESS;
+	if(trace_path != NULL) {
+		if(kjc_argprofile_write_trace(&profile, trace_path) == 0) {
+			printf("Wrote %zu handler runs to the trace\n", profile.spans_count);
+		}
+		else {
+			fprintf(stderr, "Error: Couldn't write the trace to %s\n", trace_path);
+			status = EXIT_FAILURE;
+		}
+	}
+	
+	kjc_argprofile_free(&profile);
+	return status;
+}
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kjc_argparse.h"
+
+/*
+Port of full_example.c to the pull API. Instead of handler bodies inside an ARGPARSE() block, the
+options are declared in a table that is compiled once into a schema, and the program asks for one
+event at a time with kjc_argparse_next(). It accepts the same arguments and produces the same output.
+*/
+
+enum {
+	OPT_USAGE,
+	OPT_TEST,
+	OPT_HELLO,
+	OPT_HELLO_CAPS,
+	OPT_FLAG,
+	OPT_ONCE,
+	OPT_INT,
+	OPT_NAME,
+	OPT_LONG,
+};
+
+static const struct kjc_argparse_option options[] = {
+	{OPT_USAGE, 0, KJC_ARGPARSE_TYPE_VOID, "usage", NULL, NULL},
+	{OPT_TEST, 't', KJC_ARGPARSE_TYPE_VOID, "test", "This is a test lol", NULL},
+	{OPT_HELLO, 0, KJC_ARGPARSE_TYPE_VOID, "hello", "Say hello!", NULL},
+	{OPT_HELLO_CAPS, 'H', KJC_ARGPARSE_TYPE_VOID, NULL, "Hello but in caps", NULL},
+	{OPT_FLAG, 'f', KJC_ARGPARSE_TYPE_VOID, "flag", "Turns this flag on", NULL},
+	{OPT_ONCE, 'o', KJC_ARGPARSE_TYPE_VOID, "once", "This flag may only be set once", NULL},
+	{OPT_INT, 'i', KJC_ARGPARSE_TYPE_LONG, "int-argument", "This argument expects an integer value", "NUMBER"},
+	{OPT_NAME, 'n', KJC_ARGPARSE_TYPE_STRING, "set-name", "This argument expects a string value", "NAME"},
+	{OPT_LONG, 'l', KJC_ARGPARSE_TYPE_VOID, "long-like-really-extremely-long-argument", "This argument is really long", NULL},
+};
+
+int main(int argc, char** argv) {
+	bool flag = false, once = false;
+	int ret = EXIT_FAILURE;
+	
+	// Same settings as the ARGPARSE_CONFIG_*() calls in full_example.c
+	struct kjc_argparse_config config;
+	kjc_argparse_config_init(&config);
+	config.flags |= KJC_ARGPARSE_USE_VARNAMES | KJC_ARGPARSE_TYPE_HINTS | KJC_ARGPARSE_CATCHALL;
+	config.description_column = 35;
+	config.indent = 4;
+	config.positional_usage = "[extra args...]";
+	
+	// A schema can be used for any number of parses, so a long-running program would keep it around
+	struct kjc_argparse_schema* schema = kjc_argparse_schema_new(&config, options, sizeof(options) / sizeof(options[0]));
+	
+	struct kjc_argparse ctx;
+	struct kjc_argparse_event ev;
+	bool stop = false;
+	
+	kjc_argparse_begin(&ctx, schema, argc, argv);
+	while(!stop && kjc_argparse_next(&ctx, &ev)) {
+		switch(ev.kind) {
+			case KJC_ARGPARSE_EVENT_OPTION:
+				switch(ev.id) {
+					case OPT_USAGE:
+						kjc_argparse_help(&ctx);
+						stop = true;
+						break;
+					
+					case OPT_TEST:
+						printf("Test:");
+						for(int i = 1; i <= 10; i++) {
+							printf(" %d", i);
+						}
+						printf("\n");
+						break;
+					
+					case OPT_HELLO:
+						printf("Hello!\n");
+						break;
+					
+					case OPT_HELLO_CAPS:
+						printf("HELLO\n");
+						break;
+					
+					case OPT_FLAG:
+						flag = true;
+						break;
+					
+					case OPT_ONCE:
+						if(once) {
+							printf("Flag --once given multiple times!\n");
+							ret = -1;
+							stop = true;
+							break;
+						}
+						once = true;
+						break;
+					
+					case OPT_INT:
+						printf("--int-argument %d\n", (int)ev.value_long);
+						break;
+					
+					case OPT_NAME:
+						printf("--set-name %s\n", ev.value);
+						if(strcmp(ev.value, "@ADMIN") == 0) {
+							printf("Error: Illegal to set name to @ADMIN!\n");
+							stop = true;
+						}
+						break;
+				}
+				break;
+			
+			case KJC_ARGPARSE_EVENT_POSITIONAL:
+				printf("ARG_POSITIONAL: %.*s\n", (int)ev.value_len, ev.value);
+				break;
+			
+			case KJC_ARGPARSE_EVENT_OTHER:
+				printf("ARG_OTHER: %.*s\n", (int)ev.value_len, ev.value);
+				printf("Index: %d\n", ev.index);
+				ret = -1;
+				stop = true;
+				break;
+			
+			case KJC_ARGPARSE_EVENT_HELP:
+				kjc_argparse_help(&ctx);
+				stop = true;
+				break;
+			
+			case KJC_ARGPARSE_EVENT_END:
+				printf("All done with argument parsing!\n");
+				if(!flag) {
+					printf("ERROR: --flag is required!\n");
+					kjc_argparse_help(&ctx);
+					exit(EXIT_FAILURE);
+				}
+				ret = 0;
+				break;
+		}
+	}
+	
+	kjc_argparse_schema_free(schema);
+	return ret;
+}
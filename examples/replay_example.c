@@ -0,0 +1,117 @@
+/* Needed for setenv(), fork() and waitpid() */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "kjc_argparse.h"
+
+/*
+A supervisor that parses its options once, then runs worker processes that need the same options. With
+ARGPARSE_CONFIG_RECORD, ARGPARSE_EXPORT() writes each step of parsing to a sealed memfd that the workers inherit.
+When a worker's ARGPARSE block has the same options, it replays those steps instead of parsing its own argv: every
+handler runs again, in the same order and with the values already converted. A worker can't be given arguments of its
+own, and it exports the options again to pass them on to workers of its own. Only supported on Linux.
+*/
+
+static const char* const modes[] = {"fast", "safe"};
+
+int main(int argc, char** argv) {
+	const char* who = getenv("WORKER_ID") ? getenv("WORKER_ID") : "supervisor";
+	long level = getenv("WORKER_LEVEL") ? strtol(getenv("WORKER_LEVEL"), NULL, 10) : 0;
+	long depth = 1;
+	struct kjc_argmap defines = KJC_ARGMAP_INIT(KJC_ARGMAP_LAST_WINS);
+	long workers = 2;
+	bool replayed = false;
+	int status = EXIT_FAILURE;
+	
+	ARGPARSE(argc, argv) {
+		ARGPARSE_CONFIG_RECORD(true);
+		
+		ARG_LONG('w', "workers", "Number of worker processes to run", count) {
+			printf("%s: %ld workers\n", who, count);
+			workers = count;
+		}
+		
+		ARG_LONG('d', "depth", "Levels of workers to run below the supervisor", levels) {
+			printf("%s: %ld levels\n", who, levels);
+			depth = levels;
+		}
+		
+		ARG_STRING('l', "listen", "Address to listen on", address) {
+			printf("%s: listening on %s\n", who, address);
+		}
+		
+		ARG_CHOICE('m', "mode", "How to serve requests", modes, mode) {
+			printf("%s: %s mode\n", who, modes[mode]);
+		}
+		
+		ARG_KV('D', "define", "Set a property", &defines, property) {
+			printf("%s: property %.*s = \"%s\"\n", who, (int)property.key_len, property.key, property.value);
+		}
+		
+		ARG_STRING(0, "header", "Add a response header, given as <name> <value>", name) {
+			const char* value = ARGPARSE_NEXT();
+			printf("%s: header %s: %s\n", who, name, value ? value : "(none)");
+		}
+		
+		ARG('v', "verbose", "Print more details") {
+			printf("%s: verbose\n", who);
+		}
+		
+		ARG_POSITIONAL("<root>...", root) {
+			printf("%s: serving %s\n", who, root);
+		}
+		
+		ARG_END {
+			replayed = ARGPARSE_REPLAYED();
+			status = EXIT_SUCCESS;
+			
+			/* Only processes that run workers export, a worker exports the same options it replayed */
+			if(level < depth && ARGPARSE_EXPORT() < 0) {
+				fprintf(stderr, "Error: Couldn't export the options\n");
+				status = EXIT_FAILURE;
+			}
+		}
+	}
+	
+	if(status == EXIT_SUCCESS) {
+		printf("%s: %s, %u properties\n", who, replayed ? "replayed the options" : "parsed the options", defines.count);
+	}
+	kjc_argmap_free(&defines);
+	if(status != EXIT_SUCCESS || level >= depth) {
+		return status;
+	}
+	
+	/* The workers are run one at a time, so their output is in a predictable order */
+	for(long i = 1; i <= workers; i++) {
+		fflush(stdout);
+		pid_t pid = fork();
+		if(pid == 0) {
+			char id[64], next_level[32];
+			if(level == 0) {
+				snprintf(id, sizeof(id), "worker %ld", i);
+			}
+			else {
+				snprintf(id, sizeof(id), "%s.%ld", who, i);
+			}
+			snprintf(next_level, sizeof(next_level), "%ld", level + 1);
+			setenv("WORKER_ID", id, 1);
+			setenv("WORKER_LEVEL", next_level, 1);
+			
+			/* Workers replay the supervisor's options, so they're only given an argument to show that it's rejected */
+			execl("/proc/self/exe", "replay_example", getenv("WORKER_ARG"), (char*)NULL);
+			_exit(127);
+		}
+		
+		int wstatus = 0;
+		if(pid < 0 || waitpid(pid, &wstatus, 0) < 0 || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) {
+			fprintf(stderr, "Error: Worker %ld failed\n", i);
+			status = EXIT_FAILURE;
+		}
+	}
+	
+	return status;
+}
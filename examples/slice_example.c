@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+Values along with their lengths, which the parser already knows. ARG_SLICE is like ARG_STRING, except that the value
+is a struct kjc_argslice holding both its pointer and its length, and ARGPARSE_VALUE_LEN() returns the length of the
+current ARG_STRING, ARG_POSITIONAL or ARG_OTHER value. Neither calls strlen() again. A value given like --title=Hello
+is a slice of that argument, without copying it.
+*/
+
+int main(int argc, char** argv) {
+	struct kjc_argslice title = {"Untitled", 8};
+	size_t section_chars = 0;
+	int status = EXIT_FAILURE;
+	
+	ARGPARSE(argc, argv) {
+		ARG_SLICE('T', "title", "Title of the document", text) {
+			printf("--title %.*s (%zu chars)\n", (int)text.len, text.ptr, text.len);
+			title = text;
+		}
+		
+		ARG_STRING('a', "author", "Author of the document", author) {
+			printf("--author %s (%zu chars)\n", author, ARGPARSE_VALUE_LEN());
+		}
+		
+		ARG_POSITIONAL("<section>...", section) {
+			printf("Section %.*s\n", (int)ARGPARSE_VALUE_LEN(), section);
+			section_chars += ARGPARSE_VALUE_LEN();
+		}
+		
+		ARG_END {
+			status = EXIT_SUCCESS;
+		}
+	}
+	
+	if(status == EXIT_SUCCESS) {
+		printf("%.*s: %zu chars of section names\n", (int)title.len, title.ptr, section_chars);
+	}
+	return status;
+}
@@ -40,13 +40,21 @@ int main(int argc, char** argv) {
 			json_inputs[json_count++] = arg;
 		}
 		
-		ARG_END {
-			if(!base_url) {
-				printf("Missing required argument --base-url!\n\n");
+		ARGPARSE_REQUIRE("base-url");
+		
+		ARG_ERROR(error) {
+			char message[256];
+			ARGPARSE_FORMAT_ERROR(message, sizeof(message));
+			fprintf(stderr, "%s", message);
+			
+			/* Like the checks above, a missing --base-url is followed by the usage */
+			if(error->code == KJC_ARGERROR_CONSTRAINT) {
+				fprintf(stderr, "\n");
 				ARGPARSE_HELP();
-				break;
 			}
-			
+		}
+		
+		ARG_END {
 			parse_success = true;
 		}
 	}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "kjc_argparse.h"
+
+/*
+A grep-like tool whose options are declared once, in an X-macro list. KJC_ARGPARSE_STATIC_SCHEMA() turns the list
+into an enum of the option ids and into the sorted lookup tables of a schema, as static const data that the compiler
+builds. Parsing then starts without registering, allocating, or sorting anything, which suits small tools that are
+started thousands of times a second. The entries must be listed in order of their long names.
+*/
+
+#define SEARCH_OPTIONS(X)                                                                                             \
+	X(OPT_CONTEXT, 'C', LONG, "context", "Print this many lines around each match", "lines")                          \
+	X(OPT_COUNT, 'c', VOID, "count", "Only print the number of matching lines", "")                                   \
+	X(CMD_EXPLAIN, 0, COMMAND, "explain", "Describe what a pattern matches instead of searching", "")                 \
+	X(OPT_IGNORE_CASE, 'i', VOID, "ignore-case", "Ignore case distinctions", "")                                      \
+	X(OPT_QUIET, 'q', VOID, "quiet", "Only exit with the status", "")                                                 \
+	X(OPT_REGEXP, 'e', STRING, "regexp", "Pattern to search for", "pattern")
+
+KJC_ARGPARSE_STATIC_SCHEMA(search_schema, SEARCH_OPTIONS, "<file>...", KJC_ARGPARSE_DEFAULT_FLAGS)
+
+#define EXPLAIN_OPTIONS(X)                                                                                            \
+	X(EXPLAIN_SYNTAX, 's', STRING, "syntax", "Pattern syntax, basic or extended", "")                                 \
+	X(EXPLAIN_VERBOSE, 'v', VOID, "verbose", "Explain each part of the pattern", "")
+
+KJC_ARGPARSE_STATIC_SCHEMA(explain_schema, EXPLAIN_OPTIONS, "<pattern>", KJC_ARGPARSE_DEFAULT_FLAGS)
+
+static int explain(struct kjc_argparse* parent) {
+	struct kjc_argparse ctx;
+	struct kjc_argparse_event ev;
+	
+	kjc_argparse_begin_command(&ctx, explain_schema(), parent);
+	while(kjc_argparse_next(&ctx, &ev)) {
+		switch(ev.kind) {
+			case KJC_ARGPARSE_EVENT_OPTION:
+				if(ev.id == EXPLAIN_SYNTAX) {
+					printf("Syntax: %s\n", ev.value);
+				}
+				else {
+					printf("Verbose explanation\n");
+				}
+				break;
+			
+			case KJC_ARGPARSE_EVENT_POSITIONAL:
+				printf("Explaining %s\n", ev.value);
+				break;
+			
+			case KJC_ARGPARSE_EVENT_HELP:
+				kjc_argparse_help(&ctx);
+				return EXIT_SUCCESS;
+			
+			case KJC_ARGPARSE_EVENT_ERROR:
+				return EXIT_FAILURE;
+		}
+	}
+	
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+	struct kjc_argparse ctx;
+	struct kjc_argparse_event ev;
+	const char* pattern = NULL;
+	long context = 0;
+	bool count = false, ignore_case = false, quiet = false;
+	int files = 0;
+	
+	kjc_argparse_begin(&ctx, search_schema(), argc, argv);
+	while(kjc_argparse_next(&ctx, &ev)) {
+		switch(ev.kind) {
+			case KJC_ARGPARSE_EVENT_OPTION:
+				switch(ev.id) {
+					case OPT_CONTEXT:
+						context = ev.value_long;
+						break;
+					
+					case OPT_COUNT:
+						count = true;
+						break;
+					
+					case OPT_IGNORE_CASE:
+						ignore_case = true;
+						break;
+					
+					case OPT_QUIET:
+						quiet = true;
+						break;
+					
+					case OPT_REGEXP:
+						pattern = ev.value;
+						break;
+				}
+				break;
+			
+			case KJC_ARGPARSE_EVENT_COMMAND:
+				return explain(&ctx);
+			
+			case KJC_ARGPARSE_EVENT_POSITIONAL:
+				printf("Searching %s\n", ev.value);
+				files++;
+				break;
+			
+			case KJC_ARGPARSE_EVENT_HELP:
+				kjc_argparse_help(&ctx);
+				return EXIT_SUCCESS;
+			
+			case KJC_ARGPARSE_EVENT_END:
+				if(pattern == NULL) {
+					fprintf(stderr, "Error: No pattern given\n");
+					kjc_argparse_help(&ctx);
+					return EXIT_FAILURE;
+				}
+				printf(
+					"Pattern \"%s\" in %d file%s, %ld lines of context%s%s%s\n", pattern, files, files == 1 ? "" : "s",
+					context, count ? ", counting" : "", ignore_case ? ", ignoring case" : "", quiet ? ", quietly" : ""
+				);
+				break;
+			
+			case KJC_ARGPARSE_EVENT_ERROR:
+				return EXIT_FAILURE;
+		}
+	}
+	
+	return EXIT_SUCCESS;
+}
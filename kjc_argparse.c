@@ -5,17 +5,57 @@
 //  Copyright © 2019 Kevin Colley. All rights reserved.
 //
 
+#if defined(_WIN32) && !defined(KJC_ARGPARSE_NO_THREADS)
+#define KJC_ARGPARSE_NO_THREADS 1
+#endif
+
+/* Needed for memfd_create() and its seals, which ARGPARSE_EXPORT() uses */
+#if defined(__linux__) && !defined(KJC_ARGPARSE_NO_MEMFD) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE 1
+#endif
+
+/* Needed for sysconf() */
+#if !defined(KJC_ARGPARSE_NO_THREADS) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "kjc_argparse.h"
 
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
 #include <assert.h>
+#include <time.h>
+
+#ifndef KJC_ARGPARSE_NO_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif /* KJC_ARGPARSE_NO_THREADS */
+
+#ifdef ARGPARSE_WITH_SCHEMA
+#include "kjc_argparse_schema.h"
+#endif /* ARGPARSE_WITH_SCHEMA */
+
+#if defined(__linux__) && !defined(KJC_ARGPARSE_NO_MEMFD)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+/* In single header mode, system headers may have been included before _GNU_SOURCE could be defined */
+#if !defined(MFD_ALLOW_SEALING) || !defined(F_ADD_SEALS)
+#define KJC_ARGPARSE_NO_MEMFD 1
+#endif
+#else /* __linux__ */
+#define KJC_ARGPARSE_NO_MEMFD 1
+#endif /* __linux__ */
 
 
 #ifdef NDEBUG
@@ -28,6 +68,151 @@
 #define argparse_assert assert
 #endif /* NDEBUG */
 
+/* Stream for argparse messages until ARGPARSE_CONFIG_STREAM() changes it */
+#ifdef ARGPARSE_DEFAULT_STREAM
+#define _argparse_default_stream() (ARGPARSE_DEFAULT_STREAM)
+#else
+#define _argparse_default_stream() stderr
+#endif
+
+/* Test a configuration flag, which is a constant when KJC_ARGPARSE_FIXED_FLAGS fixed it at compile time */
+#define _argparse_flag(argparse_context, flag) ((_kARGPARSE_FIXED_FLAGS & (flag)) \
+	? (KJC_ARGPARSE_DEFAULT_FLAGS & (flag)) \
+	: ((argparse_context)->flags & (flag)))
+
+/* Functions that only run on error paths, kept out of line and away from the hot parsing code */
+#ifdef __GNUC__
+#define _argparse_cold __attribute__((__cold__, __noinline__))
+#else /* __GNUC__ */
+#define _argparse_cold
+#endif /* __GNUC__ */
+
+/* Long lists in help output, like the choices of an ARG_CHOICE option, are wrapped to this many columns */
+#define _kARGPARSE_HELP_WIDTH 80
+
+/* The trigram index for --help=<pattern> has 2^12 buckets */
+#define _kARGPARSE_HELP_INDEX_BITS 12
+
+/* Destination of formatted error messages: a stream, or a buffer filled like snprintf() */
+struct _argsink {
+	FILE* f;
+	char* buf;
+	size_t size;
+	size_t len;
+};
+
+/*
+ * Blob written by kjc_argparse_export(): a header, then one record for each step of parsing, each followed by the
+ * NUL-terminated arguments that step took. Concatenated, those arguments are the argv that a child process replays.
+ */
+#define _kARGREPLAY_MAGIC    0x52434a4b  /* "KJCR" */
+#define _kARGREPLAY_VERSION  1
+
+/* Arguments taken by a handler with ARGPARSE_NEXT(), skipped when replaying */
+#define _kARGRECORD_TAKEN    0
+
+struct _argreplay_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_size;
+	uint64_t schema_hash;  /* Of the root argparse block, see _argparse_schema_hash() */
+	uint64_t size;         /* Of the whole blob, including this header */
+	uint32_t count;        /* Number of records */
+	uint32_t reserved;
+};
+
+struct _argrecord {
+	int64_t value;         /* LONG value, or string index << 32 | byte offset of a STRING or KV value */
+	uint64_t len;          /* argvalue_len */
+	int32_t ret;           /* An arg_id, a _kARG_VALUE_* state, _kARGRECORD_TAKEN, or END for the unparsed rest */
+	int32_t option;        /* Index of the option in registration order, or -1 */
+	uint32_t count;        /* Number of strings following this record */
+	uint32_t size;         /* Of this record and its strings, a multiple of 8 */
+	int32_t key_len;       /* Of a KV value */
+	int32_t error_offset;
+	int32_t error_option;  /* Index of the option an error is about, or -1 */
+	uint8_t argtype;       /* Type of the value, never SHORTGROUP or DASHDASH */
+	uint8_t error;         /* KJC_ARGERROR_* code of an ARG_OTHER argument */
+	uint8_t error_string;  /* Index of the string the error is in */
+	uint8_t dashdash;      /* Recorded after "--", so any unparsed arguments are positional */
+};
+
+/* Records of the root context, which become the blob once the header is put in front of them */
+struct _argrecorder {
+	unsigned char* data;
+	size_t size;
+	size_t cap;
+	uint64_t hash;
+	unsigned count;
+	int mark;  /* Index of the first argument that isn't in any record yet */
+	
+	/* Last memfd written by kjc_argparse_export() or -1, and the number of records and parsed arguments in it */
+	int exported_fd;
+	unsigned exported_count;
+	int exported_argidx;
+};
+
+/* Position of the root context in the replayed records */
+struct _argreplay {
+	size_t pos;
+	int slot;  /* Index in the replayed argv of the next record's first string */
+	bool dashdash;
+	bool done;
+	bool rejected;  /* This process was given arguments of its own, which can't be combined with the replayed ones */
+};
+
+static void _argsink_printf(struct _argsink* sink, const char* format, ...) {
+	va_list ap;
+	va_start(ap, format);
+	
+	if(sink->f != NULL) {
+		vfprintf(sink->f, format, ap);
+	}
+	else {
+		/* Keep counting once the buffer is full, so the caller learns the length it needs */
+		size_t avail = sink->len < sink->size ? sink->size - sink->len : 0;
+		int len = vsnprintf(avail != 0 ? &sink->buf[sink->len] : NULL, avail, format, ap);
+		if(len > 0) {
+			sink->len += (size_t)len;
+		}
+	}
+	
+	va_end(ap);
+}
+
+
+static void _argparse_set_defaults(struct kjc_argparse* argparse_context) {
+	/* Configurable values */
+	argparse_context->stream = _argparse_default_stream();
+	argparse_context->custom_usage = ARGPARSE_DEFAULT_CUSTOM_USAGE;
+	argparse_context->custom_suffix = ARGPARSE_DEFAULT_HELP_SUFFIX;
+	argparse_context->long_arg_prefix = ARGPARSE_DEFAULT_LONG_PREFIX;
+	argparse_context->long_prefix_len = strlen(ARGPARSE_DEFAULT_LONG_PREFIX);
+	argparse_context->subcmd_description_column = ARGPARSE_DEFAULT_COMMAND_DESCRIPTION_COLUMN;
+	argparse_context->description_column = ARGPARSE_DEFAULT_DESCRIPTION_COLUMN;
+	argparse_context->indent = ARGPARSE_DEFAULT_INDENT;
+	argparse_context->description_padding = ARGPARSE_DEFAULT_DESCRIPTION_PADDING;
+	argparse_context->thread_count = ARGPARSE_DEFAULT_THREADS;
+	
+	/* Configurable bit flags */
+	argparse_context->flags = KJC_ARGPARSE_DEFAULT_FLAGS;
+}
+
+#ifdef ARGPARSE_WITH_SCHEMA
+/* Path named by the schema dump marker, so that the contexts of subcommands see it too */
+static const char* _argparse_schema_out = NULL;
+
+/* Schema build mode: only tools/kjc_argparse_schema passes the marker, and it's never parsed as a normal argument */
+static void _argparse_schema_claim(struct kjc_argparse* argparse_context) {
+	static const char marker[] = KJC_SCHEMA_DUMP_ARG;
+	if(argparse_context->orig_argc < 2 || strncmp(argparse_context->orig_argv[1], marker, sizeof(marker) - 1) != 0) {
+		return;
+	}
+	
+	_argparse_schema_out = &argparse_context->orig_argv[1][sizeof(marker) - 1];
+	*argparse_context->argidx = 2;
+}
+#endif /* ARGPARSE_WITH_SCHEMA */
 
 void _argparse_init(struct kjc_argparse* argparse_context) {
 	/* Subcommand argparse context? */
@@ -40,34 +225,55 @@ void _argparse_init(struct kjc_argparse* argparse_context) {
 		
 		/* This is needed later for printing program name in usage text */
 		argparse_assert(argparse_context->parent->cur_arg->type == _kARG_TYPE_COMMAND);
+		
+		/* Global options are only ever registered at the root, so every descendant shares its table of them */
+		argparse_context->globals = argparse_context->parent->globals;
+		argparse_context->globals_count = argparse_context->parent->globals_count;
+		argparse_context->hoisted = argparse_context->parent->hoisted;
+		
+		/* Only the root replays records, its descendants parse the arguments after a subcommand themselves */
+		argparse_context->replay = argparse_context->parent->replay;
+		
+		/* Handlers run by a subcommand's block are timed along with the subcommand's own handler */
+		argparse_context->profile = argparse_context->parent->profile;
 	}
 	else {
 		argparse_context->argidx_top = 1;
 		argparse_context->argidx = &argparse_context->argidx_top;
+		
+#ifdef ARGPARSE_WITH_SCHEMA
+		_argparse_schema_claim(argparse_context);
+#endif /* ARGPARSE_WITH_SCHEMA */
 	}
 	
-	/* Configurable values */
-	argparse_context->stream = ARGPARSE_DEFAULT_STREAM != (void*)1 ? ARGPARSE_DEFAULT_STREAM : stderr;
-	argparse_context->custom_usage = ARGPARSE_DEFAULT_CUSTOM_USAGE;
-	argparse_context->custom_suffix = ARGPARSE_DEFAULT_HELP_SUFFIX;
-	argparse_context->long_arg_prefix = ARGPARSE_DEFAULT_LONG_PREFIX;
-	argparse_context->long_prefix_len = strlen(ARGPARSE_DEFAULT_LONG_PREFIX);
-	argparse_context->subcmd_description_column = ARGPARSE_DEFAULT_COMMAND_DESCRIPTION_COLUMN;
-	argparse_context->description_column = ARGPARSE_DEFAULT_DESCRIPTION_COLUMN;
-	argparse_context->indent = ARGPARSE_DEFAULT_INDENT;
-	argparse_context->description_padding = ARGPARSE_DEFAULT_DESCRIPTION_PADDING;
+	_argparse_set_defaults(argparse_context);
 	
-	/* Configurable bit flags */
-	argparse_context->flags = 0
-		| (ARGPARSE_DEFAULT_USE_VARNAMES ? _kARGPARSE_USE_VARNAMES : 0)
-		| (ARGPARSE_DEFAULT_TYPE_HINTS ? _kARGPARSE_TYPE_HINTS : 0)
-		| (ARGPARSE_DEFAULT_SHORTGROUPS ? _kARGPARSE_WITH_SHORTGROUPS : 0)
-		| (ARGPARSE_DEFAULT_AUTO_HELP ? _kARGPARSE_AUTO_HELP : 0)
-		| (ARGPARSE_DEFAULT_DASHDASH ? _kARGPARSE_DASHDASH : 0)
-		;
+	/*
+	 * Health checks and scripts mostly run programs with no arguments or just --version. One argument is looked up
+	 * faster by comparing it with each option than by sorting the tables first, so they're only sorted once there
+	 * are more arguments, or when the help message needs them.
+	 */
+	if(argparse_context->orig_argc - *argparse_context->argidx <= 1) {
+		argparse_context->ext_flags |= _kARGPARSE_EXT_UNSORTED;
+	}
 	
 	/* Set initial state */
-	argparse_context->state = _kARG_VALUE_COUNT;
+	argparse_context->state = _kARG_VALUE_INIT;
+}
+
+static void _argparse_discard_deferred(struct kjc_argparse* argparse_context) {
+	free(argparse_context->deferred);
+	argparse_context->deferred = NULL;
+	argparse_context->deferred_count = 0;
+	argparse_context->deferred_cap = 0;
+}
+
+static void _argparse_free_choices(struct kjc_argparse* argparse_context) {
+	while(argparse_context->choices != NULL) {
+		struct _argchoices* next = argparse_context->choices->next;
+		free(argparse_context->choices);
+		argparse_context->choices = next;
+	}
 }
 
 static void _argparse_dealloc(struct kjc_argparse* argparse_context) {
@@ -79,17 +285,50 @@ static void _argparse_dealloc(struct kjc_argparse* argparse_context) {
 	argparse_context->longargs_cap = 0;
 	argparse_context->shortargs_count = 0;
 	argparse_context->shortargs_cap = 0;
+	argparse_context->globals = NULL;
+	argparse_context->globals_count = 0;
+	argparse_context->globals_cap = 0;
+	if(argparse_context->parent == NULL) {
+		if(argparse_context->recorder != NULL) {
+			free(argparse_context->recorder->data);
+		}
+		free(argparse_context->recorder);
+		free(argparse_context->replay);
+		free(argparse_context->hoisted);
+	}
+	argparse_context->hoisted = NULL;
+	argparse_context->recorder = NULL;
+	argparse_context->replay = NULL;
+	memset(argparse_context->hot, 0, sizeof(argparse_context->hot));
+	argparse_context->constraints_count = 0;
+	argparse_context->constraints_cap = 0;
 	argparse_context->cur_arg = NULL;
 	argparse_context->argvalue.val_string = NULL;
+	argparse_context->argvalue_len = 0;
 	memset(argparse_context->short_bitmap, 0, sizeof(argparse_context->short_bitmap));
 	memset(argparse_context->short_value_bitmap, 0, sizeof(argparse_context->short_value_bitmap));
+	memset(argparse_context->constraint_required, 0, sizeof(argparse_context->constraint_required));
+	memset(argparse_context->constraint_matched, 0, sizeof(argparse_context->constraint_matched));
+	_argparse_discard_deferred(argparse_context);
+	_argparse_free_choices(argparse_context);
+	free(argparse_context->help_groups);
+	argparse_context->help_groups = NULL;
+	argparse_context->help_groups_count = 0;
+	argparse_context->help_group = 0;
+	if(argparse_context->help_index != NULL) {
+		free(*argparse_context->help_index);
+		free(argparse_context->help_index);
+		argparse_context->help_index = NULL;
+	}
+	argparse_context->help_query = NULL;
+	free(argparse_context->constraints_staging);
+	argparse_context->constraints_staging = NULL;
 	free(argparse_context->argbuffer);
 	argparse_context->argbuffer = NULL;
 }
 
 int _argparse_done(const struct kjc_argparse* argparse_context) {
-	return argparse_context->state == _kARG_VALUE_ERROR
-		|| argparse_context->state == _kARG_VALUE_BREAK
+	return argparse_context->state == _kARG_VALUE_BREAK
 		|| (argparse_context->flags & _kARGPARSE_FLAG_DONE)
 		;
 }
@@ -104,10 +343,33 @@ static inline bool _argparse_short_option_expects_value(const struct kjc_argpars
 		!!(argparse_context->short_value_bitmap[(unsigned char)short_name >> 3] & (1 << (short_name & 7)));
 }
 
-static inline struct _arginfo** _argparse_get_subcmds(const struct kjc_argparse* argparse_context) {
+/*
+ * Layout of argbuffer once the arguments are compacted:
+ *
+ * - uint64_t name_prefixes[subcmds_cap + longargs_cap];
+ * - struct _arginfo* subcmds[subcmds_cap];
+ * - struct _arginfo* longargs[longargs_cap];
+ * - struct _arginfo* shortargs[shortargs_cap];
+ * - struct _arginfo* globals[globals_cap];
+ * - struct _arginfo argstorage[argstorage_cap];
+ * - struct _argconstraint constraints[constraints_cap];
+ * - unsigned name_lengths[subcmds_cap + longargs_cap];
+ *
+ * The name prefixes and lengths are the search keys for the sorted subcmds and longargs tables, kept in
+ * arrays parallel to them so a binary search mostly touches consecutive words instead of chasing pointers.
+ */
+static inline unsigned _argparse_get_keys_cap(const struct kjc_argparse* argparse_context) {
+	return argparse_context->subcmds_cap + argparse_context->longargs_cap;
+}
+
+static inline uint64_t* _argparse_get_name_prefixes(const struct kjc_argparse* argparse_context) {
 	return argparse_context->argbuffer;
 }
 
+static inline struct _arginfo** _argparse_get_subcmds(const struct kjc_argparse* argparse_context) {
+	return (struct _arginfo**)&_argparse_get_name_prefixes(argparse_context)[_argparse_get_keys_cap(argparse_context)];
+}
+
 static inline struct _arginfo** _argparse_get_longargs(const struct kjc_argparse* argparse_context) {
 	struct _arginfo** subcmds = _argparse_get_subcmds(argparse_context);
 	return &subcmds[argparse_context->subcmds_cap];
@@ -118,21 +380,64 @@ static inline struct _arginfo** _argparse_get_shortargs(const struct kjc_argpars
 	return &long_args[argparse_context->longargs_cap];
 }
 
+static inline struct _arginfo** _argparse_get_globals(const struct kjc_argparse* argparse_context) {
+	struct _arginfo** shortargs = _argparse_get_shortargs(argparse_context);
+	return &shortargs[argparse_context->shortargs_cap];
+}
+
 static inline size_t _argparse_get_args_cap(const struct kjc_argparse* argparse_context) {
 	return argparse_context->subcmds_cap
 		+ argparse_context->longargs_cap
-		+ argparse_context->shortargs_cap;
+		+ argparse_context->shortargs_cap
+		+ argparse_context->globals_cap;
 }
 
 static inline struct _arginfo* _argparse_get_argstorage(const struct kjc_argparse* argparse_context) {
-	return (struct _arginfo*)(
-		argparse_context->argbuffer + _argparse_get_args_cap(argparse_context) * sizeof(struct _arginfo*)
-	);
+	return (struct _arginfo*)&_argparse_get_subcmds(argparse_context)[_argparse_get_args_cap(argparse_context)];
+}
+
+static inline struct _argconstraint* _argparse_get_constraints(const struct kjc_argparse* argparse_context) {
+	return (struct _argconstraint*)&_argparse_get_argstorage(argparse_context)[argparse_context->argstorage_cap];
+}
+
+static inline unsigned* _argparse_get_name_lengths(const struct kjc_argparse* argparse_context) {
+	return (unsigned*)&_argparse_get_constraints(argparse_context)[argparse_context->constraints_cap];
 }
 
 static inline size_t _argparse_get_argbuffer_size(const struct kjc_argparse* argparse_context) {
-	return _argparse_get_args_cap(argparse_context) * sizeof(struct _arginfo*) \
-		+ argparse_context->argstorage_cap * sizeof(struct _arginfo);
+	return _argparse_get_keys_cap(argparse_context) * (sizeof(uint64_t) + sizeof(unsigned)) \
+		+ _argparse_get_args_cap(argparse_context) * sizeof(struct _arginfo*) \
+		+ argparse_context->argstorage_cap * sizeof(struct _arginfo) \
+		+ argparse_context->constraints_cap * sizeof(struct _argconstraint);
+}
+
+/* First 8 bytes of a name as a big-endian integer (zero padded), so comparing prefixes orders like strcmp() */
+static inline uint64_t _argparse_name_prefix(const char* name) {
+	uint64_t prefix = 0;
+	for(unsigned i = 0; i < sizeof(prefix); i++) {
+		prefix <<= 8;
+		if(*name != '\0') {
+			prefix |= (unsigned char)*name++;
+		}
+	}
+	return prefix;
+}
+
+/* One FNV-1a step per byte, starting from the offset basis or a previous hash */
+static inline uint64_t _argparse_hash_bytes(uint64_t hash, const void* data, size_t len) {
+	const unsigned char* bytes = data;
+	for(size_t i = 0; i < len; i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3;
+	}
+	return hash;
+}
+
+static inline void _argparse_bitset_set(uint64_t* bits, unsigned bit) {
+	bits[bit >> 6] |= (uint64_t)1 << (bit & 63);
+}
+
+static inline bool _argparse_bitset_test(const uint64_t* bits, unsigned bit) {
+	return !!(bits[bit >> 6] & ((uint64_t)1 << (bit & 63)));
 }
 
 void _argparse_add(
@@ -147,9 +452,6 @@ void _argparse_add(
 	/* Error if neither a short name nor a long name are provided */
 	argparse_assert(short_name != '\0' || long_name != NULL);
 	
-	/* Array of arginfo structs */
-	struct _arginfo* argstorage = _argparse_get_argstorage(argparse_context);
-	
 	/* Memset-init, then set fields */
 	struct _arginfo arg = {0};
 	arg.arg_id = arg_id;
@@ -158,21 +460,40 @@ void _argparse_add(
 	arg.description = description;
 	arg.type = type;
 	arg.var_name = var_name;
+	arg.group = argparse_context->help_group;
+	
+	/* Wrapped in ARG_GLOBAL? */
+	if(argparse_context->ext_flags & _kARGPARSE_EXT_NEXT_GLOBAL) {
+		argparse_assert(argparse_context->parent == NULL && "Global options can only be registered at the root");
+		argparse_assert(type != _kARG_TYPE_COMMAND && "Subcommands can't be global");
+		argparse_context->ext_flags &= ~_kARGPARSE_EXT_NEXT_GLOBAL;
+		arg.global = 1;
+		++argparse_context->globals_count;
+	}
+	
+	/*
+	 * Until _argparse_post_init(), argbuffer only holds the arguments in registration order. It's grown
+	 * geometrically, as the number of arguments isn't known until the whole ARGPARSE body has run.
+	 */
+	if(argparse_context->argstorage_count == argparse_context->argstorage_cap) {
+		unsigned cap = argparse_context->argstorage_cap ? argparse_context->argstorage_cap * 2 : 16;
+		void* staging = realloc(argparse_context->argbuffer, cap * sizeof(struct _arginfo));
+		argparse_assert(staging != NULL && "Allocation failure");
+		argparse_context->argbuffer = staging;
+		argparse_context->argstorage_cap = cap;
+	}
 	
 	/* Store argument metadata in argparse context structure */
-	argparse_assert(argparse_context->argstorage_count < argparse_context->argstorage_cap);
-	struct _arginfo* parg = &argstorage[argparse_context->argstorage_count++];
-	*parg = arg;
+	struct _arginfo* argstorage = argparse_context->argbuffer;
+	argstorage[argparse_context->argstorage_count++] = arg;
 	
-	/* Register long name (if set) */
+	/* Count long names (if set), the tables are filled in when the arguments are compacted */
 	if(long_name != NULL) {
 		if(type == _kARG_TYPE_COMMAND) {
-			argparse_assert(argparse_context->subcmds_count < argparse_context->subcmds_cap);
-			_argparse_get_subcmds(argparse_context)[argparse_context->subcmds_count++] = parg;
+			++argparse_context->subcmds_count;
 		}
 		else {
-			argparse_assert(argparse_context->longargs_count < argparse_context->longargs_cap);
-			_argparse_get_longargs(argparse_context)[argparse_context->longargs_count++] = parg;
+			++argparse_context->longargs_count;
 		}
 	}
 	
@@ -191,9 +512,343 @@ void _argparse_add(
 			argparse_context->short_value_bitmap[(unsigned char)short_name >> 3] |= (1 << (short_name & 7));
 		}
 		
-		/* Actually register short argument in argparse context structure */
-		argparse_assert(argparse_context->shortargs_count < argparse_context->shortargs_cap);
-		_argparse_get_shortargs(argparse_context)[argparse_context->shortargs_count++] = parg;
+		++argparse_context->shortargs_count;
+	}
+}
+
+void _argparse_add_lean(
+	struct kjc_argparse* argparse_context,
+	int arg_id,
+	unsigned type_short_name,
+	const char* long_name,
+	const char* description,
+	const char* var_name
+) {
+	_argparse_add(
+		argparse_context,
+		arg_id,
+		(char)(type_short_name & 0xff),
+		long_name,
+		description,
+		(unsigned char)(type_short_name >> 8),
+		var_name
+	);
+}
+
+void _argparse_group(struct kjc_argparse* argparse_context, const char* title) {
+	if(!title) {
+		argparse_context->help_group = 0;
+		return;
+	}
+	
+	/* A title that was used before continues its group, so the options of a group don't have to be adjacent */
+	for(unsigned i = 0; i < argparse_context->help_groups_count; i++) {
+		if(strcmp(argparse_context->help_groups[i], title) == 0) {
+			argparse_context->help_group = (unsigned char)(i + 1);
+			return;
+		}
+	}
+	
+	argparse_assert(argparse_context->help_groups_count < 255 && "Too many help groups");
+	const char** groups = realloc(
+		argparse_context->help_groups, (argparse_context->help_groups_count + 1) * sizeof(*groups)
+	);
+	argparse_assert(groups != NULL && "Allocation failure");
+	groups[argparse_context->help_groups_count++] = title;
+	argparse_context->help_groups = groups;
+	argparse_context->help_group = (unsigned char)argparse_context->help_groups_count;
+}
+
+/* FNV-1a hash of a string, which is computed once per lookup of a choice or key */
+static inline uint64_t _argparse_hash_string(const char* name, size_t len) {
+	uint64_t hash = 0xcbf29ce484222325;
+	for(size_t i = 0; i < len; i++) {
+		hash = (hash ^ (unsigned char)name[i]) * 0x100000001b3;
+	}
+	return hash;
+}
+
+/* Spread the bits of a hash over the whole word, as the table index only uses its low bits */
+static inline uint64_t _argparse_hash_mix(uint64_t hash) {
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccd;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+static inline unsigned _argchoice_bucket(const struct _argchoices* choices, uint64_t hash) {
+	return (unsigned)_argparse_hash_mix(hash) & choices->bucket_mask;
+}
+
+static inline unsigned _argchoice_slot(const struct _argchoices* choices, uint64_t hash, unsigned displacement) {
+	return (unsigned)_argparse_hash_mix(hash ^ ((displacement + 1) * 0x9e3779b97f4a7c15)) & choices->slot_mask;
+}
+
+/* Keys of the choices, in the order their buckets are placed into the table (largest buckets first) */
+struct _argchoice_key {
+	uint64_t hash;
+	unsigned bucket;
+	unsigned bucket_size;
+	unsigned index;
+};
+
+static int _argchoice_key_compare(const void* _a, const void* _b) {
+	const struct _argchoice_key* a = _a;
+	const struct _argchoice_key* b = _b;
+	
+	if(a->bucket_size != b->bucket_size) {
+		return a->bucket_size > b->bucket_size ? -1 : 1;
+	}
+	return (a->bucket > b->bucket) - (a->bucket < b->bucket);
+}
+
+/*
+ * Build a perfect hash table of the choices with the hash and displace method. Each choice first hashes to a
+ * bucket, which holds about two of them. Buckets are then placed from largest to smallest, each searching for a
+ * displacement value that moves all of its choices into free slots. The table has at least twice as many slots
+ * as there are choices, so that search ends quickly. A lookup then always costs one hash and one string compare.
+ */
+static struct _argchoices* _argchoices_new(const char* const* names, size_t count) {
+	argparse_assert(count > 0 && count < UINT16_MAX && "Too many choices");
+	
+	unsigned bucket_count = 1;
+	while(bucket_count * 2 < count) {
+		bucket_count *= 2;
+	}
+	
+	unsigned slot_count = 2;
+	while(slot_count < count * 2) {
+		slot_count *= 2;
+	}
+	
+	/* The table lives in the same allocation, right after the struct */
+	size_t table_size = (bucket_count + slot_count) * sizeof(uint16_t);
+	struct _argchoices* choices = calloc(1, sizeof(*choices) + table_size);
+	struct _argchoice_key* keys = malloc(count * sizeof(*keys));
+	unsigned* bucket_sizes = calloc(bucket_count, sizeof(*bucket_sizes));
+	argparse_assert(choices != NULL && keys != NULL && bucket_sizes != NULL && "Allocation failure");
+	
+	choices->names = names;
+	choices->count = (unsigned)count;
+	choices->bucket_mask = bucket_count - 1;
+	choices->slot_mask = slot_count - 1;
+	choices->table = (uint16_t*)&choices[1];
+	
+	uint16_t* displacements = choices->table;
+	uint16_t* slots = &choices->table[bucket_count];
+	
+	for(unsigned i = 0; i < count; i++) {
+		keys[i].hash = _argparse_hash_string(names[i], strlen(names[i]));
+		keys[i].bucket = _argchoice_bucket(choices, keys[i].hash);
+		keys[i].index = i;
+		++bucket_sizes[keys[i].bucket];
+	}
+	for(unsigned i = 0; i < count; i++) {
+		keys[i].bucket_size = bucket_sizes[keys[i].bucket];
+	}
+	qsort(keys, count, sizeof(*keys), _argchoice_key_compare);
+	
+	for(unsigned first = 0; first < count; first += keys[first].bucket_size) {
+		const struct _argchoice_key* bucket = &keys[first];
+		unsigned displacement = 0;
+		
+		for(;;) {
+			/* Try to place every choice of the bucket, undoing the ones already placed on a collision */
+			unsigned placed = 0;
+			while(placed < bucket->bucket_size) {
+				unsigned slot = _argchoice_slot(choices, bucket[placed].hash, displacement);
+				if(slots[slot] != 0) {
+					break;
+				}
+				
+				slots[slot] = (uint16_t)(bucket[placed].index + 1);
+				++placed;
+			}
+			
+			if(placed == bucket->bucket_size) {
+				break;
+			}
+			
+			while(placed-- > 0) {
+				slots[_argchoice_slot(choices, bucket[placed].hash, displacement)] = 0;
+			}
+			
+			/* Choices with the same hash can never be separated, which in practice means they're duplicates */
+			++displacement;
+			argparse_assert(displacement < UINT16_MAX && "Duplicate choices");
+		}
+		
+		displacements[bucket->bucket] = (uint16_t)displacement;
+	}
+	
+	free(bucket_sizes);
+	free(keys);
+	return choices;
+}
+
+/* Index of the choice named by value (which has length len), or -1 if it isn't one of the choices */
+static int _argchoices_find(const struct _argchoices* choices, const char* value, size_t len) {
+	uint64_t hash = _argparse_hash_string(value, len);
+	unsigned displacement = choices->table[_argchoice_bucket(choices, hash)];
+	unsigned index = choices->table[choices->bucket_mask + 1 + _argchoice_slot(choices, hash, displacement)];
+	if(index == 0) {
+		return -1;
+	}
+	
+	/* Any value hashes to some slot, so check that it's really the choice stored there */
+	const char* name = choices->names[index - 1];
+	if(strncmp(name, value, len) != 0 || name[len] != '\0') {
+		return -1;
+	}
+	return (int)index - 1;
+}
+
+void _argparse_add_choice(
+	struct kjc_argparse* argparse_context,
+	int arg_id,
+	char short_name,
+	const char* long_name,
+	const char* description,
+	const char* var_name,
+	const char* const* choices,
+	size_t count
+) {
+	_argparse_add(argparse_context, arg_id, short_name, long_name, description, _kARG_TYPE_CHOICE, var_name);
+	
+	/* Owned by the context rather than the arginfo, which is moved around until the tables are built */
+	struct _argchoices* table = _argchoices_new(choices, count);
+	table->next = argparse_context->choices;
+	argparse_context->choices = table;
+	
+	struct _arginfo* argstorage = argparse_context->argbuffer;
+	argstorage[argparse_context->argstorage_count - 1].ext.choices = table;
+}
+
+/* Hash table slot of a key, which a lookup probes linearly from */
+static inline unsigned _argmap_first_slot(const struct kjc_argmap* map, uint64_t hash) {
+	return (unsigned)_argparse_hash_mix(hash) & (map->cap * 2 - 1);
+}
+
+/* Slot holding the key, or the empty slot where it would go */
+static uint32_t* _argmap_find_slot(const struct kjc_argmap* map, const char* key, size_t key_len) {
+	unsigned mask = map->cap * 2 - 1;
+	unsigned slot = _argmap_first_slot(map, _argparse_hash_string(key, key_len));
+	
+	for(;;) {
+		uint32_t entry = map->slots[slot];
+		if(entry == 0) {
+			return &map->slots[slot];
+		}
+		
+		const struct kjc_argkv* kv = &map->entries[entry - 1];
+		if(kv->key_len == key_len && memcmp(kv->key, key, key_len) == 0) {
+			return &map->slots[slot];
+		}
+		
+		slot = (slot + 1) & mask;
+	}
+}
+
+/* Double the capacity of the map, with the entries and the (twice as large) hash table in one allocation */
+static void _argmap_grow(struct kjc_argmap* map) {
+	unsigned cap = map->cap ? map->cap * 2 : 16;
+	size_t entries_size = cap * sizeof(struct kjc_argkv);
+	struct kjc_argkv* entries = malloc(entries_size + cap * 2 * sizeof(uint32_t));
+	argparse_assert(entries != NULL && "Allocation failure");
+	
+	if(map->count > 0) {
+		memcpy(entries, map->entries, map->count * sizeof(*entries));
+	}
+	free(map->entries);
+	
+	map->entries = entries;
+	map->cap = cap;
+	map->slots = (uint32_t*)((char*)entries + entries_size);
+	memset(map->slots, 0, cap * 2 * sizeof(uint32_t));
+	
+	/* Keys are unique, so each one just goes into the first empty slot */
+	unsigned mask = cap * 2 - 1;
+	for(unsigned i = 0; i < map->count; i++) {
+		unsigned slot = _argmap_first_slot(map, _argparse_hash_string(entries[i].key, entries[i].key_len));
+		while(map->slots[slot] != 0) {
+			slot = (slot + 1) & mask;
+		}
+		map->slots[slot] = i + 1;
+	}
+}
+
+/* Add or replace a key, returns NULL if the key was already given to a KJC_ARGMAP_UNIQUE map */
+static const struct kjc_argkv* _argmap_put(struct kjc_argmap* map, const struct kjc_argkv* kv) {
+	/* The hash table is never more than half full */
+	if(map->count == map->cap) {
+		_argmap_grow(map);
+	}
+	
+	uint32_t* slot = _argmap_find_slot(map, kv->key, kv->key_len);
+	if(*slot != 0) {
+		if(map->flags & KJC_ARGMAP_UNIQUE) {
+			return NULL;
+		}
+		
+		/* Last one wins, but the key keeps its place in the order of the entries */
+		map->entries[*slot - 1] = *kv;
+		return &map->entries[*slot - 1];
+	}
+	
+	map->entries[map->count] = *kv;
+	*slot = ++map->count;
+	return &map->entries[map->count - 1];
+}
+
+void _argparse_add_kv(
+	struct kjc_argparse* argparse_context,
+	int arg_id,
+	char short_name,
+	const char* long_name,
+	const char* description,
+	const char* var_name,
+	struct kjc_argmap* map
+) {
+	argparse_assert(map != NULL);
+	_argparse_add(argparse_context, arg_id, short_name, long_name, description, _kARG_TYPE_KV, var_name);
+	
+	struct _arginfo* argstorage = argparse_context->argbuffer;
+	argstorage[argparse_context->argstorage_count - 1].ext.map = map;
+}
+
+void _argparse_add_constraints(
+	struct kjc_argparse* argparse_context,
+	unsigned char kind,
+	const char* const* names,
+	size_t count,
+	const char* other
+) {
+	argparse_assert(kind >= _kARG_CONSTRAINT_REQUIRED && kind <= _kARG_CONSTRAINT_REQUIRES);
+	argparse_assert(kind == _kARG_CONSTRAINT_REQUIRED || other != NULL);
+	
+	if(argparse_context->constraints_count + count > argparse_context->constraints_cap) {
+		/* Staged separately from the arguments until they're compacted, grown like them */
+		unsigned cap = argparse_context->constraints_cap ? argparse_context->constraints_cap : 8;
+		while(cap < argparse_context->constraints_count + count) {
+			cap *= 2;
+		}
+		
+		struct _argconstraint* staging = realloc(argparse_context->constraints_staging, cap * sizeof(*staging));
+		argparse_assert(staging != NULL && "Allocation failure");
+		argparse_context->constraints_staging = staging;
+		argparse_context->constraints_cap = cap;
+	}
+	
+	for(size_t i = 0; i < count; i++) {
+		/* Names are resolved to arginfo structs in _argparse_post_init(), once the tables are sorted */
+		unsigned index = argparse_context->constraints_count++;
+		struct _argconstraint* constraint = &argparse_context->constraints_staging[index];
+		memset(constraint, 0, sizeof(*constraint));
+		constraint->name = names[i];
+		constraint->other = other;
+		constraint->kind = kind;
 	}
 }
 
@@ -216,26 +871,104 @@ static const char* _argtype_name(unsigned char type) {
 	switch(type) {
 		case _kARG_TYPE_STRING: return "string";
 		case _kARG_TYPE_LONG: return "int";
+		case _kARG_TYPE_CHOICE: return "choice";
+		case _kARG_TYPE_KV: return "key=value";
 	}
 	
 	return NULL;
 }
 
 static const char* _arginfo_value_hint(const struct kjc_argparse* argparse_context, const struct _arginfo* arginfo) {
-	if((argparse_context->flags & _kARGPARSE_USE_VARNAMES) && arginfo->var_name != NULL) {
+	if(_argparse_flag(argparse_context, _kARGPARSE_USE_VARNAMES) && arginfo->var_name != NULL) {
 		return arginfo->var_name;
 	}
 	
 	return _argtype_name(arginfo->type);
 }
 
-static void _argparse_post_init(struct kjc_argparse* argparse_context) {
-	/* Initialization phase just ended, check consistency */
-	argparse_assert(argparse_context->subcmds_count == argparse_context->subcmds_cap);
-	argparse_assert(argparse_context->longargs_count == argparse_context->longargs_cap);
-	argparse_assert(argparse_context->shortargs_count == argparse_context->shortargs_cap);
-	argparse_assert(argparse_context->argstorage_count == argparse_context->argstorage_cap);
+static void _argparse_resolve_constraints(struct kjc_argparse* argparse_context);
+static struct _arginfo* _argparse_find_longarg(struct kjc_argparse* argparse_context, const char* longarg);
+static void _argparse_record_begin(struct kjc_argparse* argparse_context);
+
+/* Widen the long option column of the help output to fit this option */
+static void _argparse_update_long_name_width(struct kjc_argparse* argparse_context, const struct _arginfo* arginfo) {
+	unsigned arglen = (unsigned)strlen(arginfo->long_name);
+	const char* valhint = _arginfo_value_hint(argparse_context, arginfo);
+	if(valhint) {
+		/* For something like "--count <num>", this counts the length of the " <num>" part */
+		arglen += 3 + (unsigned)strlen(valhint);
+	}
+	
+	if(arglen > argparse_context->long_name_width) {
+		argparse_context->long_name_width = arglen;
+	}
+}
+
+/* Move the staged arguments and constraints into one exactly-sized buffer, then fill in the lookup tables */
+static void _argparse_compact(struct kjc_argparse* argparse_context) {
+	struct _arginfo* staged_args = argparse_context->argbuffer;
+	struct _argconstraint* staged_constraints = argparse_context->constraints_staging;
+	
+	argparse_context->argstorage_cap = argparse_context->argstorage_count;
+	argparse_context->subcmds_cap = argparse_context->subcmds_count;
+	argparse_context->longargs_cap = argparse_context->longargs_count;
+	argparse_context->shortargs_cap = argparse_context->shortargs_count;
+	argparse_context->globals_cap = argparse_context->parent ? 0 : argparse_context->globals_count;
+	argparse_context->constraints_cap = argparse_context->constraints_count;
+	argparse_context->argbuffer = NULL;
+	argparse_context->constraints_staging = NULL;
+	
+	size_t bufsize = _argparse_get_argbuffer_size(argparse_context);
+	if(bufsize > 0) {
+		argparse_context->argbuffer = malloc(bufsize);
+		argparse_assert(argparse_context->argbuffer != NULL && "Allocation failure");
+		
+		struct _arginfo* argstorage = _argparse_get_argstorage(argparse_context);
+		struct _arginfo** subcmds = _argparse_get_subcmds(argparse_context);
+		struct _arginfo** longargs = _argparse_get_longargs(argparse_context);
+		struct _arginfo** shortargs = _argparse_get_shortargs(argparse_context);
+		struct _arginfo** globals = _argparse_get_globals(argparse_context);
+		unsigned subcmds_count = 0, longargs_count = 0, shortargs_count = 0, globals_count = 0;
+		
+		for(unsigned i = 0; i < argparse_context->argstorage_count; i++) {
+			struct _arginfo* parg = &argstorage[i];
+			*parg = staged_args[i];
+			
+			if(parg->long_name != NULL) {
+				if(parg->type == _kARG_TYPE_COMMAND) {
+					subcmds[subcmds_count++] = parg;
+				}
+				else {
+					longargs[longargs_count++] = parg;
+				}
+			}
+			if(parg->short_name != '\0') {
+				shortargs[shortargs_count++] = parg;
+			}
+			if(parg->global) {
+				globals[globals_count++] = parg;
+			}
+		}
+		
+		/* Subcommand contexts point to this table from _argparse_init(), the root outlives all of them */
+		if(argparse_context->globals_cap > 0) {
+			argparse_context->globals = globals;
+		}
+		
+		if(argparse_context->constraints_count > 0) {
+			memcpy(
+				_argparse_get_constraints(argparse_context), staged_constraints,
+				argparse_context->constraints_count * sizeof(*staged_constraints)
+			);
+		}
+	}
 	
+	free(staged_args);
+	free(staged_constraints);
+}
+
+/* Sort the lookup tables, check them for duplicates, and fill in their search keys and the widths for the help */
+static void _argparse_sort_tables(struct kjc_argparse* argparse_context) {
 	struct _arginfo** subcmds = _argparse_get_subcmds(argparse_context);
 	struct _arginfo** longargs = _argparse_get_longargs(argparse_context);
 	struct _arginfo** shortargs = _argparse_get_shortargs(argparse_context);
@@ -277,33 +1010,214 @@ static void _argparse_post_init(struct kjc_argparse* argparse_context) {
 	
 	/* Compute longest long arg width */
 	for(unsigned i = 0; i < argparse_context->longargs_count; i++) {
-		/* Update max long_name_width */
-		unsigned arglen = (unsigned)strlen(longargs[i]->long_name);
-		const char* valhint = _arginfo_value_hint(argparse_context, longargs[i]);
-		if(valhint) {
-			/* For something like "--count <num>", this counts the length of the " <num>" part */
-			arglen += 3 + (unsigned)strlen(valhint);
-		}
-		
-		if(arglen > argparse_context->long_name_width) {
-			argparse_context->long_name_width = arglen;
+		_argparse_update_long_name_width(argparse_context, longargs[i]);
+	}
+	
+	/* A subcommand's help also lists the global options it inherited, which can't be shadowed by its own */
+	if(argparse_context->parent != NULL) {
+		for(unsigned i = 0; i < argparse_context->globals_count; i++) {
+			const struct _arginfo* global = argparse_context->globals[i];
+			argparse_assert(
+				!_argparse_has_short_option(argparse_context, global->short_name)
+				&& (!global->long_name || !_argparse_find_longarg(argparse_context, global->long_name))
+				&& "Option shadows a global option"
+			);
+			
+			if(global->long_name != NULL) {
+				_argparse_update_long_name_width(argparse_context, global);
+			}
+		}
+	}
+	
+	/* Fill in the search keys, now that the tables are in their final order */
+	uint64_t* name_prefixes = _argparse_get_name_prefixes(argparse_context);
+	unsigned* name_lengths = _argparse_get_name_lengths(argparse_context);
+	for(unsigned i = 0; i < argparse_context->subcmds_count + argparse_context->longargs_count; i++) {
+		/* Subcommands and long args are adjacent, so their keys can be filled in together */
+		const char* name = subcmds[i]->long_name;
+		name_prefixes[i] = _argparse_name_prefix(name);
+		name_lengths[i] = (unsigned)strlen(name);
+	}
+	
+	argparse_context->ext_flags &= ~_kARGPARSE_EXT_UNSORTED;
+}
+
+/* Add a name to an open addressing hash table of names, or return false if it's already in it */
+static bool _argparse_name_insert(const char** slots, size_t mask, const char* name) {
+	size_t i = (size_t)_argparse_hash_bytes(0xcbf29ce484222325, name, strlen(name)) & mask;
+	while(slots[i] != NULL) {
+		if(strcmp(slots[i], name) == 0) {
+			return false;
 		}
+		
+		i = (i + 1) & mask;
+	}
+	
+	slots[i] = name;
+	return true;
+}
+
+/*
+ * The same checks that _argparse_sort_tables() makes on adjacent names, for tables that stay unsorted. Each name
+ * goes in a hash table instead, so this is linear in the number of options.
+ */
+static void _argparse_check_names(const struct kjc_argparse* argparse_context) {
+	struct _arginfo** subcmds = _argparse_get_subcmds(argparse_context);
+	struct _arginfo** longargs = _argparse_get_longargs(argparse_context);
+	unsigned globals_count = argparse_context->parent != NULL ? argparse_context->globals_count : 0;
+	
+	unsigned most = argparse_context->longargs_count + globals_count;
+	if(argparse_context->subcmds_count > most) {
+		most = argparse_context->subcmds_count;
+	}
+	if(most < 2) {
+		return;
+	}
+	
+	/* At most half full, and on the stack unless the block has more than 256 names */
+	const char* stack_slots[512];
+	size_t cap = 4;
+	while(cap < (size_t)most * 2) {
+		cap <<= 1;
+	}
+	const char** slots = stack_slots;
+	if(cap <= sizeof(stack_slots) / sizeof(*stack_slots)) {
+		memset(slots, 0, cap * sizeof(*slots));
+	}
+	else {
+		slots = calloc(cap, sizeof(*slots));
+		argparse_assert(slots != NULL && "Allocation failure");
+	}
+	
+	for(unsigned i = 0; i < argparse_context->subcmds_count; i++) {
+		bool unique = _argparse_name_insert(slots, cap - 1, subcmds[i]->long_name);
+		argparse_assert(unique && "Duplicate subcommand");
+	}
+	
+	memset(slots, 0, cap * sizeof(*slots));
+	for(unsigned i = 0; i < argparse_context->longargs_count; i++) {
+		bool unique = _argparse_name_insert(slots, cap - 1, longargs[i]->long_name);
+		argparse_assert(unique && "Duplicate long arg name");
+	}
+	
+	for(unsigned i = 0; i < globals_count; i++) {
+		const struct _arginfo* global = argparse_context->globals[i];
+		argparse_assert(
+			!_argparse_has_short_option(argparse_context, global->short_name)
+			&& (!global->long_name || _argparse_name_insert(slots, cap - 1, global->long_name))
+			&& "Option shadows a global option"
+		);
+	}
+	
+	if(slots != stack_slots) {
+		free(slots);
+	}
+}
+
+static void _argparse_post_init(struct kjc_argparse* argparse_context) {
+	/* Initialization phase just ended, so all arguments are known */
+	_argparse_compact(argparse_context);
+	argparse_assert(!(argparse_context->ext_flags & _kARGPARSE_EXT_NEXT_GLOBAL) && "ARG_GLOBAL must wrap an option");
+	
+	/* Names are checked for duplicates either way, however many arguments there are */
+	if(!(argparse_context->ext_flags & _kARGPARSE_EXT_UNSORTED)) {
+		_argparse_sort_tables(argparse_context);
+	}
+	else {
+		_argparse_check_names(argparse_context);
 	}
 	
 	/* In case the long argument prefix was changed */
 	argparse_context->long_prefix_len = strlen(argparse_context->long_arg_prefix);
+	
+	if(argparse_context->constraints_count > 0) {
+		_argparse_resolve_constraints(argparse_context);
+	}
+	
+	if((argparse_context->ext_flags & _kARGPARSE_EXT_RECORD) && argparse_context->parent == NULL) {
+		_argparse_record_begin(argparse_context);
+	}
 }
 
-static int _arginfo_find_long(const void* key, const void* item) {
-	const char* name = key;
-	const struct _arginfo* const* parg = item;
-	argparse_assert((*parg)->long_name != NULL);
+#ifdef ARGPARSE_WITH_SCHEMA
+/* Schema build mode: write this context's args to the path named by the marker and exit if it's the one queried */
+static void _argparse_schema_dump(const struct kjc_argparse* argparse_context) {
+	const char* path = _argparse_schema_out;
+	if(!path || *path == '\0') {
+		return;
+	}
+	
+	/* Only the context reached by consuming every argument is dumped (the last subcommand named in argv) */
+	if(*argparse_context->argidx < argparse_context->orig_argc) {
+		return;
+	}
+	
+	uint32_t flags = 0
+		| (_argparse_flag(argparse_context, _kARGPARSE_AUTO_HELP) ? KJC_SCHEMA_NODE_AUTO_HELP : 0)
+		| (_argparse_flag(argparse_context, _kARGPARSE_DASHDASH) ? KJC_SCHEMA_NODE_DASHDASH : 0)
+		| (_argparse_flag(argparse_context, _kARGPARSE_WITH_SHORTGROUPS) ? KJC_SCHEMA_NODE_SHORTGROUPS : 0)
+		;
+	
+	struct kjc_schema_writer writer;
+	kjc_schema_writer_init(&writer);
+	kjc_schema_writer_add_node(
+		&writer, NULL, KJC_SCHEMA_NONE, argparse_context->positional_usage, argparse_context->long_arg_prefix, flags
+	);
+	
+	const struct _arginfo* argstorage = _argparse_get_argstorage(argparse_context);
+	for(unsigned i = 0; i < argparse_context->argstorage_count; i++) {
+		const struct _arginfo* pcur = &argstorage[i];
+		kjc_schema_writer_add_arg(
+			&writer, pcur->short_name, pcur->long_name, pcur->description, pcur->var_name, pcur->type
+		);
+		
+		if(pcur->type == _kARG_TYPE_CHOICE) {
+			for(unsigned j = 0; j < pcur->ext.choices->count; j++) {
+				kjc_schema_writer_add_choice(&writer, pcur->ext.choices->names[j]);
+			}
+		}
+	}
+	
+	size_t size = 0;
+	void* blob = kjc_schema_writer_finish(&writer, &size);
+	
+	FILE* fp = fopen(path, "wb");
+	int ok = fp != NULL && fwrite(blob, 1, size, fp) == size;
+	if(fp != NULL && fclose(fp) != 0) {
+		ok = 0;
+	}
+	free(blob);
+	
+	/* Don't run any handlers, the program was only started to describe itself */
+	exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+#endif /* ARGPARSE_WITH_SCHEMA */
+
+static int _arginfo_find_long(
+	const char* name,
+	uint64_t name_prefix,
+	uint64_t long_name_prefix,
+	unsigned long_name_len,
+	const struct _arginfo* arginfo
+) {
+	/* Check up to the length of arginfo's long arg, starting with the part stored in its prefix */
+	if(long_name_len < sizeof(name_prefix)) {
+		name_prefix &= ~(UINT64_MAX >> (8 * long_name_len));
+	}
+	if(name_prefix != long_name_prefix) {
+		return name_prefix < long_name_prefix ? -1 : 1;
+	}
 	
-	/* Check up to the length of arginfo's long arg */
-	size_t long_name_len = strlen((*parg)->long_name);
-	int diff = strncmp(name, (*parg)->long_name, long_name_len);
-	if(diff) {
-		return diff;
+	/* Only long names that don't fit in the prefix need the string itself */
+	if(long_name_len > sizeof(name_prefix)) {
+		int diff = strncmp(
+			name + sizeof(name_prefix),
+			arginfo->long_name + sizeof(name_prefix),
+			long_name_len - sizeof(name_prefix)
+		);
+		if(diff) {
+			return diff;
+		}
 	}
 	
 	/* Fully matched long arg? */
@@ -332,35 +1246,485 @@ static int _arginfo_find_short(const void* key, const void* item) {
 	return *name - (*parg)->short_name;
 }
 
-static struct _arginfo** _args_search_long(struct _arginfo** args, const char* name, unsigned count) {
-	return bsearch(name, args, count, sizeof(*args), _arginfo_find_long);
+static struct _arginfo* _args_search_long(
+	struct _arginfo** args,
+	const uint64_t* name_prefixes,
+	const unsigned* name_lengths,
+	const char* name,
+	unsigned count
+) {
+	uint64_t name_prefix = _argparse_name_prefix(name);
+	unsigned lo = 0, hi = count;
+	
+	while(lo < hi) {
+		unsigned mid = lo + (hi - lo) / 2;
+		int diff = _arginfo_find_long(name, name_prefix, name_prefixes[mid], name_lengths[mid], args[mid]);
+		if(diff == 0) {
+			return args[mid];
+		}
+		
+		if(diff < 0) {
+			hi = mid;
+		}
+		else {
+			lo = mid + 1;
+		}
+	}
+	
+	return NULL;
 }
 
 static struct _arginfo** _args_search_short(struct _arginfo** args, char name, unsigned count) {
 	return bsearch(&name, args, count, sizeof(*args), _arginfo_find_short);
 }
 
+/* Find a long name in a table that is still in registration order, matching like _arginfo_find_long() */
+static struct _arginfo* _args_scan_long(struct _arginfo** args, const char* name, unsigned count) {
+	for(unsigned i = 0; i < count; i++) {
+		size_t len = strlen(args[i]->long_name);
+		if(strncmp(name, args[i]->long_name, len) == 0 && (name[len] == '\0' || name[len] == '=')) {
+			return args[i];
+		}
+	}
+	
+	return NULL;
+}
+
 static struct _arginfo* _argparse_find_subcmd(struct kjc_argparse* argparse_context, const char* subcmd) {
-	struct _arginfo** parg = _args_search_long(
-		_argparse_get_subcmds(argparse_context), subcmd, argparse_context->subcmds_count
+	if(argparse_context->ext_flags & _kARGPARSE_EXT_UNSORTED) {
+		return _args_scan_long(_argparse_get_subcmds(argparse_context), subcmd, argparse_context->subcmds_count);
+	}
+	
+	return _args_search_long(
+		_argparse_get_subcmds(argparse_context),
+		_argparse_get_name_prefixes(argparse_context),
+		_argparse_get_name_lengths(argparse_context),
+		subcmd,
+		argparse_context->subcmds_count
 	);
-	return parg ? *parg : NULL;
 }
 
 static struct _arginfo* _argparse_find_longarg(struct kjc_argparse* argparse_context, const char* longarg) {
-	struct _arginfo** parg = _args_search_long(
-		_argparse_get_longargs(argparse_context), longarg, argparse_context->longargs_count
+	if(argparse_context->ext_flags & _kARGPARSE_EXT_UNSORTED) {
+		return _args_scan_long(_argparse_get_longargs(argparse_context), longarg, argparse_context->longargs_count);
+	}
+	
+	/* The keys for the long args come right after the ones for subcommands */
+	return _args_search_long(
+		_argparse_get_longargs(argparse_context),
+		&_argparse_get_name_prefixes(argparse_context)[argparse_context->subcmds_cap],
+		&_argparse_get_name_lengths(argparse_context)[argparse_context->subcmds_cap],
+		longarg,
+		argparse_context->longargs_count
 	);
-	return parg ? *parg : NULL;
+}
+
+static struct _arginfo* _argparse_find_shortarg(struct kjc_argparse* argparse_context, char shortarg);
+
+/* Look up the option that a constraint refers to by its long name, or by its short name if it's a single character */
+static struct _arginfo* _argparse_find_named(struct kjc_argparse* argparse_context, const char* name) {
+	struct _arginfo* arginfo = _argparse_find_longarg(argparse_context, name);
+	if(!arginfo) {
+		arginfo = _argparse_find_subcmd(argparse_context, name);
+	}
+	if(!arginfo && name[0] != '\0' && name[1] == '\0') {
+		arginfo = _argparse_find_shortarg(argparse_context, name[0]);
+	}
+	
+	argparse_assert(arginfo != NULL && "Constraint refers to an unknown option");
+	return arginfo;
+}
+
+/* Give each option that's part of a constraint its own bit in the constraint bitsets */
+static void _arginfo_assign_constraint_bit(struct _arginfo* arginfo, unsigned* nbits) {
+	if(arginfo->constraint_bit == 0) {
+		/* Checked in every build, as the bit of one more option would be past the end of the bitsets */
+		if(*nbits >= _kARGPARSE_MAX_CONSTRAINED) {
+			fprintf(stderr, "Error: Constraints refer to more than %d options\n", _kARGPARSE_MAX_CONSTRAINED);
+			abort();
+		}
+		arginfo->constraint_bit = (unsigned short)++*nbits;
+	}
+}
+
+static int _argconstraint_compare(const void* _a, const void* _b) {
+	const struct _argconstraint* a = _a;
+	const struct _argconstraint* b = _b;
+	
+	if(a->kind != b->kind) {
+		return a->kind - b->kind;
+	}
+	
+	/* Keeps the members of each exclusive group next to each other */
+	if(a->other != b->other) {
+		if(!a->other || !b->other) {
+			return a->other ? 1 : -1;
+		}
+		
+		int cmp = strcmp(a->other, b->other);
+		if(cmp != 0) {
+			return cmp;
+		}
+	}
+	
+	return strcmp(a->name, b->name);
+}
+
+static void _argparse_resolve_constraints(struct kjc_argparse* argparse_context) {
+	struct _argconstraint* constraints = _argparse_get_constraints(argparse_context);
+	unsigned count = argparse_context->constraints_count;
+	unsigned nbits = 0;
+	
+	/* Sorted once here so that checking them at the end of parsing is a single pass */
+	qsort(constraints, count, sizeof(*constraints), _argconstraint_compare);
+	
+	for(unsigned i = 0; i < count; i++) {
+		struct _argconstraint* constraint = &constraints[i];
+		constraint->arg = _argparse_find_named(argparse_context, constraint->name);
+		_arginfo_assign_constraint_bit(constraint->arg, &nbits);
+		
+		switch(constraint->kind) {
+			case _kARG_CONSTRAINT_REQUIRED:
+				_argparse_bitset_set(argparse_context->constraint_required, constraint->arg->constraint_bit - 1);
+				break;
+			
+			case _kARG_CONSTRAINT_EXCLUSIVE:
+				/* Mark the first member of each group, so the check doesn't need to compare group names */
+				constraint->group_start = i == 0
+					|| constraints[i - 1].kind != _kARG_CONSTRAINT_EXCLUSIVE
+					|| strcmp(constraints[i - 1].other, constraint->other) != 0;
+				break;
+			
+			case _kARG_CONSTRAINT_REQUIRES:
+				constraint->other_arg = _argparse_find_named(argparse_context, constraint->other);
+				_arginfo_assign_constraint_bit(constraint->other_arg, &nbits);
+				break;
+		}
+	}
+}
+
+static void _arginfo_print_name(
+	const struct kjc_argparse* argparse_context,
+	const struct _arginfo* arginfo,
+	struct _argsink* sink
+) {
+	if(arginfo->type == _kARG_TYPE_COMMAND) {
+		_argsink_printf(sink, "%s", arginfo->long_name);
+	}
+	else if(arginfo->long_name) {
+		_argsink_printf(sink, "%s%s", argparse_context->long_arg_prefix, arginfo->long_name);
+	}
+	else {
+		_argsink_printf(sink, "-%c", arginfo->short_name);
+	}
+}
+
+static inline bool _argparse_matched(const struct kjc_argparse* argparse_context, const struct _arginfo* arginfo) {
+	return _argparse_bitset_test(argparse_context->constraint_matched, arginfo->constraint_bit - 1);
+}
+
+/*
+ * Check all constraints once every argument has been parsed, returning the first one that isn't met (or NULL).
+ * With a sink, an error is printed to it for each constraint that isn't met.
+ */
+static const struct _argconstraint* _argparse_check_constraints(
+	const struct kjc_argparse* argparse_context,
+	struct _argsink* sink
+) {
+	const struct _argconstraint* constraints = _argparse_get_constraints(argparse_context);
+	const struct _arginfo* group_first = NULL;
+	const struct _argconstraint* failed = NULL;
+	
+	/* Required options are all checked at once, a word at a time */
+	uint64_t missing = 0;
+	for(unsigned i = 0; i < _kARGPARSE_CONSTRAINT_WORDS; i++) {
+		missing |= argparse_context->constraint_required[i] & ~argparse_context->constraint_matched[i];
+	}
+	
+	for(unsigned i = 0; i < argparse_context->constraints_count; i++) {
+		const struct _argconstraint* constraint = &constraints[i];
+		
+		switch(constraint->kind) {
+			case _kARG_CONSTRAINT_REQUIRED:
+				if(!missing || _argparse_matched(argparse_context, constraint->arg)) {
+					break;
+				}
+				
+				failed = failed ? failed : constraint;
+				if(sink != NULL) {
+					_argsink_printf(sink, "Error: The ");
+					_arginfo_print_name(argparse_context, constraint->arg, sink);
+					_argsink_printf(sink, " option is required.\n");
+				}
+				break;
+			
+			case _kARG_CONSTRAINT_EXCLUSIVE:
+				if(constraint->group_start) {
+					group_first = NULL;
+				}
+				if(!_argparse_matched(argparse_context, constraint->arg)) {
+					break;
+				}
+				if(!group_first) {
+					group_first = constraint->arg;
+					break;
+				}
+				
+				failed = failed ? failed : constraint;
+				if(sink != NULL) {
+					_argsink_printf(sink, "Error: The ");
+					_arginfo_print_name(argparse_context, group_first, sink);
+					_argsink_printf(sink, " and ");
+					_arginfo_print_name(argparse_context, constraint->arg, sink);
+					_argsink_printf(sink, " options can't be used together.\n");
+				}
+				break;
+			
+			case _kARG_CONSTRAINT_REQUIRES:
+				if(
+					!_argparse_matched(argparse_context, constraint->arg)
+					|| _argparse_matched(argparse_context, constraint->other_arg)
+				) {
+					break;
+				}
+				
+				failed = failed ? failed : constraint;
+				if(sink != NULL) {
+					_argsink_printf(sink, "Error: The ");
+					_arginfo_print_name(argparse_context, constraint->arg, sink);
+					_argsink_printf(sink, " option requires the ");
+					_arginfo_print_name(argparse_context, constraint->other_arg, sink);
+					_argsink_printf(sink, " option.\n");
+				}
+				break;
+		}
+	}
+	
+	return failed;
 }
 
 static struct _arginfo* _argparse_find_shortarg(struct kjc_argparse* argparse_context, char shortarg) {
+	if(argparse_context->ext_flags & _kARGPARSE_EXT_UNSORTED) {
+		struct _arginfo** shortargs = _argparse_get_shortargs(argparse_context);
+		for(unsigned i = 0; i < argparse_context->shortargs_count; i++) {
+			if(shortargs[i]->short_name == shortarg) {
+				return shortargs[i];
+			}
+		}
+		return NULL;
+	}
+	
 	struct _arginfo** parg = _args_search_short(
 		_argparse_get_shortargs(argparse_context), shortarg, argparse_context->shortargs_count
 	);
 	return parg ? *parg : NULL;
 }
 
+/*
+ * Find the option named by an argument among the ones matched most recently, which are kept in most recently used
+ * order. Programs like compiler drivers repeat the same few options (-I, -L, --define) many times over, and these
+ * are then found without searching the tables. Options are only added once the search for a subcommand failed, so
+ * finding one here also means that the argument isn't a subcommand.
+ */
+static struct _arginfo* _argparse_hot_find(struct kjc_argparse* argparse_context, const char* arg, uint64_t prefix) {
+#ifdef KJC_ARGPARSE_NO_HOT_CACHE
+	/* Only for measuring what the cache saves (bench/repeat_parse_nocache), every option is searched for */
+	(void)argparse_context;
+	(void)arg;
+	(void)prefix;
+	return NULL;
+#else /* KJC_ARGPARSE_NO_HOT_CACHE */
+	struct _arghot* hot = argparse_context->hot;
+	
+	for(unsigned i = 0; i < _kARGPARSE_HOT_COUNT && hot[i].arginfo != NULL; i++) {
+		uint64_t key = prefix;
+		if(hot[i].len < sizeof(key)) {
+			key &= ~(UINT64_MAX >> (8 * hot[i].len));
+		}
+		if(key != hot[i].key) {
+			continue;
+		}
+		
+		/* The name has to end where the one it was matched from did */
+		size_t rest = hot[i].len > sizeof(key) ? hot[i].len - sizeof(key) : 0;
+		if(rest > 0 && strncmp(&arg[sizeof(key)], &hot[i].arg[sizeof(key)], rest) != 0) {
+			continue;
+		}
+		if(arg[hot[i].len] != '\0' && arg[hot[i].len] != hot[i].sep) {
+			continue;
+		}
+		
+		struct _arghot found = hot[i];
+		memmove(&hot[1], &hot[0], i * sizeof(*hot));
+		hot[0] = found;
+		return found.arginfo;
+	}
+	
+	return NULL;
+#endif /* KJC_ARGPARSE_NO_HOT_CACHE */
+}
+
+/*
+ * Remember an option that was just found by searching the tables. It takes the first free entry, or else replaces the
+ * least recently used one, so that options which are each given once don't have to shift the others down.
+ */
+static void _argparse_hot_add(
+	struct kjc_argparse* argparse_context,
+	const char* arg,
+	uint64_t prefix,
+	unsigned len,
+	char sep,
+	struct _arginfo* arginfo
+) {
+#ifdef KJC_ARGPARSE_NO_HOT_CACHE
+	(void)argparse_context;
+	(void)arg;
+	(void)prefix;
+	(void)len;
+	(void)sep;
+	(void)arginfo;
+#else /* KJC_ARGPARSE_NO_HOT_CACHE */
+	struct _arghot* hot = argparse_context->hot;
+	unsigned i = 0;
+	while(i < _kARGPARSE_HOT_COUNT - 1 && hot[i].arginfo != NULL) {
+		i++;
+	}
+	
+	if(len < sizeof(prefix)) {
+		prefix &= ~(UINT64_MAX >> (8 * len));
+	}
+	hot[i].arg = arg;
+	hot[i].arginfo = arginfo;
+	hot[i].key = prefix;
+	hot[i].len = len;
+	hot[i].sep = sep;
+#endif /* KJC_ARGPARSE_NO_HOT_CACHE */
+}
+
+/* Whether _argparse_parse() would treat this argument as positional, without needing its length */
+static inline bool _argparse_is_positional(struct kjc_argparse* argparse_context, const char* arg) {
+	size_t prefix_len = argparse_context->long_prefix_len;
+	if(strncmp(arg, argparse_context->long_arg_prefix, prefix_len) == 0 && arg[prefix_len] != '\0') {
+		return false;
+	}
+	if(arg[0] == '-' && arg[1] != '\0') {
+		return false;
+	}
+	
+	return argparse_context->subcmds_count == 0 || _argparse_find_subcmd(argparse_context, arg) == NULL;
+}
+
+/* Whether an argument is one of the root's global options, in a form that _argparse_parse() accepts */
+static bool _argparse_is_global(struct kjc_argparse* argparse_context, const char* arg) {
+	size_t prefix_len = argparse_context->long_prefix_len;
+	if(strncmp(arg, argparse_context->long_arg_prefix, prefix_len) == 0 && arg[prefix_len] != '\0') {
+		struct _arginfo* arginfo = _argparse_find_longarg(argparse_context, &arg[prefix_len]);
+		return arginfo != NULL && arginfo->global;
+	}
+	if(arg[0] != '-' || arg[1] == '\0' || arg[1] == '-') {
+		return false;
+	}
+	
+	struct _arginfo* first = _argparse_find_shortarg(argparse_context, arg[1]);
+	if(first == NULL || !first->global) {
+		return false;
+	}
+	if(arg[2] == '\0' || first->type == _kARG_TYPE_KV) {
+		return true;
+	}
+	
+	/* A group of short options is only taken if every one of them is global */
+	if(!_argparse_flag(argparse_context, _kARGPARSE_WITH_SHORTGROUPS)) {
+		return false;
+	}
+	for(const char* c = &arg[2]; *c != '\0'; c++) {
+		struct _arginfo* arginfo = _argparse_find_shortarg(argparse_context, *c);
+		if(arginfo == NULL || !arginfo->global) {
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+/*
+ * Whether an argument after a subcommand may be one of the subcommand's options, taking the next argument as its
+ * value. The root can't tell, as the subcommand only registers its options once its handler runs.
+ */
+static bool _argparse_may_take_value(const struct kjc_argparse* argparse_context, const char* arg) {
+	size_t prefix_len = argparse_context->long_prefix_len;
+	if(strncmp(arg, argparse_context->long_arg_prefix, prefix_len) == 0 && arg[prefix_len] != '\0') {
+		/* Unless its value is embedded, like --name=value */
+		return strchr(arg, '=') == NULL;
+	}
+	
+	return arg[0] == '-' && arg[1] != '\0';
+}
+
+/* A subcommand's own lookup missed, so check whether the argument is one of the global options it inherited */
+static const struct _arginfo* _argparse_find_global(const struct kjc_argparse* argparse_context, const char* arg) {
+	size_t prefix_len = argparse_context->long_prefix_len;
+	bool is_long = strncmp(arg, argparse_context->long_arg_prefix, prefix_len) == 0 && arg[prefix_len] != '\0';
+	if(!is_long && (arg[0] != '-' || arg[1] == '\0' || arg[2] != '\0')) {
+		return NULL;
+	}
+	
+	for(unsigned i = 0; i < argparse_context->globals_count; i++) {
+		const struct _arginfo* global = argparse_context->globals[i];
+		if(is_long && global->long_name != NULL) {
+			size_t len = strlen(global->long_name);
+			const char* name = &arg[prefix_len];
+			if(strncmp(name, global->long_name, len) == 0 && (name[len] == '\0' || name[len] == '=')) {
+				return global;
+			}
+		}
+		else if(!is_long && global->short_name == arg[1]) {
+			return global;
+		}
+	}
+	
+	return NULL;
+}
+
+static inline bool _argparse_is_hoisted(const struct kjc_argparse* argparse_context, int argi) {
+	return (argparse_context->hoisted[argi >> 3] >> (argi & 7)) & 1;
+}
+
+/*
+ * Global options given after a subcommand are handled by the root before the subcommand's handler runs. argv is
+ * left as it is: each one is marked in the hoisted bitset along with any values it took, and the subcommand's
+ * contexts skip over them. A global option right after one of the subcommand's own options may be that option's
+ * value instead, like the "-v" in "commit -m -v", so it's left for the subcommand, which knows which it is.
+ */
+static char* _argparse_hoist_next(struct kjc_argparse* argparse_context) {
+	char** argv = argparse_context->orig_argv;
+	int* argidx = argparse_context->argidx;
+	
+	/* Mark the last global option, with any values it took */
+	for(int i = argparse_context->hoist_last; i < *argidx; i++) {
+		argparse_context->hoisted[i >> 3] |= (unsigned char)(1u << (i & 7));
+	}
+	
+	bool maybe_value = false;
+	while(*argidx < argparse_context->orig_argc) {
+		char* arg = argv[(*argidx)++];
+		
+		/* Everything after "--" belongs to the subcommand */
+		if(strcmp(arg, "--") == 0) {
+			break;
+		}
+		
+		if(!maybe_value && _argparse_is_global(argparse_context, arg)) {
+			argparse_context->hoist_last = *argidx - 1;
+			return arg;
+		}
+		
+		maybe_value = _argparse_may_take_value(argparse_context, arg);
+	}
+	
+	return NULL;
+}
+
 #ifndef NDEBUG
 static inline const char* _argparse_repr_type(unsigned char type) {
 	switch(type) {
@@ -369,6 +1733,8 @@ static inline const char* _argparse_repr_type(unsigned char type) {
 		case _kARG_TYPE_LONG: return "_kARG_TYPE_LONG";
 		case _kARG_TYPE_SHORTGROUP: return "_kARG_TYPE_SHORTGROUP";
 		case _kARG_TYPE_COMMAND: return "_kARG_TYPE_COMMAND";
+		case _kARG_TYPE_CHOICE: return "_kARG_TYPE_CHOICE";
+		case _kARG_TYPE_KV: return "_kARG_TYPE_KV";
 		default: return "<invalid>";
 	}
 }
@@ -428,12 +1794,14 @@ static inline const char* _argparse_state_name(const struct kjc_argparse* argpar
 	
 	switch(state) {
 		case _kARG_VALUE_INIT: return "INIT";
-		case _kARG_VALUE_COUNT: return "COUNT";
 		case _kARG_VALUE_POSITIONAL: return "POSITIONAL";
 		case _kARG_VALUE_OTHER: return "OTHER";
 		case _kARG_VALUE_END: return "END";
 		case _kARG_VALUE_BREAK: return "BREAK";
 		case _kARG_VALUE_ERROR: return "ERROR";
+		case _kARG_VALUE_HELP: return "HELP";
+		case _kARG_VALUE_READY: return "READY";
+		case _kARG_VALUE_POSITIONAL_BATCH: return "POSITIONAL_BATCH";
 	}
 	
 	const struct _arginfo* argstorage = _argparse_get_argstorage(argparse_context);
@@ -457,603 +1825,2863 @@ static inline const char* _argparse_state_name(const struct kjc_argparse* argpar
 }
 #endif /* NDEBUG */
 
-void _argparse_parse(struct kjc_argparse* argparse_context) {
-	int ret = _kARG_VALUE_OTHER;
-	struct _arginfo* arginfo = NULL;
-	const char* argval_str = NULL;
-	const char* arg = NULL;
-	size_t arglen = 0;
-	FILE* f = argparse_context->stream;
-	int state = argparse_context->state;
+void _argparse_defer(
+	struct kjc_argparse* argparse_context,
+	unsigned group,
+	const char* (*fn)(void* arg),
+	void* arg
+) {
+	if(argparse_context->deferred_count == argparse_context->deferred_cap) {
+		/* Geometric growth, as the number of deferred handlers isn't known in advance */
+		unsigned cap = argparse_context->deferred_cap ? argparse_context->deferred_cap * 2 : 8;
+		struct _argdeferred* deferred = realloc(argparse_context->deferred, cap * sizeof(*deferred));
+		argparse_assert(deferred != NULL && "Allocation failure");
+		argparse_context->deferred = deferred;
+		argparse_context->deferred_cap = cap;
+	}
 	
-	if(state == _kARG_VALUE_COUNT) {
-		size_t bufsize = _argparse_get_argbuffer_size(argparse_context);
-		if (bufsize > 0) {
-			/* We now know how many arguments we will need to register, so allocate memory */
-			argparse_context->argbuffer = calloc(1, bufsize);
-			argparse_assert(argparse_context->argbuffer != NULL && "Allocation failure");
-		}
-		
-		/* Transition into initialization phase */
-		ret = _kARG_VALUE_INIT;
-		goto out;
-	}
+	struct _argdeferred* work = &argparse_context->deferred[argparse_context->deferred_count++];
+	work->fn = fn;
+	work->arg = arg;
+	work->error = NULL;
+	work->group = group;
+}
+
+/* Reference to deferred work, sorted so that each ordering group is contiguous and in queue order */
+struct _deferred_ref {
+	unsigned group;
+	unsigned index;
+};
+
+/* Unit of scheduling: one independent piece of work, or a whole ordering group that runs sequentially */
+struct _deferred_unit {
+	unsigned start;
+	unsigned count;
+};
+
+struct _deferred_pool {
+	struct _argdeferred* deferred;
+	const struct _deferred_ref* refs;
+	const struct _deferred_unit* units;
+	struct _deferred_worker* workers;
+	unsigned worker_count;
+};
+
+struct _deferred_worker {
+	struct _deferred_pool* pool;
+	unsigned index;
+#ifndef KJC_ARGPARSE_NO_THREADS
+	pthread_t thread;
+	pthread_mutex_t lock;
+	bool started;
+#endif /* KJC_ARGPARSE_NO_THREADS */
 	
-	/* Illegal to enter the state machine in the error state */
-	argparse_assert(state != _kARG_VALUE_ERROR);
+	/* Units [head, tail) are still queued on this worker. The owner takes from the head, thieves from the tail */
+	unsigned head;
+	unsigned tail;
+};
+
+static int _deferred_ref_compare(const void* _a, const void* _b) {
+	const struct _deferred_ref* a = _a;
+	const struct _deferred_ref* b = _b;
 	
-	/* Time for cleanup? */
-	if(state == _kARG_VALUE_END || state == _kARG_VALUE_BREAK) {
-		_argparse_dealloc(argparse_context);
+	if(a->group != b->group) {
+		return a->group < b->group ? -1 : 1;
+	}
+	return a->index < b->index ? -1 : a->index > b->index;
+}
+
+static void _deferred_run_unit(struct _deferred_pool* pool, const struct _deferred_unit* unit) {
+	for(unsigned i = 0; i < unit->count; i++) {
+		struct _argdeferred* work = &pool->deferred[pool->refs[unit->start + i].index];
+		work->error = work->fn(work->arg);
 		
-		/* Set the done flag but still do one more parsing run (to support ARG_END) */
-		if(state == _kARG_VALUE_END) {
-			argparse_context->flags |= _kARGPARSE_FLAG_DONE;
+		/* Later work in an ordering group depends on the earlier work having succeeded */
+		if(work->error != NULL) {
+			break;
 		}
-		
-		ret = state;
-		goto out;
 	}
+}
+
+#ifndef KJC_ARGPARSE_NO_THREADS
+static bool _deferred_take(struct _deferred_worker* worker, bool steal, unsigned* unit) {
+	bool found = false;
 	
-	/* Just finished with init phase? */
-	if(state == _kARG_VALUE_INIT) {
-		_argparse_post_init(argparse_context);
-		
-#ifndef NDEBUG
-		if (argparse_context->flags & _kARGPARSE_DEBUG && f != NULL) {
-			fprintf(f, "subcmds:\n");
-			_arginfo_dump_multiple(_argparse_get_subcmds(argparse_context), argparse_context->subcmds_count, f);
-			
-			fprintf(f, "\nlongargs:\n");
-			_arginfo_dump_multiple(_argparse_get_longargs(argparse_context), argparse_context->longargs_count, f);
-			
-			fprintf(f, "\nshortargs:\n");
-			_arginfo_dump_multiple(_argparse_get_shortargs(argparse_context), argparse_context->shortargs_count, f);
-		}
-#endif /* NDEBUG */
-		
-		/* Fallthrough to start parsing arguments */
+	pthread_mutex_lock(&worker->lock);
+	if(worker->head < worker->tail) {
+		*unit = steal ? --worker->tail : worker->head++;
+		found = true;
 	}
+	pthread_mutex_unlock(&worker->lock);
 	
-	/* Multiple short options in a single argument like ls -laF */
-	if(argparse_context->argtype == _kARG_TYPE_SHORTGROUP) {
-		/* Read next character of current argument */
-		char c = *argparse_context->argvalue.val_string++;
-		if(c != '\0') {
-			/* Next character exists, so look it up */
-			arginfo = _argparse_find_shortarg(argparse_context, c);
-			
-			/* We should have already ensured that all characters in this argument are valid short options */
-			argparse_assert(arginfo != NULL);
-			
-			/* Found an argument handler registered to handle this short option */
-			goto parse_done;
+	return found;
+}
+
+static void* _deferred_worker_main(void* arg) {
+	struct _deferred_worker* worker = arg;
+	struct _deferred_pool* pool = worker->pool;
+	
+	for(;;) {
+		unsigned unit = 0;
+		bool found = _deferred_take(worker, false, &unit);
+		
+		/* Own queue is empty, so steal from the back of another worker's queue */
+		for(unsigned i = 1; !found && i < pool->worker_count; i++) {
+			found = _deferred_take(&pool->workers[(worker->index + i) % pool->worker_count], true, &unit);
 		}
-	}
-	else if(argparse_context->argtype == _kARG_TYPE_COMMAND) {
-		/* Don't do any more parsing in this argparse context after encountering a subcommand */
-		ret = _kARG_VALUE_END;
-		goto out;
-	}
-	else if(argparse_context->argtype == _kARG_TYPE_DASHDASH) {
-		/* This label is jumped to directly after finding the "--" argument */
-	dash_dash:
-		/* Treat all remaining arguments as ARG_POSITIONAL */
-		if((*argparse_context->argidx)++ < argparse_context->orig_argc) {
-			ret = _kARG_VALUE_POSITIONAL;
-			goto parse_done;
+		
+		/* No new work is ever queued while the pool runs, so all queues being empty means we're done */
+		if(!found) {
+			break;
 		}
 		
-		/* Clear out "dashdash" status and mark arg parsing as done */
-		argparse_context->argtype = _kARG_TYPE_VOID;
-		ret = _kARG_VALUE_END;
-		goto out;
+		_deferred_run_unit(pool, &pool->units[unit]);
 	}
 	
-	/* Clear argument type and value */
-	argparse_context->argtype = _kARG_TYPE_VOID;
-	memset(&argparse_context->argvalue, 0, sizeof(argparse_context->argvalue));
+	return NULL;
+}
+
+static unsigned _deferred_default_threads(void) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return cpus > 0 ? (unsigned)cpus : 1;
+}
+#endif /* KJC_ARGPARSE_NO_THREADS */
+
+/* Run all deferred work and return the error of the first failed piece of work in queue order, or NULL */
+static const char* _argparse_run_deferred(struct kjc_argparse* argparse_context) {
+	unsigned count = argparse_context->deferred_count;
+	struct _deferred_ref* refs = malloc(count * sizeof(*refs));
+	struct _deferred_unit* units = malloc(count * sizeof(*units));
+	argparse_assert(refs != NULL && units != NULL && "Allocation failure");
 	
-	/* Grab next argument (if not at the end) */
-	arg = _argparse_next(argparse_context);
-	if(!arg) {
-		/*
-		 * Don't cleanup resources just yet, we'll do that after one more iteration
-		 * to allow ARG_END to use ARGPARSE_HELP()
-		 */
-		ret = _kARG_VALUE_END;
-		goto out;
+	for(unsigned i = 0; i < count; i++) {
+		refs[i].group = argparse_context->deferred[i].group;
+		refs[i].index = i;
 	}
+	qsort(refs, count, sizeof(*refs), _deferred_ref_compare);
 	
-	/* Check if this arg is a subcmd */
-	arginfo = _argparse_find_subcmd(argparse_context, arg);
-	if(arginfo) {
-		argparse_context->argtype = _kARG_TYPE_COMMAND;
-		goto parse_done;
+	/* Group 0 is independent work, every other group is a single unit that runs in queue order */
+	unsigned unit_count = 0;
+	for(unsigned i = 0; i < count; i++) {
+		if(refs[i].group != 0 && i > 0 && refs[i - 1].group == refs[i].group) {
+			units[unit_count - 1].count++;
+			continue;
+		}
+		
+		units[unit_count].start = i;
+		units[unit_count].count = 1;
+		unit_count++;
 	}
 	
-	/* Get argument length just once */
-	arglen = strlen(arg);
+	struct _deferred_pool pool = {0};
+	pool.deferred = argparse_context->deferred;
+	pool.refs = refs;
+	pool.units = units;
 	
-	/* In case the long argument prefix was overridden to something like "-", check that first */
-	if(
-		arglen > argparse_context->long_prefix_len
-		&& strncmp(arg, argparse_context->long_arg_prefix, argparse_context->long_prefix_len) == 0
-	) {
-		/* Long option */
-		const char* longarg = &arg[argparse_context->long_prefix_len];
-		arginfo = _argparse_find_longarg(argparse_context, longarg);
-		if(!arginfo) {
-			/* Support for the auto help handler (--help, /help, depending on prefix) */
-			if((argparse_context->flags & _kARGPARSE_AUTO_HELP) && strcmp(longarg, "help") == 0) {
-				ret = _kARG_VALUE_HELP;
-			}
-			goto parse_done;
+#ifndef KJC_ARGPARSE_NO_THREADS
+	unsigned threads = argparse_context->thread_count ? argparse_context->thread_count : _deferred_default_threads();
+	pool.worker_count = threads < unit_count ? threads : unit_count;
+#endif /* KJC_ARGPARSE_NO_THREADS */
+	
+	if(pool.worker_count <= 1) {
+		for(unsigned i = 0; i < unit_count; i++) {
+			_deferred_run_unit(&pool, &units[i]);
 		}
+	}
+#ifndef KJC_ARGPARSE_NO_THREADS
+	else {
+		pool.workers = calloc(pool.worker_count, sizeof(*pool.workers));
+		argparse_assert(pool.workers != NULL && "Allocation failure");
 		
-		/* Check if this argument is in the form --long-with-value=foo */
-		argval_str = strchr(arg, '=');
-		if(argval_str) {
-			argval_str++;
+		/* Split the units evenly, then let idle workers steal to balance out uneven work */
+		for(unsigned i = 0; i < pool.worker_count; i++) {
+			struct _deferred_worker* worker = &pool.workers[i];
+			worker->pool = &pool;
+			worker->index = i;
+			worker->head = (unsigned)((size_t)unit_count * i / pool.worker_count);
+			worker->tail = (unsigned)((size_t)unit_count * (i + 1) / pool.worker_count);
+			pthread_mutex_init(&worker->lock, NULL);
 		}
 		
-		goto parse_done;
+		/* The calling thread is worker 0. If a thread can't be created, its units get stolen by the others */
+		for(unsigned i = 1; i < pool.worker_count; i++) {
+			struct _deferred_worker* worker = &pool.workers[i];
+			worker->started = pthread_create(&worker->thread, NULL, _deferred_worker_main, worker) == 0;
+		}
+		_deferred_worker_main(&pool.workers[0]);
+		
+		for(unsigned i = 0; i < pool.worker_count; i++) {
+			struct _deferred_worker* worker = &pool.workers[i];
+			if(worker->started) {
+				pthread_join(worker->thread, NULL);
+			}
+			pthread_mutex_destroy(&worker->lock);
+		}
+		free(pool.workers);
 	}
+#endif /* KJC_ARGPARSE_NO_THREADS */
 	
-	if(arg[0] != '-' || arglen < 2) {
-		/*
-		 * Positional arguments include:
-		 *
-		 * - Any string that doesn't start with a '-' (like "foo")
-		 * - The string "-" (commonly used as a filename to mean stdin or stdout)
-		 * - The empty string (might be used as a blank value on purpose)
-		 */
-		ret = _kARG_VALUE_POSITIONAL;
-		goto parse_done;
+	free(units);
+	free(refs);
+	
+	/* Report errors in queue order, so the result doesn't depend on thread timing */
+	const char* error = NULL;
+	for(unsigned i = 0; i < count && !error; i++) {
+		error = argparse_context->deferred[i].error;
 	}
-	else if(arglen == 2) {
-		/* Check for support of "--" (if configured) */
-		if(arg[1] == '-' && (argparse_context->flags & _kARGPARSE_DASHDASH)) {
-			/* Don't override a user-defined "--" handler if present */
-			if(!_argparse_has_short_option(argparse_context, '-')) {
-				argparse_context->argtype = _kARG_TYPE_DASHDASH;
-				goto dash_dash;
-			}
-		}
+	
+	_argparse_discard_deferred(argparse_context);
+	return error;
+}
+
+/*
+ * Record an error found by _argparse_parse(), for the argument at index (or -1 for errors found once all arguments
+ * are parsed). Nothing is formatted here, as the caller may only want to know that the argument was rejected.
+ */
+static inline void _argparse_set_error(
+	struct kjc_argparse* argparse_context,
+	int code,
+	int index,
+	int offset,
+	const struct _arginfo* arginfo,
+	const char* value
+) {
+	argparse_context->error.code = code;
+	argparse_context->error.index = index;
+	argparse_context->error.offset = offset;
+	argparse_context->error.arginfo = arginfo;
+	argparse_context->error.value = value;
+}
+
+/* Format the recorded error message */
+static _argparse_cold void _argparse_write_error(const struct kjc_argparse* argparse_context, struct _argsink* sink) {
+	const struct kjc_argerror* error = &argparse_context->error;
+	const char* arg = error->index >= 0 ? argparse_context->orig_argv[error->index] : NULL;
+	
+	switch(error->code) {
+		case KJC_ARGERROR_UNKNOWN_SHORT:
+			_argsink_printf(sink,
+				"Error: In argument \"%s\", there is no supported option '-%c'\n", arg, arg[error->offset]
+			);
+			break;
 		
-		/* Single short argument */
-		arginfo = _argparse_find_shortarg(argparse_context, arg[1]);
+		case KJC_ARGERROR_SHORT_NOT_LAST:
+			_argsink_printf(sink,
+				"Error: In argument \"%s\", option '-%c' expects a value and therefore must be the last character.\n",
+				arg, arg[error->offset]
+			);
+			break;
 		
-		/* If not found, will be passed to ARG_OTHER */
-		goto parse_done;
-	}
-	else if(arg[1] != '-') {
-		/* Multiple short options in a single argument, like "-xzf" in "tar -xzf archive.tar.gz" */
-		if(!(argparse_context->flags & _kARGPARSE_WITH_SHORTGROUPS)) {
-			/* If support for short groups is disabled, pass to the ARG_OTHER handler */
-			goto parse_done;
-		}
+		case KJC_ARGERROR_UNEXPECTED:
+			_argsink_printf(sink, "Error: Unexpected argument: \"%s\"\n", arg);
+			break;
 		
-		/* Ensure that every character in this argument is a registered short option */
-		for(unsigned i = 1; i < arglen; i++) {
-			if(!_argparse_has_short_option(argparse_context, arg[i]) || arg[i] == '-') {
-				if(!(argparse_context->flags & _kARGPARSE_HAS_CATCHALL)) {
-					if(f != NULL) {
-						fprintf(f,
-							"Error: In argument \"%s\", there is no supported option '-%c'\n",
-							arg, arg[i]
-						);
-					}
-					ret = _kARG_VALUE_ERROR;
-				}
-				goto parse_done;
-			}
-			
-			/* Only the last short option can take a value */
-			if(_argparse_short_option_expects_value(argparse_context, arg[i]) && i != arglen - 1) {
-				if(!(argparse_context->flags & _kARGPARSE_HAS_CATCHALL)) {
-					if(f != NULL) {
-						fprintf(f,
-							"Error: In argument \"%s\", option '-%c' expects a value and therefore"
-							" must be the last character.\n",
-							arg, arg[i]
-						);
-					}
-					ret = _kARG_VALUE_ERROR;
-				}
-				goto parse_done;
+		case KJC_ARGERROR_EMBEDDED_VALUE:
+			_argsink_printf(sink, "Error: Argument \"%s\" has an embedded value but doesn't expect any value.\n", arg);
+			break;
+		
+		case KJC_ARGERROR_MISSING_VALUE:
+			_argsink_printf(sink, "Error: Argument \"%s\" needs a value but there are no more arguments.\n", arg);
+			break;
+		
+		case KJC_ARGERROR_NOT_INTEGRAL:
+			_argsink_printf(sink, "Error: The ");
+			_arginfo_print_name(argparse_context, error->arginfo, sink);
+			_argsink_printf(sink, " option expects an integral value, not \"%s\".\n", error->value);
+			break;
+		
+		case KJC_ARGERROR_INVALID_CHOICE:
+			_argsink_printf(sink, "Error: Invalid value \"%s\" for the ", error->value);
+			_arginfo_print_name(argparse_context, error->arginfo, sink);
+			_argsink_printf(sink, " option.\nValid choices:");
+			for(unsigned i = 0; i < error->arginfo->ext.choices->count; i++) {
+				_argsink_printf(sink, "%s %s", i ? "," : "", error->arginfo->ext.choices->names[i]);
 			}
-		}
+			_argsink_printf(sink, "\n");
+			break;
 		
-		/* Store current argument character position in argvalue.val_string */
-		argparse_context->argtype = _kARG_TYPE_SHORTGROUP;
-		argparse_context->argvalue.val_string = &arg[2];
+		case KJC_ARGERROR_NOT_KEY_VALUE:
+			_argsink_printf(sink, "Error: The ");
+			_arginfo_print_name(argparse_context, error->arginfo, sink);
+			_argsink_printf(sink, " option expects a key=value pair, not \"%s\".\n", error->value);
+			break;
 		
-		/* Look up short option character */
-		arginfo = _argparse_find_shortarg(argparse_context, arg[1]);
+		case KJC_ARGERROR_DUPLICATE_KEY:
+			_argsink_printf(sink, "Error: Duplicate key \"%.*s\" for the ",
+				(int)(strchr(error->value, '=') - error->value), error->value
+			);
+			_arginfo_print_name(argparse_context, error->arginfo, sink);
+			_argsink_printf(sink, " option.\n");
+			break;
 		
-		/* Shouldn't be possible as we just ensured that all characters are registered short options */
-		assert(arginfo != NULL);
-		goto parse_done;
+		case KJC_ARGERROR_CONSTRAINT:
+			/* Running the check again prints every constraint that isn't met, not just the recorded one */
+			_argparse_check_constraints(argparse_context, sink);
+			break;
+		
+		case KJC_ARGERROR_DEFERRED:
+			_argsink_printf(sink, "Error: %s\n", error->value);
+			break;
+		
+		case KJC_ARGERROR_GLOBAL_AFTER:
+			_argsink_printf(sink,
+				"Error: Global option \"%s\" can't directly follow \"%s\", it has to come before the subcommand.\n",
+				arg, argparse_context->orig_argv[error->index - 1]
+			);
+			break;
+		
+		case KJC_ARGERROR_REPLAY_ARGS:
+			_argsink_printf(sink,
+				"Error: Unexpected argument: \"%s\", the options are replayed from the parent process.\n", arg
+			);
+			break;
+		
+		default:
+			argparse_assert(false);
+			break;
 	}
+}
+
+static void* _argparse_grow(void* array, size_t elem_size, size_t used, size_t count, size_t* pcap);
+
+/* FNV-1a hash of everything that decides how the root context parses its arguments and numbers its options */
+static uint64_t _argparse_schema_hash(const struct kjc_argparse* argparse_context) {
+	const struct _arginfo* argstorage = _argparse_get_argstorage(argparse_context);
+	const char* prefix = argparse_context->long_arg_prefix;
+	unsigned char flags[3] = {
+		argparse_context->flags
+			& (_kARGPARSE_HAS_CATCHALL | _kARGPARSE_WITH_SHORTGROUPS | _kARGPARSE_AUTO_HELP | _kARGPARSE_DASHDASH),
+		argparse_context->ext_flags & _kARGPARSE_EXT_POSITIONAL_BATCH,
+		argparse_context->positional_usage != NULL,
+	};
 	
-parse_done:
-	if(arginfo != NULL) {
-		ret = arginfo->arg_id;
+	uint64_t hash = _argparse_hash_string(prefix, strlen(prefix) + 1);
+	hash = _argparse_hash_bytes(hash, flags, sizeof(flags));
+	hash = _argparse_hash_bytes(hash, &argparse_context->argstorage_count, sizeof(argparse_context->argstorage_count));
+	for(unsigned i = 0; i < argparse_context->argstorage_count; i++) {
+		const struct _arginfo* arginfo = &argstorage[i];
+		const char* long_name = arginfo->long_name ? arginfo->long_name : "";
+		hash = _argparse_hash_bytes(hash, &arginfo->arg_id, sizeof(arginfo->arg_id));
+		hash = _argparse_hash_bytes(hash, &arginfo->type, sizeof(arginfo->type));
+		hash = _argparse_hash_bytes(hash, &arginfo->short_name, sizeof(arginfo->short_name));
+		hash = _argparse_hash_bytes(hash, &arginfo->global, sizeof(arginfo->global));
+		hash = _argparse_hash_bytes(hash, long_name, strlen(long_name) + 1);
+		
+		/* The replayed value of an ARG_CHOICE option is the index of the choice */
+		if(arginfo->type == _kARG_TYPE_CHOICE) {
+			for(unsigned j = 0; j < arginfo->ext.choices->count; j++) {
+				const char* name = arginfo->ext.choices->names[j];
+				hash = _argparse_hash_bytes(hash, name, strlen(name) + 1);
+			}
+		}
 	}
 	
-	/* Pass positional arguments to the ARG_OTHER handler if there's no ARG_POSITIONAL handler */
-	if(ret == _kARG_VALUE_POSITIONAL) {
-		if(!argparse_context->positional_usage) {
-			ret = _kARG_VALUE_OTHER;
+	return hash;
+}
+
+/* Append a record of the arguments from first up to end, along with the value the current step produced */
+static void _argparse_record(
+	struct kjc_argparse* argparse_context,
+	int ret,
+	const struct _arginfo* arginfo,
+	int first,
+	int end
+) {
+	struct _argrecorder* recorder = argparse_context->recorder;
+	char* const* argv = argparse_context->orig_argv;
+	unsigned count = 0;
+	
+	/* The unparsed rest after a subcommand leaves out the global options that were recorded before it */
+	bool skip_hoisted = ret == _kARG_VALUE_END && argparse_context->hoisted != NULL;
+	
+	size_t size = sizeof(struct _argrecord);
+	for(int i = first; i < end; i++) {
+		if(!skip_hoisted || !_argparse_is_hoisted(argparse_context, i)) {
+			size += strlen(argv[i]) + 1;
+			count++;
 		}
 	}
+	size = (size + 7) & ~(size_t)7;
 	
-	/* Did we fail to parse this argument? */
-	if(ret == _kARG_VALUE_OTHER) {
-		/* Error out unless there's an ARG_OTHER catchall present */
-		if(argparse_context->flags & _kARGPARSE_HAS_CATCHALL) {
-			goto out;
+	recorder->data = _argparse_grow(recorder->data, 1, recorder->size, size, &recorder->cap);
+	unsigned char* dst = &recorder->data[recorder->size];
+	memset(dst, 0, size);
+	
+	struct _argrecord* rec = (struct _argrecord*)dst;
+	rec->ret = ret;
+	rec->option = arginfo ? (int32_t)(arginfo - _argparse_get_argstorage(argparse_context)) : -1;
+	rec->count = count;
+	rec->size = (uint32_t)size;
+	rec->error_option = -1;
+	
+	/* Arguments that no handler has seen yet only need their strings */
+	const char* value = NULL;
+	if(ret != _kARGRECORD_TAKEN && ret != _kARG_VALUE_END) {
+		rec->len = argparse_context->argvalue_len;
+		rec->dashdash = argparse_context->argtype == _kARG_TYPE_DASHDASH;
+		
+		switch(argparse_context->argtype) {
+			case _kARG_TYPE_LONG:
+			case _kARG_TYPE_COMMAND:
+				rec->argtype = argparse_context->argtype;
+				rec->value = argparse_context->argvalue.val_long;
+				break;
+			
+			case _kARG_TYPE_STRING:
+				rec->argtype = _kARG_TYPE_STRING;
+				value = argparse_context->argvalue.val_string;
+				break;
+			
+			case _kARG_TYPE_KV: {
+				const struct kjc_argkv* kv = argparse_context->argvalue.val_kv;
+				rec->argtype = _kARG_TYPE_KV;
+				value = kv->key;
+				rec->key_len = (int32_t)kv->key_len;
+				rec->len = kv->key_len + 1 + kv->value_len;
+				break;
+			}
+			
+			default:
+				/* Options without a value, including those in a short group or after "--" */
+				rec->argtype = _kARG_TYPE_VOID;
+				break;
 		}
 		
-		if(f != NULL) {
-			fprintf(f, "Error: Unexpected argument: \"%s\"\n", arg);
+		const struct kjc_argerror* error = &argparse_context->error;
+		if(ret == _kARG_VALUE_OTHER && error->code != KJC_ARGERROR_NONE) {
+			argparse_assert(error->index >= first && error->index < end);
+			rec->error = (uint8_t)error->code;
+			rec->error_string = (uint8_t)(error->index - first);
+			rec->error_offset = error->offset;
+			if(error->arginfo != NULL) {
+				rec->error_option = (int32_t)(error->arginfo - _argparse_get_argstorage(argparse_context));
+			}
 		}
-		ret = _kARG_VALUE_ERROR;
-		goto out;
 	}
-	else if(arginfo != NULL) {
-		/* We found a matching argument, now check if it has a non-void type */
-		if(arginfo->type == _kARG_TYPE_VOID) {
-			/* Argument shouldn't have a value, so ensure that it doesn't */
-			if(argval_str) {
-				if(argparse_context->flags & _kARGPARSE_HAS_CATCHALL) {
-					ret = _kARG_VALUE_OTHER;
-					goto out;
-				}
-				
-				if(f != NULL) {
-					fprintf(f, "Error: Argument \"%s\" has an embedded value but doesn't expect any value.\n", arg);
-				}
-				ret = _kARG_VALUE_ERROR;
-				goto out;
-			}
+	
+	/* A string value is stored as where it points into the arguments, which it may not be the last of */
+	dst += sizeof(*rec);
+	for(int i = first; i < end; i++) {
+		if(skip_hoisted && _argparse_is_hoisted(argparse_context, i)) {
+			continue;
 		}
-		else if(arginfo->type != _kARG_TYPE_COMMAND) {
-			/* Get argument value string */
-			if(!argval_str) {
-				/* This argument expects a value as the next argument like --test foo */
-				argval_str = _argparse_next(argparse_context);
-				if(!argval_str) {
-					/* No more arguments, so this is an error */
-					if(f != NULL) {
-						fprintf(f, "Error: Argument \"%s\" needs a value but there are no more arguments.\n", arg);
-					}
-					ret = _kARG_VALUE_ERROR;
-					goto out;
-				}
+		
+		size_t len = strlen(argv[i]);
+		if(value != NULL && value >= argv[i] && value <= argv[i] + len) {
+			rec->value = (int64_t)(i - first) << 32 | (int64_t)(value - argv[i]);
+			value = NULL;
+		}
+		
+		memcpy(dst, argv[i], len + 1);
+		dst += len + 1;
+	}
+	argparse_assert(value == NULL && "Value isn't in the recorded arguments");
+	
+	recorder->size += size;
+	recorder->count++;
+}
+
+/* Record the arguments that the last handler took with ARGPARSE_NEXT() */
+static void _argparse_record_taken(struct kjc_argparse* argparse_context) {
+	struct _argrecorder* recorder = argparse_context->recorder;
+	int argidx = *argparse_context->argidx;
+	if(argidx > argparse_context->orig_argc) {
+		argidx = argparse_context->orig_argc;
+	}
+	
+	/* While global options are hoisted, the arguments skipped over belong to the subcommand */
+	if(argparse_context->ext_flags & _kARGPARSE_EXT_HOISTING) {
+		return;
+	}
+	
+	if(argidx > recorder->mark) {
+		_argparse_record(argparse_context, _kARGRECORD_TAKEN, NULL, recorder->mark, argidx);
+	}
+	recorder->mark = argidx;
+}
+
+/* Record a step of parsing that reaches a handler */
+static void _argparse_record_step(struct kjc_argparse* argparse_context, int ret, const struct _arginfo* arginfo) {
+	struct _argrecorder* recorder = argparse_context->recorder;
+	int first = recorder->mark;
+	int end = *argparse_context->argidx;
+	
+	if(
+		!(ret & 1) && ret != _kARG_VALUE_POSITIONAL && ret != _kARG_VALUE_OTHER
+		&& ret != _kARG_VALUE_POSITIONAL_BATCH && ret != _kARG_VALUE_HELP
+	) {
+		return;
+	}
+	
+	if((ret & 1) && arginfo->type == _kARG_TYPE_COMMAND) {
+		/* Any global options given after the subcommand were recorded before it */
+		first = end - 1;
+	}
+	else if((argparse_context->ext_flags & _kARGPARSE_EXT_HOISTING) && argparse_context->hoist_last > first) {
+		/* A global option found after the subcommand, with any value it took */
+		first = argparse_context->hoist_last;
+	}
+	
+	_argparse_record(argparse_context, ret, arginfo, first, end);
+	recorder->mark = *argparse_context->argidx;
+}
+
+#ifndef KJC_ARGPARSE_NO_MEMFD
+/* The blob exported by the parent process, which stays mapped for the life of the process */
+static struct {
+	const unsigned char* data;
+	size_t size;
+	char** argv;  /* argv[0] of this process, then the strings of every record */
+	int argc;
+	int fd;
+	bool checked;  /* The environment was looked at already, or this process exported its own options */
+} _argparse_replay_blob = {NULL, 0, NULL, 0, -1, false};
+
+/* Map the blob named by $KJC_ARGPARSE_REPLAY_FD, if its records and their strings are well-formed */
+static bool _argparse_replay_load(const char* argv0) {
+	if(_argparse_replay_blob.checked) {
+		return _argparse_replay_blob.data != NULL;
+	}
+	_argparse_replay_blob.checked = true;
+	
+	const char* env = getenv(KJC_ARGPARSE_REPLAY_ENV);
+	if(env == NULL) {
+		return false;
+	}
+	
+	char* env_end = NULL;
+	long fd = strtol(env, &env_end, 10);
+	bool valid = env_end != env && *env_end == '\0';
+	
+	/* The fd was meant for this process, its own child processes only replay what it exports itself */
+	unsetenv(KJC_ARGPARSE_REPLAY_ENV);
+	
+	struct stat st;
+	if(!valid || fd < 0 || fd > INT_MAX || fstat((int)fd, &st) != 0) {
+		return false;
+	}
+	if(st.st_size < (off_t)sizeof(struct _argreplay_header)) {
+		return false;
+	}
+	
+	size_t size = (size_t)st.st_size;
+	const unsigned char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, (int)fd, 0);
+	if(data == MAP_FAILED) {
+		return false;
+	}
+	
+	const struct _argreplay_header* header = (const struct _argreplay_header*)data;
+	bool ok = header->magic == _kARGREPLAY_MAGIC && header->version == _kARGREPLAY_VERSION
+		&& header->header_size == sizeof(*header) && header->size == size;
+	
+	/* Every record has to fit, along with its strings, each of which has to be terminated */
+	size_t pos = sizeof(*header);
+	size_t strings = 0;
+	for(unsigned i = 0; ok && i < header->count; i++) {
+		const struct _argrecord* rec = (const struct _argrecord*)&data[pos];
+		ok = size - pos >= sizeof(*rec) && rec->size >= sizeof(*rec) && rec->size % 8 == 0 && rec->size <= size - pos;
+		
+		const char* str = (const char*)&data[pos + sizeof(*rec)];
+		for(unsigned j = 0; ok && j < rec->count; j++) {
+			const char* nul = memchr(str, '\0', (size_t)((const char*)&data[pos + rec->size] - str));
+			ok = nul != NULL;
+			str = nul + 1;
+		}
+		
+		if(ok) {
+			strings += rec->count;
+			pos += rec->size;
+		}
+	}
+	
+	char** argv = ok && pos == size && strings < INT_MAX ? malloc((strings + 2) * sizeof(*argv)) : NULL;
+	if(argv == NULL) {
+		munmap((void*)data, size);
+		return false;
+	}
+	
+	/* The replayed arguments point into the read-only mapping */
+	int argc = 0;
+	argv[argc++] = (char*)argv0;
+	for(pos = sizeof(*header); pos < size; pos += ((const struct _argrecord*)&data[pos])->size) {
+		const char* str = (const char*)&data[pos + sizeof(struct _argrecord)];
+		for(unsigned j = 0; j < ((const struct _argrecord*)&data[pos])->count; j++) {
+			argv[argc++] = (char*)str;
+			str += strlen(str) + 1;
+		}
+	}
+	argv[argc] = NULL;
+	
+	_argparse_replay_blob.data = data;
+	_argparse_replay_blob.size = size;
+	_argparse_replay_blob.argv = argv;
+	_argparse_replay_blob.argc = argc;
+	_argparse_replay_blob.fd = (int)fd;
+	return true;
+}
+
+/* Whether every record fits the root context's options, once the schema hash has matched */
+static bool _argparse_replay_check(const struct kjc_argparse* argparse_context) {
+	const struct _arginfo* argstorage = _argparse_get_argstorage(argparse_context);
+	int32_t option_count = (int32_t)argparse_context->argstorage_count;
+	char* const* strings = &_argparse_replay_blob.argv[1];
+	
+	for(size_t pos = sizeof(struct _argreplay_header); pos < _argparse_replay_blob.size;) {
+		const struct _argrecord* rec = (const struct _argrecord*)&_argparse_replay_blob.data[pos];
+		pos += rec->size;
+		
+		if(
+			rec->option < -1 || rec->option >= option_count
+			|| rec->error_option < -1 || rec->error_option >= option_count
+		) {
+			return false;
+		}
+		
+		/* The type of the value is decided by the option, or there's no value at all */
+		unsigned char argtype = _kARG_TYPE_VOID;
+		if(rec->ret & 1) {
+			if(rec->option < 0 || argstorage[rec->option].arg_id != rec->ret) {
+				return false;
 			}
+			argtype = argstorage[rec->option].type;
+			if(argtype == _kARG_TYPE_CHOICE) {
+				argtype = _kARG_TYPE_LONG;
+			}
+		}
+		else if(rec->ret == _kARG_VALUE_END) {
+			/* Only the arguments left unparsed can come last */
+			if(pos != _argparse_replay_blob.size) {
+				return false;
+			}
+		}
+		else if(
+			rec->ret != _kARGRECORD_TAKEN && rec->ret != _kARG_VALUE_POSITIONAL && rec->ret != _kARG_VALUE_OTHER
+			&& rec->ret != _kARG_VALUE_POSITIONAL_BATCH && rec->ret != _kARG_VALUE_HELP
+		) {
+			return false;
+		}
+		
+		if(rec->argtype != argtype || (rec->error != KJC_ARGERROR_NONE && rec->error_string >= rec->count)) {
+			return false;
+		}
+		if(rec->ret == _kARG_VALUE_POSITIONAL_BATCH && rec->len != rec->count) {
+			return false;
+		}
+		if(
+			(rec->ret == _kARG_VALUE_POSITIONAL || rec->ret == _kARG_VALUE_OTHER)
+			&& (rec->count == 0 || rec->len != strlen(strings[rec->count - 1]))
+		) {
+			return false;
+		}
+		
+		if(argtype == _kARG_TYPE_STRING || argtype == _kARG_TYPE_KV) {
+			uint64_t index = (uint64_t)rec->value >> 32;
+			uint64_t offset = (uint64_t)rec->value & 0xffffffff;
+			if(index >= rec->count || offset + rec->len > strlen(strings[index])) {
+				return false;
+			}
+			if(argtype == _kARG_TYPE_KV && (rec->key_len < 0 || (uint64_t)rec->key_len >= rec->len)) {
+				return false;
+			}
+			if(argtype == _kARG_TYPE_KV && strings[index][offset + rec->key_len] != '=') {
+				return false;
+			}
+		}
+		
+		strings += rec->count;
+	}
+	
+	return true;
+}
+
+static bool _argparse_write_all(int fd, const void* data, size_t size) {
+	const unsigned char* bytes = data;
+	while(size > 0) {
+		ssize_t written = write(fd, bytes, size);
+		if(written < 0 && errno == EINTR) {
+			continue;
+		}
+		if(written <= 0) {
+			return false;
+		}
+		
+		bytes += written;
+		size -= (size_t)written;
+	}
+	
+	return true;
+}
+#endif /* KJC_ARGPARSE_NO_MEMFD */
+
+/* With ARGPARSE_CONFIG_RECORD, replay the options exported by the parent process if they match, or record them */
+static void _argparse_record_begin(struct kjc_argparse* argparse_context) {
+#ifndef KJC_ARGPARSE_NO_MEMFD
+	uint64_t hash = _argparse_schema_hash(argparse_context);
+	
+	if(
+		_argparse_replay_load(argparse_context->orig_argv[0])
+		&& ((const struct _argreplay_header*)_argparse_replay_blob.data)->schema_hash == hash
+		&& _argparse_replay_check(argparse_context)
+	) {
+		argparse_context->replay = calloc(1, sizeof(*argparse_context->replay));
+		argparse_assert(argparse_context->replay != NULL && "Allocation failure");
+		argparse_context->replay->pos = sizeof(struct _argreplay_header);
+		argparse_context->replay->slot = 1;
+		
+		/* The replayed argv takes the place of this process's own, so it can't have any arguments of its own */
+		if(*argparse_context->argidx < argparse_context->orig_argc) {
+			argparse_context->replay->rejected = true;
+			return;
+		}
+		
+		argparse_context->orig_argc = _argparse_replay_blob.argc;
+		argparse_context->orig_argv = _argparse_replay_blob.argv;
+		*argparse_context->argidx = 1;
+		return;
+	}
+	
+	argparse_context->recorder = calloc(1, sizeof(*argparse_context->recorder));
+	argparse_assert(argparse_context->recorder != NULL && "Allocation failure");
+	argparse_context->recorder->hash = hash;
+	argparse_context->recorder->mark = *argparse_context->argidx;
+	argparse_context->recorder->exported_fd = -1;
+#else /* KJC_ARGPARSE_NO_MEMFD */
+	(void)argparse_context;
+#endif /* KJC_ARGPARSE_NO_MEMFD */
+}
+
+/* Produce the next recorded step, or return false once the rest of the arguments are left to be parsed */
+static bool _argparse_replay_next(struct kjc_argparse* argparse_context, int* pret, struct _arginfo** parginfo) {
+#ifndef KJC_ARGPARSE_NO_MEMFD
+	struct _argreplay* replay = argparse_context->replay;
+	struct _arginfo* argstorage = _argparse_get_argstorage(argparse_context);
+	
+	if(replay->rejected) {
+		replay->done = true;
+		_argparse_set_error(argparse_context, KJC_ARGERROR_REPLAY_ARGS, *argparse_context->argidx, 0, NULL, NULL);
+		*pret = _kARG_VALUE_ERROR;
+		*parginfo = NULL;
+		return true;
+	}
+	
+	while(replay->pos < _argparse_replay_blob.size) {
+		const struct _argrecord* rec = (const struct _argrecord*)&_argparse_replay_blob.data[replay->pos];
+		int first = replay->slot;
+		if(rec->ret == _kARG_VALUE_END) {
+			break;
+		}
+		
+		replay->pos += rec->size;
+		replay->slot += rec->count;
+		if(rec->ret == _kARGRECORD_TAKEN) {
+			continue;
+		}
+		
+		/* Everything was checked by _argparse_replay_check(), so the step is taken as it was recorded */
+		struct _arginfo* arginfo = rec->option >= 0 ? &argstorage[rec->option] : NULL;
+		*argparse_context->argidx = replay->slot;
+		replay->dashdash = rec->dashdash != 0;
+		memset(&argparse_context->argvalue, 0, sizeof(argparse_context->argvalue));
+		argparse_context->argtype = rec->argtype;
+		argparse_context->argvalue_len = (size_t)rec->len;
+		*pret = rec->ret;
+		*parginfo = arginfo;
+		
+		switch(rec->argtype) {
+			case _kARG_TYPE_LONG:
+				argparse_context->argvalue.val_long = (long)rec->value;
+				break;
 			
-			switch(arginfo->type) {
-				case _kARG_TYPE_LONG: {
-					/* Parse the string as an integer with strtol() to support negative ints and other bases */
-					char* str_end = NULL;
-					long val = strtol(argval_str, &str_end, 0);
-					if(*str_end != '\0') {
-						/* Failed to fully parse argument value string */
-						if(f != NULL) {
-							fprintf(f, "Error: ");
-							if(arginfo->long_name) {
-								fprintf(f, "The %s%s", argparse_context->long_arg_prefix, arginfo->long_name);
-							}
-							else {
-								fprintf(f, "The -%c", arginfo->short_name);
-							}
-							fprintf(f, " option expects an integral value, not \"%s\".\n", argval_str);
-						}
-						ret = _kARG_VALUE_ERROR;
-						goto out;
-					}
-					
-					/* Store argument type and value in argparse context */
-					argparse_context->argtype = _kARG_TYPE_LONG;
-					argparse_context->argvalue.val_long = val;
-					break;
+			case _kARG_TYPE_STRING: {
+				const char* str = argparse_context->orig_argv[first + (int)((uint64_t)rec->value >> 32)];
+				argparse_context->argvalue.val_string = &str[rec->value & 0xffffffff];
+				break;
+			}
+			
+			case _kARG_TYPE_KV: {
+				/* The map belongs to this process, so the pair is put in it again */
+				int index = first + (int)((uint64_t)rec->value >> 32);
+				const char* str = argparse_context->orig_argv[index];
+				struct kjc_argkv kv;
+				kv.key = &str[rec->value & 0xffffffff];
+				kv.key_len = (size_t)rec->key_len;
+				kv.value = kv.key + kv.key_len + 1;
+				kv.value_len = (size_t)rec->len - kv.key_len - 1;
+				kv.index = index;
+				argparse_context->argvalue.val_kv = _argmap_put(arginfo->ext.map, &kv);
+				if(argparse_context->argvalue.val_kv == NULL) {
+					_argparse_set_error(
+						argparse_context, KJC_ARGERROR_DUPLICATE_KEY, kv.index, (int)(kv.key - str), arginfo, kv.key
+					);
+					*pret = _kARG_VALUE_ERROR;
 				}
-				
-				case _kARG_TYPE_STRING:
-					/* Store argument type and value in argparse context */
-					argparse_context->argtype = _kARG_TYPE_STRING;
-					argparse_context->argvalue.val_string = argval_str;
-					break;
-				
-				default:
-					argparse_assert(false);
-					break;
+				break;
 			}
+			
+			default:
+				break;
 		}
+		
+		if(rec->error != KJC_ARGERROR_NONE) {
+			const char* arg = argparse_context->orig_argv[first + rec->error_string];
+			_argparse_set_error(
+				argparse_context, rec->error, first + rec->error_string, rec->error_offset,
+				rec->error_option >= 0 ? &argstorage[rec->error_option] : NULL,
+				rec->error == KJC_ARGERROR_EMBEDDED_VALUE ? &arg[rec->error_offset] : NULL
+			);
+		}
+		
+		return true;
 	}
 	
-out:
-#ifndef NDEBUG
-	if((argparse_context->flags & _kARGPARSE_DEBUG) && f != NULL) {
-		int aidx = *argparse_context->argidx - (argparse_context->argtype != _kARG_TYPE_SHORTGROUP);
+	/* Parse whatever wasn't recorded, which is all positional if the parent was past "--" */
+	replay->done = true;
+	*argparse_context->argidx = replay->slot;
+	argparse_context->argtype = replay->dashdash ? _kARG_TYPE_DASHDASH : _kARG_TYPE_VOID;
+#else /* KJC_ARGPARSE_NO_MEMFD */
+	(void)argparse_context;
+	(void)pret;
+	(void)parginfo;
+#endif /* KJC_ARGPARSE_NO_MEMFD */
+	return false;
+}
+
+void _argparse_parse(struct kjc_argparse* argparse_context) {
+	int ret = _kARG_VALUE_OTHER;
+	struct _arginfo* arginfo = NULL;
+	const char* argval_str = NULL;
+	const char* arg = NULL;
+	size_t arglen = 0;
+	uint64_t arg_prefix = 0;
+	FILE* f = argparse_context->stream;
+	int state = argparse_context->state;
+	
+	/* Time for cleanup? */
+	if(state == _kARG_VALUE_END || state == _kARG_VALUE_BREAK || state == _kARG_VALUE_ERROR) {
+		_argparse_dealloc(argparse_context);
 		
-		if(arg) {
-			fprintf(f, "\"%s\": ", arg);
+		/* Set the done flag but still do one more parsing run (to support ARG_END and ARG_ERROR) */
+		if(state != _kARG_VALUE_BREAK) {
+			argparse_context->flags |= _kARGPARSE_FLAG_DONE;
 		}
 		
-		fprintf(f, "%s", _argparse_state_name(argparse_context, state));
-		fprintf(f, " -> ");
-		fprintf(f, "%s", _argparse_state_name(argparse_context, ret));
-		fprintf(f, ", argidx=%d", aidx);
-		fprintf(f, "\n");
+		ret = state;
+		goto out;
 	}
-#endif /* NDEBUG */
 	
-	argparse_context->cur_arg = arginfo;
-	argparse_context->state = ret;
-}
+	/* Any error is only about the argument it was found in */
+	argparse_context->error.code = KJC_ARGERROR_NONE;
+	
+	/* Just finished with init phase? */
+	if(state == _kARG_VALUE_INIT) {
+		_argparse_post_init(argparse_context);
+		
+#ifdef ARGPARSE_WITH_SCHEMA
+		_argparse_schema_dump(argparse_context);
+#endif /* ARGPARSE_WITH_SCHEMA */
 
-/* Recursively print cmd of each argparse context, top-down */
-static void _argparse_help_cmd(const struct kjc_argparse* ctx, FILE* f) {
-	if(!ctx->parent) {
-		/* Root context: get cmd from basename of argv[0] */
-		const char* cmd = ctx->orig_argv[0];
-		const char* last_slash = strrchr(cmd, '/');
-		if(last_slash) {
-			cmd = last_slash + 1;
+#ifndef NDEBUG
+		if (argparse_context->flags & _kARGPARSE_DEBUG && f != NULL) {
+			if(argparse_context->ext_flags & _kARGPARSE_EXT_UNSORTED) {
+				_argparse_sort_tables(argparse_context);
+			}
+			
+			fprintf(f, "subcmds:\n");
+			_arginfo_dump_multiple(_argparse_get_subcmds(argparse_context), argparse_context->subcmds_count, f);
+			
+			fprintf(f, "\nlongargs:\n");
+			_arginfo_dump_multiple(_argparse_get_longargs(argparse_context), argparse_context->longargs_count, f);
+			
+			fprintf(f, "\nshortargs:\n");
+			_arginfo_dump_multiple(_argparse_get_shortargs(argparse_context), argparse_context->shortargs_count, f);
 		}
+#endif /* NDEBUG */
 		
-		fprintf(f, " %s", cmd);
-		return;
+		/* Fallthrough to start parsing arguments */
 	}
 	
-	/* Print parent commands first, so order comes naturally */
-	_argparse_help_cmd(ctx->parent, f);
+	if(argparse_context->recorder != NULL) {
+		_argparse_record_taken(argparse_context);
+	}
+	else if(
+		argparse_context->replay != NULL && !argparse_context->replay->done && argparse_context->parent == NULL
+		&& argparse_context->argtype != _kARG_TYPE_COMMAND
+	) {
+		/* Take the steps recorded by the parent process instead of parsing the arguments again */
+		if(_argparse_replay_next(argparse_context, &ret, &arginfo)) {
+			goto out;
+		}
+	}
 	
-	/* Get cmd from subcommand name used to call into this argparse context */
-	fprintf(f, " %s", ctx->parent->cur_arg->long_name);
+	/* Multiple short options in a single argument like ls -laF */
+	if(argparse_context->argtype == _kARG_TYPE_SHORTGROUP) {
+		/* Read next character of current argument */
+		char c = *argparse_context->argvalue.val_string++;
+		if(c != '\0') {
+			/* Next character exists, so look it up */
+			arginfo = _argparse_find_shortarg(argparse_context, c);
+			
+			/* We should have already ensured that all characters in this argument are valid short options */
+			argparse_assert(arginfo != NULL);
+			
+			/* Found an argument handler registered to handle this short option */
+			goto parse_done;
+		}
+	}
+	else if(argparse_context->argtype == _kARG_TYPE_COMMAND) {
+		/* Don't do any more parsing in this argparse context after encountering a subcommand */
+		ret = _kARG_VALUE_END;
+		goto out;
+	}
+	else if(argparse_context->argtype == _kARG_TYPE_DASHDASH) {
+		/* This label is jumped to directly after finding the "--" argument */
+	dash_dash:
+		/* Treat all remaining arguments as ARG_POSITIONAL */
+		if((*argparse_context->argidx)++ < argparse_context->orig_argc) {
+			arglen = strlen(argparse_context->orig_argv[*argparse_context->argidx - 1]);
+			ret = _kARG_VALUE_POSITIONAL;
+			goto parse_done;
+		}
+		
+		/* Clear out "dashdash" status and mark arg parsing as done */
+		argparse_context->argtype = _kARG_TYPE_VOID;
+		ret = _kARG_VALUE_END;
+		goto out;
+	}
+	
+	/* Clear argument type and value */
+	argparse_context->argtype = _kARG_TYPE_VOID;
+	memset(&argparse_context->argvalue, 0, sizeof(argparse_context->argvalue));
+	argparse_context->argvalue_len = 0;
+	
+	if(argparse_context->ext_flags & _kARGPARSE_EXT_HOISTING) {
+		/* This label is jumped to directly after finding a subcommand, when there are global options */
+	hoist:
+		/* Handle the next global option given after the subcommand, before the subcommand itself */
+		arg = _argparse_hoist_next(argparse_context);
+		if(!arg) {
+			/* Run the subcommand, which parses its arguments from the start, skipping the hoisted ones */
+			arg = argparse_context->orig_argv[argparse_context->hoist_cmdidx];
+			arginfo = _argparse_find_subcmd(argparse_context, arg);
+			argparse_context->ext_flags &= ~_kARGPARSE_EXT_HOISTING;
+			*argparse_context->argidx = argparse_context->hoist_cmdidx + 1;
+			argparse_context->argtype = _kARG_TYPE_COMMAND;
+			goto parse_done;
+		}
+		arg_prefix = _argparse_name_prefix(arg);
+	}
+	else {
+		/* Grab next argument (if not at the end) */
+		arg = _argparse_next(argparse_context);
+		if(!arg) {
+			/*
+			 * Don't cleanup resources just yet, we'll do that after one more iteration
+			 * to allow ARG_END to use ARGPARSE_HELP()
+			 */
+			ret = _kARG_VALUE_END;
+			goto out;
+		}
+		
+		/* Options that were matched recently don't need to be searched for, and can't be subcmds */
+		arg_prefix = _argparse_name_prefix(arg);
+		arginfo = _argparse_hot_find(argparse_context, arg, arg_prefix);
+		if(arginfo) {
+			unsigned len = argparse_context->hot[0].len;
+			arglen = strlen(arg);
+			if(arg[len] == '=') {
+				argval_str = &arg[len + 1];
+			}
+			goto parse_done;
+		}
+		
+		/* Check if this arg is a subcmd */
+		arginfo = _argparse_find_subcmd(argparse_context, arg);
+		if(arginfo) {
+			/* Only the root has global options of its own, subcommand contexts just point to them */
+			if(argparse_context->globals_count > 0 && argparse_context->parent == NULL) {
+				argparse_context->hoisted = calloc((size_t)(argparse_context->orig_argc + 7) / 8, 1);
+				argparse_assert(argparse_context->hoisted != NULL && "Allocation failure");
+				argparse_context->ext_flags |= _kARGPARSE_EXT_HOISTING;
+				argparse_context->hoist_cmdidx = *argparse_context->argidx - 1;
+				argparse_context->hoist_last = *argparse_context->argidx;
+				goto hoist;
+			}
+			
+			argparse_context->argtype = _kARG_TYPE_COMMAND;
+			goto parse_done;
+		}
+	}
+	
+	/* Get argument length just once */
+	arglen = strlen(arg);
+	
+	/* In case the long argument prefix was overridden to something like "-", check that first */
+	if(
+		arglen > argparse_context->long_prefix_len
+		&& strncmp(arg, argparse_context->long_arg_prefix, argparse_context->long_prefix_len) == 0
+	) {
+		/* Long option */
+		const char* longarg = &arg[argparse_context->long_prefix_len];
+		arginfo = _argparse_find_longarg(argparse_context, longarg);
+		if(!arginfo) {
+			/* Support for the auto help handler (--help, /help, depending on prefix), and --help=<query> */
+			if(
+				_argparse_flag(argparse_context, _kARGPARSE_AUTO_HELP)
+				&& strncmp(longarg, "help", 4) == 0 && (longarg[4] == '\0' || longarg[4] == '=')
+			) {
+				argparse_context->help_query = longarg[4] == '=' ? &longarg[5] : NULL;
+				ret = _kARG_VALUE_HELP;
+			}
+			goto parse_done;
+		}
+		
+		/* Check if this argument is in the form --long-with-value=foo */
+		argval_str = strchr(arg, '=');
+		if(argval_str) {
+			argval_str++;
+		}
+		
+		unsigned len = argval_str ? (unsigned)(argval_str - 1 - arg) : (unsigned)arglen;
+		_argparse_hot_add(argparse_context, arg, arg_prefix, len, '=', arginfo);
+		goto parse_done;
+	}
+	
+	if(arg[0] != '-' || arglen < 2) {
+		/*
+		 * Positional arguments include:
+		 *
+		 * - Any string that doesn't start with a '-' (like "foo")
+		 * - The string "-" (commonly used as a filename to mean stdin or stdout)
+		 * - The empty string (might be used as a blank value on purpose)
+		 */
+		ret = _kARG_VALUE_POSITIONAL;
+		goto parse_done;
+	}
+	else if(arglen == 2) {
+		/* Check for support of "--" (if configured) */
+		if(arg[1] == '-' && _argparse_flag(argparse_context, _kARGPARSE_DASHDASH)) {
+			/* Don't override a user-defined "--" handler if present */
+			if(!_argparse_has_short_option(argparse_context, '-')) {
+				argparse_context->argtype = _kARG_TYPE_DASHDASH;
+				goto dash_dash;
+			}
+		}
+		
+		/* Single short argument */
+		arginfo = _argparse_find_shortarg(argparse_context, arg[1]);
+		if(arginfo) {
+			_argparse_hot_add(argparse_context, arg, arg_prefix, 2, '\0', arginfo);
+		}
+		
+		/* If not found, will be passed to ARG_OTHER */
+		goto parse_done;
+	}
+	else if(arg[1] != '-') {
+		/* The value of an ARG_KV option can be attached like "-Dkey=value", the way compilers take it */
+		if(_argparse_short_option_expects_value(argparse_context, arg[1])) {
+			struct _arginfo* first = _argparse_find_shortarg(argparse_context, arg[1]);
+			if(first->type == _kARG_TYPE_KV) {
+				arginfo = first;
+				argval_str = &arg[2];
+				goto parse_done;
+			}
+		}
+		
+		/* Multiple short options in a single argument, like "-xzf" in "tar -xzf archive.tar.gz" */
+		if(!_argparse_flag(argparse_context, _kARGPARSE_WITH_SHORTGROUPS)) {
+			/* If support for short groups is disabled, pass to the ARG_OTHER handler */
+			goto parse_done;
+		}
+		
+		/* Ensure that every character in this argument is a registered short option */
+		for(unsigned i = 1; i < arglen; i++) {
+			if(!_argparse_has_short_option(argparse_context, arg[i]) || arg[i] == '-') {
+				_argparse_set_error(
+					argparse_context, KJC_ARGERROR_UNKNOWN_SHORT, *argparse_context->argidx - 1, (int)i, NULL, NULL
+				);
+				if(!(argparse_context->flags & _kARGPARSE_HAS_CATCHALL)) {
+					ret = _kARG_VALUE_ERROR;
+				}
+				goto parse_done;
+			}
+			
+			/* Only the last short option can take a value */
+			if(_argparse_short_option_expects_value(argparse_context, arg[i]) && i != arglen - 1) {
+				_argparse_set_error(
+					argparse_context, KJC_ARGERROR_SHORT_NOT_LAST, *argparse_context->argidx - 1, (int)i,
+					_argparse_find_shortarg(argparse_context, arg[i]), NULL
+				);
+				if(!(argparse_context->flags & _kARGPARSE_HAS_CATCHALL)) {
+					ret = _kARG_VALUE_ERROR;
+				}
+				goto parse_done;
+			}
+		}
+		
+		/* Store current argument character position in argvalue.val_string */
+		argparse_context->argtype = _kARG_TYPE_SHORTGROUP;
+		argparse_context->argvalue.val_string = &arg[2];
+		
+		/* Look up short option character */
+		arginfo = _argparse_find_shortarg(argparse_context, arg[1]);
+		
+		/* Shouldn't be possible as we just ensured that all characters are registered short options */
+		assert(arginfo != NULL);
+		goto parse_done;
+	}
+	
+parse_done:
+	if(arginfo != NULL) {
+		ret = arginfo->arg_id;
+	}
+	
+	/* Hand over the whole run of consecutive positional arguments in one handler call */
+	if(ret == _kARG_VALUE_POSITIONAL && (argparse_context->ext_flags & _kARGPARSE_EXT_POSITIONAL_BATCH)) {
+		int* argidx = argparse_context->argidx;
+		int start = *argidx - 1;
+		
+		if(argparse_context->argtype == _kARG_TYPE_DASHDASH) {
+			/* Everything after "--" is positional, so the run is the rest of argv */
+			*argidx = argparse_context->orig_argc;
+		}
+		else {
+			while(*argidx < argparse_context->orig_argc) {
+				if(
+					!_argparse_is_positional(argparse_context, argparse_context->orig_argv[*argidx])
+					|| (argparse_context->hoisted != NULL && _argparse_is_hoisted(argparse_context, *argidx))
+				) {
+					break;
+				}
+				
+				++*argidx;
+			}
+		}
+		
+		argparse_context->argvalue_len = (size_t)(*argidx - start);
+		ret = _kARG_VALUE_POSITIONAL_BATCH;
+		goto out;
+	}
+	
+	/* Pass positional arguments to the ARG_OTHER handler if there's no ARG_POSITIONAL handler */
+	if(ret == _kARG_VALUE_POSITIONAL) {
+		if(!argparse_context->positional_usage) {
+			ret = _kARG_VALUE_OTHER;
+		}
+	}
+	
+	/* Positional and unmatched arguments are their own value, and we already know their length */
+	if(ret == _kARG_VALUE_POSITIONAL || ret == _kARG_VALUE_OTHER) {
+		argparse_context->argvalue_len = arglen;
+	}
+	
+	/* Did we fail to parse this argument? */
+	if(ret == _kARG_VALUE_OTHER) {
+		/* A short group may have already said why */
+		if(argparse_context->error.code == KJC_ARGERROR_NONE) {
+			/* A global option the root didn't take, as it may have been the value of the option before it */
+			const struct _arginfo* global = NULL;
+			if(arg != NULL && argparse_context->parent != NULL && argparse_context->globals_count > 0) {
+				global = _argparse_find_global(argparse_context, arg);
+			}
+			
+			_argparse_set_error(
+				argparse_context, global ? KJC_ARGERROR_GLOBAL_AFTER : KJC_ARGERROR_UNEXPECTED,
+				*argparse_context->argidx - 1, 0, global, NULL
+			);
+		}
+		
+		/* Error out unless there's an ARG_OTHER catchall present */
+		if(!(argparse_context->flags & _kARGPARSE_HAS_CATCHALL)) {
+			ret = _kARG_VALUE_ERROR;
+		}
+		goto out;
+	}
+	else if(arginfo != NULL) {
+		/* We found a matching argument, now check if it has a non-void type */
+		if(arginfo->type == _kARG_TYPE_VOID) {
+			/* Argument shouldn't have a value, so ensure that it doesn't */
+			if(argval_str) {
+				_argparse_set_error(
+					argparse_context, KJC_ARGERROR_EMBEDDED_VALUE, *argparse_context->argidx - 1,
+					(int)(argval_str - arg), arginfo, argval_str
+				);
+				
+				if(argparse_context->flags & _kARGPARSE_HAS_CATCHALL) {
+					argparse_context->argvalue_len = arglen;
+					ret = _kARG_VALUE_OTHER;
+					goto out;
+				}
+				
+				ret = _kARG_VALUE_ERROR;
+				goto out;
+			}
+		}
+		else if(arginfo->type != _kARG_TYPE_COMMAND) {
+			size_t argval_len = 0;
+			
+			/* Get argument value string */
+			if(argval_str) {
+				/* Embedded value like --name=value runs to the end of the argument */
+				argval_len = arglen - (size_t)(argval_str - arg);
+			}
+			else {
+				/* This argument expects a value as the next argument like --test foo */
+				argval_str = _argparse_next(argparse_context);
+				if(!argval_str) {
+					/* No more arguments, so this is an error (about the last argument, which may be a short group) */
+					int argi = *argparse_context->argidx - 1;
+					_argparse_set_error(
+						argparse_context, KJC_ARGERROR_MISSING_VALUE, argi,
+						(int)strlen(argparse_context->orig_argv[argi]), arginfo, NULL
+					);
+					ret = _kARG_VALUE_ERROR;
+					goto out;
+				}
+				argval_len = strlen(argval_str);
+			}
+			
+			switch(arginfo->type) {
+				case _kARG_TYPE_LONG: {
+					/* Parse the string as an integer with strtol() to support negative ints and other bases */
+					char* str_end = NULL;
+					long val = strtol(argval_str, &str_end, 0);
+					if(*str_end != '\0') {
+						/* Failed to fully parse argument value string, which is in the argument before argidx */
+						int argi = *argparse_context->argidx - 1;
+						_argparse_set_error(
+							argparse_context, KJC_ARGERROR_NOT_INTEGRAL, argi,
+							(int)(str_end - argparse_context->orig_argv[argi]), arginfo, argval_str
+						);
+						ret = _kARG_VALUE_ERROR;
+						goto out;
+					}
+					
+					/* Store argument type and value in argparse context */
+					argparse_context->argtype = _kARG_TYPE_LONG;
+					argparse_context->argvalue.val_long = val;
+					break;
+				}
+				
+				case _kARG_TYPE_STRING:
+					/* Store argument type and value in argparse context */
+					argparse_context->argtype = _kARG_TYPE_STRING;
+					argparse_context->argvalue.val_string = argval_str;
+					argparse_context->argvalue_len = argval_len;
+					break;
+				
+				case _kARG_TYPE_CHOICE: {
+					/* A single lookup in the perfect hash table, however many choices there are */
+					int index = _argchoices_find(arginfo->ext.choices, argval_str, argval_len);
+					if(index < 0) {
+						_argparse_set_error(
+							argparse_context, KJC_ARGERROR_INVALID_CHOICE, *argparse_context->argidx - 1,
+							(int)(argval_str - argparse_context->orig_argv[*argparse_context->argidx - 1]),
+							arginfo, argval_str
+						);
+						ret = _kARG_VALUE_ERROR;
+						goto out;
+					}
+					
+					/* The handler gets the index of the choice as an integer value */
+					argparse_context->argtype = _kARG_TYPE_LONG;
+					argparse_context->argvalue.val_long = index;
+					break;
+				}
+				
+				case _kARG_TYPE_KV: {
+					/* Split at the first '=' without copying, the key just ends there */
+					int argi = *argparse_context->argidx - 1;
+					const char* equals = memchr(argval_str, '=', argval_len);
+					struct kjc_argkv kv;
+					
+					if(equals != NULL) {
+						kv.key = argval_str;
+						kv.key_len = (size_t)(equals - argval_str);
+						kv.value = equals + 1;
+						kv.value_len = argval_len - kv.key_len - 1;
+						kv.index = argi;
+						argparse_context->argvalue.val_kv = _argmap_put(arginfo->ext.map, &kv);
+					}
+					
+					if(equals == NULL || argparse_context->argvalue.val_kv == NULL) {
+						_argparse_set_error(
+							argparse_context, equals ? KJC_ARGERROR_DUPLICATE_KEY : KJC_ARGERROR_NOT_KEY_VALUE, argi,
+							(int)(argval_str - argparse_context->orig_argv[argi]), arginfo, argval_str
+						);
+						ret = _kARG_VALUE_ERROR;
+						goto out;
+					}
+					
+					argparse_context->argtype = _kARG_TYPE_KV;
+					break;
+				}
+				
+				default:
+					argparse_assert(false);
+					break;
+			}
+		}
+	}
+	
+out:
+	/* Remember which constrained options were given, and check the constraints once every argument is parsed */
+	if((ret & 1) && arginfo->constraint_bit != 0) {
+		_argparse_bitset_set(argparse_context->constraint_matched, arginfo->constraint_bit - 1);
+	}
+	else if(ret == _kARG_VALUE_END) {
+		const struct _argconstraint* failed = NULL;
+		if(argparse_context->constraints_count > 0) {
+			failed = _argparse_check_constraints(argparse_context, NULL);
+		}
+		
+		if(failed != NULL) {
+			/* Deferred work isn't run when the arguments themselves are invalid */
+			_argparse_discard_deferred(argparse_context);
+			_argparse_set_error(argparse_context, KJC_ARGERROR_CONSTRAINT, -1, 0, failed->arg, NULL);
+			ret = _kARG_VALUE_ERROR;
+		}
+		else if(argparse_context->deferred_count > 0) {
+			/* All deferred work has to finish before ARG_END runs */
+			const char* error = _argparse_run_deferred(argparse_context);
+			if(error != NULL) {
+				_argparse_set_error(argparse_context, KJC_ARGERROR_DEFERRED, -1, 0, NULL, error);
+				ret = _kARG_VALUE_ERROR;
+			}
+		}
+	}
+	
+	/* Record each step that reaches a handler, for ARGPARSE_EXPORT() */
+	if(argparse_context->recorder != NULL) {
+		_argparse_record_step(argparse_context, ret, arginfo);
+	}
+	
+	/* Only now is the error formatted, unless there's nowhere to print it or the program handles it itself */
+	if(
+		ret == _kARG_VALUE_ERROR && state != _kARG_VALUE_ERROR && f != NULL
+		&& !(argparse_context->ext_flags & _kARGPARSE_EXT_ERROR_HANDLER)
+	) {
+		struct _argsink sink = {f, NULL, 0, 0};
+		_argparse_write_error(argparse_context, &sink);
+	}
+	
+#ifndef NDEBUG
+	if((argparse_context->flags & _kARGPARSE_DEBUG) && f != NULL) {
+		int aidx = *argparse_context->argidx - (argparse_context->argtype != _kARG_TYPE_SHORTGROUP);
+		
+		if(arg) {
+			fprintf(f, "\"%s\": ", arg);
+		}
+		
+		fprintf(f, "%s", _argparse_state_name(argparse_context, state));
+		fprintf(f, " -> ");
+		fprintf(f, "%s", _argparse_state_name(argparse_context, ret));
+		fprintf(f, ", argidx=%d", aidx);
+		fprintf(f, "\n");
+	}
+#endif /* NDEBUG */
+	
+	argparse_context->cur_arg = arginfo;
+	argparse_context->state = ret;
+}
+
+/* Recursively print cmd of each argparse context, top-down */
+static void _argparse_help_cmd(const struct kjc_argparse* ctx, FILE* f) {
+	if(!ctx->parent) {
+		/* Root context: get cmd from basename of argv[0] */
+		const char* cmd = ctx->orig_argv[0];
+		const char* last_slash = strrchr(cmd, '/');
+		if(last_slash) {
+			cmd = last_slash + 1;
+		}
+		
+		fprintf(f, " %s", cmd);
+		return;
+	}
+	
+	/* Print parent commands first, so order comes naturally */
+	_argparse_help_cmd(ctx->parent, f);
+	
+	/* Get cmd from subcommand name used to call into this argparse context */
+	fprintf(f, " %s", ctx->parent->cur_arg->long_name);
+}
+
+static void _argparse_help_usage(const struct kjc_argparse* argparse_context, FILE* f) {
+	if(argparse_context->custom_usage) {
+		fprintf(f, "%s\n", argparse_context->custom_usage);
+		return;
+	}
+	
+	/* Print usage header with command used to reach this argparse context */
+	fprintf(f, "Usage:");
+	_argparse_help_cmd(argparse_context, f);
+	
+	if(argparse_context->shortargs_count > 0) {
+		/* Print all available short options (already sorted) */
+		fprintf(f, " [-");
+		
+		struct _arginfo** shortargs = _argparse_get_shortargs(argparse_context);
+		for(unsigned i = 0; i < argparse_context->shortargs_count; i++) {
+			fprintf(f, "%c", shortargs[i]->short_name);
+		}
+		
+		fprintf(f, "]");
+	}
+	
+	if(argparse_context->longargs_count > 0) {
+		fprintf(f, " [OPTIONS]");
+	}
+	
+	/* Print usage description of positional arguments */
+	if(argparse_context->positional_usage != NULL) {
+		fprintf(f, " %s", argparse_context->positional_usage);
+	}
+	
+	/* Print usage description for subcommand */
+	if(argparse_context->subcmds_count) {
+		fprintf(f, " COMMAND ...");
+	}
+	
+	fprintf(f, "\n");
+}
+
+/*
+ * Options listed by the help message are numbered like this: first the context's own options and subcommands in
+ * argstorage, then the global options a subcommand's context inherited from the root. A filtered help message has a
+ * bitset over these numbers of the options it lists.
+ */
+static inline unsigned _argparse_help_entries_count(const struct kjc_argparse* argparse_context) {
+	return argparse_context->argstorage_count + (argparse_context->parent ? argparse_context->globals_count : 0);
+}
+
+static inline const struct _arginfo* _argparse_help_entry(const struct kjc_argparse* argparse_context, unsigned i) {
+	if(i < argparse_context->argstorage_count) {
+		return &_argparse_get_argstorage(argparse_context)[i];
+	}
+	
+	return argparse_context->globals[i - argparse_context->argstorage_count];
+}
+
+/* The root's global options are in its own argstorage, a subcommand's are only pointed to */
+static inline unsigned _argparse_help_global_entry(const struct kjc_argparse* argparse_context, unsigned i) {
+	if(argparse_context->parent) {
+		return argparse_context->argstorage_count + i;
+	}
+	
+	return (unsigned)(argparse_context->globals[i] - _argparse_get_argstorage(argparse_context));
+}
+
+static inline bool _argparse_help_shows(const uint64_t* shown, unsigned i) {
+	return !shown || _argparse_bitset_test(shown, i);
+}
+
+/* The first option listed from i on (every option is listed without a filter), or count if there are no more */
+static unsigned _argparse_help_next(const uint64_t* shown, unsigned count, unsigned i) {
+	if(!shown) {
+		return i;
+	}
+	
+	/* Whole words of options that aren't listed are skipped at once, as a filter usually lists very few */
+	while(i < count) {
+		uint64_t word = shown[i >> 6] >> (i & 63);
+		if(word == 0) {
+			i = (i | 63) + 1;
+			continue;
+		}
+		
+		while(!(word & 1)) {
+			word >>= 1;
+			i++;
+		}
+		return i < count ? i : count;
+	}
+	
+	return count;
+}
+
+static bool _argparse_help_any_shown(const struct kjc_argparse* argparse_context, const uint64_t* shown) {
+	for(unsigned i = 0; i < _argparse_help_entries_count(argparse_context) / 64 + 1; i++) {
+		if(shown[i] != 0) {
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+/* Whether an option is listed under a group's heading, where group 0 is the "Options" heading */
+static inline bool _argparse_help_in_group(const struct _arginfo* pcur, unsigned group) {
+	/* Options without a description, subcommands, and global options are never listed in a group */
+	return pcur->description != NULL && pcur->type != _kARG_TYPE_COMMAND && !pcur->global && pcur->group == group;
+}
+
+/* Case insensitive comparison of two strings, like POSIX strcasecmp() */
+static bool _argparse_help_same_title(const char* title, const char* query) {
+	while(*title != '\0' && tolower((unsigned char)*title) == tolower((unsigned char)*query)) {
+		title++;
+		query++;
+	}
+	
+	return *title == *query;
+}
+
+/* Selects every option under a heading of the help message when the query is its title, like --help=commands */
+static bool _argparse_help_select_group(
+	const struct kjc_argparse* argparse_context,
+	const char* query,
+	uint64_t* shown
+) {
+	struct _arginfo* argstorage = _argparse_get_argstorage(argparse_context);
+	bool found = false;
+	
+	if(_argparse_help_same_title("Commands", query)) {
+		for(unsigned i = 0; i < argparse_context->argstorage_count; i++) {
+			if(argstorage[i].type == _kARG_TYPE_COMMAND) {
+				_argparse_bitset_set(shown, i);
+			}
+		}
+		found = true;
+	}
+	
+	for(unsigned group = 0; group <= argparse_context->help_groups_count; group++) {
+		const char* title = group == 0 ? "Options" : argparse_context->help_groups[group - 1];
+		if(!_argparse_help_same_title(title, query)) {
+			continue;
+		}
+		
+		for(unsigned i = 0; i < argparse_context->argstorage_count; i++) {
+			if(_argparse_help_in_group(&argstorage[i], group)) {
+				_argparse_bitset_set(shown, i);
+			}
+		}
+		found = true;
+	}
+	
+	if(_argparse_help_same_title("Global options", query)) {
+		for(unsigned i = 0; i < argparse_context->globals_count; i++) {
+			_argparse_bitset_set(shown, _argparse_help_global_entry(argparse_context, i));
+		}
+		found = true;
+	}
+	
+	return found;
+}
+
+/* ASCII case folding, which is all that --help=<pattern> needs and much cheaper than tolower() */
+static inline unsigned _argparse_help_fold(char c) {
+	return (unsigned char)c + (c >= 'A' && c <= 'Z' ? 'a' - 'A' : 0);
+}
+
+/* Case insensitive strstr(), for matching --help=<pattern> against names and descriptions */
+static bool _argparse_help_contains(const char* text, const char* pattern, size_t len) {
+	if(!text) {
+		return false;
+	}
+	
+	for(; *text != '\0'; text++) {
+		size_t i = 0;
+		while(i < len && _argparse_help_fold(text[i]) == _argparse_help_fold(pattern[i])) {
+			i++;
+		}
+		
+		if(i == len) {
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+/* Bucket of the trigram whose folded characters are the low 24 bits of chars */
+static inline unsigned _argparse_help_bucket(uint32_t chars) {
+	return ((chars & 0xffffff) * 0x9e3779b1u) >> (32 - _kARGPARSE_HELP_INDEX_BITS);
+}
+
+/*
+ * Trigram index of the names and descriptions in the help message. Any option whose text contains a pattern also
+ * contains every trigram of the pattern, so only the options in the bucket of one of the pattern's trigrams (the
+ * smallest one) need to be compared with it.
+ */
+struct _arghelp_index {
+	unsigned offsets[(1 << _kARGPARSE_HELP_INDEX_BITS) + 2];  /* Bucket b is postings[offsets[b]..offsets[b + 1]] */
+	unsigned postings[];  /* Ascending numbers of the options with a trigram in each bucket */
+};
+
+/* Adds an option to the bucket of each trigram in text, or only counts it in the bucket's size until filling */
+static void _argparse_help_index_text(
+	struct _arghelp_index* index,
+	unsigned* seen,
+	const char* text,
+	unsigned entry,
+	bool fill
+) {
+	if(!text) {
+		return;
+	}
+	
+	uint32_t chars = 0;
+	for(size_t i = 0; text[i] != '\0'; i++) {
+		chars = chars << 8 | _argparse_help_fold(text[i]);
+		if(i < 2) {
+			continue;
+		}
+		
+		/* Each bucket lists an option once, however many of its trigrams land there */
+		unsigned bucket = _argparse_help_bucket(chars);
+		if(seen[bucket] == entry + 1) {
+			continue;
+		}
+		seen[bucket] = entry + 1;
+		
+		if(fill) {
+			index->postings[index->offsets[bucket + 1]++] = entry;
+		}
+		else {
+			index->offsets[bucket + 2]++;
+		}
+	}
+}
+
+static struct _arghelp_index* _argparse_help_index_build(const struct kjc_argparse* argparse_context) {
+	unsigned buckets = 1 << _kARGPARSE_HELP_INDEX_BITS;
+	unsigned* seen = calloc(buckets, sizeof(*seen));
+	struct _arghelp_index* index = calloc(1, sizeof(*index));
+	argparse_assert(seen != NULL && index != NULL && "Allocation failure");
+	
+	/*
+	 * Counting sort: the first pass counts the size of each bucket, then each bucket is filled in after all of the
+	 * ones before it. Filling moves offsets[b + 1] from the start of bucket b to its end, the start of bucket b + 1.
+	 */
+	for(int fill = 0; fill < 2; fill++) {
+		if(fill) {
+			for(unsigned bucket = 0; bucket < buckets; bucket++) {
+				index->offsets[bucket + 2] += index->offsets[bucket + 1];
+			}
+			
+			index = realloc(index, sizeof(*index) + index->offsets[buckets + 1] * sizeof(*index->postings));
+			argparse_assert(index != NULL && "Allocation failure");
+			memset(seen, 0, buckets * sizeof(*seen));
+		}
+		
+		for(unsigned i = 0; i < _argparse_help_entries_count(argparse_context); i++) {
+			/* Options without a description aren't in the help message, so they never match */
+			const struct _arginfo* pcur = _argparse_help_entry(argparse_context, i);
+			if(pcur->description != NULL) {
+				_argparse_help_index_text(index, seen, pcur->long_name, i, fill);
+				_argparse_help_index_text(index, seen, pcur->description, i, fill);
+			}
+		}
+	}
+	
+	free(seen);
+	return index;
+}
+
+/* Selects the options whose name or description contains the pattern, using the index when there is one */
+static void _argparse_help_match(
+	const struct kjc_argparse* argparse_context,
+	const struct _arghelp_index* index,
+	const char* pattern,
+	uint64_t* shown
+) {
+	size_t len = strlen(pattern);
+	const unsigned* candidates = NULL;
+	unsigned candidates_count = _argparse_help_entries_count(argparse_context);
+	
+	/* Patterns shorter than a trigram have to be compared with every option */
+	if(index && len >= 3) {
+		/* The smallest bucket of the pattern's trigrams has the fewest options to compare it with */
+		unsigned best = 0;
+		uint32_t chars = _argparse_help_fold(pattern[0]) << 8 | _argparse_help_fold(pattern[1]);
+		for(size_t i = 2; i < len; i++) {
+			chars = chars << 8 | _argparse_help_fold(pattern[i]);
+			unsigned bucket = _argparse_help_bucket(chars);
+			if(
+				i == 2
+				|| index->offsets[bucket + 1] - index->offsets[bucket] < index->offsets[best + 1] - index->offsets[best]
+			) {
+				best = bucket;
+			}
+		}
+		
+		candidates = &index->postings[index->offsets[best]];
+		candidates_count = index->offsets[best + 1] - index->offsets[best];
+	}
+	
+	for(unsigned i = 0; i < candidates_count; i++) {
+		unsigned entry = candidates ? candidates[i] : i;
+		const struct _arginfo* pcur = _argparse_help_entry(argparse_context, entry);
+		if(
+			pcur->description != NULL
+			&& (_argparse_help_contains(pcur->long_name, pattern, len)
+				|| _argparse_help_contains(pcur->description, pattern, len))
+		) {
+			_argparse_bitset_set(shown, entry);
+		}
+	}
+}
+
+static unsigned _argparse_get_subcmd_description_column(const struct kjc_argparse* argparse_context) {
+	if(argparse_context->subcmd_description_column >= 0) {
+		return argparse_context->subcmd_description_column;
+	}
+	
+	return 0
+		+ argparse_context->indent
+		+ argparse_context->subcmd_width
+		+ argparse_context->description_padding
+		;
+}
+
+static void _argparse_help_subcmds(const struct kjc_argparse* argparse_context, const uint64_t* shown, FILE* f) {
+	struct _arginfo** subcmds = _argparse_get_subcmds(argparse_context);
+	struct _arginfo* argstorage = _argparse_get_argstorage(argparse_context);
+	bool work_to_do = false;
+	
+	for(unsigned i = 0; i < argparse_context->subcmds_count; i++) {
+		if(subcmds[i]->description != NULL && _argparse_help_shows(shown, (unsigned)(subcmds[i] - argstorage))) {
+			work_to_do = true;
+		}
+	}
+	
+	if(!work_to_do) {
+		return;
+	}
+	
+	unsigned descStart = _argparse_get_subcmd_description_column(argparse_context);
+	
+	fprintf(f, "\n");
+	fprintf(f, "Commands:\n");
+	
+	/* Print description of each command */
+	for(unsigned i = 0; i < argparse_context->subcmds_count; i++) {
+		/* Don't print help for subcommands without a description */
+		if(!subcmds[i]->description || !_argparse_help_shows(shown, (unsigned)(subcmds[i] - argstorage))) {
+			continue;
+		}
+		
+		unsigned col = 0;
+		col += fprintf(f, "%*s", argparse_context->indent, "");
+		
+		/* Print command name */
+		col += fprintf(f, "%s", subcmds[i]->long_name);
+		
+		/* Seek to description column */
+		if(col + 2 > descStart) {
+			/* Description will go on next line */
+			fprintf(f, "\n");
+			col = 0;
+		}
+		
+		/* Pad with spaces until reaching description column */
+		fprintf(f, "%*s", descStart - col, "");
+		
+		/* Print command description */
+		fprintf(f, "%s\n", subcmds[i]->description);
+	}
+}
+
+static unsigned _argparse_get_description_column(const struct kjc_argparse* argparse_context) {
+	if(argparse_context->description_column >= 0) {
+		return argparse_context->description_column;
+	}
+	
+	return 0
+		+ argparse_context->indent
+		+ 2 /* Short option */
+		+ 2 /* Comma and space between short and long options */
+		+ argparse_context->long_prefix_len /* "--" before long option */
+		+ argparse_context->long_name_width
+		+ argparse_context->description_padding
+		;
+}
+
+/* List the choices of an ARG_CHOICE option under its description, wrapping long lists of choices */
+static void _argparse_help_choices(const struct _argchoices* choices, unsigned descStart, FILE* f) {
+	unsigned col = fprintf(f, "%*sValid choices:", descStart, "");
+	unsigned wrapStart = col + 1;
+	
+	for(unsigned i = 0; i < choices->count; i++) {
+		const char* separator = i + 1 < choices->count ? "," : "";
+		unsigned len = (unsigned)strlen(choices->names[i]) + (unsigned)strlen(separator);
+		
+		if(col + 1 + len > _kARGPARSE_HELP_WIDTH && col > wrapStart) {
+			fprintf(f, "\n");
+			col = fprintf(f, "%*s", wrapStart - 1, "");
+		}
+		
+		col += fprintf(f, " %s%s", choices->names[i], separator);
+	}
+	
+	fprintf(f, "\n");
+}
+
+/* Print one line of help for an option (and its choices, if it has any) */
+static void _argparse_help_option(
+	const struct kjc_argparse* argparse_context,
+	const struct _arginfo* pcur,
+	unsigned descStart,
+	FILE* f
+) {
+	const char* value_hint = _arginfo_value_hint(argparse_context, pcur);
+	unsigned col = 0;
+	
+	col += fprintf(f, "%*s", argparse_context->indent, "");
+	
+	/* Print short option (if set) */
+	if(pcur->short_name != '\0') {
+		col += fprintf(f, "-%c", pcur->short_name);
+		if(!pcur->long_name && value_hint != NULL) {
+			col += fprintf(f, " <%s>", value_hint);
+		}
+	}
+	else {
+		col += fprintf(f, "  ");
+	}
+	
+	/* Print long option (if set) */
+	if(pcur->long_name != NULL) {
+		/* If short option was set, separate it with a comma */
+		if(pcur->short_name != '\0') {
+			col += fprintf(f, ", ");
+		}
+		else {
+			col += fprintf(f, "  ");
+		}
+		
+		/* Print long option */
+		col += fprintf(f, "%s%s", argparse_context->long_arg_prefix, pcur->long_name);
+		if(value_hint != NULL) {
+			col += fprintf(f, " <%s>", value_hint);
+		}
+	}
+	
+	/* Seek to description column */
+	if(col + 2 > descStart) {
+		/* Description will go on next line */
+		fprintf(f, "\n");
+		col = 0;
+	}
+	
+	/* Pad with spaces until reaching description column */
+	fprintf(f, "%*s", descStart - col, "");
+	
+	/* Print the argument's type if not void */
+	if(_argparse_flag(argparse_context, _kARGPARSE_TYPE_HINTS)) {
+		switch(pcur->type) {
+			case _kARG_TYPE_LONG:
+				fprintf(f, "[int] ");
+				break;
+			
+			case _kARG_TYPE_STRING:
+				fprintf(f, "[string] ");
+				break;
+			
+			case _kARG_TYPE_CHOICE:
+				fprintf(f, "[choice] ");
+				break;
+			
+			case _kARG_TYPE_KV:
+				fprintf(f, "[key=value] ");
+				break;
+		}
+	}
+	
+	/* Print the description and end the line */
+	fprintf(f, "%s\n", pcur->description);
+	
+	if(pcur->type == _kARG_TYPE_CHOICE) {
+		_argparse_help_choices(pcur->ext.choices, descStart, f);
+	}
+}
+
+static void _argparse_help_options(
+	const struct kjc_argparse* argparse_context,
+	unsigned group,
+	const uint64_t* shown,
+	FILE* f
+) {
+	struct _arginfo* argstorage = _argparse_get_argstorage(argparse_context);
+	unsigned count = argparse_context->argstorage_count;
+	bool work_to_do = false;
+	
+	for(unsigned i = _argparse_help_next(shown, count, 0); i < count; i = _argparse_help_next(shown, count, i + 1)) {
+		if(_argparse_help_in_group(&argstorage[i], group)) {
+			work_to_do = true;
+			break;
+		}
+	}
+	
+	if(!work_to_do) {
+		return;
+	}
+	
+	unsigned descStart = _argparse_get_description_column(argparse_context);
+	
+	fprintf(f, "\n");
+	fprintf(f, "%s:\n", group == 0 ? "Options" : argparse_context->help_groups[group - 1]);
+	
+	/* Print description of each argument */
+	for(unsigned i = _argparse_help_next(shown, count, 0); i < count; i = _argparse_help_next(shown, count, i + 1)) {
+		if(_argparse_help_in_group(&argstorage[i], group)) {
+			_argparse_help_option(argparse_context, &argstorage[i], descStart, f);
+		}
+	}
+}
+
+/* Global options are listed once in their own section, by the root and by every subcommand that accepts them */
+static void _argparse_help_globals(const struct kjc_argparse* argparse_context, const uint64_t* shown, FILE* f) {
+	bool work_to_do = false;
+	
+	for(unsigned i = 0; i < argparse_context->globals_count; i++) {
+		if(
+			argparse_context->globals[i]->description != NULL
+			&& _argparse_help_shows(shown, _argparse_help_global_entry(argparse_context, i))
+		) {
+			work_to_do = true;
+			break;
+		}
+	}
+	
+	if(!work_to_do) {
+		return;
+	}
+	
+	unsigned descStart = _argparse_get_description_column(argparse_context);
+	
+	fprintf(f, "\n");
+	fprintf(f, "Global options:\n");
+	
+	for(unsigned i = 0; i < argparse_context->globals_count; i++) {
+		if(
+			argparse_context->globals[i]->description != NULL
+			&& _argparse_help_shows(shown, _argparse_help_global_entry(argparse_context, i))
+		) {
+			_argparse_help_option(argparse_context, argparse_context->globals[i], descStart, f);
+		}
+	}
+}
+
+static void _argparse_help_suffix(const struct kjc_argparse* argparse_context, FILE* f) {
+	if(!argparse_context->custom_suffix) {
+		return;
+	}
+	
+	fprintf(f, "\n");
+	fprintf(f, "%s\n", argparse_context->custom_suffix);
+}
+
+/*
+ * The index is built the first time a pattern needs it, and kept for as long as the schema. Contexts copied from the
+ * same schema share it, and may print their help on several threads at once.
+ */
+static const struct _arghelp_index* _argparse_help_get_index(const struct kjc_argparse* argparse_context) {
+	struct _arghelp_index** slot = argparse_context->help_index;
+#if defined(__GNUC__) && !defined(KJC_ARGPARSE_NO_THREADS)
+	struct _arghelp_index* index = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+	if(!index) {
+		struct _arghelp_index* expected = NULL;
+		index = _argparse_help_index_build(argparse_context);
+		if(!__atomic_compare_exchange_n(slot, &expected, index, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			/* Another thread built it first */
+			free(index);
+			index = expected;
+		}
+	}
+#else /* __GNUC__ && !KJC_ARGPARSE_NO_THREADS */
+	struct _arghelp_index* index = *slot;
+	if(!index) {
+		index = *slot = _argparse_help_index_build(argparse_context);
+	}
+#endif /* __GNUC__ && !KJC_ARGPARSE_NO_THREADS */
+	return index;
+}
+
+/* Print the help message, or with --help=<query> only the part of it that the query selects */
+static void _argparse_help_print(const struct kjc_argparse* argparse_context) {
+	FILE* f = argparse_context->stream;
+	if(!f) {
+		return;
+	}
+	
+	/* Leading dashes are skipped, so --help=--verbose finds the --verbose option */
+	const char* query = argparse_context->help_query;
+	while(query != NULL && *query == '-') {
+		query++;
+	}
+	
+	uint64_t* shown = NULL;
+	if(query != NULL && *query != '\0') {
+		shown = calloc(_argparse_help_entries_count(argparse_context) / 64 + 1, sizeof(*shown));
+		argparse_assert(shown != NULL && "Allocation failure");
+		
+		/*
+		 * Only a schema's options are indexed, as building the index costs more than comparing the pattern with
+		 * every option once, and an ARGPARSE block prints its help once. Patterns shorter than a trigram are always
+		 * compared with every option.
+		 */
+		if(!_argparse_help_select_group(argparse_context, query, shown)) {
+			const struct _arghelp_index* index = NULL;
+			if(argparse_context->help_index != NULL && strlen(query) >= 3) {
+				index = _argparse_help_get_index(argparse_context);
+			}
+			_argparse_help_match(argparse_context, index, query, shown);
+		}
+	}
+	
+	_argparse_help_usage(argparse_context, f);
+	if(shown && !_argparse_help_any_shown(argparse_context, shown)) {
+		fprintf(f, "\n");
+		fprintf(f, "No options match \"%s\".\n", query);
+	}
+	else {
+		_argparse_help_subcmds(argparse_context, shown, f);
+		for(unsigned group = 0; group <= argparse_context->help_groups_count; group++) {
+			_argparse_help_options(argparse_context, group, shown, f);
+		}
+		_argparse_help_globals(argparse_context, shown, f);
+	}
+	_argparse_help_suffix(argparse_context, f);
+	
+	free(shown);
+}
+
+void _argparse_help(struct kjc_argparse* argparse_context) {
+	/* The help message lists the options in order and lines up their descriptions */
+	if(argparse_context->ext_flags & _kARGPARSE_EXT_UNSORTED) {
+		_argparse_sort_tables(argparse_context);
+	}
+	
+	_argparse_help_print(argparse_context);
+}
+
+char* _argparse_next(struct kjc_argparse* argparse_context) {
+	/* After a subcommand, the global options that the root already handled are skipped */
+	if(argparse_context->hoisted != NULL && !(argparse_context->ext_flags & _kARGPARSE_EXT_HOISTING)) {
+		while(
+			*argparse_context->argidx < argparse_context->orig_argc
+			&& _argparse_is_hoisted(argparse_context, *argparse_context->argidx)
+		) {
+			++*argparse_context->argidx;
+		}
+	}
+	
+	if(*argparse_context->argidx >= argparse_context->orig_argc) {
+		return NULL;
+	}
+	
+	return argparse_context->orig_argv[(*argparse_context->argidx)++];
+}
+
+struct kjc_argkv _argparse_value_kv(const struct kjc_argparse* argparse_context) {
+	argparse_assert(argparse_context->argtype == _kARG_TYPE_KV);
+	return *argparse_context->argvalue.val_kv;
+}
+
+long _argparse_value_long(const struct kjc_argparse* argparse_context) {
+	argparse_assert(argparse_context->argtype == _kARG_TYPE_LONG);
+	return argparse_context->argvalue.val_long;
+}
+
+const char* _argparse_value_string(const struct kjc_argparse* argparse_context) {
+	argparse_assert(argparse_context->argtype == _kARG_TYPE_STRING);
+	return argparse_context->argvalue.val_string;
+}
+
+size_t _argparse_value_len(const struct kjc_argparse* argparse_context) {
+	return argparse_context->argvalue_len;
+}
+
+struct kjc_argslice _argparse_value_slice(const struct kjc_argparse* argparse_context) {
+	struct kjc_argslice slice;
+	slice.ptr = _argparse_value_string(argparse_context);
+	slice.len = argparse_context->argvalue_len;
+	return slice;
+}
+
+struct kjc_argbatch _argparse_value_batch(const struct kjc_argparse* argparse_context) {
+	/* The run ends just before the current argument index */
+	struct kjc_argbatch batch;
+	batch.count = (int)argparse_context->argvalue_len;
+	batch.args = &argparse_context->orig_argv[*argparse_context->argidx - batch.count];
+	return batch;
+}
+
+
+struct _schema_command {
+	int id;
+	struct kjc_argparse_schema* schema;
+};
+
+struct _builder_command {
+	int id;
+	struct kjc_argparse_builder* builder;
+};
+
+/* Help group of the options from first_option on, until the next group */
+struct _builder_group {
+	size_t first_option;
+	const char* title;
+};
+
+struct kjc_argparse_builder {
+	struct kjc_argparse_config config;
+	
+	/* Grown geometrically, so adding an option is amortized O(1) */
+	struct kjc_argparse_option* options;
+	size_t options_count;
+	size_t options_cap;
+	
+	struct kjc_argparse_constraint* constraints;
+	size_t constraints_count;
+	size_t constraints_cap;
+	
+	struct _builder_command* commands;
+	size_t commands_count;
+	size_t commands_cap;
+	
+	struct _builder_group* groups;
+	size_t groups_count;
+	size_t groups_cap;
+};
+
+void kjc_argparse_config_init(struct kjc_argparse_config* config) {
+	struct kjc_argparse defaults = {0};
+	_argparse_set_defaults(&defaults);
+	
+	memset(config, 0, sizeof(*config));
+	config->stream = defaults.stream;
+	config->custom_usage = defaults.custom_usage;
+	config->custom_suffix = defaults.custom_suffix;
+	config->long_prefix = defaults.long_arg_prefix;
+	config->positional_usage = NULL;
+	config->subcmd_description_column = defaults.subcmd_description_column;
+	config->description_column = defaults.description_column;
+	config->indent = defaults.indent;
+	config->description_padding = defaults.description_padding;
+	config->flags = defaults.flags;
+}
+
+static struct kjc_argparse_schema* _argparse_schema_compile(
+	const struct kjc_argparse_config* config,
+	const struct kjc_argparse_option* options,
+	size_t count,
+	const struct kjc_argparse_constraint* constraints,
+	size_t constraints_count,
+	const struct _builder_group* groups,
+	size_t groups_count
+) {
+	struct kjc_argparse_config default_config;
+	if(!config) {
+		kjc_argparse_config_init(&default_config);
+		config = &default_config;
+	}
+	
+	struct kjc_argparse_schema* schema = calloc(1, sizeof(*schema));
+	argparse_assert(schema != NULL && "Allocation failure");
+	struct kjc_argparse* ctx = &schema->context;
+	
+	ctx->stream = config->stream;
+	ctx->custom_usage = config->custom_usage;
+	ctx->custom_suffix = config->custom_suffix;
+	ctx->long_arg_prefix = config->long_prefix;
+	ctx->positional_usage = config->positional_usage;
+	ctx->subcmd_description_column = config->subcmd_description_column;
+	ctx->description_column = config->description_column;
+	ctx->indent = config->indent;
+	ctx->description_padding = config->description_padding;
+	ctx->flags = (unsigned char)(config->flags & ~_kARGPARSE_FLAG_DONE);
+	ctx->ext_flags = (unsigned char)(config->flags >> 8);
+	argparse_assert(
+		((ctx->flags ^ KJC_ARGPARSE_DEFAULT_FLAGS) & _kARGPARSE_FIXED_FLAGS) == 0
+		&& "Flag differs from its ARGPARSE_DEFAULT_* setting, which KJC_ARGPARSE_FIXED_FLAGS made constant"
+	);
+	
+	/* Initialization phase */
+	size_t group = 0;
+	for(size_t i = 0; i < count; i++) {
+		while(group < groups_count && groups[group].first_option == i) {
+			_argparse_group(ctx, groups[group++].title);
+		}
+		
+		const struct kjc_argparse_option* opt = &options[i];
+		_argparse_add(
+			ctx, _arg_make_id(opt->id), opt->short_name, opt->long_name, opt->description, opt->type, opt->var_name
+		);
+	}
+	for(size_t i = 0; i < constraints_count; i++) {
+		const struct kjc_argparse_constraint* constraint = &constraints[i];
+		_argparse_add_constraints(ctx, (unsigned char)constraint->kind, &constraint->option, 1, constraint->other);
+	}
+	_argparse_post_init(ctx);
+	
+	/* Every context copied from the schema keeps the --help=<pattern> index here, once one of them builds it */
+	ctx->help_index = calloc(1, sizeof(*ctx->help_index));
+	argparse_assert(ctx->help_index != NULL && "Allocation failure");
+	
+	ctx->state = _kARG_VALUE_READY;
+	return schema;
+}
+
+struct kjc_argparse_schema* kjc_argparse_schema_new(
+	const struct kjc_argparse_config* config,
+	const struct kjc_argparse_option* options,
+	size_t count
+) {
+	return _argparse_schema_compile(config, options, count, NULL, 0, NULL, 0);
+}
+
+void kjc_argparse_schema_free(struct kjc_argparse_schema* schema) {
+	if(schema) {
+		argparse_assert(!(schema->context.ext_flags & _kARGPARSE_EXT_STATIC) && "Static schemas can't be freed");
+		for(size_t i = 0; i < schema->commands_count; i++) {
+			kjc_argparse_schema_free(schema->commands[i].schema);
+		}
+		free(schema->commands);
+		_argparse_dealloc(&schema->context);
+		free(schema);
+	}
+}
+
+static int _schema_command_compare(const void* _a, const void* _b) {
+	const struct _schema_command* a = _a;
+	const struct _schema_command* b = _b;
+	
+	return (a->id > b->id) - (a->id < b->id);
+}
+
+const struct kjc_argparse_schema* kjc_argparse_schema_command(const struct kjc_argparse_schema* schema, int id) {
+	struct _schema_command key = {id, NULL};
+	const struct _schema_command* found = NULL;
+	if(schema->commands_count > 0) {
+		found = bsearch(&key, schema->commands, schema->commands_count, sizeof(key), _schema_command_compare);
+	}
+	
+	return found ? found->schema : NULL;
+}
+
+struct kjc_argparse_builder* kjc_argparse_builder_new(const struct kjc_argparse_config* config) {
+	struct kjc_argparse_builder* builder = calloc(1, sizeof(*builder));
+	argparse_assert(builder != NULL && "Allocation failure");
+	
+	if(config) {
+		builder->config = *config;
+	}
+	else {
+		kjc_argparse_config_init(&builder->config);
+	}
+	
+	return builder;
+}
+
+/* Make room for at least count more elements in a geometrically growing array */
+static void* _argparse_grow(void* array, size_t elem_size, size_t used, size_t count, size_t* pcap) {
+	size_t cap = *pcap;
+	if(used + count <= cap) {
+		return array;
+	}
+	
+	if(cap < 8) {
+		cap = 8;
+	}
+	while(cap < used + count) {
+		cap *= 2;
+	}
+	
+	array = realloc(array, cap * elem_size);
+	argparse_assert(array != NULL && "Allocation failure");
+	*pcap = cap;
+	return array;
+}
+
+void kjc_argparse_builder_add(
+	struct kjc_argparse_builder* builder,
+	const struct kjc_argparse_option* options,
+	size_t count
+) {
+	builder->options = _argparse_grow(
+		builder->options, sizeof(*builder->options), builder->options_count, count, &builder->options_cap
+	);
+	memcpy(&builder->options[builder->options_count], options, count * sizeof(*options));
+	builder->options_count += count;
+}
+
+void kjc_argparse_builder_constrain(
+	struct kjc_argparse_builder* builder,
+	const struct kjc_argparse_constraint* constraints,
+	size_t count
+) {
+	builder->constraints = _argparse_grow(
+		builder->constraints, sizeof(*builder->constraints), builder->constraints_count, count,
+		&builder->constraints_cap
+	);
+	memcpy(&builder->constraints[builder->constraints_count], constraints, count * sizeof(*constraints));
+	builder->constraints_count += count;
 }
 
-static void _argparse_help_usage(const struct kjc_argparse* argparse_context, FILE* f) {
-	if(argparse_context->custom_usage) {
-		fprintf(f, "%s\n", argparse_context->custom_usage);
-		return;
-	}
+struct kjc_argparse_builder* kjc_argparse_builder_command(
+	struct kjc_argparse_builder* builder,
+	int id,
+	const char* name,
+	const char* description,
+	const struct kjc_argparse_config* config
+) {
+	struct kjc_argparse_option opt = {0};
+	opt.id = id;
+	opt.type = _kARG_TYPE_COMMAND;
+	opt.long_name = name;
+	opt.description = description;
+	kjc_argparse_builder_add(builder, &opt, 1);
 	
-	/* Print usage header with command used to reach this argparse context */
-	fprintf(f, "Usage:");
-	_argparse_help_cmd(argparse_context, f);
+	builder->commands = _argparse_grow(
+		builder->commands, sizeof(*builder->commands), builder->commands_count, 1, &builder->commands_cap
+	);
+	struct _builder_command* cmd = &builder->commands[builder->commands_count++];
+	cmd->id = id;
+	cmd->builder = kjc_argparse_builder_new(config);
+	return cmd->builder;
+}
+
+void kjc_argparse_builder_group(struct kjc_argparse_builder* builder, const char* title) {
+	builder->groups = _argparse_grow(
+		builder->groups, sizeof(*builder->groups), builder->groups_count, 1, &builder->groups_cap
+	);
+	struct _builder_group* group = &builder->groups[builder->groups_count++];
+	group->first_option = builder->options_count;
+	group->title = title;
+}
+
+struct kjc_argparse_schema* kjc_argparse_builder_freeze(struct kjc_argparse_builder* builder) {
+	/* All options are known now, so they only need to be sorted once */
+	struct kjc_argparse_schema* schema = _argparse_schema_compile(
+		&builder->config, builder->options, builder->options_count,
+		builder->constraints, builder->constraints_count,
+		builder->groups, builder->groups_count
+	);
 	
-	if(argparse_context->shortargs_count > 0) {
-		/* Print all available short options (already sorted) */
-		fprintf(f, " [-");
+	if(builder->commands_count > 0) {
+		schema->commands = calloc(builder->commands_count, sizeof(*schema->commands));
+		argparse_assert(schema->commands != NULL && "Allocation failure");
 		
-		struct _arginfo** shortargs = _argparse_get_shortargs(argparse_context);
-		for(unsigned i = 0; i < argparse_context->shortargs_count; i++) {
-			fprintf(f, "%c", shortargs[i]->short_name);
+		for(size_t i = 0; i < builder->commands_count; i++) {
+			schema->commands[i].id = builder->commands[i].id;
+			schema->commands[i].schema = kjc_argparse_builder_freeze(builder->commands[i].builder);
+			builder->commands[i].builder = NULL;
 		}
+		schema->commands_count = builder->commands_count;
 		
-		fprintf(f, "]");
+		qsort(schema->commands, schema->commands_count, sizeof(*schema->commands), _schema_command_compare);
+		for(size_t i = 1; i < schema->commands_count; i++) {
+			argparse_assert(schema->commands[i - 1].id != schema->commands[i].id && "Duplicate subcommand id");
+		}
 	}
 	
-	if(argparse_context->longargs_count > 0) {
-		fprintf(f, " [OPTIONS]");
+	kjc_argparse_builder_free(builder);
+	return schema;
+}
+
+void kjc_argparse_builder_free(struct kjc_argparse_builder* builder) {
+	if(builder) {
+		for(size_t i = 0; i < builder->commands_count; i++) {
+			kjc_argparse_builder_free(builder->commands[i].builder);
+		}
+		free(builder->commands);
+		free(builder->groups);
+		free(builder->constraints);
+		free(builder->options);
+		free(builder);
+	}
+}
+
+/* Finish setting up a context copied from a KJC_ARGPARSE_STATIC_SCHEMA(), whose tables were built by the compiler */
+static void _argparse_begin_static(struct kjc_argparse* ctx) {
+	if(ctx->ext_flags & _kARGPARSE_EXT_DEFAULT_STREAM) {
+		ctx->stream = _argparse_default_stream();
+		ctx->ext_flags &= ~_kARGPARSE_EXT_DEFAULT_STREAM;
 	}
 	
-	/* Print usage description of positional arguments */
-	if(argparse_context->positional_usage != NULL) {
-		fprintf(f, " %s", argparse_context->positional_usage);
+	/*
+	 * The compiler can't sort strings, so the tables are in the order the options were listed in. Lookups would
+	 * silently miss options in unsorted tables, so this is checked in every build.
+	 */
+	bool sorted = true;
+	struct _arginfo** subcmds = _argparse_get_subcmds(ctx);
+	for(unsigned i = 1; i < ctx->subcmds_count; i++) {
+		sorted &= strcmp(subcmds[i - 1]->long_name, subcmds[i]->long_name) < 0;
 	}
 	
-	/* Print usage description for subcommand */
-	if(argparse_context->subcmds_count) {
-		fprintf(f, " COMMAND ...");
+	struct _arginfo** longargs = _argparse_get_longargs(ctx);
+	for(unsigned i = 1; i < ctx->longargs_count; i++) {
+		sorted &= strcmp(longargs[i - 1]->long_name, longargs[i]->long_name) < 0;
 	}
 	
-	fprintf(f, "\n");
+	if(!sorted) {
+		fprintf(stderr, "Error: The entries of a static schema aren't sorted by their long names\n");
+		abort();
+	}
 }
 
-static unsigned _argparse_get_subcmd_description_column(const struct kjc_argparse* argparse_context) {
-	if(argparse_context->subcmd_description_column >= 0) {
-		return argparse_context->subcmd_description_column;
+void kjc_argparse_begin(struct kjc_argparse* ctx, const struct kjc_argparse_schema* schema, int argc, char** argv) {
+	/* The sorted tables are shared with the schema, only the parsing state is per context */
+	*ctx = schema->context;
+	ctx->orig_argc = argc;
+	ctx->orig_argv = argv;
+	ctx->argidx_top = 1;
+	ctx->argidx = &ctx->argidx_top;
+	
+#ifdef ARGPARSE_WITH_SCHEMA
+	_argparse_schema_claim(ctx);
+#endif /* ARGPARSE_WITH_SCHEMA */
+	
+	if(ctx->ext_flags & _kARGPARSE_EXT_STATIC) {
+		_argparse_begin_static(ctx);
 	}
 	
-	return 0
-		+ argparse_context->indent
-		+ argparse_context->subcmd_width
-		+ argparse_context->description_padding
-		;
+#ifdef ARGPARSE_WITH_SCHEMA
+	/* A schema's contexts skip the init phase, where argparse blocks dump theirs, so they're dumped as they start */
+	_argparse_schema_dump(ctx);
+#endif /* ARGPARSE_WITH_SCHEMA */
 }
 
-static void _argparse_help_subcmds(const struct kjc_argparse* argparse_context, FILE* f) {
-	struct _arginfo** subcmds = _argparse_get_subcmds(argparse_context);
-	bool work_to_do = false;
+void kjc_argparse_begin_command(
+	struct kjc_argparse* ctx,
+	const struct kjc_argparse_schema* schema,
+	struct kjc_argparse* parent
+) {
+	/* Needed later for printing the program name in usage text */
+	argparse_assert(parent->cur_arg != NULL && parent->cur_arg->type == _kARG_TYPE_COMMAND);
 	
-	for(unsigned i = 0; i < argparse_context->subcmds_count; i++) {
-		if(subcmds[i]->description != NULL) {
-			work_to_do = true;
-		}
+	*ctx = schema->context;
+	ctx->parent = parent;
+	ctx->orig_argc = parent->orig_argc;
+	ctx->orig_argv = parent->orig_argv;
+	ctx->argidx = parent->argidx;
+	
+	if(ctx->ext_flags & _kARGPARSE_EXT_STATIC) {
+		_argparse_begin_static(ctx);
 	}
 	
-	if(!work_to_do) {
-		return;
+#ifdef ARGPARSE_WITH_SCHEMA
+	_argparse_schema_dump(ctx);
+#endif /* ARGPARSE_WITH_SCHEMA */
+}
+
+int kjc_argparse_next(struct kjc_argparse* ctx, struct kjc_argparse_event* event) {
+	/*
+	 * Never advance past the END state: _argparse_parse() would free the arg tables, which
+	 * belong to the schema here.
+	 */
+	if(ctx->state == _kARG_VALUE_END || ctx->state == _kARG_VALUE_ERROR) {
+		return 0;
 	}
 	
-	unsigned descStart = _argparse_get_subcmd_description_column(argparse_context);
+	_argparse_parse(ctx);
 	
-	fprintf(f, "\n");
-	fprintf(f, "Commands:\n");
+	memset(event, 0, sizeof(*event));
+	event->index = *ctx->argidx - (ctx->argtype != _kARG_TYPE_SHORTGROUP);
+	event->id = -1;
 	
-	/* Print description of each command */
-	for(unsigned i = 0; i < argparse_context->subcmds_count; i++) {
-		/* Don't print help for subcommands without a description */
-		if(!subcmds[i]->description) {
-			continue;
-		}
+	switch(ctx->state) {
+		case _kARG_VALUE_POSITIONAL:
+		case _kARG_VALUE_OTHER:
+			event->kind = ctx->state == _kARG_VALUE_OTHER ? KJC_ARGPARSE_EVENT_OTHER : KJC_ARGPARSE_EVENT_POSITIONAL;
+			event->value = ctx->orig_argv[*ctx->argidx - 1];
+			event->value_len = ctx->argvalue_len;
+			break;
 		
-		unsigned col = 0;
-		col += fprintf(f, "%*s", argparse_context->indent, "");
+		case _kARG_VALUE_POSITIONAL_BATCH:
+			event->kind = KJC_ARGPARSE_EVENT_POSITIONAL_BATCH;
+			event->batch = _argparse_value_batch(ctx);
+			event->index = (int)(event->batch.args - ctx->orig_argv);
+			break;
 		
-		/* Print command name */
-		col += fprintf(f, "%s", subcmds[i]->long_name);
+		case _kARG_VALUE_HELP:
+			event->kind = KJC_ARGPARSE_EVENT_HELP;
+			event->value = ctx->help_query;
+			break;
 		
-		/* Seek to description column */
-		if(col + 2 > descStart) {
-			/* Description will go on next line */
-			fprintf(f, "\n");
-			col = 0;
-		}
+		case _kARG_VALUE_END:
+			event->kind = KJC_ARGPARSE_EVENT_END;
+			break;
 		
-		/* Pad with spaces until reaching description column */
-		fprintf(f, "%*s", descStart - col, "");
+		case _kARG_VALUE_ERROR:
+			event->kind = KJC_ARGPARSE_EVENT_ERROR;
+			break;
 		
-		/* Print command description */
-		fprintf(f, "%s\n", subcmds[i]->description);
+		default:
+			/* Matched a registered option, whose id was stored with _arg_make_id() */
+			argparse_assert(ctx->cur_arg != NULL && ctx->cur_arg->arg_id == ctx->state);
+			event->id = ctx->state >> 1;
+			
+			switch(ctx->cur_arg->type) {
+				case _kARG_TYPE_COMMAND:
+					event->kind = KJC_ARGPARSE_EVENT_COMMAND;
+					break;
+				
+				case _kARG_TYPE_STRING:
+					event->kind = KJC_ARGPARSE_EVENT_OPTION;
+					event->value = ctx->argvalue.val_string;
+					event->value_len = ctx->argvalue_len;
+					break;
+				
+				case _kARG_TYPE_LONG:
+					event->kind = KJC_ARGPARSE_EVENT_OPTION;
+					event->value_long = ctx->argvalue.val_long;
+					break;
+				
+				default:
+					event->kind = KJC_ARGPARSE_EVENT_OPTION;
+					break;
+			}
+			break;
 	}
+	
+	return 1;
 }
 
-static unsigned _argparse_get_description_column(const struct kjc_argparse* argparse_context) {
-	if(argparse_context->description_column >= 0) {
-		return argparse_context->description_column;
+void kjc_argparse_help(const struct kjc_argparse* ctx) {
+	_argparse_help_print(ctx);
+}
+
+char* kjc_argparse_take_next(struct kjc_argparse* ctx) {
+	return _argparse_next(ctx);
+}
+
+const struct kjc_argerror* kjc_argparse_error(const struct kjc_argparse* ctx) {
+	return ctx->error.code != KJC_ARGERROR_NONE ? &ctx->error : NULL;
+}
+
+const struct kjc_argkv* kjc_argmap_get(const struct kjc_argmap* map, const char* key) {
+	if(map->count == 0) {
+		return NULL;
 	}
 	
-	return 0
-		+ argparse_context->indent
-		+ 2 /* Short option */
-		+ 2 /* Comma and space between short and long options */
-		+ argparse_context->long_prefix_len /* "--" before long option */
-		+ argparse_context->long_name_width
-		+ argparse_context->description_padding
-		;
+	uint32_t entry = *_argmap_find_slot(map, key, strlen(key));
+	return entry != 0 ? &map->entries[entry - 1] : NULL;
 }
 
-static void _argparse_help_options(const struct kjc_argparse* argparse_context, FILE* f) {
-	struct _arginfo* argstorage = _argparse_get_argstorage(argparse_context);
-	bool work_to_do = false;
+void kjc_argmap_free(struct kjc_argmap* map) {
+	/* The hash table is in the same allocation as the entries */
+	free(map->entries);
+	map->entries = NULL;
+	map->slots = NULL;
+	map->count = 0;
+	map->cap = 0;
+}
+
+size_t kjc_argparse_format_error(const struct kjc_argparse* ctx, char* buf, size_t size) {
+	struct _argsink sink = {NULL, buf, size, 0};
+	if(size != 0) {
+		buf[0] = '\0';
+	}
 	
-	for(unsigned i = 0; i < argparse_context->argstorage_count; i++) {
-		struct _arginfo* pcur = &argstorage[i];
-		if(pcur->type != _kARG_TYPE_COMMAND && pcur->description != NULL) {
-			work_to_do = true;
-			break;
+	if(ctx->error.code != KJC_ARGERROR_NONE) {
+		_argparse_write_error(ctx, &sink);
+	}
+	return sink.len;
+}
+
+int kjc_argparse_export(struct kjc_argparse* ctx) {
+#ifndef KJC_ARGPARSE_NO_MEMFD
+	/* Only the root context records, ARGPARSE_EXPORT() may be used from a subcommand's handlers */
+	while(ctx->parent != NULL) {
+		ctx = ctx->parent;
+	}
+	
+	/* A process that replayed its options passes on the same ones, naming them again for its child processes */
+	if(ctx->replay != NULL) {
+		char fd_str[16];
+		snprintf(fd_str, sizeof(fd_str), "%d", _argparse_replay_blob.fd);
+		if(ctx->replay->rejected || setenv(KJC_ARGPARSE_REPLAY_ENV, fd_str, 1) != 0) {
+			return -1;
 		}
+		return _argparse_replay_blob.fd;
 	}
 	
-	if(!work_to_do) {
-		return;
+	struct _argrecorder* recorder = ctx->recorder;
+	if(recorder == NULL) {
+		return -1;
 	}
 	
-	unsigned descStart = _argparse_get_description_column(argparse_context);
+	/*
+	 * The arguments that weren't parsed yet go in records that are dropped again once they're written. After a
+	 * subcommand, that's all of its arguments, as subcommands parse theirs in the child process.
+	 */
+	size_t size = recorder->size;
+	unsigned count = recorder->count;
+	int argidx = *ctx->argidx < ctx->orig_argc ? *ctx->argidx : ctx->orig_argc;
+	if(ctx->argtype == _kARG_TYPE_COMMAND || argidx < recorder->mark) {
+		argidx = recorder->mark;
+	}
 	
-	fprintf(f, "\n");
-	fprintf(f, "Options:\n");
+	/* Nothing was parsed since the last export, so its memfd still holds the same records */
+	if(recorder->exported_fd >= 0 && recorder->exported_count == count && recorder->exported_argidx == argidx) {
+		return recorder->exported_fd;
+	}
 	
-	/* Print description of each argument */
-	for(unsigned i = 0; i < argparse_context->argstorage_count; i++) {
-		struct _arginfo* pcur = &argstorage[i];
-		const char* value_hint = _arginfo_value_hint(argparse_context, pcur);
-		unsigned col = 0;
-		
-		/* Don't print help info for options without a description or subcommands */
-		if(!pcur->description || pcur->type == _kARG_TYPE_COMMAND) {
-			continue;
-		}
-		
-		col += fprintf(f, "%*s", argparse_context->indent, "");
-		
-		/* Print short option (if set) */
-		if(pcur->short_name != '\0') {
-			col += fprintf(f, "-%c", pcur->short_name);
-			if(!pcur->long_name && value_hint != NULL) {
-				col += fprintf(f, " <%s>", value_hint);
-			}
-		}
-		else {
-			col += fprintf(f, "  ");
+	if(argidx > recorder->mark) {
+		_argparse_record(ctx, _kARGRECORD_TAKEN, NULL, recorder->mark, argidx);
+	}
+	if(argidx < ctx->orig_argc) {
+		_argparse_record(ctx, _kARG_VALUE_END, NULL, argidx, ctx->orig_argc);
+	}
+	
+	struct _argreplay_header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = _kARGREPLAY_MAGIC;
+	header.version = _kARGREPLAY_VERSION;
+	header.header_size = sizeof(header);
+	header.schema_hash = recorder->hash;
+	header.size = sizeof(header) + recorder->size;
+	header.count = recorder->count;
+	
+	/* Not close-on-exec, so that child processes inherit it */
+	int fd = memfd_create("kjc_argparse", MFD_ALLOW_SEALING);
+	bool ok = fd >= 0
+		&& _argparse_write_all(fd, &header, sizeof(header))
+		&& _argparse_write_all(fd, recorder->data, recorder->size)
+		&& fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == 0;
+	recorder->size = size;
+	recorder->count = count;
+	
+	char fd_str[16];
+	snprintf(fd_str, sizeof(fd_str), "%d", fd);
+	if(!ok || setenv(KJC_ARGPARSE_REPLAY_ENV, fd_str, 1) != 0) {
+		if(fd >= 0) {
+			close(fd);
 		}
+		return -1;
+	}
+	
+	/* Child processes started since the last export have their own copy of its fd, this process only needs one */
+	if(recorder->exported_fd >= 0) {
+		close(recorder->exported_fd);
+	}
+	recorder->exported_fd = fd;
+	recorder->exported_count = count;
+	recorder->exported_argidx = argidx;
+	
+	/* This process's own ARGPARSE blocks parse their arguments instead of replaying these */
+	_argparse_replay_blob.checked = true;
+	return fd;
+#else /* KJC_ARGPARSE_NO_MEMFD */
+	(void)ctx;
+	return -1;
+#endif /* KJC_ARGPARSE_NO_MEMFD */
+}
+
+
+/* Monotonic clock for ARGPARSE_CONFIG_PROFILE(), falling back to processor time where there isn't one */
+static uint64_t _argparse_now_ns(void) {
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#else /* CLOCK_MONOTONIC */
+	return (uint64_t)clock() * (1000000000u / CLOCKS_PER_SEC);
+#endif /* CLOCK_MONOTONIC */
+}
+
+/* Name of a handler in the profile, after the names of the subcommands whose blocks it's in */
+static char* _argparse_profile_name(const struct kjc_argparse* argparse_context, const struct kjc_argprofile* profile) {
+	char short_name[3] = {'-', '\0', '\0'};
+	const char* prefix = "";
+	const char* name = NULL;
+	
+	switch(argparse_context->state) {
+		case _kARG_VALUE_POSITIONAL: name = "ARG_POSITIONAL"; break;
+		case _kARG_VALUE_POSITIONAL_BATCH: name = "ARG_POSITIONAL_BATCH"; break;
+		case _kARG_VALUE_OTHER: name = "ARG_OTHER"; break;
+		case _kARG_VALUE_END: name = "ARG_END"; break;
+		case _kARG_VALUE_ERROR: name = "ARG_ERROR"; break;
 		
-		/* Print long option (if set) */
-		if(pcur->long_name != NULL) {
-			/* If short option was set, separate it with a comma */
-			if(pcur->short_name != '\0') {
-				col += fprintf(f, ", ");
+		default: {
+			const struct _arginfo* arginfo = argparse_context->cur_arg;
+			if(arginfo->long_name == NULL) {
+				short_name[1] = arginfo->short_name;
+				name = short_name;
 			}
 			else {
-				col += fprintf(f, "  ");
-			}
-			
-			/* Print long option */
-			col += fprintf(f, "%s%s", argparse_context->long_arg_prefix, pcur->long_name);
-			if(value_hint != NULL) {
-				col += fprintf(f, " <%s>", value_hint);
+				/* Subcommands are named without the prefix of long options */
+				if(arginfo->type != _kARG_TYPE_COMMAND) {
+					prefix = argparse_context->long_arg_prefix;
+				}
+				name = arginfo->long_name;
 			}
+			break;
 		}
-		
-		/* Seek to description column */
-		if(col + 2 > descStart) {
-			/* Description will go on next line */
-			fprintf(f, "\n");
-			col = 0;
-		}
-		
-		/* Pad with spaces until reaching description column */
-		fprintf(f, "%*s", descStart - col, "");
-		
-		/* Print the argument's type if not void */
-		if(argparse_context->flags & _kARGPARSE_TYPE_HINTS) {
-			switch(pcur->type) {
-				case _kARG_TYPE_LONG:
-					fprintf(f, "[int] ");
-					break;
-				
-				case _kARG_TYPE_STRING:
-					fprintf(f, "[string] ");
-					break;
+	}
+	
+	const char* parent = "";
+	const char* sep = "";
+	if(argparse_context->parent != NULL && argparse_context->parent->profile == profile) {
+		parent = profile->stats[argparse_context->parent->profile_stat].name;
+		sep = " ";
+	}
+	
+	size_t size = strlen(parent) + strlen(sep) + strlen(prefix) + strlen(name) + 1;
+	char* result = malloc(size);
+	argparse_assert(result != NULL && "Allocation failure");
+	snprintf(result, size, "%s%s%s%s", parent, sep, prefix, name);
+	return result;
+}
+
+void _argparse_profile_enter(struct kjc_argparse* argparse_context) {
+	struct kjc_argprofile* profile = argparse_context->profile;
+	if(profile == NULL) {
+		return;
+	}
+	
+	/* The handler's state is its id, which is only unique within one block, so it's told apart by its parent too */
+	int arg_id = argparse_context->state;
+	int parent = -1;
+	if(argparse_context->parent != NULL && argparse_context->parent->profile == profile) {
+		parent = argparse_context->parent->profile_stat;
+	}
+	
+	/* Handlers tend to run over and over, like for each positional argument, so the last one is checked first */
+	size_t i = (size_t)argparse_context->profile_stat;
+	if(i >= profile->stats_count || profile->stats[i].arg_id != arg_id || profile->stats[i].parent != parent) {
+		for(i = 0; i < profile->stats_count; i++) {
+			if(profile->stats[i].arg_id == arg_id && profile->stats[i].parent == parent) {
+				break;
 			}
 		}
-		
-		/* Print the description and end the line */
-		fprintf(f, "%s\n", pcur->description);
+	}
+	if(i == profile->stats_count) {
+		profile->stats = _argparse_grow(
+			profile->stats, sizeof(*profile->stats), profile->stats_count, 1, &profile->stats_cap
+		);
+		struct kjc_argprofile_stat* stat = &profile->stats[profile->stats_count++];
+		memset(stat, 0, sizeof(*stat));
+		stat->name = _argparse_profile_name(argparse_context, profile);
+		stat->arg_id = arg_id;
+		stat->parent = parent;
+	}
+	
+	argparse_context->profile_stat = (int)i;
+	argparse_context->profile_index = *argparse_context->argidx - (argparse_context->argtype != _kARG_TYPE_SHORTGROUP);
+	
+	/* Read the clock last, so that none of the above counts towards the handler */
+	argparse_context->profile_start = _argparse_now_ns();
+	if(profile->spans_count == 0 && profile->origin_ns == 0) {
+		profile->origin_ns = argparse_context->profile_start;
 	}
 }
 
-static void _argparse_help_suffix(const struct kjc_argparse* argparse_context, FILE* f) {
-	if(!argparse_context->custom_suffix) {
+void _argparse_profile_exit(struct kjc_argparse* argparse_context) {
+	struct kjc_argprofile* profile = argparse_context->profile;
+	if(profile == NULL) {
 		return;
 	}
 	
-	fprintf(f, "\n");
-	fprintf(f, "%s\n", argparse_context->custom_suffix);
+	uint64_t duration = _argparse_now_ns() - argparse_context->profile_start;
+	struct kjc_argprofile_stat* stat = &profile->stats[argparse_context->profile_stat];
+	stat->count++;
+	stat->total_ns += duration;
+	if(duration > stat->max_ns) {
+		stat->max_ns = duration;
+	}
+	
+	profile->spans = _argparse_grow(
+		profile->spans, sizeof(*profile->spans), profile->spans_count, 1, &profile->spans_cap
+	);
+	struct kjc_argprofile_span* span = &profile->spans[profile->spans_count++];
+	span->start_ns = argparse_context->profile_start - profile->origin_ns;
+	span->duration_ns = duration;
+	span->stat = (unsigned)argparse_context->profile_stat;
+	span->index = argparse_context->profile_index;
 }
 
-void _argparse_help(const struct kjc_argparse* argparse_context) {
-	FILE* f = argparse_context->stream;
-	if(!f) {
-		return;
+static int _argprofile_compare_total(const void* _a, const void* _b) {
+	const struct kjc_argprofile_stat* const* a = _a;
+	const struct kjc_argprofile_stat* const* b = _b;
+	
+	if((*a)->total_ns != (*b)->total_ns) {
+		return (*a)->total_ns < (*b)->total_ns ? 1 : -1;
 	}
 	
-	_argparse_help_usage(argparse_context, f);
-	_argparse_help_subcmds(argparse_context, f);
-	_argparse_help_options(argparse_context, f);
-	_argparse_help_suffix(argparse_context, f);
+	/* Ties stay in the order the handlers first ran */
+	return (*a > *b) - (*a < *b);
 }
 
-char* _argparse_next(struct kjc_argparse* argparse_context) {
-	if(*argparse_context->argidx >= argparse_context->orig_argc) {
-		return NULL;
+void kjc_argprofile_print(const struct kjc_argprofile* profile, void* fp) {
+	FILE* f = fp;
+	if(profile->stats_count == 0) {
+		return;
 	}
 	
-	return argparse_context->orig_argv[(*argparse_context->argidx)++];
+	const struct kjc_argprofile_stat** sorted = malloc(profile->stats_count * sizeof(*sorted));
+	argparse_assert(sorted != NULL && "Allocation failure");
+	int name_width = (int)strlen("Handler");
+	for(size_t i = 0; i < profile->stats_count; i++) {
+		sorted[i] = &profile->stats[i];
+		if((int)strlen(sorted[i]->name) > name_width) {
+			name_width = (int)strlen(sorted[i]->name);
+		}
+	}
+	qsort(sorted, profile->stats_count, sizeof(*sorted), _argprofile_compare_total);
+	
+	fprintf(f, "%-*s %10s %14s %14s\n", name_width, "Handler", "Calls", "Total (us)", "Max (us)");
+	for(size_t i = 0; i < profile->stats_count; i++) {
+		fprintf(
+			f, "%-*s %10lu %14.1f %14.1f\n", name_width, sorted[i]->name, sorted[i]->count,
+			sorted[i]->total_ns / 1000.0, sorted[i]->max_ns / 1000.0
+		);
+	}
+	
+	free(sorted);
 }
 
-long _argparse_value_long(const struct kjc_argparse* argparse_context) {
-	argparse_assert(argparse_context->argtype == _kARG_TYPE_LONG);
-	return argparse_context->argvalue.val_long;
+/* Write a string as a JSON string literal */
+static void _argprofile_write_json_string(FILE* f, const char* str) {
+	fputc('"', f);
+	for(; *str != '\0'; str++) {
+		unsigned char c = (unsigned char)*str;
+		if(c == '"' || c == '\\') {
+			fprintf(f, "\\%c", c);
+		}
+		else if(c < 0x20) {
+			fprintf(f, "\\u%04x", c);
+		}
+		else {
+			fputc(c, f);
+		}
+	}
+	fputc('"', f);
 }
 
-const char* _argparse_value_string(const struct kjc_argparse* argparse_context) {
-	argparse_assert(argparse_context->argtype == _kARG_TYPE_STRING);
-	return argparse_context->argvalue.val_string;
+int kjc_argprofile_write_trace(const struct kjc_argprofile* profile, const char* path) {
+	FILE* f = fopen(path, "w");
+	if(f == NULL) {
+		return -1;
+	}
+	
+	/* Complete ("X") events, which trace viewers nest by time, so subcommands enclose their handlers */
+	fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	for(size_t i = 0; i < profile->spans_count; i++) {
+		const struct kjc_argprofile_span* span = &profile->spans[i];
+		fprintf(f, "%s\n{\"name\":", i > 0 ? "," : "");
+		_argprofile_write_json_string(f, profile->stats[span->stat].name);
+		fprintf(
+			f, ",\"cat\":\"argparse\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+			"\"args\":{\"index\":%d}}",
+			span->start_ns / 1000.0, span->duration_ns / 1000.0, span->index
+		);
+	}
+	fprintf(f, "\n]}\n");
+	
+	bool ok = !ferror(f);
+	if(fclose(f) != 0) {
+		ok = false;
+	}
+	return ok ? 0 : -1;
+}
+
+void kjc_argprofile_free(struct kjc_argprofile* profile) {
+	for(size_t i = 0; i < profile->stats_count; i++) {
+		free((char*)profile->stats[i].name);
+	}
+	free(profile->stats);
+	free(profile->spans);
+	memset(profile, 0, sizeof(*profile));
 }
@@ -21,10 +21,21 @@
  * - ARG_INT(char shortarg, const char* longarg, const char* help, name) { arg handler } - Arg with an int value
  * - ARG_LONG(char shortarg, const char* longarg, const char* help, name) { arg handler } - Arg with a long value
  * - ARG_STRING(char shortarg, const char* longarg, const char* help, name) { arg handler } - Arg with a string value
+ * - ARG_SLICE(char shortarg, const char* longarg, const char* help, name) { arg handler } - Arg with a string value
+ *   passed as a struct kjc_argslice (pointer and length)
+ * - ARG_CHOICE(char shortarg, const char* longarg, const char* help, const char* choices[], name) { arg handler } -
+ *   Arg whose value must be one of the choices, passed as the int index of that choice
+ * - ARG_KV(char shortarg, const char* longarg, const char* help, struct kjc_argmap* map, name) { arg handler } - Arg
+ *   that can be repeated with a key=value pair, which is added to the map and passed as a struct kjc_argkv
  * - ARG_COMMAND(const char* cmd, const char* help) { arg handler } - Named subcommand with its own argument parsing
+ * - ARG_GLOBAL(ARG*(...)) { arg handler } - Wraps an option of the root argparse block, which is then also accepted
+ *   after any subcommand, at any depth
  * - ARG_POSITIONAL(const char* help, name) { arg handler } - Handles any unhandled arguments
+ * - ARG_POSITIONAL_BATCH(const char* help, name) { arg handler } - Handles runs of positional arguments at once
  * - ARG_OTHER(name) { arg handler } - Handles any unhandled arguments
  * - ARG_END { arg handler } - Runs after argparse ends
+ * - ARG_ERROR(name) { arg handler } - Runs instead of ARG_END when parsing fails, with the error as a
+ *   const struct kjc_argerror*. Errors aren't printed to the configured stream when this handler is present
  *
  * Argparse configuration (in argparse block body):
  * - ARGPARSE_CONFIG_STREAM(FILE* output_fp); - Set output stream used for argparse messages (like ARGPARSE_HELP())
@@ -37,29 +48,136 @@
  * - ARGPARSE_CONFIG_TYPE_HINTS(bool val); - Set whether type hints are printed in option descriptions
  * - ARGPARSE_CONFIG_DESCRIPTION_PADDING(int padding); - Set minimum number of spaces before options' descriptions
  * - ARGPARSE_CONFIG_SHORTGROUPS(bool enable); - True to enable support for multiple short options in a single argument
- * - ARGPARSE_CONFIG_AUTO_HELP(bool enable); - True to automatically support "--help"
+ * - ARGPARSE_CONFIG_AUTO_HELP(bool enable); - True to automatically support "--help", and "--help=<pattern>" to only
+ *   list the matching options, or "--help=<group>" to only list one group of options
  * - ARGPARSE_CONFIG_DASHDASH(bool enable); - True to treat everything after "--" as ARG_POSITIONAL
  * - ARGPARSE_CONFIG_LONG_PREFIX(const char* prefix); - String used as the prefix for long options, "--" by default
  * - ARGPARSE_CONFIG_DEBUG(bool debug); - Print internal argparse debug information
+ * - ARGPARSE_CONFIG_THREADS(unsigned count); - Number of threads for ARGPARSE_DEFER() work, 0 for one per CPU
+ * - ARGPARSE_CONFIG_RECORD(bool enable); - Record the parsed options, so ARGPARSE_EXPORT() can pass them to child
+ *   processes
+ * - ARGPARSE_CONFIG_PROFILE(struct kjc_argprofile* profile); - Add the time spent in each arg handler to the profile
+ *   (only when built with KJC_ARGPARSE_PROFILE defined)
+ * - ARGPARSE_GROUP(const char* title); - List the options that follow under their own heading in help output
+ *
+ * Compile-time options (defined before including kjc_argparse.h):
+ * - KJC_ARGPARSE_LEAN - Smaller expansion of each ARG*() for programs with very many options, which compiles faster
+ *   and produces less code
+ * - KJC_ARGPARSE_PROFILE - Time each arg handler, for the argparse blocks configured with ARGPARSE_CONFIG_PROFILE()
+ *
+ * Argparse constraints (checked once all arguments are parsed, before ARG_END):
+ * - ARGPARSE_REQUIRE(const char* option, ...); - Each of these options must be given
+ * - ARGPARSE_EXCLUSIVE(const char* group, const char* option, ...); - At most one of the group's options may be given
+ * - ARGPARSE_REQUIRES(const char* option, const char* other); - The option may only be given along with the other
  *
  * Argparse functions (only valid within an arg handler)
  * - void ARGPARSE_HELP() - Print help usage message to configured output stream
  * - int ARGPARSE_INDEX() - Get index of current argument
  * - char* ARGPARSE_NEXT() - Take the next argument, or NULL if there are no more
+ * - size_t ARGPARSE_VALUE_LEN() - Length of the value of an ARG_STRING, ARG_SLICE, ARG_POSITIONAL or ARG_OTHER arg
  * - void ARGPARSE_REWIND(int count) - Rewinds the argparse index by the given amount
+ * - const struct kjc_argerror* ARGPARSE_ERROR() - Why the current argument failed to parse (in ARG_OTHER and
+ *   ARG_ERROR), or NULL
+ * - size_t ARGPARSE_FORMAT_ERROR(char* buf, size_t size) - Format the error message like snprintf()
+ * - void ARGPARSE_DEFER(fn, void* arg) - Run fn(arg) on a thread pool after all arguments are parsed, before ARG_END
+ * - void ARGPARSE_DEFER_ORDERED(unsigned group, fn, void* arg) - Like ARGPARSE_DEFER(), but runs after the work
+ *   queued earlier in the same group
+ * - int ARGPARSE_EXPORT() - Write the options parsed so far to a sealed memfd that child processes inherit and
+ *   replay instead of parsing their own argv, returns its fd or -1
+ * - int ARGPARSE_REPLAYED() - Nonzero if the options were replayed from a parent process' ARGPARSE_EXPORT()
+ *
+ * Pull API (parse without the ARGPARSE macros, e.g. from an event loop):
+ * - void kjc_argparse_config_init(struct kjc_argparse_config* config) - Fill in the default configuration
+ * - struct kjc_argparse_schema* kjc_argparse_schema_new(config, options, count) - Compile an array of options
+ * - void kjc_argparse_schema_free(struct kjc_argparse_schema* schema) - Free a compiled schema
+ * - const struct kjc_argparse_schema* kjc_argparse_schema_command(schema, int id) - Get a subcommand's schema
+ * - struct kjc_argparse_builder* kjc_argparse_builder_new(config) - Start building a schema at runtime
+ * - void kjc_argparse_builder_add(builder, options, count) - Append options to a schema being built
+ * - struct kjc_argparse_builder* kjc_argparse_builder_command(builder, id, name, description, config) - Add a
+ *   subcommand, returns the builder for its options
+ * - void kjc_argparse_builder_constrain(builder, constraints, count) - Add constraints to a schema being built
+ * - void kjc_argparse_builder_group(builder, const char* title) - List the options added after this under their own
+ *   heading in help output
+ * - struct kjc_argparse_schema* kjc_argparse_builder_freeze(builder) - Compile a built schema, frees the builder
+ * - KJC_ARGPARSE_STATIC_SCHEMA(name, options, positional_usage, flags) - Define a function returning a schema whose
+ *   tables were built at compile time from an X-macro list of options, see below
+ * - void kjc_argparse_begin(struct kjc_argparse* ctx, schema, int argc, char** argv) - Start parsing all arguments
+ * - void kjc_argparse_begin_command(struct kjc_argparse* ctx, schema, parent) - Parse a subcommand's arguments
+ * - int kjc_argparse_next(struct kjc_argparse* ctx, struct kjc_argparse_event* event) - Get the next event,
+ *   returns 0 once parsing has ended (after an END or ERROR event)
+ * - void kjc_argparse_help(const struct kjc_argparse* ctx) - Print help usage message to configured output stream
+ * - char* kjc_argparse_take_next(struct kjc_argparse* ctx) - Take the next argument, or NULL if there are no more
+ * - const struct kjc_argerror* kjc_argparse_error(const struct kjc_argparse* ctx) - Error of an ERROR or OTHER event
+ * - size_t kjc_argparse_format_error(const struct kjc_argparse* ctx, char* buf, size_t size) - Format the error
+ *   message like snprintf()
+ *
+ * Key/value maps filled by ARG_KV (usable after parsing):
+ * - const struct kjc_argkv* kjc_argmap_get(const struct kjc_argmap* map, const char* key) - Look up a key, or NULL
+ * - void kjc_argmap_free(struct kjc_argmap* map) - Free the map's storage
+ *
+ * Passing parsed options to child processes:
+ * - int kjc_argparse_export(struct kjc_argparse* ctx) - Same as ARGPARSE_EXPORT()
+ *
+ * Handler times collected by ARGPARSE_CONFIG_PROFILE (usable after parsing):
+ * - void kjc_argprofile_print(const struct kjc_argprofile* profile, FILE* fp) - Print the time spent in each handler,
+ *   slowest first
+ * - int kjc_argprofile_write_trace(const struct kjc_argprofile* profile, const char* path) - Write every handler run
+ *   to a file as Chrome trace event JSON (for chrome://tracing or Perfetto), returns 0 or -1 on failure
+ * - void kjc_argprofile_free(struct kjc_argprofile* profile) - Free the profile's storage
  *
  * For usage instructions, refer to full_example.c and other example programs
  */
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * Single header mode: when KJC_ARGPARSE_IMPLEMENTATION is defined, this header also includes kjc_argparse.c, and every
+ * function below is static inline in that translation unit, so the program doesn't need to link against
+ * libkjc_argparse.
+ */
+#ifdef KJC_ARGPARSE_IMPLEMENTATION
+#define KJC_ARGPARSE_API static inline
+#else /* KJC_ARGPARSE_IMPLEMENTATION */
+#define KJC_ARGPARSE_API
+#endif /* KJC_ARGPARSE_IMPLEMENTATION */
+
+/*
+ * When KJC_ARGPARSE_FIXED_FLAGS is also defined, the ARGPARSE_DEFAULT_* settings of the configuration flags (varnames,
+ * type hints, short groups, auto help, and "--") become constants. The parser's branches on them are then compiled
+ * out, and ARGPARSE_CONFIG_* can't change them (it's a compile error to try).
+ */
+#ifdef KJC_ARGPARSE_FIXED_FLAGS
+#ifndef KJC_ARGPARSE_IMPLEMENTATION
+#error "KJC_ARGPARSE_FIXED_FLAGS only works in single header mode, with KJC_ARGPARSE_IMPLEMENTATION defined"
+#endif /* KJC_ARGPARSE_IMPLEMENTATION */
+#define _kARGPARSE_FIXED_FLAGS (                                                                                      \
+	_kARGPARSE_USE_VARNAMES | _kARGPARSE_TYPE_HINTS | _kARGPARSE_WITH_SHORTGROUPS | _kARGPARSE_AUTO_HELP              \
+	| _kARGPARSE_DASHDASH                                                                                             \
+)
+#else /* KJC_ARGPARSE_FIXED_FLAGS */
+#define _kARGPARSE_FIXED_FLAGS 0
+#endif /* KJC_ARGPARSE_FIXED_FLAGS */
+
 #ifdef __GNUC__
 /* Dangling else syntax is required to achieve this argparse syntax */
 #pragma GCC diagnostic ignored "-Wdangling-else"
 #endif
 
+/* Number of elements in an array. With GCC and Clang, passing a pointer instead is a compile error (negative size) */
+#if defined(__GNUC__) && !defined(__cplusplus)
+#define _argparse_array_count(array) (                                                                                \
+	sizeof(array) / sizeof(*(array))                                                                                  \
+	+ 0 * sizeof(char[__builtin_types_compatible_p(__typeof__(array), __typeof__(&(array)[0])) ? -1 : 1])             \
+)
+#else
+#define _argparse_array_count(array) (sizeof(array) / sizeof(*(array)))
+#endif
+
 #ifndef UNIQUIFY
 #ifdef __COUNTER__
 #define UNIQUIFY(macro, ...) UNIQUIFY_(macro, __COUNTER__, ##__VA_ARGS__)
@@ -77,6 +195,107 @@ extern "C" {
 
 struct kjc_argparse;
 
+/* String value that carries its length, so handlers don't need to call strlen() */
+struct kjc_argslice {
+	const char* ptr;
+	size_t len;
+};
+
+/* Run of consecutive positional arguments, pointing into argv */
+struct kjc_argbatch {
+	char** args;
+	int count;
+};
+
+/* Values of kjc_argerror.code */
+#define KJC_ARGERROR_NONE            0
+#define KJC_ARGERROR_UNKNOWN_SHORT   1  /* Character at offset isn't a short option, in a short group like "-xzf" */
+#define KJC_ARGERROR_SHORT_NOT_LAST  2  /* Short option at offset expects a value but isn't last in its short group */
+#define KJC_ARGERROR_UNEXPECTED      3  /* Argument isn't an option (or is positional, without ARG_POSITIONAL) */
+#define KJC_ARGERROR_EMBEDDED_VALUE  4  /* Option doesn't take a value, but one is embedded at offset like --flag=x */
+#define KJC_ARGERROR_MISSING_VALUE   5  /* Option expects a value but it's the last argument */
+#define KJC_ARGERROR_NOT_INTEGRAL    6  /* Integer option's value isn't a number, offset is the first bad character */
+#define KJC_ARGERROR_CONSTRAINT      7  /* An ARGPARSE_REQUIRE/EXCLUSIVE/REQUIRES constraint on arginfo isn't met */
+#define KJC_ARGERROR_DEFERRED        8  /* ARGPARSE_DEFER() work failed, value is its error message */
+#define KJC_ARGERROR_INVALID_CHOICE  9  /* Value of an ARG_CHOICE option isn't one of its choices */
+#define KJC_ARGERROR_NOT_KEY_VALUE  10  /* Value of an ARG_KV option has no '=' */
+#define KJC_ARGERROR_DUPLICATE_KEY  11  /* Key of an ARG_KV option was given again, with a KJC_ARGMAP_UNIQUE map */
+#define KJC_ARGERROR_GLOBAL_AFTER   12  /* Global option follows a subcommand's option that may take it as a value */
+#define KJC_ARGERROR_REPLAY_ARGS    13  /* Argument was given to a process that replays its parent's options instead */
+
+/* Environment variable holding the fd of the options exported by the parent process with ARGPARSE_EXPORT(). It's */
+/* removed again by the process that reads it, so only the direct children of an exporting process replay */
+#define KJC_ARGPARSE_REPLAY_ENV "KJC_ARGPARSE_REPLAY_FD"
+
+/* Parse error, recorded without any formatting. The message is only built when it's printed or formatted */
+struct kjc_argerror {
+	int code;
+	int index;                       /* Index of the offending argument in argv, or -1 once all were parsed */
+	int offset;                      /* Offset of the offending character in that argument */
+	const struct _arginfo* arginfo;  /* Option the error is about, if any */
+	const char* value;               /* Value that was rejected, or the error message of deferred work */
+};
+
+/* Key and value of an ARG_KV option, pointing into argv. The key isn't terminated, as it ends at the '=' */
+struct kjc_argkv {
+	const char* key;
+	size_t key_len;
+	const char* value;
+	size_t value_len;
+	int index;  /* Index in argv of the argument that set this value */
+};
+
+/* Flags for struct kjc_argmap */
+#define KJC_ARGMAP_LAST_WINS  0         /* A repeated key replaces the earlier value */
+#define KJC_ARGMAP_UNIQUE     (1 << 0)  /* A repeated key is an error */
+
+/*
+ * Keys and values collected by ARG_KV, owned by the program: initialize it with {0} or KJC_ARGMAP_INIT(flags)
+ * and free it with kjc_argmap_free(). The entries are in the order each key was first given.
+ */
+struct kjc_argmap {
+	struct kjc_argkv* entries;
+	unsigned count;
+	unsigned flags;
+	unsigned cap;
+	uint32_t* slots;  /* Open addressing hash table of index + 1 into entries, or 0 for an empty slot */
+};
+
+#define KJC_ARGMAP_INIT(flags) {0, 0, (flags), 0, 0}
+
+/* Time spent in one arg handler, over every time it ran */
+struct kjc_argprofile_stat {
+	const char* name;  /* Like "--output", "-o" or "ARG_END", after the subcommands it's in like "remote add --force" */
+	int arg_id;        /* Id of the handler, only unique within its argparse block */
+	int parent;        /* Index of the ARG_COMMAND handler whose argparse block this handler is in, or -1 */
+	unsigned long count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+};
+
+/* One run of an arg handler */
+struct kjc_argprofile_span {
+	uint64_t start_ns;  /* Since the first handler started */
+	uint64_t duration_ns;
+	unsigned stat;      /* Index of the handler in stats */
+	int index;          /* ARGPARSE_INDEX() when it started */
+};
+
+/*
+ * Times of the arg handlers run by argparse blocks with ARGPARSE_CONFIG_PROFILE(), owned by the program: initialize
+ * it with {0} and free it with kjc_argprofile_free(). The stats are in the order each handler first ran, and a
+ * subcommand's time includes the handlers in its block. Handlers left with return or goto aren't counted.
+ */
+struct kjc_argprofile {
+	struct kjc_argprofile_stat* stats;
+	size_t stats_count;
+	size_t stats_cap;
+	struct kjc_argprofile_span* spans;
+	size_t spans_count;
+	size_t spans_cap;
+	uint64_t origin_ns;  /* Clock reading when the first handler started */
+};
+
 /* ARGPARSE(int argc, char** argv) { argparse body } - Parse all arguments */
 #define ARGPARSE(argc, argv)                                                                                          \
 	_argparse_setup()                                                                                                 \
@@ -104,7 +323,7 @@ struct kjc_argparse;
 #define _argparse_block() _argparse_block_(_top)
 #define _argparse_block_(id)                                                                                          \
 	/* Jump table based on the generated argument ID to select an argument handler */                                 \
-	/* For the count and initialization phases, we instead jump to the beginning of the code block */                 \
+	/* For the initialization phase, we instead jump to the beginning of the code block */                             \
 	/* Trailing statement after this macro invocation will attach to this switch statement! */                        \
 	switch(_argparse_pcontext->state)                                                                                 \
 	___dummy##id: __attribute__((__unused__)) if(0) {                                                                 \
@@ -113,7 +332,6 @@ struct kjc_argparse;
 			_argparse_pcontext->state = _kARG_VALUE_BREAK;                                                            \
 			break;                                                                                                    \
 	} else /* FALLTHROUGH */                                                                                          \
-		case _kARG_VALUE_COUNT:                                                                                       \
 		case _kARG_VALUE_INIT:
 
 #define _argparse_top()                                                                                               \
@@ -139,21 +357,47 @@ struct kjc_argparse;
 	_argparse_loop_(id)
 
 /*
- * Actual argument parsing loop, first iteration is counting phase, then initialization phase, then
- * after that, each iteration is for parsing one option.
+ * Actual argument parsing loop, first iteration is the initialization phase, then after that, each
+ * iteration is for parsing one option.
  */
 #define _argparse_loop_(id)                                                                                           \
 	for(_argparse_init(_argparse_pcontext); !_argparse_done(_argparse_pcontext); _argparse_parse(_argparse_pcontext)) \
 		_argparse_block_(id)
 
+#ifdef KJC_ARGPARSE_PROFILE
+/* Timestamps for ARGPARSE_CONFIG_PROFILE(), taken when a handler's loop starts and once its body was left */
+#define _arg_profile_enter(value) (_argparse_profile_enter(_argparse_pcontext), (value))
+#define _arg_profile_exit() _argparse_profile_exit(_argparse_pcontext)
+#else /* KJC_ARGPARSE_PROFILE */
+#define _arg_profile_enter(value) (value)
+#define _arg_profile_exit() ((void)0)
+#endif /* KJC_ARGPARSE_PROFILE */
+
+#ifdef KJC_ARGPARSE_LEAN
+#define _arg_handler(id, ...)                                                                                         \
+	/* Same behavior as below with a single flag: _arg_break is still 1 after the inner loop if its update */         \
+	/* expression was skipped by a break within the handler body, which then breaks out of the argparse loop */       \
+	for(                                                                                                              \
+		int _arg_loop##id = _arg_profile_enter(1), _arg_break##id = 1;                                                \
+		_arg_loop##id;                                                                                                \
+		_arg_loop##id = 0,                                                                                            \
+		_arg_profile_exit(),                                                                                          \
+		(_arg_break##id && _argparse_pcontext->state != _kARG_VALUE_END)                                              \
+			? (void)(_argparse_pcontext->state = _kARG_VALUE_BREAK) : (void)0                                         \
+	)                                                                                                                 \
+		/* Trailing statement after this macro invocation will attach to this for statement! */                       \
+		for(__VA_ARGS__; _arg_break##id; _arg_break##id = 0)
+
+#else /* KJC_ARGPARSE_LEAN */
 #define _arg_handler(id, ...)                                                                                         \
 	/* Set up _arg_loop to determine when this outer loop has run at least once. */                                   \
 	/* Also set up _arg_break, which is only set to zero when the inner loop's update */                              \
 	/* expression runs. This means that if the inner loop's update expression is skipped by */                        \
 	/* use of the break keyword within that loop, then _arg_break will still be 1. */                                 \
-	for(int _arg_loop##id = 0, _arg_break##id = 1; ; ++_arg_loop##id)                                                 \
+	for(int _arg_loop##id = _arg_profile_enter(0), _arg_break##id = 1; ; ++_arg_loop##id)                             \
 		if(_arg_loop##id == 1) {                                                                                      \
 			/* We already ran the argument handler body */                                                            \
+			_arg_profile_exit();                                                                                      \
 			if(_arg_break##id && _argparse_pcontext->state != _kARG_VALUE_END) {                                      \
 				/* The argument handler was escaped via the break keyword, so break out of the argparse loop */       \
 				_argparse_pcontext->state = _kARG_VALUE_BREAK;                                                        \
@@ -170,30 +414,31 @@ struct kjc_argparse;
 			/* Trailing statement after this macro invocation will attach to this for statement! */                   \
 			for(__VA_ARGS__; _arg_break##id; _arg_break##id = 0)
 
+#endif /* KJC_ARGPARSE_LEAN */
+
 #define _arg_custom_helper(short_name, long_name, description, type, varname, handler, ...)                           \
 	UNIQUIFY(_arg_custom_helper_, short_name, long_name, description, type, varname, handler, ##__VA_ARGS__)
 
 /* Ensure that the argument ID won't collide with any "special" _kARG_VALUE_* values (even if value is 0) */
 #define _arg_make_id(value) (((value) << 1) | 1)
 
+#ifdef KJC_ARGPARSE_LEAN
 #define _arg_custom_helper_(id, short_name, long_name, description, type, varname, handler, ...)                      \
-	if(_argparse_pcontext->state == _kARG_VALUE_COUNT) {                                                              \
-		/* Count phase: increment the count of arguments to be registered during the initialization phase */          \
-		++_argparse_pcontext->argstorage_cap;                                                                         \
-		/* For options with both a short name and long name, we double count them */                                  \
-		if(short_name != '\0') {                                                                                      \
-			++_argparse_pcontext->shortargs_cap;                                                                      \
-		}                                                                                                             \
-		if(long_name) {                                                                                               \
-			if(type == _kARG_TYPE_COMMAND) {                                                                          \
-				++_argparse_pcontext->subcmds_cap;                                                                    \
-			}                                                                                                         \
-			else {                                                                                                    \
-				++_argparse_pcontext->longargs_cap;                                                                   \
-			}                                                                                                         \
-		}                                                                                                             \
+	if(_argparse_pcontext->state == _kARG_VALUE_INIT) {                                                               \
+		/* Initialization phase: register this argument, with every parameter passed in a register */                 \
+		_argparse_add_lean(                                                                                           \
+			_argparse_pcontext, _arg_make_id(id), ((unsigned)(type) << 8) | (unsigned char)(short_name),              \
+			long_name, description, varname                                                                           \
+		);                                                                                                            \
 	}                                                                                                                 \
-	else if(_argparse_pcontext->state == _kARG_VALUE_INIT) {                                                          \
+	/* Code inside is only accessible via jumptable from switch statement in _argparse_block(), NOT initialization */ \
+	else if(0)                                                                                                        \
+		case _arg_make_id(id):                                                                                        \
+			handler(id, ##__VA_ARGS__)
+
+#else /* KJC_ARGPARSE_LEAN */
+#define _arg_custom_helper_(id, short_name, long_name, description, type, varname, handler, ...)                      \
+	if(_argparse_pcontext->state == _kARG_VALUE_INIT) {                                                               \
 		/* Initialization phase: register this argument's info in the _argparse_context struct */                     \
 		_argparse_add(_argparse_pcontext, _arg_make_id(id), short_name, long_name, description, type, varname);       \
 	}                                                                                                                 \
@@ -204,6 +449,8 @@ struct kjc_argparse;
 			/* Keywords like break and continue will work as expected, but return will leak memory */                 \
 			handler(id, ##__VA_ARGS__)
 
+#endif /* KJC_ARGPARSE_LEAN */
+
 #define _arg_helper(short_name, long_name, description, type, varname, ...)                                           \
 	_arg_custom_helper(short_name, long_name, description, type, varname, _arg_handler, ##__VA_ARGS__)
 
@@ -230,15 +477,92 @@ struct kjc_argparse;
 		const char* var = _argparse_value_string(_argparse_pcontext)                                                  \
 	)
 
+/* ARG_SLICE(char shortarg, const char* longarg, const char* help, name) { arg handler } - Arg with a string value */
+/* passed as a struct kjc_argslice (pointer and length) */
+#define ARG_SLICE(short_name, long_name, description, var)                                                            \
+	_arg_helper(short_name, long_name, description, _kARG_TYPE_STRING, STRINGIFY(var),                                \
+		struct kjc_argslice var = _argparse_value_slice(_argparse_pcontext)                                           \
+	)
+
+/* ARG_CHOICE(char shortarg, const char* longarg, const char* help, const char* choices[], name) { arg handler } - */
+/* Arg whose value must be one of the choices (an array of strings), passed as the int index of that choice */
+#define ARG_CHOICE(short_name, long_name, description, choices, var)                                                  \
+	UNIQUIFY(_arg_choice_helper_, short_name, long_name, description, choices, var)
+
+#define _arg_choice_helper_(id, short_name, long_name, description, choices, var)                                     \
+	if(_argparse_pcontext->state == _kARG_VALUE_INIT) {                                                               \
+		/* Initialization phase: register this argument, along with a perfect hash table of its choices */            \
+		_argparse_add_choice(                                                                                         \
+			_argparse_pcontext, _arg_make_id(id), short_name, long_name, description, STRINGIFY(var),                 \
+			choices, _argparse_array_count(choices)                                                                   \
+		);                                                                                                            \
+	}                                                                                                                 \
+	/* Code inside is only accessible via jumptable from switch statement in _argparse_block(), NOT initialization */ \
+	else if(0)                                                                                                        \
+		case _arg_make_id(id):                                                                                        \
+			/* Trailing statement after this macro invocation will be the argument handler body. */                   \
+			/* Keywords like break and continue will work as expected, but return will leak memory */                 \
+			_arg_handler(id, int var = (int)_argparse_value_long(_argparse_pcontext))
+
+/* ARG_KV(char shortarg, const char* longarg, const char* help, struct kjc_argmap* map, name) { arg handler } - */
+/* Arg that can be repeated with a key=value pair, which is added to the map and passed as a struct kjc_argkv */
+#define ARG_KV(short_name, long_name, description, map, var)                                                          \
+	UNIQUIFY(_arg_kv_helper_, short_name, long_name, description, map, var)
+
+#define _arg_kv_helper_(id, short_name, long_name, description, map, var)                                             \
+	if(_argparse_pcontext->state == _kARG_VALUE_INIT) {                                                               \
+		/* Initialization phase: register this argument along with the map it fills in */                             \
+		_argparse_add_kv(                                                                                             \
+			_argparse_pcontext, _arg_make_id(id), short_name, long_name, description, STRINGIFY(var), map             \
+		);                                                                                                            \
+	}                                                                                                                 \
+	/* Code inside is only accessible via jumptable from switch statement in _argparse_block(), NOT initialization */ \
+	else if(0)                                                                                                        \
+		case _arg_make_id(id):                                                                                        \
+			/* Trailing statement after this macro invocation will be the argument handler body. */                   \
+			/* Keywords like break and continue will work as expected, but return will leak memory */                 \
+			_arg_handler(id, struct kjc_argkv var = _argparse_value_kv(_argparse_pcontext))
+
 /* ARG_COMMAND(const char* cmd, const char* help) { arg handler } - Named subcommand with its own argument parsing */
 #define ARG_COMMAND(name, description)                                                                                \
 	_arg_helper(0, name, description, _kARG_TYPE_COMMAND, (const char*)0)
 
+/* ARG_GLOBAL(ARG*(...)) { arg handler } - Wraps an option of the root argparse block, which is then also accepted */
+/* after any subcommand, at any depth */
+#define ARG_GLOBAL(...)                                                                                               \
+	/* Initialization phase: flag the wrapped argument as global, which it picks up when registering itself */        \
+	if(                                                                                                               \
+		_argparse_pcontext->state == _kARG_VALUE_INIT                                                                 \
+		&& (_argparse_pcontext->ext_flags |= _kARGPARSE_EXT_NEXT_GLOBAL, 0)                                           \
+	) {}                                                                                                              \
+	/* Trailing statement after this macro invocation will be the wrapped argument's handler body */                  \
+	else __VA_ARGS__
+
 
 /* ARG_POSITIONAL(const char* help, name) { arg handler } - Handles any positional arguments */
 #define ARG_POSITIONAL(usage, var)                                                                                    \
 	_arg_other_helper(var, 0, usage, _kARG_VALUE_POSITIONAL)
 
+/* ARG_POSITIONAL_BATCH(const char* help, name) { arg handler } - Handles each run of consecutive positional */
+/* arguments at once, passed as a struct kjc_argbatch. Everything after "--" is a single run */
+#define ARG_POSITIONAL_BATCH(usage, var)                                                                              \
+	UNIQUIFY(_arg_positional_batch_helper_, var, usage)
+
+#define _arg_positional_batch_helper_(id, var, usage)                                                                 \
+	if(_argparse_pcontext->state == _kARG_VALUE_INIT) {                                                               \
+		/* Initialization phase: positional arguments will be collected into runs */                                  \
+		_argparse_pcontext->ext_flags |= _kARGPARSE_EXT_POSITIONAL_BATCH;                                             \
+		if(usage) {                                                                                                   \
+			_argparse_pcontext->positional_usage = (usage);                                                           \
+		}                                                                                                             \
+	}                                                                                                                 \
+	/* Code inside is only accessible via jumptable from switch statement in _argparse_block(), NOT initialization */ \
+	else if(0)                                                                                                        \
+		case _kARG_VALUE_POSITIONAL_BATCH:                                                                            \
+			/* Trailing statement after this macro invocation will be the argument handler body. */                   \
+			/* Keywords like break and continue will work as expected, but return will leak memory */                 \
+			_arg_handler(id, struct kjc_argbatch var = _argparse_value_batch(_argparse_pcontext))
+
 /* ARG_OTHER(var) { arg handler } - Handles any unhandled arguments */
 #define ARG_OTHER(var)                                                                                                \
 	_arg_other_helper(var, 1, (const char*)0, _kARG_VALUE_OTHER)
@@ -275,6 +599,23 @@ struct kjc_argparse;
 			/* Keywords like break and continue will work as expected, but return will leak memory */                 \
 			_arg_handler(id)
 
+/* ARG_ERROR(var) { arg handler } - Runs instead of ARG_END when parsing fails, with the error as a */
+/* const struct kjc_argerror*. Errors aren't printed to the configured stream when this handler is present */
+#define ARG_ERROR(var)                                                                                                \
+	UNIQUIFY(_arg_error_helper, var)
+
+#define _arg_error_helper(id, var)                                                                                    \
+	if(_argparse_pcontext->state == _kARG_VALUE_INIT) {                                                               \
+		/* Initialization phase: the program reports errors itself */                                                 \
+		_argparse_pcontext->ext_flags |= _kARGPARSE_EXT_ERROR_HANDLER;                                                \
+	}                                                                                                                 \
+	/* Code inside is only accessible via jumptable from switch statement in _argparse_block(), NOT initialization */ \
+	else if(0)                                                                                                        \
+		case _kARG_VALUE_ERROR:                                                                                       \
+			/* Trailing statement after this macro invocation will be the argument handler body. */                   \
+			/* Keywords like break and continue will work as expected, but return will leak memory */                 \
+			_arg_handler(id, const struct kjc_argerror* var = kjc_argparse_error(_argparse_pcontext))
+
 
 #define _argparse_config_helper(field, value) do {                                                                    \
 	if(_argparse_pcontext->state == _kARG_VALUE_INIT) {                                                               \
@@ -282,14 +623,15 @@ struct kjc_argparse;
 	}                                                                                                                 \
 } while(0)
 
-#define _argparse_config_flag(flag, value)                                                                            \
-	_argparse_config_helper(flags, (_argparse_pcontext->flags & ~(flag)) | (-!!(value) & (flag)))
+/* The array has a negative size (a compile error) for flags that KJC_ARGPARSE_FIXED_FLAGS made constant */
+#define _argparse_config_flag(flag, value) do {                                                                       \
+	(void)sizeof(char[(_kARGPARSE_FIXED_FLAGS & (flag)) ? -1 : 1]);                                                   \
+	_argparse_config_helper(flags, (_argparse_pcontext->flags & ~(flag)) | (-!!(value) & (flag)));                    \
+} while(0)
 
 /* ARGPARSE_CONFIG_STREAM(FILE* output_fp); - Set output stream used for argparse messages (like ARGPARSE_HELP()) */
 #define ARGPARSE_CONFIG_STREAM(fp) _argparse_config_helper(stream, fp)
-#ifndef ARGPARSE_DEFAULT_STREAM
-#define ARGPARSE_DEFAULT_STREAM ((FILE*)1)
-#endif
+/* ARGPARSE_DEFAULT_STREAM isn't defined by default, which stands for stderr (not a constant, so it can't be one) */
 
 /* ARGPARSE_CONFIG_CUSTOM_USAGE(const char* usage); - Set custom usage text for help output */
 #define ARGPARSE_CONFIG_CUSTOM_USAGE(usage) _argparse_config_helper(custom_usage, usage)
@@ -345,7 +687,7 @@ struct kjc_argparse;
 #define ARGPARSE_DEFAULT_SHORTGROUPS 1
 #endif
 
-/* ARGPARSE_CONFIG_AUTO_HELP(bool enable); - True to automatically support "--help" */
+/* ARGPARSE_CONFIG_AUTO_HELP(bool enable); - True to automatically support "--help" and "--help=<query>" */
 #define ARGPARSE_CONFIG_AUTO_HELP(enable) _argparse_config_flag(_kARGPARSE_AUTO_HELP, enable)
 #ifndef ARGPARSE_DEFAULT_AUTO_HELP
 #define ARGPARSE_DEFAULT_AUTO_HELP 1
@@ -363,6 +705,50 @@ struct kjc_argparse;
 #define ARGPARSE_DEFAULT_LONG_PREFIX "--"
 #endif
 
+/* Option names in constraints are long names, or a single character for an option with only a short name */
+#define _argparse_constraint_helper(kind, other, names) do {                                                          \
+	if(_argparse_pcontext->state == _kARG_VALUE_INIT) {                                                               \
+		_argparse_add_constraints(_argparse_pcontext, kind, names, sizeof(names) / sizeof(*(names)), other);          \
+	}                                                                                                                 \
+} while(0)
+
+/* ARGPARSE_REQUIRE(const char* option, ...); - Each of these options must be given */
+#define ARGPARSE_REQUIRE(...)                                                                                         \
+	_argparse_constraint_helper(_kARG_CONSTRAINT_REQUIRED, (const char*)0, ((const char* const[]){__VA_ARGS__}))
+
+/* ARGPARSE_EXCLUSIVE(const char* group, const char* option, ...); - At most one of the group's options may be given */
+/* Options with the same group id form one group, even across multiple ARGPARSE_EXCLUSIVE() lines */
+#define ARGPARSE_EXCLUSIVE(group, ...)                                                                                \
+	_argparse_constraint_helper(_kARG_CONSTRAINT_EXCLUSIVE, group, ((const char* const[]){__VA_ARGS__}))
+
+/* ARGPARSE_REQUIRES(const char* option, const char* other); - The option may only be given along with the other */
+#define ARGPARSE_REQUIRES(option, other)                                                                              \
+	_argparse_constraint_helper(_kARG_CONSTRAINT_REQUIRES, other, ((const char* const[]){option}))
+
+/* ARGPARSE_CONFIG_THREADS(unsigned count); - Number of threads for ARGPARSE_DEFER() work, 0 for one per CPU */
+#define ARGPARSE_CONFIG_THREADS(count) _argparse_config_helper(thread_count, count)
+#ifndef ARGPARSE_DEFAULT_THREADS
+#define ARGPARSE_DEFAULT_THREADS 0
+#endif
+
+/* ARGPARSE_CONFIG_RECORD(bool enable); - Record the parsed options, so ARGPARSE_EXPORT() can pass them to child */
+/* processes. Only the root argparse block's setting matters, a subcommand's arguments are passed on unparsed */
+#define ARGPARSE_CONFIG_RECORD(enable)                                                                                \
+	_argparse_config_helper(ext_flags, (_argparse_pcontext->ext_flags & ~_kARGPARSE_EXT_RECORD)                       \
+		| (-!!(enable) & _kARGPARSE_EXT_RECORD))
+
+/* ARGPARSE_CONFIG_PROFILE(struct kjc_argprofile* profile); - Add the time spent in each arg handler to the profile */
+/* (only when built with KJC_ARGPARSE_PROFILE defined). Subcommands' argparse blocks add theirs to the same profile */
+#define ARGPARSE_CONFIG_PROFILE(prof) _argparse_config_helper(profile, prof)
+
+/* ARGPARSE_GROUP(const char* title); - List the options that follow under their own heading in help output, which */
+/* "--help=<title>" prints on its own. NULL goes back to the default "Options" heading */
+#define ARGPARSE_GROUP(title) do {                                                                                    \
+	if(_argparse_pcontext->state == _kARG_VALUE_INIT) {                                                               \
+		_argparse_group(_argparse_pcontext, title);                                                                   \
+	}                                                                                                                 \
+} while(0)
+
 #ifndef NDEBUG
 /* ARGPARSE_CONFIG_DEBUG(bool debug); - Print internal argparse debug information */
 #define ARGPARSE_CONFIG_DEBUG(debug) _argparse_config_flag(_kARGPARSE_DEBUG, debug)
@@ -380,27 +766,293 @@ struct kjc_argparse;
 /* char* ARGPARSE_NEXT() - Take the next argument, or NULL if there are no more */
 #define ARGPARSE_NEXT() _argparse_next(_argparse_pcontext)
 
+/* size_t ARGPARSE_VALUE_LEN() - Length of the value of an ARG_STRING, ARG_SLICE, ARG_POSITIONAL or ARG_OTHER arg */
+#define ARGPARSE_VALUE_LEN() _argparse_value_len(_argparse_pcontext)
+
+/*
+ * void ARGPARSE_DEFER(const char* (*fn)(void* arg), void* arg) - Queue fn(arg) to run on a thread pool once all
+ * arguments are parsed, before ARG_END. fn returns NULL on success or an error message, and if any of them fail,
+ * the error of the one queued first is printed and ARG_END doesn't run.
+ */
+#define ARGPARSE_DEFER(fn, arg) _argparse_defer(_argparse_pcontext, 0, fn, arg)
+
+/*
+ * void ARGPARSE_DEFER_ORDERED(unsigned group, const char* (*fn)(void* arg), void* arg) - Like ARGPARSE_DEFER(),
+ * but fn only starts after the work queued earlier with the same (nonzero) group has succeeded
+ */
+#define ARGPARSE_DEFER_ORDERED(group, fn, arg) _argparse_defer(_argparse_pcontext, group, fn, arg)
+
 /* void ARGPARSE_REWIND(int count) - Rewinds the argparse index by the given amount */
 #define ARGPARSE_REWIND(count) do { *_argparse_pcontext->argidx -= (count); } while(0)
 
+/*
+ * int ARGPARSE_EXPORT() - Write the options parsed so far (with ARGPARSE_CONFIG_RECORD enabled) to a sealed memfd
+ * and return its fd, or -1 on failure. The fd is inherited by child processes and named by the KJC_ARGPARSE_REPLAY_FD
+ * environment variable, so the ARGPARSE block of a child with the same options replays them instead of parsing its
+ * own argv. Calling it again returns the same fd if nothing was parsed in between, and otherwise closes the previous
+ * one. In a process that replayed its options, it passes on the same ones. Only supported on Linux.
+ */
+#define ARGPARSE_EXPORT() kjc_argparse_export(_argparse_pcontext)
+
+/* int ARGPARSE_REPLAYED() - Nonzero if the options were replayed from a parent process' ARGPARSE_EXPORT() */
+#define ARGPARSE_REPLAYED() (_argparse_pcontext->replay != 0)
+
+/* const struct kjc_argerror* ARGPARSE_ERROR() - Why the current argument failed to parse (in ARG_OTHER and */
+/* ARG_ERROR), or NULL */
+#define ARGPARSE_ERROR() kjc_argparse_error(_argparse_pcontext)
+
+/* size_t ARGPARSE_FORMAT_ERROR(char* buf, size_t size) - Format the error message like snprintf() */
+#define ARGPARSE_FORMAT_ERROR(buf, size) kjc_argparse_format_error(_argparse_pcontext, buf, size)
+
 /* void* ARGPARSE_GET_CONTEXT() - Get a pointer to the argparse context (to pass to a function) */
 #define ARGPARSE_GET_CONTEXT() _argparse_pcontext
 
 
+/*
+ * Pull API: the same parser as the ARGPARSE macros, driven by calling kjc_argparse_next() for each event.
+ * A schema is compiled (sorted and indexed) once and can then be used by any number of parses.
+ */
+
+/* Option types for struct kjc_argparse_option */
+#define KJC_ARGPARSE_TYPE_VOID     _kARG_TYPE_VOID     /* Like ARG() */
+#define KJC_ARGPARSE_TYPE_STRING   _kARG_TYPE_STRING   /* Like ARG_STRING() */
+#define KJC_ARGPARSE_TYPE_LONG     _kARG_TYPE_LONG     /* Like ARG_LONG() */
+#define KJC_ARGPARSE_TYPE_COMMAND  _kARG_TYPE_COMMAND  /* Like ARG_COMMAND() */
+
+/* Flags for struct kjc_argparse_config, each matching an ARGPARSE_CONFIG_* setting */
+#define KJC_ARGPARSE_CATCHALL      _kARGPARSE_HAS_CATCHALL      /* Produce OTHER events instead of errors */
+#define KJC_ARGPARSE_USE_VARNAMES  _kARGPARSE_USE_VARNAMES
+#define KJC_ARGPARSE_TYPE_HINTS    _kARGPARSE_TYPE_HINTS
+#define KJC_ARGPARSE_SHORTGROUPS   _kARGPARSE_WITH_SHORTGROUPS
+#define KJC_ARGPARSE_AUTO_HELP     _kARGPARSE_AUTO_HELP         /* Produce HELP events for "--help" */
+#define KJC_ARGPARSE_DASHDASH      _kARGPARSE_DASHDASH
+#define KJC_ARGPARSE_POSITIONAL_BATCH  (_kARGPARSE_EXT_POSITIONAL_BATCH << 8)  /* Produce POSITIONAL_BATCH events */
+
+/* Flags set by kjc_argparse_config_init(), from the ARGPARSE_DEFAULT_* settings */
+#define KJC_ARGPARSE_DEFAULT_FLAGS (                                                                                  \
+	(ARGPARSE_DEFAULT_USE_VARNAMES ? _kARGPARSE_USE_VARNAMES : 0)                                                     \
+	| (ARGPARSE_DEFAULT_TYPE_HINTS ? _kARGPARSE_TYPE_HINTS : 0)                                                       \
+	| (ARGPARSE_DEFAULT_SHORTGROUPS ? _kARGPARSE_WITH_SHORTGROUPS : 0)                                                \
+	| (ARGPARSE_DEFAULT_AUTO_HELP ? _kARGPARSE_AUTO_HELP : 0)                                                         \
+	| (ARGPARSE_DEFAULT_DASHDASH ? _kARGPARSE_DASHDASH : 0)                                                           \
+)
+
+/* Values of kjc_argparse_constraint.kind */
+#define KJC_ARGPARSE_REQUIRED   _kARG_CONSTRAINT_REQUIRED   /* Like ARGPARSE_REQUIRE() */
+#define KJC_ARGPARSE_EXCLUSIVE  _kARG_CONSTRAINT_EXCLUSIVE  /* Like ARGPARSE_EXCLUSIVE(), other is the group id */
+#define KJC_ARGPARSE_REQUIRES   _kARG_CONSTRAINT_REQUIRES   /* Like ARGPARSE_REQUIRES() */
+
+/* Values of kjc_argparse_event.kind */
+#define KJC_ARGPARSE_EVENT_OPTION      0  /* A declared option matched (id and its value are set) */
+#define KJC_ARGPARSE_EVENT_COMMAND     1  /* A subcommand matched, continue with kjc_argparse_begin_command() */
+#define KJC_ARGPARSE_EVENT_POSITIONAL  2  /* Like ARG_POSITIONAL, only when positional_usage is configured */
+#define KJC_ARGPARSE_EVENT_OTHER       3  /* Like ARG_OTHER, only with KJC_ARGPARSE_CATCHALL */
+#define KJC_ARGPARSE_EVENT_HELP        4  /* Unhandled "--help", call kjc_argparse_help() to print help */
+#define KJC_ARGPARSE_EVENT_END         5  /* Like ARG_END, all arguments were parsed */
+#define KJC_ARGPARSE_EVENT_ERROR       6  /* Parsing failed, see kjc_argparse_error() */
+#define KJC_ARGPARSE_EVENT_POSITIONAL_BATCH  7  /* Like ARG_POSITIONAL_BATCH, with KJC_ARGPARSE_POSITIONAL_BATCH */
+
+/* One option of a schema, like the arguments to ARG(), ARG_STRING(), ARG_LONG() or ARG_COMMAND() */
+struct kjc_argparse_option {
+	int id;
+	char short_name;
+	unsigned char type;
+	const char* long_name;
+	const char* description;
+	const char* var_name;
+};
+
+/* Constraint between options, which are named by their long name (or short name, for short-only options) */
+struct kjc_argparse_constraint {
+	int kind;
+	const char* option;
+	const char* other;  /* REQUIRES: the option that must also be given, EXCLUSIVE: the id of the group */
+};
+
+/* Equivalent of the ARGPARSE_CONFIG_* settings, use kjc_argparse_config_init() for the defaults */
+struct kjc_argparse_config {
+	void* stream;
+	const char* custom_usage;
+	const char* custom_suffix;
+	const char* long_prefix;
+	const char* positional_usage;
+	int subcmd_description_column;
+	int description_column;
+	unsigned indent;
+	unsigned description_padding;
+	unsigned flags;
+};
+
+struct kjc_argparse_event {
+	int kind;
+	int id;                 /* Option id, for OPTION and COMMAND events */
+	const char* value;      /* STRING option value, the argument of a POSITIONAL or OTHER event, or the */
+	                        /* query of a HELP event from "--help=<query>" */
+	size_t value_len;
+	long value_long;        /* LONG option value */
+	int index;              /* Index of the argument in argv, like ARGPARSE_INDEX() */
+	struct kjc_argbatch batch;  /* Arguments of a POSITIONAL_BATCH event */
+};
+
+/* Compiled option schema, only defined below for KJC_ARGPARSE_STATIC_SCHEMA() */
+struct kjc_argparse_schema;
+
+/* Fill in the default configuration */
+KJC_ARGPARSE_API void kjc_argparse_config_init(struct kjc_argparse_config* config);
+
+/* Compile an array of options (config may be NULL for the defaults), free it with kjc_argparse_schema_free() */
+KJC_ARGPARSE_API struct kjc_argparse_schema* kjc_argparse_schema_new(
+	const struct kjc_argparse_config* config,
+	const struct kjc_argparse_option* options,
+	size_t count
+);
+
+/* Free a compiled schema, which must not be used by any parse that is still in progress */
+KJC_ARGPARSE_API void kjc_argparse_schema_free(struct kjc_argparse_schema* schema);
+
+/* Schema of the subcommand with this id, when the schema was built with kjc_argparse_builder_command() */
+KJC_ARGPARSE_API const struct kjc_argparse_schema* kjc_argparse_schema_command(
+	const struct kjc_argparse_schema* schema,
+	int id
+);
+
+/* Schema under construction for options that are only known at runtime (e.g. provided by plugins), opaque */
+struct kjc_argparse_builder;
+
+/* Start a new schema (config may be NULL for the defaults) */
+KJC_ARGPARSE_API struct kjc_argparse_builder* kjc_argparse_builder_new(const struct kjc_argparse_config* config);
+
+/* Append options to the schema. The strings are not copied and must outlive the frozen schema */
+KJC_ARGPARSE_API void kjc_argparse_builder_add(
+	struct kjc_argparse_builder* builder,
+	const struct kjc_argparse_option* options,
+	size_t count
+);
+
+/* Add a subcommand and return the builder for its options, which is owned and frozen by its parent */
+KJC_ARGPARSE_API struct kjc_argparse_builder* kjc_argparse_builder_command(
+	struct kjc_argparse_builder* builder,
+	int id,
+	const char* name,
+	const char* description,
+	const struct kjc_argparse_config* config
+);
+
+/* Add constraints to the schema, which are checked when parsing reaches the END event */
+KJC_ARGPARSE_API void kjc_argparse_builder_constrain(
+	struct kjc_argparse_builder* builder,
+	const struct kjc_argparse_constraint* constraints,
+	size_t count
+);
+
+/* List the options added after this under their own heading in help output, NULL for the default "Options" */
+KJC_ARGPARSE_API void kjc_argparse_builder_group(struct kjc_argparse_builder* builder, const char* title);
+
+/* Compile the schema and all subcommand schemas, then free the builder */
+KJC_ARGPARSE_API struct kjc_argparse_schema* kjc_argparse_builder_freeze(struct kjc_argparse_builder* builder);
+
+/* Free a builder without compiling it */
+KJC_ARGPARSE_API void kjc_argparse_builder_free(struct kjc_argparse_builder* builder);
+
+/*
+ * Static schema, for short-lived programs that only parse once: the options are listed once in an X-macro, which
+ * expands into an enum of their ids and into the same sorted tables that kjc_argparse_schema_new() builds, as static
+ * const data. KJC_ARGPARSE_STATIC_SCHEMA() defines `static const struct kjc_argparse_schema* name(void)`, and parsing
+ * with that schema doesn't register, allocate, or sort anything. Each entry of the list is
+ * X(id, short_name, TYPE, long_name, description, var_name), where:
+ *
+ * - TYPE is VOID, STRING, LONG, or COMMAND
+ * - long_name is a string literal, every option needs one
+ * - short_name is 0 or a printable ASCII character, and always 0 for subcommands
+ * - var_name is a string literal, "" if the option has none
+ * - The entries are sorted by long_name, which is checked when parsing starts (unsorted tables abort, even with NDEBUG)
+ *
+ * positional_usage is like kjc_argparse_config.positional_usage, and flags like kjc_argparse_config.flags (start from
+ * KJC_ARGPARSE_DEFAULT_FLAGS). All other settings have their default values. Only available in C. The schema of a
+ * subcommand is another static schema passed to kjc_argparse_begin_command(), and static schemas are never freed.
+ */
+#define KJC_ARGPARSE_STATIC_SCHEMA(name, options, positional_usage, flags)                                            \
+	_argstatic_schema(name, options, positional_usage, flags)
+
+/* Start parsing all arguments, ctx is caller-owned and needs no cleanup */
+KJC_ARGPARSE_API void kjc_argparse_begin(
+	struct kjc_argparse* ctx,
+	const struct kjc_argparse_schema* schema,
+	int argc,
+	char** argv
+);
+
+/* Start parsing a subcommand's arguments, after parent produced a COMMAND event */
+KJC_ARGPARSE_API void kjc_argparse_begin_command(
+	struct kjc_argparse* ctx,
+	const struct kjc_argparse_schema* schema,
+	struct kjc_argparse* parent
+);
+
+/* Get the next event, returns 0 once parsing has ended (after an END or ERROR event) */
+KJC_ARGPARSE_API int kjc_argparse_next(struct kjc_argparse* ctx, struct kjc_argparse_event* event);
+
+/* Print help usage message to the configured output stream */
+KJC_ARGPARSE_API void kjc_argparse_help(const struct kjc_argparse* ctx);
+
+/* Take the next argument, or NULL if there are no more */
+KJC_ARGPARSE_API char* kjc_argparse_take_next(struct kjc_argparse* ctx);
+
+/*
+ * Why parsing failed after an ERROR event, or why the argument of an OTHER event wasn't accepted, otherwise NULL.
+ * The error of an ERROR event is also printed to the configured stream, set that to NULL to skip formatting it.
+ */
+KJC_ARGPARSE_API const struct kjc_argerror* kjc_argparse_error(const struct kjc_argparse* ctx);
+
+/* Format the error message like snprintf(), returns its length (0 if there is no error) */
+KJC_ARGPARSE_API size_t kjc_argparse_format_error(const struct kjc_argparse* ctx, char* buf, size_t size);
+
+/* Look up a key in a map filled by ARG_KV, or NULL if it wasn't given */
+KJC_ARGPARSE_API const struct kjc_argkv* kjc_argmap_get(const struct kjc_argmap* map, const char* key);
+
+/* Free the storage of a map filled by ARG_KV, which can then be reused */
+KJC_ARGPARSE_API void kjc_argmap_free(struct kjc_argmap* map);
+
+/* Write the options recorded so far to a sealed memfd for child processes to replay, returns its fd or -1 */
+KJC_ARGPARSE_API int kjc_argparse_export(struct kjc_argparse* ctx);
+
+/* Print the time spent in each handler to a FILE*, slowest first */
+KJC_ARGPARSE_API void kjc_argprofile_print(const struct kjc_argprofile* profile, void* fp);
+
+/* Write every handler run to a file as Chrome trace event JSON, returns 0 or -1 on failure */
+KJC_ARGPARSE_API int kjc_argprofile_write_trace(const struct kjc_argprofile* profile, const char* path);
+
+/* Free the storage of a profile filled by ARGPARSE_CONFIG_PROFILE(), which can then be reused */
+KJC_ARGPARSE_API void kjc_argprofile_free(struct kjc_argprofile* profile);
+
+
 /*
  * Everything below this line is considered PRIVATE API - DO NOT USE.
  */
 
 
 /* "Special" values for the argument ID, stored in argparse_context.state */
-#define _kARG_VALUE_COUNT      (0 << 1)  /* Set only during the first iteration, aka the counting phase */
-#define _kARG_VALUE_INIT       (1 << 1)  /* Set only during the second iteration, aka the initialization phase */
+#define _kARG_VALUE_INIT       (1 << 1)  /* Set only during the first iteration, aka the initialization phase */
 #define _kARG_VALUE_POSITIONAL (2 << 1)  /* Set when the argument doesn't start with '-' */
 #define _kARG_VALUE_OTHER      (3 << 1)  /* Set when the argument being parsed doesn't match a declared argument */
 #define _kARG_VALUE_END        (4 << 1)  /* Set when all arguments have been parsed */
 #define _kARG_VALUE_BREAK      (5 << 1)  /* Set when the break keyword is used from an argument handler */
 #define _kARG_VALUE_ERROR      (6 << 1)  /* Set when argparse internally encounters an error for some reason */
 #define _kARG_VALUE_HELP       (7 << 1)  /* Set when the automatic "--help" handler should run */
+#define _kARG_VALUE_READY      (8 << 1)  /* Set by kjc_argparse_begin(), the arg tables are already built */
+#define _kARG_VALUE_POSITIONAL_BATCH (9 << 1)  /* Set for a run of positional arguments with ARG_POSITIONAL_BATCH */
+
+/* Kinds of constraints between options */
+#define _kARG_CONSTRAINT_REQUIRED   1
+#define _kARG_CONSTRAINT_EXCLUSIVE  2
+#define _kARG_CONSTRAINT_REQUIRES   3
+
+/* Maximum number of distinct options that constraints can refer to, one bit each. More abort, even with NDEBUG */
+#define _kARGPARSE_CONSTRAINT_WORDS  4
+#define _kARGPARSE_MAX_CONSTRAINED   (_kARGPARSE_CONSTRAINT_WORDS * 64)
+
+/* Number of recently matched options that are checked before searching the sorted tables */
+#define _kARGPARSE_HOT_COUNT  4
 
 /* Intentionally not using an enum so the underlying type doesn't have to be int */
 #define _kARG_TYPE_VOID        0
@@ -409,6 +1061,8 @@ struct kjc_argparse;
 #define _kARG_TYPE_SHORTGROUP  3
 #define _kARG_TYPE_COMMAND     4
 #define _kARG_TYPE_DASHDASH    5
+#define _kARG_TYPE_CHOICE      6
+#define _kARG_TYPE_KV          7
 
 /* Configurable flags for argparse */
 #define _kARGPARSE_HAS_CATCHALL      (1 << 0)
@@ -422,15 +1076,67 @@ struct kjc_argparse;
 /* Also stored in flags but not configurable */
 #define _kARGPARSE_FLAG_DONE         (1 << 7)
 
+/* Stored in ext_flags, as every bit of flags is taken */
+#define _kARGPARSE_EXT_POSITIONAL_BATCH  (1 << 0)
+#define _kARGPARSE_EXT_ERROR_HANDLER     (1 << 1)
+#define _kARGPARSE_EXT_NEXT_GLOBAL       (1 << 2)
+#define _kARGPARSE_EXT_HOISTING          (1 << 3)
+#define _kARGPARSE_EXT_RECORD            (1 << 4)
+#define _kARGPARSE_EXT_STATIC            (1 << 5)  /* Tables are static data from KJC_ARGPARSE_STATIC_SCHEMA() */
+#define _kARGPARSE_EXT_UNSORTED          (1 << 6)  /* Tables are in registration order, see _argparse_init() */
+#define _kARGPARSE_EXT_DEFAULT_STREAM    (1 << 7)  /* Static data can't name stderr, so stream is set when parsing */
+
 
 /* Fields have been hand-packed, hence the weird ordering */
 struct _arginfo {
 	const char* long_name;
 	const char* description;
 	const char* var_name;
+	union {
+		const struct _argchoices* choices;  /* _kARG_TYPE_CHOICE */
+		struct kjc_argmap* map;             /* _kARG_TYPE_KV */
+	} ext;
 	int arg_id;
 	unsigned char type;
 	char short_name;
+	unsigned short constraint_bit;  /* 1 + index of this option's bit in the constraint bitsets, or 0 */
+	unsigned char global;           /* Registered with ARG_GLOBAL */
+	unsigned char group;            /* 1 + index of its title in help_groups, or 0 if it has none */
+};
+
+/* Choices of an ARG_CHOICE option, with a perfect hash table from each name to its index */
+struct _argchoices {
+	struct _argchoices* next;
+	const char* const* names;
+	unsigned count;
+	unsigned bucket_mask;
+	unsigned slot_mask;
+	uint16_t* table;  /* Displacement of each bucket, then index + 1 of the name in each slot (0 if empty) */
+};
+
+struct _argdeferred {
+	const char* (*fn)(void* arg);
+	void* arg;
+	const char* error;
+	unsigned group;
+};
+
+/* Recently matched option, found again by comparing the raw argument it was matched from */
+struct _arghot {
+	const char* arg;  /* Argument it was matched from, which outlives the parse */
+	struct _arginfo* arginfo;
+	uint64_t key;  /* First bytes of the option's name in arg, like _argparse_name_prefix() */
+	unsigned len;  /* Length of the option's name in arg, including the prefix */
+	char sep;  /* '=' if a value may be embedded after the name, like --name=value */
+};
+
+struct _argconstraint {
+	const char* name;
+	const char* other;
+	struct _arginfo* arg;
+	struct _arginfo* other_arg;
+	unsigned char kind;
+	unsigned char group_start;
 };
 
 /* Fields have been hand-packed, hence the weird ordering */
@@ -443,11 +1149,24 @@ struct kjc_argparse {
 	const char* long_arg_prefix;
 	const char* positional_usage;
 	struct _arginfo* cur_arg;
+	struct _arginfo** globals;
+	unsigned char* hoisted;  /* Bitset of the arguments after a subcommand that the root took as global options */
+	struct _argrecorder* recorder;
+	struct _argreplay* replay;
+	struct kjc_argprofile* profile;
 	union {
 		const char* val_string;
 		long val_long;
+		const struct kjc_argkv* val_kv;
 	} argvalue;
+	size_t argvalue_len;
 	void* argbuffer;
+	struct _argconstraint* constraints_staging;
+	struct _argdeferred* deferred;
+	struct _argchoices* choices;
+	const char** help_groups;
+	const char* help_query;  /* From "--help=<query>", or NULL to list every option */
+	struct _arghelp_index** help_index;  /* Where a schema keeps the index for "--help=<pattern>", or NULL */
 	char** orig_argv;
 	int orig_argc;
 	int argidx_top;
@@ -460,6 +1179,14 @@ struct kjc_argparse {
 	unsigned longargs_count;
 	unsigned shortargs_cap;
 	unsigned shortargs_count;
+	unsigned globals_cap;
+	unsigned globals_count;
+	unsigned constraints_cap;
+	unsigned constraints_count;
+	unsigned deferred_cap;
+	unsigned deferred_count;
+	unsigned help_groups_count;
+	unsigned thread_count;
 	unsigned indent;
 	unsigned long_prefix_len;
 	int subcmd_description_column;
@@ -467,18 +1194,228 @@ struct kjc_argparse {
 	unsigned description_padding;
 	unsigned subcmd_width;
 	unsigned long_name_width;
+	int hoist_cmdidx;
+	int hoist_last;
+	int profile_stat;  /* Stat of the handler being timed */
+	int profile_index;
+	uint64_t profile_start;
 	unsigned char short_bitmap[32];
 	unsigned char short_value_bitmap[32];
+	uint64_t constraint_required[_kARGPARSE_CONSTRAINT_WORDS];
+	uint64_t constraint_matched[_kARGPARSE_CONSTRAINT_WORDS];
+	struct _arghot hot[_kARGPARSE_HOT_COUNT];
+	struct kjc_argerror error;
 	unsigned char argtype;
+	unsigned char help_group;  /* Group of the options registered next */
 	unsigned char flags;
+	unsigned char ext_flags;
 };
 
+struct _schema_command;
 
-/* Initializes the argparse context structure and returns the initial argparse state (_kARG_VALUE_COUNT) */
-void _argparse_init(struct kjc_argparse* argparse_context);
+struct kjc_argparse_schema {
+	/* Context that went through the count and init phases, copied by kjc_argparse_begin() */
+	struct kjc_argparse context;
+
+	/* Subcommand schemas from kjc_argparse_builder_command(), sorted by id */
+	struct _schema_command* commands;
+	size_t commands_count;
+};
+
+
+/*
+ * KJC_ARGPARSE_STATIC_SCHEMA() expands the list of options several times over: into the enum of ids (which are also
+ * the indexes of the options in argstorage), and into each table of the argbuffer layout described in
+ * kjc_argparse.c. The list is already sorted by name, so subcommands and long options go into their tables in list
+ * order. Short options are sorted by character instead, so each one is placed at the number of short options with a
+ * lower character, counted in bitmasks of the characters that are used. Everything in the function is a constant
+ * expression, so the tables are initialized by the compiler.
+ */
+#define _argstatic_schema(name, options, usage, flag_bits)                                                            \
+	enum { options(_argstatic_id) };                                                                                  \
+	static const struct kjc_argparse_schema* name(void) {                                                             \
+		enum {                                                                                                        \
+			_argstatic_flags = (flag_bits),                                                                           \
+			_argstatic_count = 0 options(_argstatic_count_option),                                                    \
+			_argstatic_commands = 0 options(_argstatic_count_command),                                                \
+			_argstatic_shorts = 0 options(_argstatic_count_short),                                                    \
+			_argstatic_shorts0 = 0 options(_argstatic_short_mask0),                                                   \
+			_argstatic_shorts1 = 0 options(_argstatic_short_mask1),                                                   \
+			_argstatic_shorts2 = 0 options(_argstatic_short_mask2),                                                   \
+			_argstatic_shorts3 = 0 options(_argstatic_short_mask3),                                                   \
+			_argstatic_values0 = 0 options(_argstatic_value_mask0),                                                   \
+			_argstatic_values1 = 0 options(_argstatic_value_mask1),                                                   \
+			_argstatic_values2 = 0 options(_argstatic_value_mask2),                                                   \
+			_argstatic_values3 = 0 options(_argstatic_value_mask3),                                                   \
+			_argstatic_short_total = 0                                                                                \
+				+ _argstatic_popcount(_argstatic_shorts0) + _argstatic_popcount(_argstatic_shorts1)                   \
+				+ _argstatic_popcount(_argstatic_shorts2) + _argstatic_popcount(_argstatic_shorts3),                  \
+			/* Fails to compile (division by zero) if two options have the same short name, or one isn't ASCII */     \
+			_argstatic_unique_short_names = 1 / (_argstatic_short_total == _argstatic_shorts),                        \
+		};                                                                                                            \
+		static const struct {                                                                                         \
+			uint64_t name_prefixes[_argstatic_count + 2];                                                             \
+			struct _arginfo* subcmds[_argstatic_commands + 1];                                                        \
+			struct _arginfo* longargs[_argstatic_count - _argstatic_commands + 1];                                    \
+			struct _arginfo* shortargs[_argstatic_shorts + _argstatic_count];                                         \
+			struct _arginfo argstorage[_argstatic_count];                                                             \
+			unsigned name_lengths[_argstatic_count + 2];                                                              \
+		} _argstatic_tables = {                                                                                       \
+			/* Keys of the subcommands, then the ones of the long options after the extra subcmds slot */             \
+			{options(_argstatic_command_prefix) 0, options(_argstatic_option_prefix)},                                \
+			{options(_argstatic_command) (struct _arginfo*)0},                                                        \
+			{options(_argstatic_option) (struct _arginfo*)0},                                                         \
+			{options(_argstatic_short)},                                                                              \
+			{options(_argstatic_arginfo)},                                                                            \
+			{options(_argstatic_command_length) 0, options(_argstatic_option_length)},                                \
+		};                                                                                                            \
+		static const struct kjc_argparse_schema _argstatic_schema = {                                                 \
+			.context = {                                                                                              \
+				.long_arg_prefix = ARGPARSE_DEFAULT_LONG_PREFIX,                                                      \
+				.positional_usage = (usage),                                                                          \
+				.argbuffer = (void*)&_argstatic_tables,                                                               \
+				.state = _kARG_VALUE_READY,                                                                           \
+				.argstorage_cap = _argstatic_count,                                                                   \
+				.argstorage_count = _argstatic_count,                                                                 \
+				/* Every table has at least one slot, as arrays can't be empty */                                     \
+				.subcmds_cap = _argstatic_commands + 1,                                                               \
+				.subcmds_count = _argstatic_commands,                                                                 \
+				.longargs_cap = _argstatic_count - _argstatic_commands + 1,                                           \
+				.longargs_count = _argstatic_count - _argstatic_commands,                                             \
+				.shortargs_cap = _argstatic_shorts + _argstatic_count,                                                \
+				.shortargs_count = _argstatic_shorts,                                                                 \
+				.thread_count = ARGPARSE_DEFAULT_THREADS,                                                             \
+				.indent = ARGPARSE_DEFAULT_INDENT,                                                                    \
+				.long_prefix_len = sizeof(ARGPARSE_DEFAULT_LONG_PREFIX) - 1,                                          \
+				.subcmd_description_column = ARGPARSE_DEFAULT_COMMAND_DESCRIPTION_COLUMN,                             \
+				.description_column = ARGPARSE_DEFAULT_DESCRIPTION_COLUMN,                                            \
+				.description_padding = ARGPARSE_DEFAULT_DESCRIPTION_PADDING,                                          \
+				/* The size of a union is that of its largest member, so these are the longest names */               \
+				.subcmd_width = sizeof(union { char _argstatic_none; options(_argstatic_command_width) }) - 1,        \
+				.long_name_width = sizeof(union { char _argstatic_none; options(_argstatic_option_width) }) - 1,      \
+				.short_bitmap = {_argstatic_bitmap(_argstatic_shorts)},                                               \
+				.short_value_bitmap = {_argstatic_bitmap(_argstatic_values)},                                         \
+				.flags = (unsigned char)(_argstatic_flags & ~_kARGPARSE_FLAG_DONE),                                   \
+				.ext_flags = (unsigned char)(                                                                         \
+					(_argstatic_flags >> 8) | _kARGPARSE_EXT_STATIC | _kARGPARSE_EXT_DEFAULT_STREAM                   \
+				),                                                                                                    \
+			},                                                                                                        \
+		};                                                                                                            \
+		return &_argstatic_schema;                                                                                    \
+	}
+
+/* Select an expression by the TYPE of an entry */
+#define _argstatic_if_command_VOID(...)
+#define _argstatic_if_command_STRING(...)
+#define _argstatic_if_command_LONG(...)
+#define _argstatic_if_command_COMMAND(...) __VA_ARGS__
+#define _argstatic_if_option_VOID(...) __VA_ARGS__
+#define _argstatic_if_option_STRING(...) __VA_ARGS__
+#define _argstatic_if_option_LONG(...) __VA_ARGS__
+#define _argstatic_if_option_COMMAND(...)
+
+/* Value hint of each type without a var_name, like _argtype_name() */
+#define _argstatic_type_name_VOID ""
+#define _argstatic_type_name_STRING "string"
+#define _argstatic_type_name_LONG "int"
+
+/* Length of a string literal, which doesn't compile for anything else (like a NULL long_name) */
+#define _argstatic_strlen(str) (sizeof("" str) - 1)
+
+/* Like _argparse_name_prefix(), reading past the end of the string is avoided even where it isn't evaluated */
+#define _argstatic_name_prefix(str) (0                                                                                \
+	| _argstatic_name_byte(str, 0) | _argstatic_name_byte(str, 1) | _argstatic_name_byte(str, 2)                      \
+	| _argstatic_name_byte(str, 3) | _argstatic_name_byte(str, 4) | _argstatic_name_byte(str, 5)                      \
+	| _argstatic_name_byte(str, 6) | _argstatic_name_byte(str, 7)                                                     \
+)
+#define _argstatic_name_byte(str, i)                                                                                  \
+	(_argstatic_strlen(str) > (i) ? (uint64_t)(unsigned char)(str)[(i) < sizeof(str) ? (i) : 0] << (56 - 8 * (i)) : 0)
+
+/* Short names from ' ' to DEL are kept in four bitmasks of 24 characters each, which fit in an enum */
+#define _argstatic_char_word(c) (((unsigned char)(c) - 32u) / 24u)
+#define _argstatic_char_bit(c) (1u << (((unsigned char)(c) - 32u) % 24u))
+#define _argstatic_char_mask(c, word) (_argstatic_char_word(c) == (word) ? _argstatic_char_bit(c) : 0u)
+
+/* Bits of the characters below c in one of the bitmasks */
+#define _argstatic_below(c, word)                                                                                     \
+	(_argstatic_char_word(c) > (word) ? 0xffffffu : _argstatic_char_word(c) == (word) ? _argstatic_char_bit(c) - 1 : 0u)
+
+/* Number of bits set in 12 bits (with a 64-bit multiply, modulo 31), then in 24 bits */
+#define _argstatic_popcount12(bits)                                                                                   \
+	((unsigned)((((bits) & 0xfffu) * 0x1001001001001ULL & 0x84210842108421ULL) % 0x1f))
+#define _argstatic_popcount(bits) (_argstatic_popcount12(bits) + _argstatic_popcount12((bits) >> 12))
+
+/* Index in the sorted shortargs table of the option with this short name */
+#define _argstatic_short_rank(c) (                                                                                    \
+	_argstatic_popcount(_argstatic_shorts0 & _argstatic_below(c, 0))                                                  \
+	+ _argstatic_popcount(_argstatic_shorts1 & _argstatic_below(c, 1))                                                \
+	+ _argstatic_popcount(_argstatic_shorts2 & _argstatic_below(c, 2))                                                \
+	+ _argstatic_popcount(_argstatic_shorts3 & _argstatic_below(c, 3))                                                \
+)
+
+/* Bytes of the short_bitmap, which starts at character 0, so the first 4 bytes are always empty */
+#define _argstatic_bitmap(masks)                                                                                      \
+	0, 0, 0, 0,                                                                                                       \
+	_argstatic_bitmap_bytes(masks##0), _argstatic_bitmap_bytes(masks##1),                                             \
+	_argstatic_bitmap_bytes(masks##2), _argstatic_bitmap_bytes(masks##3)
+#define _argstatic_bitmap_bytes(mask) (unsigned char)(mask), (unsigned char)((mask) >> 8), (unsigned char)((mask) >> 16)
+
+#define _argstatic_arginfo_ptr(id) ((struct _arginfo*)&_argstatic_tables.argstorage[id])
+
+/* What each entry X(id, short_name, TYPE, long_name, description, var_name) expands to */
+#define _argstatic_id(id, ...) id,
+#define _argstatic_count_option(...) + 1
+#define _argstatic_count_command(id, short_name, type, ...) _argstatic_if_command_##type(+ 1)
+#define _argstatic_count_short(id, short_name, ...) + ((short_name) != 0)
+#define _argstatic_short_mask0(id, short_name, ...) | _argstatic_char_mask(short_name, 0)
+#define _argstatic_short_mask1(id, short_name, ...) | _argstatic_char_mask(short_name, 1)
+#define _argstatic_short_mask2(id, short_name, ...) | _argstatic_char_mask(short_name, 2)
+#define _argstatic_short_mask3(id, short_name, ...) | _argstatic_char_mask(short_name, 3)
+#define _argstatic_value_mask0(id, short_name, type, ...)                                                             \
+	_argstatic_if_option_##type(| _argstatic_value_mask(short_name, type, 0))
+#define _argstatic_value_mask1(id, short_name, type, ...)                                                             \
+	_argstatic_if_option_##type(| _argstatic_value_mask(short_name, type, 1))
+#define _argstatic_value_mask2(id, short_name, type, ...)                                                             \
+	_argstatic_if_option_##type(| _argstatic_value_mask(short_name, type, 2))
+#define _argstatic_value_mask3(id, short_name, type, ...)                                                             \
+	_argstatic_if_option_##type(| _argstatic_value_mask(short_name, type, 3))
+#define _argstatic_value_mask(short_name, type, word)                                                                 \
+	(_kARG_TYPE_##type != _kARG_TYPE_VOID ? _argstatic_char_mask(short_name, word) : 0u)
+#define _argstatic_command_prefix(id, short_name, type, long_name, ...)                                               \
+	_argstatic_if_command_##type(_argstatic_name_prefix(long_name),)
+#define _argstatic_option_prefix(id, short_name, type, long_name, ...)                                                \
+	_argstatic_if_option_##type(_argstatic_name_prefix(long_name),)
+#define _argstatic_command_length(id, short_name, type, long_name, ...)                                               \
+	_argstatic_if_command_##type(_argstatic_strlen(long_name),)
+#define _argstatic_option_length(id, short_name, type, long_name, ...)                                                \
+	_argstatic_if_option_##type(_argstatic_strlen(long_name),)
+#define _argstatic_command(id, short_name, type, ...) _argstatic_if_command_##type(_argstatic_arginfo_ptr(id),)
+#define _argstatic_option(id, short_name, type, ...) _argstatic_if_option_##type(_argstatic_arginfo_ptr(id),)
+#define _argstatic_short(id, short_name, ...)                                                                         \
+	[(short_name) != 0 ? _argstatic_short_rank(short_name) : _argstatic_shorts + (id)] = _argstatic_arginfo_ptr(id),
+#define _argstatic_arginfo(id, short_name, type, long_name, description, var_name)                                    \
+	{                                                                                                                 \
+		long_name, description, _argstatic_strlen(var_name) > 0 ? var_name : (const char*)0, {0},                     \
+		_arg_make_id(id), _kARG_TYPE_##type, short_name, 0, 0, 0                                                      \
+	},
+#define _argstatic_command_width(id, short_name, type, long_name, ...)                                                \
+	char id[1 _argstatic_if_command_##type(+ _argstatic_strlen(long_name))];
+#define _argstatic_option_width(id, short_name, type, long_name, description, var_name)                               \
+	char id[1 _argstatic_if_option_##type(+ _argstatic_strlen(long_name) + _argstatic_hint_width(type, var_name))];
+
+/* Like _arginfo_value_hint(), and then the 3 characters of " <>" around it */
+#define _argstatic_hint_width(type, var_name)                                                                         \
+	(_argstatic_hint_length(type, var_name) > 0 ? 3 + _argstatic_hint_length(type, var_name) : 0)
+#define _argstatic_hint_length(type, var_name)                                                                        \
+	((_argstatic_flags & _kARGPARSE_USE_VARNAMES) && _argstatic_strlen(var_name) > 0                                  \
+		? _argstatic_strlen(var_name) : _argstatic_strlen(_argstatic_type_name_##type))
+
+
+/* Initializes the argparse context structure and sets the initial argparse state (_kARG_VALUE_INIT) */
+KJC_ARGPARSE_API void _argparse_init(struct kjc_argparse* argparse_context);
 
 /* Register an argument with the argparse context struct */
-void _argparse_add(
+KJC_ARGPARSE_API void _argparse_add(
 	struct kjc_argparse* argparse_context,
 	int arg_id,
 	char short_name,
@@ -488,27 +1425,102 @@ void _argparse_add(
 	const char* var_name
 );
 
+/* Same as _argparse_add(), with the type and short name packed together as (type << 8) | short_name */
+KJC_ARGPARSE_API void _argparse_add_lean(
+	struct kjc_argparse* argparse_context,
+	int arg_id,
+	unsigned type_short_name,
+	const char* long_name,
+	const char* description,
+	const char* var_name
+);
+
+/* Register an ARG_CHOICE argument, building the hash table of its choices */
+KJC_ARGPARSE_API void _argparse_add_choice(
+	struct kjc_argparse* argparse_context,
+	int arg_id,
+	char short_name,
+	const char* long_name,
+	const char* description,
+	const char* var_name,
+	const char* const* choices,
+	size_t count
+);
+
+/* Register an ARG_KV argument, which adds each key=value pair to the map */
+KJC_ARGPARSE_API void _argparse_add_kv(
+	struct kjc_argparse* argparse_context,
+	int arg_id,
+	char short_name,
+	const char* long_name,
+	const char* description,
+	const char* var_name,
+	struct kjc_argmap* map
+);
+
+/* Register constraints on named arguments, which are resolved once all arguments have been registered */
+KJC_ARGPARSE_API void _argparse_add_constraints(
+	struct kjc_argparse* argparse_context,
+	unsigned char kind,
+	const char* const* names,
+	size_t count,
+	const char* other
+);
+
+/* Set the help group of the arguments registered after this, NULL for none */
+KJC_ARGPARSE_API void _argparse_group(struct kjc_argparse* argparse_context, const char* title);
+
+/* Queue work to run on a thread pool once all arguments are parsed */
+KJC_ARGPARSE_API void _argparse_defer(
+	struct kjc_argparse* argparse_context,
+	unsigned group,
+	const char* (*fn)(void* arg),
+	void* arg
+);
+
+/* Start timing the handler that's about to run, for ARGPARSE_CONFIG_PROFILE() */
+KJC_ARGPARSE_API void _argparse_profile_enter(struct kjc_argparse* argparse_context);
+
+/* Add the time since _argparse_profile_enter() to the handler's stat */
+KJC_ARGPARSE_API void _argparse_profile_exit(struct kjc_argparse* argparse_context);
+
 /* Returns nonzero if argument parsing should stop */
-int _argparse_done(const struct kjc_argparse* argparse_context);
+KJC_ARGPARSE_API int _argparse_done(const struct kjc_argparse* argparse_context);
 
 /* Advance the argparse state machine, usually by parsing an argument */
-void _argparse_parse(struct kjc_argparse* argparse_context);
+KJC_ARGPARSE_API void _argparse_parse(struct kjc_argparse* argparse_context);
 
 /* Automatically build, format, and display usage and help text based on the info of registered arguments */
-void _argparse_help(const struct kjc_argparse* argparse_context);
+KJC_ARGPARSE_API void _argparse_help(struct kjc_argparse* argparse_context);
 
 /* Return the next argument (unparsed), advancing the argparse index */
-char* _argparse_next(struct kjc_argparse* argparse_context);
+KJC_ARGPARSE_API char* _argparse_next(struct kjc_argparse* argparse_context);
 
 /* Get current argument's attached integer value */
-long _argparse_value_long(const struct kjc_argparse* argparse_context);
+KJC_ARGPARSE_API long _argparse_value_long(const struct kjc_argparse* argparse_context);
 
 /* Get current argument's attached string value */
-const char* _argparse_value_string(const struct kjc_argparse* argparse_context);
+KJC_ARGPARSE_API const char* _argparse_value_string(const struct kjc_argparse* argparse_context);
+
+/* Get the length of the current argument's string value (or of the positional/other argument) */
+KJC_ARGPARSE_API size_t _argparse_value_len(const struct kjc_argparse* argparse_context);
+
+/* Get current argument's attached string value along with its length */
+KJC_ARGPARSE_API struct kjc_argslice _argparse_value_slice(const struct kjc_argparse* argparse_context);
+
+/* Get the current key=value pair of an ARG_KV argument */
+KJC_ARGPARSE_API struct kjc_argkv _argparse_value_kv(const struct kjc_argparse* argparse_context);
+
+/* Get the current run of positional arguments */
+KJC_ARGPARSE_API struct kjc_argbatch _argparse_value_batch(const struct kjc_argparse* argparse_context);
 
 
 #ifdef __cplusplus
 }
 #endif
 
+#ifdef KJC_ARGPARSE_IMPLEMENTATION
+#include "kjc_argparse.c"
+#endif /* KJC_ARGPARSE_IMPLEMENTATION */
+
 #endif /* KJC_ARGPARSE_H */
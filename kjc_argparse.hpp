@@ -0,0 +1,1586 @@
+//
+//  kjc_argparse.hpp
+//
+//  Created by Kevin Colley on 10/18/26.
+//  Copyright © 2026 Kevin Colley. All rights reserved.
+//
+
+#ifndef KJC_ARGPARSE_HPP
+#define KJC_ARGPARSE_HPP
+
+/*
+ * Header-only C++17 front end for kjc_argparse.
+ *
+ * The option schema is a constexpr object. Sorting, duplicate detection, help column widths and a
+ * perfect hash of all long option and subcommand names are computed by the compiler, so declaring
+ * the same option twice is a compile error and the runtime only has to match each argument. Parsing
+ * behavior, error messages and help output are the same as for the ARGPARSE macros.
+ *
+ * Schema (usable in constant expressions):
+ * - kjc::arg(int id, char shortarg, std::string_view longarg, std::string_view help) - Arg with no associated value
+ * - kjc::arg_int(int id, char shortarg, std::string_view longarg, std::string_view help, var) - Arg with an int value
+ * - kjc::arg_long(int id, char shortarg, std::string_view longarg, std::string_view help, var) - Arg with a long value
+ * - kjc::arg_string(int id, char shortarg, std::string_view longarg, std::string_view help, var) - Arg with a string value
+ * - kjc::arg_command(int id, std::string_view cmd, std::string_view help) - Named subcommand
+ * - kjc::make_schema([kjc::config cfg,] options...) - Build a kjc::schema from a list of options
+ *
+ * Use 0 for shortarg and kjc::none for longarg or help to leave them out. Options without help are
+ * hidden from the help output, like passing NULL as the description to ARG().
+ *
+ * Parsing:
+ * - kjc::parser p(schema, argc, argv) - Start parsing all arguments
+ * - kjc::parser p(schema, args, count) - Start parsing an array of std::string_view arguments (args[0] is the
+ *   program name), which don't need to be NUL-terminated. With C++20, a std::span<const std::string_view> also works.
+ * - kjc::parser p(schema, parent_parser) - Continue parsing after parent_parser produced a command event
+ * - bool p.next(kjc::event& ev) - Fetch the next event, returns false once parsing has ended
+ * - void p.help() - Print help usage message to the configured output stream
+ * - void p.print_error(const kjc::event& ev) - Print the message for an error event to the configured stream
+ * - std::FILE* p.stream() - Get the configured output stream, or NULL if output is disabled
+ * - int p.index() - Get index of current argument
+ * - std::string_view p.take_next() - Take the next argument, or a view with a NULL data() if there are no more
+ *
+ * Example:
+ *
+ *   enum { OPT_VERBOSE, OPT_JOBS };
+ *   static constexpr auto schema = kjc::make_schema(
+ *       kjc::arg(OPT_VERBOSE, 'v', "verbose", "Enable verbose logging"),
+ *       kjc::arg_int(OPT_JOBS, 'j', "jobs", "Number of jobs to run in parallel", "jobs")
+ *   );
+ *
+ *   kjc::parser p(schema, argc, argv);
+ *   for(kjc::event ev; p.next(ev); ) {
+ *       switch(ev.kind) { ... }
+ *   }
+ *
+ * Coroutine interface (C++20):
+ * - kjc::generator<kjc::event> kjc::events(kjc::parser& p) - Lazily yield the events of p, one per resumption
+ *
+ *   kjc::parser p(schema, argc, argv);
+ *   for(const kjc::event& ev : kjc::events(p)) {
+ *       ...  // Arguments after the current one haven't been looked at yet
+ *   }
+ *
+ * Binding options to struct members (no handler code, the type of the member picks the option type):
+ * - kjc::bind(char shortarg, std::string_view longarg, std::string_view help, &T::member) - bool member, set to true
+ * - kjc::bind(char shortarg, std::string_view longarg, std::string_view help, var, &T::member) - int, long, double
+ *   or std::string_view member
+ * - kjc::bind(char shortarg, std::string_view longarg, std::string_view help, var, &T::member, names) - enum member,
+ *   names is an array of kjc::enum_name<E> listing the accepted values
+ * - kjc::make_binding([kjc::config cfg,] bound options...) - Build a kjc::binding from a list of bound options
+ * - kjc::parse_into(binding, T& target, argc, argv[, on_positional]) - Parse all arguments, assigning the members
+ *   of target, returns a kjc::parse_result
+ * - kjc::parse_into(binding, T& target, args, count[, on_positional]) - Same for an array of std::string_view
+ *   arguments (or a std::span<const std::string_view> with C++20)
+ *
+ *   struct options { bool verbose; int jobs; };
+ *   static constexpr auto binding = kjc::make_binding(
+ *       kjc::bind('v', "verbose", "Enable verbose logging", &options::verbose),
+ *       kjc::bind('j', "jobs", "Number of jobs to run in parallel", "jobs", &options::jobs)
+ *   );
+ *
+ *   options opts{};
+ *   if(kjc::parse_into(binding, opts, argc, argv) != kjc::parse_result::ok) { ... }
+ */
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <system_error>
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#endif
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace kjc {
+
+/* Same values as the _kARG_TYPE_* constants in kjc_argparse.h */
+enum class arg_type : unsigned char {
+	flag = 0,
+	string = 1,
+	integer = 2,
+	command = 4,
+};
+
+/* Used for a missing long name or help string */
+inline constexpr std::string_view none{};
+
+struct option {
+	int id;
+	char short_name;
+	arg_type type;
+	std::string_view long_name;
+	std::string_view description;
+	std::string_view var_name;
+};
+
+/* kjc::arg(int id, char shortarg, std::string_view longarg, std::string_view help) - Arg with no associated value */
+constexpr option arg(int id, char short_name, std::string_view long_name, std::string_view description) {
+	return option{id, short_name, arg_type::flag, long_name, description, none};
+}
+
+/* kjc::arg_long(int id, char shortarg, std::string_view longarg, std::string_view help, var) - Arg with a long value */
+constexpr option arg_long(
+	int id, char short_name, std::string_view long_name, std::string_view description, std::string_view var_name
+) {
+	return option{id, short_name, arg_type::integer, long_name, description, var_name};
+}
+
+/* kjc::arg_int(int id, char shortarg, std::string_view longarg, std::string_view help, var) - Arg with an int value */
+constexpr option arg_int(
+	int id, char short_name, std::string_view long_name, std::string_view description, std::string_view var_name
+) {
+	return arg_long(id, short_name, long_name, description, var_name);
+}
+
+/* kjc::arg_string(int id, char shortarg, std::string_view longarg, std::string_view help, var) - Arg with a string value */
+constexpr option arg_string(
+	int id, char short_name, std::string_view long_name, std::string_view description, std::string_view var_name
+) {
+	return option{id, short_name, arg_type::string, long_name, description, var_name};
+}
+
+/* kjc::arg_command(int id, std::string_view cmd, std::string_view help) - Named subcommand */
+constexpr option arg_command(int id, std::string_view name, std::string_view description) {
+	return option{id, '\0', arg_type::command, name, description, none};
+}
+
+
+/* Equivalent of the ARGPARSE_CONFIG_* settings, with the same defaults */
+struct config {
+	std::FILE* stream = nullptr;                 /* nullptr means stderr, like ARGPARSE_DEFAULT_STREAM */
+	bool quiet = false;                          /* Like ARGPARSE_CONFIG_STREAM(NULL) */
+	std::string_view custom_usage = none;
+	std::string_view custom_suffix = none;
+	std::string_view positional_usage = none;    /* Usage text of the ARG_POSITIONAL handler, if there is one */
+	bool catchall = false;                       /* True if there is an ARG_OTHER handler */
+	int subcmd_description_column = -1;
+	int description_column = -1;
+	unsigned indent = 2;
+	unsigned description_padding = 3;
+	bool use_varnames = true;
+	bool type_hints = false;
+	bool shortgroups = true;
+	bool auto_help = true;
+	bool dashdash = true;
+	std::string_view long_prefix = "--";
+};
+
+
+namespace detail {
+
+/* Calling this outside of a constant expression is what turns an invalid schema into a compile error */
+[[noreturn]] inline void schema_error(const char* message) {
+	std::fprintf(stderr, "kjc::make_schema: %s\n", message);
+	std::abort();
+}
+
+constexpr std::uint64_t fnv1a(std::string_view s) {
+	std::uint64_t h = 0xcbf29ce484222325ull;
+	for(char c : s) {
+		h ^= (unsigned char)c;
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+constexpr std::uint64_t mix(std::uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+/* Slot of a key within the table, given the displacement chosen for its bucket */
+constexpr std::size_t phf_slot(std::uint64_t hash, std::uint16_t displacement, std::size_t table_size) {
+	return (std::size_t)mix(hash ^ (displacement * 0x9e3779b97f4a7c15ull)) & (table_size - 1);
+}
+
+constexpr std::size_t phf_bucket(std::uint64_t hash, std::size_t bucket_count) {
+	return (std::size_t)(mix(hash) % bucket_count);
+}
+
+/* Power of two with at most half of the slots used, so displacements are found quickly */
+constexpr std::size_t phf_table_size(std::size_t count) {
+	std::size_t size = 2;
+	while(size < count * 2) {
+		size *= 2;
+	}
+	return size;
+}
+
+constexpr std::size_t phf_bucket_count(std::size_t count) {
+	return count / 4 + 1;
+}
+
+template<typename Less>
+constexpr void sift_down(std::uint16_t* items, std::size_t root, std::size_t count, Less less) {
+	while(root * 2 + 1 < count) {
+		std::size_t child = root * 2 + 1;
+		if(child + 1 < count && less(items[child], items[child + 1])) {
+			child++;
+		}
+		if(!less(items[root], items[child])) {
+			return;
+		}
+		std::uint16_t tmp = items[root];
+		items[root] = items[child];
+		items[child] = tmp;
+		root = child;
+	}
+}
+
+/* Heapsort, because std::sort isn't constexpr until C++20 */
+template<typename Less>
+constexpr void sort(std::uint16_t* items, std::size_t count, Less less) {
+	for(std::size_t i = count / 2; i-- > 0; ) {
+		sift_down(items, i, count, less);
+	}
+	for(std::size_t end = count; end-- > 1; ) {
+		std::uint16_t tmp = items[0];
+		items[0] = items[end];
+		items[end] = tmp;
+		sift_down(items, 0, end, less);
+	}
+}
+
+constexpr bool is_long_option(const option& opt) {
+	return opt.type != arg_type::command && opt.long_name.data() != nullptr;
+}
+
+constexpr bool is_command(const option& opt) {
+	return opt.type == arg_type::command;
+}
+
+constexpr std::string_view type_name(arg_type type) {
+	switch(type) {
+		case arg_type::string: return "string";
+		case arg_type::integer: return "int";
+		default: return none;
+	}
+}
+
+constexpr std::string_view value_hint(const option& opt, bool use_varnames) {
+	if(use_varnames && opt.var_name.data() != nullptr) {
+		return opt.var_name;
+	}
+	return type_name(opt.type);
+}
+
+/* Parse like strtol(value, &end, 0) with *end == '\0', but without needing a NUL terminator */
+constexpr bool parse_long(std::string_view value, long& out) {
+	std::size_t i = 0;
+	while(i < value.size() && (value[i] == ' ' || (value[i] >= '\t' && value[i] <= '\r'))) {
+		i++;
+	}
+	
+	bool negative = false;
+	if(i < value.size() && (value[i] == '+' || value[i] == '-')) {
+		negative = value[i] == '-';
+		i++;
+	}
+	
+	unsigned base = 10;
+	if(i + 1 < value.size() && value[i] == '0' && (value[i + 1] == 'x' || value[i + 1] == 'X')) {
+		base = 16;
+		i += 2;
+	}
+	else if(i < value.size() && value[i] == '0') {
+		base = 8;
+	}
+	
+	if(i >= value.size()) {
+		return false;
+	}
+	
+	unsigned long limit = negative
+		? (unsigned long)std::numeric_limits<long>::max() + 1
+		: (unsigned long)std::numeric_limits<long>::max();
+	unsigned long result = 0;
+	for(; i < value.size(); i++) {
+		char c = value[i];
+		unsigned digit = 0;
+		if(c >= '0' && c <= '9') {
+			digit = (unsigned)(c - '0');
+		}
+		else if(c >= 'a' && c <= 'z') {
+			digit = (unsigned)(c - 'a') + 10;
+		}
+		else if(c >= 'A' && c <= 'Z') {
+			digit = (unsigned)(c - 'A') + 10;
+		}
+		else {
+			return false;
+		}
+		
+		if(digit >= base || result > (limit - digit) / base) {
+			return false;
+		}
+		result = result * base + digit;
+	}
+	
+	out = negative ? (long)(0 - result) : (long)result;
+	return true;
+}
+
+} /* namespace detail */
+
+
+/* Compiled option schema, build it with kjc::make_schema() */
+template<std::size_t N>
+struct schema {
+	static_assert(N < 0xffff, "Too many options for one schema");
+	
+	static constexpr std::size_t option_count = N;
+	static constexpr std::size_t table_size = detail::phf_table_size(N);
+	static constexpr std::size_t bucket_count = detail::phf_bucket_count(N);
+	
+	config cfg{};
+	option options[N ? N : 1]{};
+	
+	/* Option index + 1 (0 means none) for each short option character */
+	std::uint16_t short_index[256]{};
+	
+	/* Short options in sorted order, for the usage line */
+	char short_names[N ? N : 1]{};
+	unsigned short_count = 0;
+	unsigned long_count = 0;
+	unsigned command_count = 0;
+	
+	/* Perfect hash tables (option index + 1 per slot, one displacement per bucket) */
+	std::uint16_t long_slots[table_size]{};
+	std::uint16_t long_displacements[bucket_count]{};
+	std::uint16_t command_slots[table_size]{};
+	std::uint16_t command_displacements[bucket_count]{};
+	
+	/* Help column widths */
+	unsigned long_name_width = 0;
+	unsigned subcmd_width = 0;
+	
+	constexpr const option* find_short(char c) const {
+		std::uint16_t idx = short_index[(unsigned char)c];
+		return idx ? &options[idx - 1] : nullptr;
+	}
+	
+	constexpr const option* find_long(std::string_view name) const {
+		return lookup(long_slots, long_displacements, name);
+	}
+	
+	constexpr const option* find_command(std::string_view name) const {
+		return lookup(command_slots, command_displacements, name);
+	}
+	
+private:
+	constexpr const option* lookup(
+		const std::uint16_t* slots,
+		const std::uint16_t* displacements,
+		std::string_view name
+	) const {
+		std::uint64_t hash = detail::fnv1a(name);
+		std::uint16_t displacement = displacements[detail::phf_bucket(hash, bucket_count)];
+		if(displacement == 0) {
+			return nullptr;
+		}
+		
+		std::uint16_t idx = slots[detail::phf_slot(hash, displacement, table_size)];
+		if(idx == 0 || options[idx - 1].long_name != name) {
+			return nullptr;
+		}
+		return &options[idx - 1];
+	}
+};
+
+
+namespace detail {
+
+/* Hash and displace: place the biggest buckets first, trying displacements until none of their keys collide */
+template<std::size_t N>
+constexpr void build_phf(
+	schema<N>& s,
+	std::uint16_t* slots,
+	std::uint16_t* displacements,
+	bool (*select)(const option&)
+) {
+	constexpr std::size_t table_size = schema<N>::table_size;
+	constexpr std::size_t bucket_count = schema<N>::bucket_count;
+	
+	std::uint64_t hashes[N ? N : 1]{};
+	std::uint16_t bucket_of[N ? N : 1]{};
+	std::uint16_t bucket_size[bucket_count]{};
+	std::uint16_t order[bucket_count]{};
+	
+	for(std::size_t i = 0; i < N; i++) {
+		if(select(s.options[i])) {
+			hashes[i] = fnv1a(s.options[i].long_name);
+			bucket_of[i] = (std::uint16_t)phf_bucket(hashes[i], bucket_count);
+			bucket_size[bucket_of[i]]++;
+		}
+	}
+	
+	for(std::size_t b = 0; b < bucket_count; b++) {
+		order[b] = (std::uint16_t)b;
+	}
+	sort(order, bucket_count, [&](std::uint16_t a, std::uint16_t b) {
+		return bucket_size[a] > bucket_size[b];
+	});
+	
+	for(std::size_t ob = 0; ob < bucket_count && bucket_size[order[ob]] != 0; ob++) {
+		std::size_t b = order[ob];
+		std::uint16_t members[N ? N : 1]{};
+		std::size_t member_count = 0;
+		for(std::size_t i = 0; i < N; i++) {
+			if(select(s.options[i]) && bucket_of[i] == b) {
+				members[member_count++] = (std::uint16_t)i;
+			}
+		}
+		
+		bool placed = false;
+		for(std::uint32_t d = 1; d <= 0xffff && !placed; d++) {
+			placed = true;
+			for(std::size_t m = 0; m < member_count && placed; m++) {
+				std::size_t slot = phf_slot(hashes[members[m]], (std::uint16_t)d, table_size);
+				if(slots[slot] != 0) {
+					placed = false;
+				}
+				for(std::size_t prev = 0; prev < m && placed; prev++) {
+					if(phf_slot(hashes[members[prev]], (std::uint16_t)d, table_size) == slot) {
+						placed = false;
+					}
+				}
+			}
+			
+			if(placed) {
+				displacements[b] = (std::uint16_t)d;
+				for(std::size_t m = 0; m < member_count; m++) {
+					slots[phf_slot(hashes[members[m]], (std::uint16_t)d, table_size)] = (std::uint16_t)(members[m] + 1);
+				}
+			}
+		}
+		
+		if(!placed) {
+			schema_error("Failed to build a perfect hash of the option names");
+		}
+	}
+}
+
+template<std::size_t N>
+constexpr void check_sorted_duplicates(const schema<N>& s, bool (*select)(const option&), const char* message) {
+	std::uint16_t sorted[N ? N : 1]{};
+	std::size_t count = 0;
+	for(std::size_t i = 0; i < N; i++) {
+		if(select(s.options[i])) {
+			sorted[count++] = (std::uint16_t)i;
+		}
+	}
+	
+	sort(sorted, count, [&](std::uint16_t a, std::uint16_t b) {
+		return s.options[a].long_name < s.options[b].long_name;
+	});
+	
+	for(std::size_t i = 1; i < count; i++) {
+		if(s.options[sorted[i - 1]].long_name == s.options[sorted[i]].long_name) {
+			schema_error(message);
+		}
+	}
+}
+
+} /* namespace detail */
+
+
+/* kjc::make_schema(kjc::config cfg, options...) - Build a kjc::schema from a list of options */
+template<typename... Options>
+constexpr schema<sizeof...(Options)> make_schema(const config& cfg, const Options&... opts) {
+	constexpr std::size_t N = sizeof...(Options);
+	schema<N> s{};
+	s.cfg = cfg;
+	
+	std::size_t i = 0;
+	((s.options[i++] = opts), ...);
+	
+	for(i = 0; i < N; i++) {
+		const option& opt = s.options[i];
+		if(opt.short_name == '\0' && opt.long_name.data() == nullptr) {
+			detail::schema_error("Option needs a short name or a long name");
+		}
+		if(opt.type == arg_type::command && (opt.long_name.empty() || opt.short_name != '\0')) {
+			detail::schema_error("Subcommands need a name and no short name");
+		}
+		
+		if(opt.short_name != '\0') {
+			if(s.short_index[(unsigned char)opt.short_name] != 0) {
+				detail::schema_error("Duplicate short option");
+			}
+			s.short_index[(unsigned char)opt.short_name] = (std::uint16_t)(i + 1);
+		}
+		
+		if(detail::is_long_option(opt)) {
+			s.long_count++;
+			
+			/* For something like "--count <num>", this counts the length of the " <num>" part */
+			std::string_view hint = detail::value_hint(opt, cfg.use_varnames);
+			unsigned width = (unsigned)opt.long_name.size() + (hint.data() ? 3 + (unsigned)hint.size() : 0);
+			if(width > s.long_name_width) {
+				s.long_name_width = width;
+			}
+		}
+		else if(detail::is_command(opt)) {
+			s.command_count++;
+			if(opt.long_name.size() > s.subcmd_width) {
+				s.subcmd_width = (unsigned)opt.long_name.size();
+			}
+		}
+	}
+	
+	/* Walking the direct table gives the short options in sorted order for free */
+	for(unsigned c = 0; c < 256; c++) {
+		if(s.short_index[c] != 0) {
+			s.short_names[s.short_count++] = (char)c;
+		}
+	}
+	
+	detail::check_sorted_duplicates(s, detail::is_long_option, "Duplicate long arg name");
+	detail::check_sorted_duplicates(s, detail::is_command, "Duplicate subcommand");
+	
+	detail::build_phf(s, s.long_slots, s.long_displacements, detail::is_long_option);
+	detail::build_phf(s, s.command_slots, s.command_displacements, detail::is_command);
+	return s;
+}
+
+/* kjc::make_schema(options...) - Build a kjc::schema with the default configuration */
+template<typename... Options>
+constexpr schema<sizeof...(Options) + 1> make_schema(const option& first, const Options&... opts) {
+	return make_schema(config{}, first, opts...);
+}
+
+
+/* What kind of event kjc::parser::next() produced */
+enum class event_kind {
+	option,      /* A declared option or subcommand matched (id and opt are set) */
+	command,     /* A subcommand matched, continue with a kjc::parser constructed from this one */
+	positional,  /* Like ARG_POSITIONAL (value is the argument) */
+	other,       /* Like ARG_OTHER, only produced when cfg.catchall is set (value is the argument) */
+	help,        /* An unhandled "--help", call help() to handle it like the automatic help handler does */
+	end,         /* Like ARG_END, all arguments were parsed */
+	error,       /* Parsing failed, call print_error() to describe it */
+};
+
+enum class error_code {
+	none,
+	unexpected_argument,
+	unknown_short_in_group,
+	value_not_last,
+	unexpected_value,
+	missing_value,
+	invalid_integer,
+	invalid_number,   /* Only produced by kjc::parse_into(), for double members */
+	invalid_choice,   /* Only produced by kjc::parse_into(), for enum members */
+};
+
+struct event {
+	event_kind kind = event_kind::end;
+	int id = -1;
+	const option* opt = nullptr;
+	std::string_view arg{};      /* The whole argument that produced this event */
+	std::string_view value{};    /* Value of string options, positionals and other arguments */
+	long integer = 0;            /* Value of integer options */
+	int index = 0;               /* Index of the argument in argv */
+	int offset = 0;              /* Character offset within arg, for errors in short option groups */
+	error_code error = error_code::none;
+};
+
+
+/* State shared by all parsers, independent of the schema size */
+class parser_base {
+public:
+	/* int index() - Get index of current argument */
+	int index() const {
+		return *argidx_ - (group_.data() == nullptr);
+	}
+	
+	/* std::string_view take_next() - Take the next argument, or a view with a NULL data() if there are no more */
+	std::string_view take_next() {
+		if(*argidx_ >= argc_) {
+			return none;
+		}
+		return arg_at((*argidx_)++);
+	}
+	
+	/* void rewind(int count) - Rewinds the argparse index by the given amount */
+	void rewind(int count) {
+		*argidx_ -= count;
+	}
+	
+protected:
+	parser_base(int argc, char** argv)
+		: argc_(argc), argv_(argv), argidx_(&argidx_top_) {}
+	
+	parser_base(const std::string_view* args, int count)
+		: argc_(count), views_(args), argidx_(&argidx_top_) {}
+	
+	parser_base(const parser_base& parent, std::string_view command)
+		: argc_(parent.argc_), argv_(parent.argv_), views_(parent.views_), argidx_(parent.argidx_),
+		  parent_(&parent), command_(command) {}
+	
+	/* Arguments are either NUL-terminated strings from argv, or views that carry their own length */
+	std::string_view arg_at(int index) const {
+		return views_ ? views_[index] : std::string_view(argv_[index]);
+	}
+	
+	void print_command(std::FILE* f) const {
+		if(!parent_) {
+			/* Root parser: get cmd from basename of argv[0] */
+			std::string_view cmd = arg_at(0);
+			std::size_t last_slash = cmd.rfind('/');
+			if(last_slash != std::string_view::npos) {
+				cmd.remove_prefix(last_slash + 1);
+			}
+			std::fprintf(f, " %.*s", (int)cmd.size(), cmd.data());
+			return;
+		}
+		
+		parent_->print_command(f);
+		std::fprintf(f, " %.*s", (int)command_.size(), command_.data());
+	}
+	
+	int argc_;
+	char** argv_ = nullptr;
+	const std::string_view* views_ = nullptr;
+	int* argidx_;
+	int argidx_top_ = 1;
+	const parser_base* parent_ = nullptr;
+	std::string_view command_{};
+	std::string_view group_{};
+	std::string_view group_arg_{};
+	const option* last_command_ = nullptr;
+	bool dashdash_ = false;
+	bool done_ = false;
+};
+
+
+template<std::size_t N>
+class parser : public parser_base {
+public:
+	/* kjc::parser p(schema, argc, argv) - Start parsing all arguments */
+	parser(const schema<N>& s, int argc, char** argv)
+		: parser_base(argc, argv), schema_(s) {}
+	
+	/* kjc::parser p(schema, args, count) - Start parsing an array of std::string_view arguments */
+	parser(const schema<N>& s, const std::string_view* args, std::size_t count)
+		: parser_base(args, (int)count), schema_(s) {}
+		
+#ifdef __cpp_lib_span
+	/* kjc::parser p(schema, args) - Start parsing a span of std::string_view arguments */
+	parser(const schema<N>& s, std::span<const std::string_view> args)
+		: parser_base(args.data(), (int)args.size()), schema_(s) {}
+#endif
+	
+	/* kjc::parser p(schema, parent_parser) - Continue parsing after parent_parser produced a command event */
+	template<std::size_t M>
+	parser(const schema<N>& s, const parser<M>& parent)
+		: parser_base(parent, parent.last_command()->long_name), schema_(s) {}
+	
+	const schema<N>& get_schema() const {
+		return schema_;
+	}
+	
+	/* Subcommand from the most recent command event */
+	const option* last_command() const {
+		return last_command_;
+	}
+	
+	/* bool next(kjc::event& ev) - Fetch the next event, returns false once parsing has ended */
+	bool next(event& ev) {
+		if(done_) {
+			return false;
+		}
+		
+		ev = event{};
+		step(ev);
+		
+		if(ev.kind == event_kind::end || ev.kind == event_kind::error) {
+			done_ = true;
+		}
+		return true;
+	}
+	
+	/* void help() - Print help usage message to the configured output stream */
+	void help() const {
+		std::FILE* f = stream();
+		if(!f) {
+			return;
+		}
+		
+		help_usage(f);
+		help_commands(f);
+		help_options(f);
+		
+		if(schema_.cfg.custom_suffix.data()) {
+			std::fprintf(f, "\n%.*s\n", (int)schema_.cfg.custom_suffix.size(), schema_.cfg.custom_suffix.data());
+		}
+	}
+	
+	/* void print_error(const kjc::event& ev) - Print the message for an error event to the configured stream */
+	void print_error(const event& ev) const {
+		std::FILE* f = stream();
+		if(!f) {
+			return;
+		}
+		
+		const std::string_view& arg = ev.arg;
+		switch(ev.error) {
+			case error_code::none:
+				break;
+			
+			case error_code::unexpected_argument:
+				std::fprintf(f, "Error: Unexpected argument: \"%.*s\"\n", (int)arg.size(), arg.data());
+				break;
+			
+			case error_code::unknown_short_in_group:
+				std::fprintf(f,
+					"Error: In argument \"%.*s\", there is no supported option '-%c'\n",
+					(int)arg.size(), arg.data(), arg[ev.offset]
+				);
+				break;
+			
+			case error_code::value_not_last:
+				std::fprintf(f,
+					"Error: In argument \"%.*s\", option '-%c' expects a value and therefore"
+					" must be the last character.\n",
+					(int)arg.size(), arg.data(), arg[ev.offset]
+				);
+				break;
+			
+			case error_code::unexpected_value:
+				std::fprintf(f,
+					"Error: Argument \"%.*s\" has an embedded value but doesn't expect any value.\n",
+					(int)arg.size(), arg.data()
+				);
+				break;
+			
+			case error_code::missing_value:
+				std::fprintf(f,
+					"Error: Argument \"%.*s\" needs a value but there are no more arguments.\n",
+					(int)arg.size(), arg.data()
+				);
+				break;
+			
+			case error_code::invalid_integer:
+				std::fprintf(f, "Error: The ");
+				print_option_name(f, *ev.opt);
+				std::fprintf(f, " option expects an integral value, not \"%.*s\".\n",
+					(int)ev.value.size(), ev.value.data()
+				);
+				break;
+			
+			case error_code::invalid_number:
+				std::fprintf(f, "Error: The ");
+				print_option_name(f, *ev.opt);
+				std::fprintf(f, " option expects a number, not \"%.*s\".\n", (int)ev.value.size(), ev.value.data());
+				break;
+			
+			case error_code::invalid_choice:
+				std::fprintf(f, "Error: Invalid value \"%.*s\" for the ", (int)ev.value.size(), ev.value.data());
+				print_option_name(f, *ev.opt);
+				std::fprintf(f, " option.\n");
+				break;
+		}
+	}
+	
+	/* std::FILE* stream() - Configured output stream, or nullptr if output is disabled */
+	std::FILE* stream() const {
+		if(schema_.cfg.quiet) {
+			return nullptr;
+		}
+		return schema_.cfg.stream ? schema_.cfg.stream : stderr;
+	}
+	
+private:
+	/* Prints "--name", or "-c" for options that only have a short name */
+	void print_option_name(std::FILE* f, const option& opt) const {
+		if(opt.long_name.data()) {
+			std::fprintf(f, "%.*s%.*s",
+				(int)schema_.cfg.long_prefix.size(), schema_.cfg.long_prefix.data(),
+				(int)opt.long_name.size(), opt.long_name.data()
+			);
+		}
+		else {
+			std::fprintf(f, "-%c", opt.short_name);
+		}
+	}
+	
+	/* Turns an unmatched argument into either an ARG_OTHER event or an error, like _argparse_parse() */
+	void other(event& ev) const {
+		if(schema_.cfg.catchall) {
+			ev.kind = event_kind::other;
+			ev.value = ev.arg;
+		}
+		else {
+			ev.kind = event_kind::error;
+			ev.error = error_code::unexpected_argument;
+		}
+	}
+	
+	void positional(event& ev) const {
+		if(schema_.cfg.positional_usage.data()) {
+			ev.kind = event_kind::positional;
+			ev.value = ev.arg;
+		}
+		else {
+			other(ev);
+		}
+	}
+	
+	/* Checks and fetches the value of a matched option */
+	void matched(event& ev, const option* opt, std::string_view embedded_value, bool has_value) {
+		ev.kind = event_kind::option;
+		ev.id = opt->id;
+		ev.opt = opt;
+		
+		if(opt->type == arg_type::command) {
+			ev.kind = event_kind::command;
+			last_command_ = opt;
+			return;
+		}
+		
+		if(opt->type == arg_type::flag) {
+			/* Argument shouldn't have a value, so ensure that it doesn't */
+			if(has_value) {
+				if(schema_.cfg.catchall) {
+					ev.kind = event_kind::other;
+					ev.value = ev.arg;
+					ev.id = -1;
+					ev.opt = nullptr;
+					return;
+				}
+				
+				ev.kind = event_kind::error;
+				ev.error = error_code::unexpected_value;
+			}
+			return;
+		}
+		
+		/* This argument expects a value as the next argument like --test foo */
+		if(!has_value) {
+			std::string_view next_arg = take_next();
+			if(!next_arg.data()) {
+				ev.kind = event_kind::error;
+				ev.error = error_code::missing_value;
+				return;
+			}
+			embedded_value = next_arg;
+		}
+		
+		ev.value = embedded_value;
+		if(opt->type == arg_type::integer && !detail::parse_long(embedded_value, ev.integer)) {
+			ev.kind = event_kind::error;
+			ev.error = error_code::invalid_integer;
+		}
+	}
+	
+	void step(event& ev) {
+		const config& cfg = schema_.cfg;
+		
+		/* Multiple short options in a single argument like ls -laF */
+		if(group_.data()) {
+			if(!group_.empty()) {
+				char c = group_.front();
+				group_.remove_prefix(1);
+				ev.arg = group_arg_;
+				ev.index = *argidx_ - 1;
+				matched(ev, schema_.find_short(c), none, false);
+				return;
+			}
+			group_ = none;
+		}
+		
+		/* Don't do any more parsing after encountering a subcommand */
+		if(last_command_) {
+			ev.kind = event_kind::end;
+			return;
+		}
+		
+		/* Treat all remaining arguments as positional after "--" */
+		if(dashdash_) {
+			ev.index = *argidx_;
+			ev.arg = take_next();
+			if(ev.arg.data()) {
+				positional(ev);
+			}
+			else {
+				ev.kind = event_kind::end;
+			}
+			return;
+		}
+		
+		ev.index = *argidx_;
+		std::string_view arg = take_next();
+		ev.arg = arg;
+		if(!arg.data()) {
+			ev.kind = event_kind::end;
+			return;
+		}
+		
+		/* Check if this arg is a subcmd */
+		if(const option* cmd = schema_.find_command(arg)) {
+			matched(ev, cmd, none, false);
+			return;
+		}
+		
+		/* In case the long argument prefix was overridden to something like "-", check that first */
+		std::string_view prefix = cfg.long_prefix;
+		if(arg.size() > prefix.size() && arg.substr(0, prefix.size()) == prefix) {
+			std::string_view name = arg.substr(prefix.size());
+			std::size_t eq = name.find('=');
+			const option* opt = schema_.find_long(name.substr(0, eq));
+			if(!opt) {
+				/* Support for the auto help handler (--help, /help, depending on prefix) */
+				if(cfg.auto_help && name == "help") {
+					ev.kind = event_kind::help;
+				}
+				else {
+					other(ev);
+				}
+				return;
+			}
+			
+			/* Check if this argument is in the form --long-with-value=foo */
+			bool has_value = eq != std::string_view::npos;
+			matched(ev, opt, has_value ? name.substr(eq + 1) : none, has_value);
+			return;
+		}
+		
+		if(arg[0] != '-' || arg.size() < 2) {
+			/* Anything that doesn't start with '-', the string "-", or the empty string */
+			positional(ev);
+			return;
+		}
+		
+		if(arg.size() == 2) {
+			/* Check for support of "--" (if configured) without overriding a user-defined "--" handler */
+			if(arg[1] == '-' && cfg.dashdash && !schema_.find_short('-')) {
+				dashdash_ = true;
+				step(ev);
+				return;
+			}
+			
+			/* Single short argument */
+			if(const option* opt = schema_.find_short(arg[1])) {
+				matched(ev, opt, none, false);
+			}
+			else {
+				other(ev);
+			}
+			return;
+		}
+		
+		if(arg[1] == '-' || !cfg.shortgroups) {
+			other(ev);
+			return;
+		}
+		
+		/* Ensure that every character in this argument is a registered short option */
+		for(std::size_t i = 1; i < arg.size(); i++) {
+			const option* opt = arg[i] == '-' ? nullptr : schema_.find_short(arg[i]);
+			if(!opt || (opt->type != arg_type::flag && i != arg.size() - 1)) {
+				if(cfg.catchall) {
+					other(ev);
+				}
+				else {
+					ev.kind = event_kind::error;
+					ev.error = opt ? error_code::value_not_last : error_code::unknown_short_in_group;
+					ev.offset = (int)i;
+				}
+				return;
+			}
+		}
+		
+		group_ = arg.substr(2);
+		group_arg_ = arg;
+		matched(ev, schema_.find_short(arg[1]), none, false);
+	}
+	
+	void help_usage(std::FILE* f) const {
+		const config& cfg = schema_.cfg;
+		if(cfg.custom_usage.data()) {
+			std::fprintf(f, "%.*s\n", (int)cfg.custom_usage.size(), cfg.custom_usage.data());
+			return;
+		}
+		
+		/* Print usage header with command used to reach this parser */
+		std::fprintf(f, "Usage:");
+		print_command(f);
+		
+		if(schema_.short_count > 0) {
+			std::fprintf(f, " [-%.*s]", (int)schema_.short_count, schema_.short_names);
+		}
+		
+		if(schema_.long_count > 0) {
+			std::fprintf(f, " [OPTIONS]");
+		}
+		
+		if(cfg.positional_usage.data()) {
+			std::fprintf(f, " %.*s", (int)cfg.positional_usage.size(), cfg.positional_usage.data());
+		}
+		
+		if(schema_.command_count > 0) {
+			std::fprintf(f, " COMMAND ...");
+		}
+		
+		std::fprintf(f, "\n");
+	}
+	
+	void help_commands(std::FILE* f) const {
+		const config& cfg = schema_.cfg;
+		bool work_to_do = false;
+		for(std::size_t i = 0; i < N; i++) {
+			if(detail::is_command(schema_.options[i]) && schema_.options[i].description.data()) {
+				work_to_do = true;
+				break;
+			}
+		}
+		
+		if(!work_to_do) {
+			return;
+		}
+		
+		unsigned desc_start = cfg.subcmd_description_column >= 0
+			? (unsigned)cfg.subcmd_description_column
+			: cfg.indent + schema_.subcmd_width + cfg.description_padding;
+		
+		std::fprintf(f, "\nCommands:\n");
+		
+		/* Commands are listed in sorted order */
+		std::uint16_t sorted[N ? N : 1]{};
+		std::size_t count = 0;
+		for(std::size_t i = 0; i < N; i++) {
+			if(detail::is_command(schema_.options[i])) {
+				sorted[count++] = (std::uint16_t)i;
+			}
+		}
+		detail::sort(sorted, count, [&](std::uint16_t a, std::uint16_t b) {
+			return schema_.options[a].long_name < schema_.options[b].long_name;
+		});
+		
+		for(std::size_t i = 0; i < count; i++) {
+			const option& cmd = schema_.options[sorted[i]];
+			if(!cmd.description.data()) {
+				continue;
+			}
+			
+			unsigned col = (unsigned)std::fprintf(f, "%*s", (int)cfg.indent, "");
+			col += (unsigned)std::fprintf(f, "%.*s", (int)cmd.long_name.size(), cmd.long_name.data());
+			if(col + 2 > desc_start) {
+				/* Description will go on next line */
+				std::fprintf(f, "\n");
+				col = 0;
+			}
+			
+			std::fprintf(f, "%*s%.*s\n",
+				(int)(desc_start - col), "",
+				(int)cmd.description.size(), cmd.description.data()
+			);
+		}
+	}
+	
+	void help_options(std::FILE* f) const {
+		const config& cfg = schema_.cfg;
+		bool work_to_do = false;
+		for(std::size_t i = 0; i < N; i++) {
+			if(!detail::is_command(schema_.options[i]) && schema_.options[i].description.data()) {
+				work_to_do = true;
+				break;
+			}
+		}
+		
+		if(!work_to_do) {
+			return;
+		}
+		
+		unsigned desc_start = cfg.description_column >= 0
+			? (unsigned)cfg.description_column
+			: cfg.indent + 2 + 2 + (unsigned)cfg.long_prefix.size() + schema_.long_name_width + cfg.description_padding;
+		
+		std::fprintf(f, "\nOptions:\n");
+		
+		/* Print description of each argument in declaration order */
+		for(std::size_t i = 0; i < N; i++) {
+			const option& opt = schema_.options[i];
+			if(!opt.description.data() || detail::is_command(opt)) {
+				continue;
+			}
+			
+			std::string_view hint = detail::value_hint(opt, cfg.use_varnames);
+			unsigned col = (unsigned)std::fprintf(f, "%*s", (int)cfg.indent, "");
+			
+			if(opt.short_name != '\0') {
+				col += (unsigned)std::fprintf(f, "-%c", opt.short_name);
+				if(!opt.long_name.data() && hint.data()) {
+					col += (unsigned)std::fprintf(f, " <%.*s>", (int)hint.size(), hint.data());
+				}
+			}
+			else {
+				col += (unsigned)std::fprintf(f, "  ");
+			}
+			
+			if(opt.long_name.data()) {
+				col += (unsigned)std::fprintf(f, opt.short_name != '\0' ? ", " : "  ");
+				col += (unsigned)std::fprintf(f, "%.*s%.*s",
+					(int)cfg.long_prefix.size(), cfg.long_prefix.data(),
+					(int)opt.long_name.size(), opt.long_name.data()
+				);
+				if(hint.data()) {
+					col += (unsigned)std::fprintf(f, " <%.*s>", (int)hint.size(), hint.data());
+				}
+			}
+			
+			if(col + 2 > desc_start) {
+				/* Description will go on next line */
+				std::fprintf(f, "\n");
+				col = 0;
+			}
+			std::fprintf(f, "%*s", (int)(desc_start - col), "");
+			
+			if(cfg.type_hints) {
+				std::string_view type = detail::type_name(opt.type);
+				if(type.data()) {
+					std::fprintf(f, "[%.*s] ", (int)type.size(), type.data());
+				}
+			}
+			
+			std::fprintf(f, "%.*s\n", (int)opt.description.size(), opt.description.data());
+		}
+	}
+	
+	const schema<N>& schema_;
+};
+
+template<std::size_t N>
+parser(const schema<N>&, int, char**) -> parser<N>;
+
+template<std::size_t N>
+parser(const schema<N>&, const std::string_view*, std::size_t) -> parser<N>;
+
+#ifdef __cpp_lib_span
+template<std::size_t N>
+parser(const schema<N>&, std::span<const std::string_view>) -> parser<N>;
+#endif
+
+template<std::size_t N, std::size_t M>
+parser(const schema<N>&, const parser<M>&) -> parser<N>;
+
+
+/* One accepted value of an enum member, for kjc::bind() */
+template<typename E>
+struct enum_name {
+	std::string_view name;
+	E value;
+};
+
+/* Option bound to a member of Target, build it with kjc::bind() */
+template<typename Target, typename T>
+struct bound_option {
+	option opt;
+	T Target::* member;
+	const enum_name<T>* names;
+	std::size_t name_count;
+};
+
+
+namespace detail {
+
+template<typename T>
+inline constexpr bool is_bindable_value =
+	std::is_same_v<T, int> || std::is_same_v<T, long> || std::is_same_v<T, double> || std::is_same_v<T, std::string_view>;
+
+template<typename T>
+constexpr arg_type bound_type() {
+	return std::is_same_v<T, int> || std::is_same_v<T, long> ? arg_type::integer : arg_type::string;
+}
+
+constexpr option with_id(option opt, int id) {
+	opt.id = id;
+	return opt;
+}
+
+/* Converts the value of a matched option and stores it in the bound member */
+template<typename Target, typename T>
+error_code assign(Target& target, const bound_option<Target, T>& field, const event& ev) {
+	T& dest = target.*field.member;
+	
+	if constexpr(std::is_same_v<T, bool>) {
+		dest = true;
+	}
+	else if constexpr(std::is_same_v<T, int>) {
+		if(ev.integer < std::numeric_limits<int>::min() || ev.integer > std::numeric_limits<int>::max()) {
+			return error_code::invalid_integer;
+		}
+		dest = (int)ev.integer;
+	}
+	else if constexpr(std::is_same_v<T, long>) {
+		dest = ev.integer;
+	}
+	else if constexpr(std::is_same_v<T, double>) {
+		/* Like the integer case, the member is left untouched unless the whole value is valid */
+		double value = 0;
+		const char* end = ev.value.data() + ev.value.size();
+		std::from_chars_result res = std::from_chars(ev.value.data(), end, value);
+		if(ev.value.empty() || res.ec != std::errc() || res.ptr != end) {
+			return error_code::invalid_number;
+		}
+		dest = value;
+	}
+	else if constexpr(std::is_same_v<T, std::string_view>) {
+		dest = ev.value;
+	}
+	else {
+		for(std::size_t i = 0; i < field.name_count; i++) {
+			if(field.names[i].name == ev.value) {
+				dest = field.names[i].value;
+				return error_code::none;
+			}
+		}
+		return error_code::invalid_choice;
+	}
+	return error_code::none;
+}
+
+} /* namespace detail */
+
+
+/* kjc::bind(char shortarg, std::string_view longarg, std::string_view help, &T::member) - bool member, set to true */
+template<typename Target>
+constexpr bound_option<Target, bool> bind(
+	char short_name, std::string_view long_name, std::string_view description, bool Target::* member
+) {
+	return {option{-1, short_name, arg_type::flag, long_name, description, none}, member, nullptr, 0};
+}
+
+/* kjc::bind(char shortarg, std::string_view longarg, std::string_view help, var, &T::member) - Value member */
+template<typename Target, typename T>
+constexpr bound_option<Target, T> bind(
+	char short_name, std::string_view long_name, std::string_view description, std::string_view var_name,
+	T Target::* member
+) {
+	static_assert(detail::is_bindable_value<T>, "Members must be int, long, double, std::string_view, bool or an enum");
+	return {option{-1, short_name, detail::bound_type<T>(), long_name, description, var_name}, member, nullptr, 0};
+}
+
+/* kjc::bind(char shortarg, std::string_view longarg, std::string_view help, var, &T::member, names) - Enum member */
+template<typename Target, typename E, std::size_t K>
+constexpr bound_option<Target, E> bind(
+	char short_name, std::string_view long_name, std::string_view description, std::string_view var_name,
+	E Target::* member, const enum_name<E> (&names)[K]
+) {
+	static_assert(std::is_enum_v<E>, "Only enum members take a list of names");
+	return {option{-1, short_name, arg_type::string, long_name, description, var_name}, member, names, K};
+}
+
+
+/* Compiled schema plus the members its options are bound to, build it with kjc::make_binding() */
+template<typename Target, typename... Ts>
+struct binding {
+	using schema_type = schema<sizeof...(Ts)>;
+	
+	schema_type options;
+	std::tuple<bound_option<Target, Ts>...> fields;
+	
+	/* Stores the value of an option event (whose id is the index of the bound option) in its member */
+	error_code apply(Target& target, const event& ev) const {
+		return dispatch<std::index_sequence_for<Ts...>>::table[ev.id](*this, target, ev);
+	}
+	
+	/* Prints " name1, name2, ..." for the enum names accepted by the option with the given id */
+	void print_choices(std::FILE* f, int id) const {
+		print_choices(f, id, std::index_sequence_for<Ts...>{});
+	}
+	
+private:
+	template<std::size_t... Is>
+	void print_choices(std::FILE* f, int id, std::index_sequence<Is...>) const {
+		((Is == (std::size_t)id ? print_names(f, std::get<Is>(fields)) : void()), ...);
+	}
+	
+	template<typename T>
+	static void print_names(std::FILE* f, const bound_option<Target, T>& field) {
+		for(std::size_t i = 0; i < field.name_count; i++) {
+			std::fprintf(f, "%s %.*s", i ? "," : "", (int)field.names[i].name.size(), field.names[i].name.data());
+		}
+	}
+	
+	using apply_fn = error_code (*)(const binding&, Target&, const event&);
+	
+	template<std::size_t I>
+	static error_code apply_one(const binding& b, Target& target, const event& ev) {
+		return detail::assign(target, std::get<I>(b.fields), ev);
+	}
+	
+	/* One instantiation of apply_one() per bound option, indexed by option id */
+	template<typename Indices>
+	struct dispatch;
+	
+	template<std::size_t... Is>
+	struct dispatch<std::index_sequence<Is...>> {
+		static constexpr apply_fn table[sizeof...(Is) ? sizeof...(Is) : 1] = {&apply_one<Is>...};
+	};
+};
+
+namespace detail {
+
+template<typename Target, typename... Ts, std::size_t... Is>
+constexpr binding<Target, Ts...> make_binding(
+	const config& cfg,
+	std::index_sequence<Is...>,
+	const bound_option<Target, Ts>&... opts
+) {
+	return binding<Target, Ts...>{
+		kjc::make_schema(cfg, with_id(opts.opt, (int)Is)...),
+		std::tuple<bound_option<Target, Ts>...>(opts...)
+	};
+}
+
+} /* namespace detail */
+
+/* kjc::make_binding(kjc::config cfg, bound options...) - Build a kjc::binding from a list of bound options */
+template<typename Target, typename... Ts>
+constexpr binding<Target, Ts...> make_binding(const config& cfg, const bound_option<Target, Ts>&... opts) {
+	return detail::make_binding(cfg, std::index_sequence_for<Ts...>{}, opts...);
+}
+
+/* kjc::make_binding(bound options...) - Build a kjc::binding with the default configuration */
+template<typename Target, typename T, typename... Ts>
+constexpr binding<Target, T, Ts...> make_binding(
+	const bound_option<Target, T>& first,
+	const bound_option<Target, Ts>&... opts
+) {
+	return make_binding(config{}, first, opts...);
+}
+
+
+/* Outcome of kjc::parse_into() */
+enum class parse_result {
+	ok,      /* All arguments were parsed */
+	help,    /* Help was requested and printed */
+	error,   /* An error message was printed */
+};
+
+namespace detail {
+
+template<typename Target, typename... Ts, typename Positional>
+parse_result parse_into(
+	const binding<Target, Ts...>& b,
+	Target& target,
+	parser<sizeof...(Ts)>& p,
+	Positional&& on_positional
+) {
+	for(event ev; p.next(ev); ) {
+		switch(ev.kind) {
+			case event_kind::option:
+				ev.error = b.apply(target, ev);
+				if(ev.error == error_code::none) {
+					break;
+				}
+				
+				p.print_error(ev);
+				if(ev.error == error_code::invalid_choice && p.stream()) {
+					/* Only enum members produce this error, so list the names they accept */
+					std::FILE* f = p.stream();
+					std::fprintf(f, "Valid choices:");
+					b.print_choices(f, ev.id);
+					std::fprintf(f, "\n");
+				}
+				return parse_result::error;
+			
+			case event_kind::positional:
+			case event_kind::other:
+				on_positional(ev.value);
+				break;
+			
+			case event_kind::help:
+				p.help();
+				return parse_result::help;
+			
+			case event_kind::error:
+				p.print_error(ev);
+				return parse_result::error;
+			
+			case event_kind::command:
+			case event_kind::end:
+				break;
+		}
+	}
+	return parse_result::ok;
+}
+
+} /* namespace detail */
+
+/* kjc::parse_into(binding, T& target, argc, argv, on_positional) - Parse all arguments into the members of target */
+template<typename Target, typename... Ts, typename Positional>
+parse_result parse_into(
+	const binding<Target, Ts...>& b,
+	Target& target,
+	int argc,
+	char** argv,
+	Positional&& on_positional
+) {
+	parser p(b.options, argc, argv);
+	return detail::parse_into(b, target, p, on_positional);
+}
+
+/* kjc::parse_into(binding, T& target, argc, argv) - Parse all arguments into the members of target */
+template<typename Target, typename... Ts>
+parse_result parse_into(const binding<Target, Ts...>& b, Target& target, int argc, char** argv) {
+	return parse_into(b, target, argc, argv, [](std::string_view) {});
+}
+
+/* kjc::parse_into(binding, T& target, args, count, on_positional) - Parse an array of std::string_view arguments */
+template<typename Target, typename... Ts, typename Positional>
+parse_result parse_into(
+	const binding<Target, Ts...>& b,
+	Target& target,
+	const std::string_view* args,
+	std::size_t count,
+	Positional&& on_positional
+) {
+	parser p(b.options, args, count);
+	return detail::parse_into(b, target, p, on_positional);
+}
+
+/* kjc::parse_into(binding, T& target, args, count) - Parse an array of std::string_view arguments */
+template<typename Target, typename... Ts>
+parse_result parse_into(const binding<Target, Ts...>& b, Target& target, const std::string_view* args, std::size_t count) {
+	return parse_into(b, target, args, count, [](std::string_view) {});
+}
+
+#ifdef __cpp_lib_span
+/* kjc::parse_into(binding, T& target, args, on_positional) - Parse a span of std::string_view arguments */
+template<typename Target, typename... Ts, typename Positional>
+parse_result parse_into(
+	const binding<Target, Ts...>& b,
+	Target& target,
+	std::span<const std::string_view> args,
+	Positional&& on_positional
+) {
+	return parse_into(b, target, args.data(), args.size(), on_positional);
+}
+
+/* kjc::parse_into(binding, T& target, args) - Parse a span of std::string_view arguments */
+template<typename Target, typename... Ts>
+parse_result parse_into(const binding<Target, Ts...>& b, Target& target, std::span<const std::string_view> args) {
+	return parse_into(b, target, args.data(), args.size());
+}
+#endif
+
+#ifdef __cpp_lib_coroutine
+/* Minimal std::generator stand-in (which not all standard libraries have yet), yielding references to T */
+template<typename T>
+class generator {
+public:
+	struct promise_type {
+		const T* value = nullptr;
+		
+		generator get_return_object() {
+			return generator(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		
+		std::suspend_always initial_suspend() noexcept {
+			return {};
+		}
+		
+		std::suspend_always final_suspend() noexcept {
+			return {};
+		}
+		
+		/* The yielded object lives in the suspended coroutine frame until it is resumed again */
+		std::suspend_always yield_value(const T& v) noexcept {
+			value = &v;
+			return {};
+		}
+		
+		void return_void() noexcept {}
+		
+		void unhandled_exception() {
+			throw;
+		}
+	};
+	
+	class iterator {
+	public:
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		
+		const T& operator*() const {
+			return *coro_.promise().value;
+		}
+		
+		iterator& operator++() {
+			coro_.resume();
+			return *this;
+		}
+		
+		void operator++(int) {
+			++*this;
+		}
+		
+		bool operator==(std::default_sentinel_t) const {
+			return coro_.done();
+		}
+	
+	private:
+		friend class generator;
+		
+		explicit iterator(std::coroutine_handle<promise_type> coro) : coro_(coro) {}
+		
+		std::coroutine_handle<promise_type> coro_;
+	};
+	
+	generator(generator&& other) noexcept : coro_(std::exchange(other.coro_, nullptr)) {}
+	generator(const generator&) = delete;
+	generator& operator=(const generator&) = delete;
+	
+	~generator() {
+		if(coro_) {
+			coro_.destroy();
+		}
+	}
+	
+	/* Runs the coroutine up to its first co_yield, so only call this once */
+	iterator begin() {
+		coro_.resume();
+		return iterator(coro_);
+	}
+	
+	std::default_sentinel_t end() const {
+		return {};
+	}
+	
+private:
+	explicit generator(std::coroutine_handle<promise_type> coro) : coro_(coro) {}
+	
+	std::coroutine_handle<promise_type> coro_;
+};
+
+/* kjc::events(kjc::parser& p) - Lazily yield the events of p, one per resumption */
+template<std::size_t N>
+generator<event> events(parser<N>& p) {
+	for(event ev; p.next(ev); ) {
+		co_yield ev;
+	}
+}
+#endif /* __cpp_lib_coroutine */
+
+} /* namespace kjc */
+
+#endif /* KJC_ARGPARSE_HPP */
@@ -0,0 +1,442 @@
+//
+//  kjc_argparse_schema.c
+//
+//  Created by Kevin Colley on 10/18/26.
+//  Copyright © 2026 Kevin Colley. All rights reserved.
+//
+
+#if !defined(_POSIX_C_SOURCE) && !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "kjc_argparse_schema.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#define KJC_SCHEMA_HAVE_ELF 1
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+#ifdef NDEBUG
+#define schema_assert(x) do { \
+	if(!(x)) { \
+		abort(); \
+	} \
+} while(0)
+#else /* NDEBUG */
+#define schema_assert assert
+#endif /* NDEBUG */
+
+
+static bool _schema_range_ok(size_t size, uint32_t offset, uint32_t count, size_t elem_size) {
+	if(offset > size) {
+		return false;
+	}
+	
+	return count <= (size - offset) / elem_size;
+}
+
+int kjc_schema_open(struct kjc_schema* schema, const void* data, size_t size) {
+	const struct kjc_schema_header* header = data;
+	
+	memset(schema, 0, sizeof(*schema));
+	
+	if(size < sizeof(*header) || ((uintptr_t)data & (sizeof(uint32_t) - 1)) != 0) {
+		return -1;
+	}
+	
+	if(memcmp(header->magic, KJC_SCHEMA_MAGIC, sizeof(header->magic)) != 0) {
+		return -1;
+	}
+	
+	if(header->version != KJC_SCHEMA_VERSION || header->byte_order != KJC_SCHEMA_BYTE_ORDER) {
+		return -1;
+	}
+	
+	/* The section may be padded, but never truncated */
+	if(header->size > size) {
+		return -1;
+	}
+	size = header->size;
+	
+	if(
+		!_schema_range_ok(size, header->nodes_offset, header->node_count, sizeof(struct kjc_schema_node))
+		|| !_schema_range_ok(size, header->args_offset, header->arg_count, sizeof(struct kjc_schema_arg))
+		|| !_schema_range_ok(size, header->choices_offset, header->choice_count, sizeof(uint32_t))
+		|| header->node_count == 0
+		|| (header->nodes_offset & 3) != 0
+		|| (header->args_offset & 3) != 0
+		|| (header->choices_offset & 3) != 0
+	) {
+		return -1;
+	}
+	
+	schema->data = data;
+	schema->size = size;
+	schema->header = header;
+	schema->nodes = (const struct kjc_schema_node*)&schema->data[header->nodes_offset];
+	schema->args = (const struct kjc_schema_arg*)&schema->data[header->args_offset];
+	schema->choices = (const uint32_t*)&schema->data[header->choices_offset];
+	
+	/* Check every node's arg range up front so accessors don't need to */
+	for(uint32_t i = 0; i < header->node_count; i++) {
+		const struct kjc_schema_node* node = &schema->nodes[i];
+		if(node->first_arg > header->arg_count || node->arg_count > header->arg_count - node->first_arg) {
+			return -1;
+		}
+		
+		if(i == 0 ? node->parent != KJC_SCHEMA_NONE : node->parent >= i) {
+			return -1;
+		}
+	}
+	
+	/* Same for the choices of every arg */
+	for(uint32_t i = 0; i < header->arg_count; i++) {
+		const struct kjc_schema_arg* arg = &schema->args[i];
+		if(arg->first_choice > header->choice_count || arg->choice_count > header->choice_count - arg->first_choice) {
+			return -1;
+		}
+	}
+	
+	/* The blob must end with a NUL so that no string can run off the end */
+	if(schema->data[size - 1] != '\0') {
+		return -1;
+	}
+	
+	return 0;
+}
+
+#ifdef KJC_SCHEMA_HAVE_ELF
+#if UINTPTR_MAX > 0xffffffffu
+typedef Elf64_Ehdr _schema_Ehdr;
+typedef Elf64_Shdr _schema_Shdr;
+#define _kSCHEMA_ELFCLASS ELFCLASS64
+#else
+typedef Elf32_Ehdr _schema_Ehdr;
+typedef Elf32_Shdr _schema_Shdr;
+#define _kSCHEMA_ELFCLASS ELFCLASS32
+#endif
+
+static const _schema_Shdr* _schema_find_section(const unsigned char* file, size_t size, const char* name) {
+	const _schema_Ehdr* ehdr = (const _schema_Ehdr*)file;
+	
+	if(size < sizeof(*ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0) {
+		return NULL;
+	}
+	
+	/* Only executables built for this machine's ELF class are supported */
+	if(ehdr->e_ident[EI_CLASS] != _kSCHEMA_ELFCLASS || ehdr->e_shentsize != sizeof(_schema_Shdr)) {
+		return NULL;
+	}
+	
+	if(ehdr->e_shoff > size || ehdr->e_shnum > (size - ehdr->e_shoff) / sizeof(_schema_Shdr)) {
+		return NULL;
+	}
+	
+	const _schema_Shdr* shdrs = (const _schema_Shdr*)&file[ehdr->e_shoff];
+	if(ehdr->e_shstrndx >= ehdr->e_shnum) {
+		return NULL;
+	}
+	
+	const _schema_Shdr* shstrtab = &shdrs[ehdr->e_shstrndx];
+	if(shstrtab->sh_offset > size || shstrtab->sh_size > size - shstrtab->sh_offset) {
+		return NULL;
+	}
+	
+	const char* names = (const char*)&file[shstrtab->sh_offset];
+	size_t name_len = strlen(name);
+	
+	for(unsigned i = 0; i < ehdr->e_shnum; i++) {
+		const _schema_Shdr* shdr = &shdrs[i];
+		if(shdr->sh_name >= shstrtab->sh_size || shstrtab->sh_size - shdr->sh_name <= name_len) {
+			continue;
+		}
+		
+		if(memcmp(&names[shdr->sh_name], name, name_len + 1) != 0) {
+			continue;
+		}
+		
+		if(shdr->sh_type == SHT_NOBITS || shdr->sh_offset > size || shdr->sh_size > size - shdr->sh_offset) {
+			return NULL;
+		}
+		
+		return shdr;
+	}
+	
+	return NULL;
+}
+#endif /* KJC_SCHEMA_HAVE_ELF */
+
+int kjc_schema_open_elf(struct kjc_schema* schema, const char* path) {
+	memset(schema, 0, sizeof(*schema));
+	
+#ifdef KJC_SCHEMA_HAVE_ELF
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0) {
+		return -1;
+	}
+	
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return -1;
+	}
+	
+	size_t size = (size_t)st.st_size;
+	void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(mapping == MAP_FAILED) {
+		return -1;
+	}
+	
+	const _schema_Shdr* shdr = _schema_find_section(mapping, size, KJC_SCHEMA_SECTION);
+	if(!shdr) {
+		munmap(mapping, size);
+		return -1;
+	}
+	
+	/* Linkers don't align the file offsets of non-loaded sections, so copy the blob if it's misaligned */
+	const unsigned char* data = (const unsigned char*)mapping + shdr->sh_offset;
+	void* copy = NULL;
+	if(((uintptr_t)data & (sizeof(uint32_t) - 1)) != 0) {
+		copy = malloc(shdr->sh_size);
+		if(!copy) {
+			munmap(mapping, size);
+			return -1;
+		}
+		
+		memcpy(copy, data, shdr->sh_size);
+		data = copy;
+	}
+	
+	if(kjc_schema_open(schema, data, shdr->sh_size) != 0) {
+		free(copy);
+		munmap(mapping, size);
+		memset(schema, 0, sizeof(*schema));
+		return -1;
+	}
+	
+	schema->mapping = mapping;
+	schema->mapping_size = size;
+	schema->copy = copy;
+	return 0;
+#else /* KJC_SCHEMA_HAVE_ELF */
+	(void)path;
+	return -1;
+#endif /* KJC_SCHEMA_HAVE_ELF */
+}
+
+void kjc_schema_close(struct kjc_schema* schema) {
+#ifdef KJC_SCHEMA_HAVE_ELF
+	if(schema->mapping) {
+		munmap(schema->mapping, schema->mapping_size);
+	}
+#endif /* KJC_SCHEMA_HAVE_ELF */
+	
+	free(schema->copy);
+	memset(schema, 0, sizeof(*schema));
+}
+
+const char* kjc_schema_string(const struct kjc_schema* schema, uint32_t offset) {
+	if(offset == 0 || offset >= schema->size) {
+		return NULL;
+	}
+	
+	return (const char*)&schema->data[offset];
+}
+
+uint32_t kjc_schema_find_child(const struct kjc_schema* schema, uint32_t node, const char* name) {
+	/* Children always come after their parent, so only look forward */
+	for(uint32_t i = node + 1; i < schema->header->node_count; i++) {
+		if(schema->nodes[i].parent != node) {
+			continue;
+		}
+		
+		const char* child_name = kjc_schema_string(schema, schema->nodes[i].name);
+		if(child_name && strcmp(child_name, name) == 0) {
+			return i;
+		}
+	}
+	
+	return KJC_SCHEMA_NONE;
+}
+
+const char* kjc_schema_choice(const struct kjc_schema* schema, const struct kjc_schema_arg* arg, uint32_t index) {
+	if(index >= arg->choice_count) {
+		return NULL;
+	}
+	
+	return kjc_schema_string(schema, schema->choices[arg->first_choice + index]);
+}
+
+
+void kjc_schema_writer_init(struct kjc_schema_writer* writer) {
+	memset(writer, 0, sizeof(*writer));
+}
+
+static void* _schema_grow(void* array, uint32_t* cap, uint32_t needed, size_t elem_size) {
+	if(needed <= *cap) {
+		return array;
+	}
+	
+	uint32_t new_cap = *cap ? *cap : 16;
+	while(new_cap < needed) {
+		new_cap *= 2;
+	}
+	
+	array = realloc(array, new_cap * elem_size);
+	schema_assert(array != NULL && "Allocation failure");
+	*cap = new_cap;
+	return array;
+}
+
+/* Returns the offset of the string within the string table plus one, or zero for NULL */
+static uint32_t _schema_writer_add_string(struct kjc_schema_writer* writer, const char* str) {
+	if(!str) {
+		return 0;
+	}
+	
+	uint32_t len = (uint32_t)strlen(str) + 1;
+	writer->strings = _schema_grow(writer->strings, &writer->strings_cap, writer->strings_size + len, 1);
+	
+	uint32_t offset = writer->strings_size;
+	memcpy(&writer->strings[offset], str, len);
+	writer->strings_size += len;
+	return offset + 1;
+}
+
+uint32_t kjc_schema_writer_add_node(
+	struct kjc_schema_writer* writer,
+	const char* name,
+	uint32_t parent,
+	const char* positional_usage,
+	const char* long_prefix,
+	uint32_t flags
+) {
+	schema_assert(parent == KJC_SCHEMA_NONE ? writer->node_count == 0 : parent < writer->node_count);
+	
+	writer->nodes = _schema_grow(writer->nodes, &writer->node_cap, writer->node_count + 1, sizeof(*writer->nodes));
+	
+	struct kjc_schema_node node = {0};
+	node.name = _schema_writer_add_string(writer, name);
+	node.parent = parent;
+	node.first_arg = writer->arg_count;
+	node.positional_usage = _schema_writer_add_string(writer, positional_usage);
+	node.long_prefix = _schema_writer_add_string(writer, long_prefix);
+	node.flags = flags;
+	
+	writer->nodes[writer->node_count] = node;
+	return writer->node_count++;
+}
+
+void kjc_schema_writer_add_arg(
+	struct kjc_schema_writer* writer,
+	char short_name,
+	const char* long_name,
+	const char* description,
+	const char* var_name,
+	unsigned char type
+) {
+	schema_assert(writer->node_count > 0);
+	
+	writer->args = _schema_grow(writer->args, &writer->arg_cap, writer->arg_count + 1, sizeof(*writer->args));
+	
+	struct kjc_schema_arg arg = {0};
+	arg.long_name = _schema_writer_add_string(writer, long_name);
+	arg.description = _schema_writer_add_string(writer, description);
+	arg.var_name = _schema_writer_add_string(writer, var_name);
+	arg.type = type;
+	arg.short_name = short_name;
+	arg.first_choice = writer->choice_count;
+	
+	writer->args[writer->arg_count++] = arg;
+	writer->nodes[writer->node_count - 1].arg_count++;
+}
+
+void kjc_schema_writer_add_choice(struct kjc_schema_writer* writer, const char* name) {
+	schema_assert(writer->arg_count > 0 && name != NULL);
+	
+	struct kjc_schema_arg* arg = &writer->args[writer->arg_count - 1];
+	schema_assert(arg->choice_count < UINT16_MAX && "Too many choices");
+	
+	writer->choices = _schema_grow(
+		writer->choices, &writer->choice_cap, writer->choice_count + 1, sizeof(*writer->choices)
+	);
+	writer->choices[writer->choice_count++] = _schema_writer_add_string(writer, name);
+	arg->choice_count++;
+}
+
+static uint32_t _schema_rebase(uint32_t offset, uint32_t strings_offset) {
+	return offset ? strings_offset + offset - 1 : 0;
+}
+
+void* kjc_schema_writer_finish(struct kjc_schema_writer* writer, size_t* size) {
+	struct kjc_schema_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, KJC_SCHEMA_MAGIC, sizeof(KJC_SCHEMA_MAGIC));
+	header.version = KJC_SCHEMA_VERSION;
+	header.byte_order = KJC_SCHEMA_BYTE_ORDER;
+	header.node_count = writer->node_count;
+	header.nodes_offset = sizeof(header);
+	header.arg_count = writer->arg_count;
+	header.args_offset = header.nodes_offset + writer->node_count * (uint32_t)sizeof(struct kjc_schema_node);
+	header.choice_count = writer->choice_count;
+	header.choices_offset = header.args_offset + writer->arg_count * (uint32_t)sizeof(struct kjc_schema_arg);
+	
+	uint32_t strings_offset = header.choices_offset + writer->choice_count * (uint32_t)sizeof(uint32_t);
+	
+	/* Always end with a NUL byte, even when there are no strings at all */
+	header.size = strings_offset + writer->strings_size + 1;
+	
+	unsigned char* blob = calloc(1, header.size);
+	schema_assert(blob != NULL && "Allocation failure");
+	
+	/* Turn string table offsets into blob offsets */
+	for(uint32_t i = 0; i < writer->node_count; i++) {
+		writer->nodes[i].name = _schema_rebase(writer->nodes[i].name, strings_offset);
+		writer->nodes[i].positional_usage = _schema_rebase(writer->nodes[i].positional_usage, strings_offset);
+		writer->nodes[i].long_prefix = _schema_rebase(writer->nodes[i].long_prefix, strings_offset);
+	}
+	for(uint32_t i = 0; i < writer->arg_count; i++) {
+		writer->args[i].long_name = _schema_rebase(writer->args[i].long_name, strings_offset);
+		writer->args[i].description = _schema_rebase(writer->args[i].description, strings_offset);
+		writer->args[i].var_name = _schema_rebase(writer->args[i].var_name, strings_offset);
+	}
+	for(uint32_t i = 0; i < writer->choice_count; i++) {
+		writer->choices[i] = _schema_rebase(writer->choices[i], strings_offset);
+	}
+	
+	memcpy(blob, &header, sizeof(header));
+	if(writer->node_count) {
+		memcpy(&blob[header.nodes_offset], writer->nodes, writer->node_count * sizeof(*writer->nodes));
+	}
+	if(writer->arg_count) {
+		memcpy(&blob[header.args_offset], writer->args, writer->arg_count * sizeof(*writer->args));
+	}
+	if(writer->choice_count) {
+		memcpy(&blob[header.choices_offset], writer->choices, writer->choice_count * sizeof(*writer->choices));
+	}
+	if(writer->strings_size) {
+		memcpy(&blob[strings_offset], writer->strings, writer->strings_size);
+	}
+	
+	free(writer->nodes);
+	free(writer->args);
+	free(writer->choices);
+	free(writer->strings);
+	memset(writer, 0, sizeof(*writer));
+	
+	*size = header.size;
+	return blob;
+}
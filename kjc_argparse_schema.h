@@ -0,0 +1,198 @@
+//
+//  kjc_argparse_schema.h
+//
+//  Created by Kevin Colley on 10/18/26.
+//  Copyright © 2026 Kevin Colley. All rights reserved.
+//
+
+#ifndef KJC_ARGPARSE_SCHEMA_H
+#define KJC_ARGPARSE_SCHEMA_H
+
+/*
+ * Serialized option schema, as embedded in the ".kjc_argparse" ELF section.
+ *
+ * The blob is position independent: every reference is a 32-bit offset from the start of the
+ * blob, so it can be mmapped straight out of an executable and used without any relocation.
+ * Offset 0 is always the header, so a string offset of 0 means "no string" (NULL).
+ *
+ * Layout (version 2):
+ *   struct kjc_schema_header                       (at offset 0)
+ *   struct kjc_schema_node[header.node_count]      (at header.nodes_offset)
+ *   struct kjc_schema_arg[header.arg_count]        (at header.args_offset)
+ *   uint32_t[header.choice_count]                  (at header.choices_offset, string offsets)
+ *   NUL-terminated strings                         (referenced by offset)
+ *
+ * Node 0 is the root ARGPARSE block. Every other node is a subcommand (ARG_COMMAND), and its
+ * parent is the node in which that subcommand was declared. The args of a node are contiguous
+ * and appear in declaration order. Subcommands are also listed as args of type COMMAND in
+ * their parent node. The choices of an ARG_CHOICE arg are likewise contiguous and in order.
+ *
+ * Public API:
+ * - int kjc_schema_open(struct kjc_schema* schema, const void* data, size_t size) - Validate an in-memory blob
+ * - int kjc_schema_open_elf(struct kjc_schema* schema, const char* path) - Map the schema section of an executable
+ * - void kjc_schema_close(struct kjc_schema* schema) - Unmap a schema opened with kjc_schema_open_elf
+ * - const char* kjc_schema_string(const struct kjc_schema* schema, uint32_t offset) - Resolve a string offset
+ * - uint32_t kjc_schema_find_child(const struct kjc_schema* schema, uint32_t node, const char* name) - Find subcommand
+ * - const char* kjc_schema_choice(const struct kjc_schema* schema, const struct kjc_schema_arg* arg, uint32_t index)
+ *   - Name of one of the choices of an ARG_CHOICE arg
+ *
+ * Writer API (used by the ARGPARSE_WITH_SCHEMA build mode and tools/kjc_argparse_schema.c):
+ * - void kjc_schema_writer_init(struct kjc_schema_writer* writer) - Start building a new blob
+ * - uint32_t kjc_schema_writer_add_node(writer, name, parent, positional_usage, long_prefix, flags) - Append a node
+ * - void kjc_schema_writer_add_arg(writer, short_name, long_name, description, var_name, type) - Append an arg
+ * - void kjc_schema_writer_add_choice(writer, name) - Append a choice to the last arg
+ * - void* kjc_schema_writer_finish(struct kjc_schema_writer* writer, size_t* size) - Produce the blob (free() it)
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Name of the ELF section holding the serialized schema */
+#define KJC_SCHEMA_SECTION ".kjc_argparse"
+
+/* Magic bytes at the start of the blob, including the terminating NUL */
+#define KJC_SCHEMA_MAGIC "KJCARGS"
+
+/* Bumped whenever the layout of the blob changes incompatibly */
+#define KJC_SCHEMA_VERSION 2
+
+/* Written in the native byte order, so readers can reject blobs from a foreign machine */
+#define KJC_SCHEMA_BYTE_ORDER 0x01020304u
+
+/* Used for the parent of the root node and for failed lookups */
+#define KJC_SCHEMA_NONE 0xffffffffu
+
+/* In the ARGPARSE_WITH_SCHEMA build mode, a program started with this marker and a path as its first argument writes */
+/* the schema of the argparse context reached by its other arguments to that path and exits */
+#define KJC_SCHEMA_DUMP_ARG "--kjc-argparse-schema-out="
+
+
+struct kjc_schema_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t size;
+	uint32_t node_count;
+	uint32_t nodes_offset;
+	uint32_t arg_count;
+	uint32_t args_offset;
+	uint32_t choice_count;
+	uint32_t choices_offset;
+};
+
+/* Flags is a combination of the KJC_SCHEMA_NODE_* values */
+struct kjc_schema_node {
+	uint32_t name;
+	uint32_t parent;
+	uint32_t first_arg;
+	uint32_t arg_count;
+	uint32_t positional_usage;
+	uint32_t long_prefix;
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+/* Mirrors of the configuration flags that change which arguments a node accepts */
+#define KJC_SCHEMA_NODE_AUTO_HELP    (1 << 0)
+#define KJC_SCHEMA_NODE_DASHDASH     (1 << 1)
+#define KJC_SCHEMA_NODE_SHORTGROUPS  (1 << 2)
+
+/* Type is one of the _kARG_TYPE_* values from kjc_argparse.h, only _kARG_TYPE_CHOICE args have choices */
+struct kjc_schema_arg {
+	uint32_t long_name;
+	uint32_t description;
+	uint32_t var_name;
+	uint8_t type;
+	char short_name;
+	uint16_t choice_count;
+	uint32_t first_choice;
+};
+
+
+/* Read-only view of a validated schema blob */
+struct kjc_schema {
+	const unsigned char* data;
+	size_t size;
+	const struct kjc_schema_header* header;
+	const struct kjc_schema_node* nodes;
+	const struct kjc_schema_arg* args;
+	const uint32_t* choices;
+	void* mapping;
+	size_t mapping_size;
+	void* copy;
+};
+
+/* Validate an in-memory schema blob, returns 0 on success or -1 if it is malformed */
+int kjc_schema_open(struct kjc_schema* schema, const void* data, size_t size);
+
+/* Map an ELF executable and open the schema in its .kjc_argparse section, returns 0 on success or -1 */
+int kjc_schema_open_elf(struct kjc_schema* schema, const char* path);
+
+/* Release the resources held by a schema from kjc_schema_open_elf (harmless for kjc_schema_open) */
+void kjc_schema_close(struct kjc_schema* schema);
+
+/* Resolve a string offset, returns NULL for offset 0 */
+const char* kjc_schema_string(const struct kjc_schema* schema, uint32_t offset);
+
+/* Find the subcommand node with the given name under a node, or KJC_SCHEMA_NONE */
+uint32_t kjc_schema_find_child(const struct kjc_schema* schema, uint32_t node, const char* name);
+
+/* Name of the choice at index (below arg->choice_count) of an ARG_CHOICE arg */
+const char* kjc_schema_choice(const struct kjc_schema* schema, const struct kjc_schema_arg* arg, uint32_t index);
+
+
+/* Growable storage used while building a schema blob */
+struct kjc_schema_writer {
+	struct kjc_schema_node* nodes;
+	struct kjc_schema_arg* args;
+	uint32_t* choices;
+	char* strings;
+	uint32_t node_count;
+	uint32_t node_cap;
+	uint32_t arg_count;
+	uint32_t arg_cap;
+	uint32_t choice_count;
+	uint32_t choice_cap;
+	uint32_t strings_size;
+	uint32_t strings_cap;
+};
+
+/* Start building a new schema blob */
+void kjc_schema_writer_init(struct kjc_schema_writer* writer);
+
+/* Append a node (args added afterwards belong to it), returns its index */
+uint32_t kjc_schema_writer_add_node(
+	struct kjc_schema_writer* writer,
+	const char* name,
+	uint32_t parent,
+	const char* positional_usage,
+	const char* long_prefix,
+	uint32_t flags
+);
+
+/* Append an arg to the most recently added node */
+void kjc_schema_writer_add_arg(
+	struct kjc_schema_writer* writer,
+	char short_name,
+	const char* long_name,
+	const char* description,
+	const char* var_name,
+	unsigned char type
+);
+
+/* Append a choice to the most recently added arg */
+void kjc_schema_writer_add_choice(struct kjc_schema_writer* writer, const char* name);
+
+/* Lay out the final blob and release the writer's storage, the result must be passed to free() */
+void* kjc_schema_writer_finish(struct kjc_schema_writer* writer, size_t* size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KJC_ARGPARSE_SCHEMA_H */
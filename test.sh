@@ -2,7 +2,6 @@
 
 script_dir="${BASH_SOURCE%/*}"
 prog_dir="$script_dir/examples"
-prog="$prog_dir/full_example"
 
 function run {
 	echo "$@"
@@ -10,6 +9,8 @@ function run {
 }
 
 function run_tests {
+	local prog="$1"
+	
 	run $prog
 	
 	run $prog --help
@@ -73,8 +74,346 @@ function run_tests {
 	run $prog --=test
 }
 
-run_tests >$prog_dir/full_out.actual 2>$prog_dir/full_err.actual
-diff $prog_dir/full_out.{expected,actual} && \
-	diff $prog_dir/full_err.{expected,actual} && \
+function run_bind_tests {
+	local prog="$1"
+	
+	run $prog
+	
+	run $prog --help
+	
+	run $prog -v -u http://example.com -j 4 a.json b.json
+	
+	run $prog --jobs=8 --max-bytes=0x1000 --timeout 2.5 --format json
+	
+	run $prog -vj 2
+	
+	run $prog -j 4096x
+	
+	run $prog -j 99999999999
+	
+	run $prog --max-bytes 99999999999
+	
+	run $prog -t 1e-3
+	
+	run $prog -t fast
+	
+	run $prog -f xml
+	
+	run $prog --verbose=yes
+	
+	run $prog -- -v
+}
+
+function run_coro_tests {
+	local prog="$1"
+	
+	run $prog
+	
+	run $prog --help
+	
+	run $prog -i a.txt -j 4 b.txt --input=c.txt
+	
+	run $prog -v -i a.txt -j
+	
+	run $prog -i a.txt -j 2 -i b.txt --bogus -i c.txt
+	
+	run $prog a.txt convert --format png
+	
+	run $prog a.txt convert -f
+	
+	run $prog convert --help
+}
+
+function run_plugin_tests {
+	local prog="$1"
+	
+	run $prog
+	
+	run $prog --help
+	
+	run $prog -v --plugins --level 9
+	
+	run $prog --fast --level 9
+	
+	run $prog -l
+	
+	run $prog --bogus
+	
+	run $prog -v upload --url http://example.com -r 3
+	
+	run $prog upload
+	
+	run $prog upload --help
+	
+	run $prog upload --level 3
+}
+
+function run_batch_tests {
+	local prog="$1"
+	
+	run $prog
+	
+	run $prog --help
+	
+	run $prog a.json b.json c.json
+	
+	run $prog -v a.json - b.json -v c.json
+	
+	run $prog a.json --verbose b.json --bogus c.json
+	
+	run $prog a.json b.json stats c.json
+	
+	run $prog -v a.json -- -v stats --help
+	
+	run $prog -v --
+	
+	run $prog -v a.json -- --
+}
+
+function run_defer_tests {
+	local prog="$1"
+	
+	run $prog
+	
+	run $prog --help
+	
+	run $prog -r localhost -r example.com --resolve=router
+	
+	run $prog -m one -m two -m three -m four
+	
+	run $prog -r router -m one -r localhost -m two
+	
+	run $prog -r nowhere -r localhost -r elsewhere.invalid
+	
+	run $prog -m one -m broken -m three
+	
+	run $prog -r localhost -r
+}
+
+function run_error_tests {
+	local prog="$1"
+	
+	run $prog
+	
+	run $prog --help
+	
+	run $prog -o out.txt -j 4
+	
+	run $prog -o out.txt -qz stray --quiet=yes
+	
+	run $prog -o out.txt -j 4x
+	
+	run $prog -o out.txt --jobs=0x1g
+	
+	run $prog -o out.txt -qj
+	
+	run $prog -j
+	
+	run $prog -q -j 2
+	
+	run $prog -o out.txt -v -q
+}
+
+function run_choice_tests {
+	local prog="$1"
+	
+	run $prog
+	
+	run $prog --help
+	
+	run $prog --mode fast -r eu-west-3
+	
+	run $prog -m paranoid --region=ap-southeast-7
+	
+	run $prog --mode=reckless
+	
+	run $prog -r us-east
+	
+	run $prog -r us-east-11
+	
+	run $prog -m
+}
+
+function run_global_tests {
+	local prog="$1"
+	
+	run $prog --help
+	
+	run $prog status --help
+	
+	run $prog remote add --help
+	
+	run $prog -v status
+	
+	run $prog status -s --config=work.rc -v src lib
+	
+	run $prog status -s src --config=work.rc -v lib
+	
+	run $prog remote add -C /etc/vcsrc origin https://example.com/repo.git -v --fetch
+	
+	run $prog remote -q add origin url
+	
+	run $prog remote add -vq origin url
+	
+	run $prog remote add -vs origin url
+	
+	run $prog status -- -v
+	
+	run $prog status --config
+	
+	run $prog commit -m -v
+	
+	run $prog commit --message -v
+	
+	run $prog commit -m fix -v
+	
+	run $prog commit --message=fix -C work.rc
+	
+	run $prog commit --amend -v
+}
+
+function run_slice_tests {
+	local prog="$1"
+	
+	run $prog
+	
+	run $prog --help
+	
+	run $prog -T hello --title=hi= -a Ann intro body
+	
+	run $prog --title=Notes -- -v intro
+	
+	run $prog -T
+}
+
+function run_kv_tests {
+	local prog="$1"
+	
+	run $prog
+	
+	run $prog --help
+	
+	run $prog -D log.level=debug -Dcache.dir=/tmp/cache --define=empty= -L team=infra
+	
+	run $prog -D a=1 -D b=2 -D a=3 -D c=x=y
+	
+	run $prog -L team=infra --label owner=ops -L team=web
+	
+	run $prog -D novalue
+	
+	run $prog -Dnovalue
+	
+	run $prog -D
+}
+
+function run_replay_tests {
+	local prog="$1"
+	
+	run $prog
+	
+	run $prog --help
+	
+	run $prog -w 2 -l :80 -m safe -D a=1 -Db=2 --header X-Trace on -v -- -v docs
+	
+	run $prog -w 1 --define=path=/a=b -vv static assets
+	
+	run $prog -w 1 --header X-Trace
+	
+	run $prog -w 1 -m slow
+	
+	run env KJC_ARGPARSE_REPLAY_FD=not-a-fd $prog -w 1 -l :8080
+	
+	run $prog -w 2 -d 2 -m fast -D a=1 -v
+	
+	run env WORKER_ARG=-v $prog -w 1
+}
+
+function run_static_tests {
+	local prog="$1"
+	
+	run $prog
+	
+	run $prog --help
+	
+	run $prog -ic -C 3 -e foo a.txt b.txt
+	
+	run $prog --regexp=foo --context=2 --quiet --count -- -e
+	
+	run $prog -qcefoo -C2 a.txt
+	
+	run $prog --context=x -e foo
+	
+	run $prog -e foo -x
+	
+	run $prog explain -v --syntax extended 'a+b'
+	
+	run $prog explain --help
+}
+
+function run_help_tests {
+	local prog="$1"
+	
+	run $prog --help
+	
+	run $prog --help=warnings
+	
+	run $prog --help=DEBUG
+	
+	run $prog --help=--warn
+	
+	run $prog --help=commands
+	
+	run $prog --help=optimization
+	
+	run $prog --help=nothing-here
+	
+	run $prog preprocess --help=verbose
+	
+	run $prog -O 2 -c x.c --warn-all -v
+}
+
+function run_profile_tests {
+	local prog="$1"
+	
+	run $prog
+	
+	run $prog -c app.conf -p a -p b -v migrate -n
+	
+	run $prog --trace /dev/null -c app.conf
+	
+	run $prog --trace /nonexistent/trace.json -c app.conf
+	
+	run $prog --help
+}
+
+# Usage: check_prog <expected output prefix> <example program> [test function]
+function check_prog {
+	local name="$1"
+	local prog="$prog_dir/$2"
+	local tests="${3:-run_tests}"
+	
+	$tests $prog >$prog_dir/${name}_out.actual 2>$prog_dir/${name}_err.actual
+	diff $prog_dir/${name}_out.{expected,actual} && \
+		diff $prog_dir/${name}_err.{expected,actual}
+}
+
+# The C++ and pull API ports of full_example must behave exactly like the original
+check_prog full full_example && \
+	check_prog cpp cpp_example && \
+	check_prog pull pull_example && \
+	check_prog bind bind_example run_bind_tests && \
+	check_prog coro coro_example run_coro_tests && \
+	check_prog plugin plugin_example run_plugin_tests && \
+	check_prog batch batch_example run_batch_tests && \
+	check_prog defer defer_example run_defer_tests && \
+	check_prog error error_example run_error_tests && \
+	check_prog choice choice_example run_choice_tests && \
+	check_prog slice slice_example run_slice_tests && \
+	check_prog kv kv_example run_kv_tests && \
+	check_prog global global_example run_global_tests && \
+	check_prog replay replay_example run_replay_tests && \
+	check_prog static static_example run_static_tests && \
+	check_prog help help_example run_help_tests && \
+	check_prog profile profile_example run_profile_tests && \
 	echo "All tests passed!" || \
 	echo "Tests failed."
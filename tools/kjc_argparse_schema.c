@@ -0,0 +1,516 @@
+//
+//  kjc_argparse_schema.c
+//
+//  Created by Kevin Colley on 10/18/26.
+//  Copyright © 2026 Kevin Colley. All rights reserved.
+//
+
+/*
+ * Build-time and introspection tool for the ".kjc_argparse" schema section.
+ *
+ * $ kjc_argparse_schema embed ./prog
+ *     Runs ./prog (which must be built with ARGPARSE_WITH_SCHEMA) once per subcommand to collect its
+ *     option schema, then stores the result in the .kjc_argparse section of ./prog using objcopy.
+ *
+ * $ kjc_argparse_schema dump ./prog
+ *     Prints the embedded schema tree without executing ./prog.
+ *
+ * $ kjc_argparse_schema complete ./prog [words...]
+ *     Prints completion candidates for the last word, which may be empty, without executing ./prog. After an
+ *     ARG_CHOICE option, the candidates are its choices.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "kjc_argparse.h"
+#include "kjc_argparse_schema.h"
+
+
+/* Deepest subcommand nesting that will be explored by `embed` */
+#define SCHEMA_MAX_DEPTH 32
+
+
+static int make_temp_file(char* path, size_t path_size) {
+	const char* tmpdir = getenv("TMPDIR");
+	if(!tmpdir || *tmpdir == '\0') {
+		tmpdir = "/tmp";
+	}
+	
+	snprintf(path, path_size, "%s/kjc_argparse_schema.XXXXXX", tmpdir);
+	return mkstemp(path);
+}
+
+static void* read_file(const char* path, size_t* size) {
+	FILE* fp = fopen(path, "rb");
+	if(!fp) {
+		return NULL;
+	}
+	
+	size_t cap = 4096, len = 0;
+	unsigned char* data = malloc(cap);
+	while(data) {
+		len += fread(&data[len], 1, cap - len, fp);
+		if(len < cap) {
+			break;
+		}
+		
+		cap *= 2;
+		unsigned char* grown = realloc(data, cap);
+		if(!grown) {
+			free(data);
+		}
+		data = grown;
+	}
+	
+	if(ferror(fp)) {
+		free(data);
+		data = NULL;
+	}
+	fclose(fp);
+	
+	*size = len;
+	return data;
+}
+
+/* Run the program with the given subcommand path, asking it to write its schema to out_path */
+static int run_schema_dump(const char* prog, char** path, int depth, const char* out_path) {
+	char marker[4096 + sizeof(KJC_SCHEMA_DUMP_ARG)];
+	snprintf(marker, sizeof(marker), "%s%s", KJC_SCHEMA_DUMP_ARG, out_path);
+	
+	char* child_argv[SCHEMA_MAX_DEPTH + 3];
+	child_argv[0] = (char*)prog;
+	child_argv[1] = marker;
+	for(int i = 0; i < depth; i++) {
+		child_argv[i + 2] = path[i];
+	}
+	child_argv[depth + 2] = NULL;
+	
+	pid_t pid = fork();
+	if(pid < 0) {
+		return -1;
+	}
+	
+	if(pid == 0) {
+		/* Keep stderr so that failures are visible, but don't let the program interact with anything else */
+		int devnull = open("/dev/null", O_RDWR);
+		if(devnull >= 0) {
+			dup2(devnull, STDIN_FILENO);
+			dup2(devnull, STDOUT_FILENO);
+			close(devnull);
+		}
+		
+		execv(prog, child_argv);
+		_exit(127);
+	}
+	
+	int status = 0;
+	while(waitpid(pid, &status, 0) < 0) {
+		if(errno != EINTR) {
+			return -1;
+		}
+	}
+	
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static int collect_node(
+	struct kjc_schema_writer* writer,
+	const char* prog,
+	char** path,
+	int depth,
+	uint32_t parent
+) {
+	char tmp_path[4096];
+	int fd = make_temp_file(tmp_path, sizeof(tmp_path));
+	if(fd < 0) {
+		perror("mkstemp");
+		return -1;
+	}
+	close(fd);
+	
+	/* Programs that don't write a schema leave the temporary file empty */
+	size_t size = 0;
+	void* blob = NULL;
+	if(run_schema_dump(prog, path, depth, tmp_path) == 0) {
+		blob = read_file(tmp_path, &size);
+	}
+	unlink(tmp_path);
+	
+	const char* name = depth > 0 ? path[depth - 1] : NULL;
+	struct kjc_schema node_schema;
+	if(!blob || kjc_schema_open(&node_schema, blob, size) != 0) {
+		free(blob);
+		
+		if(depth == 0) {
+			fprintf(stderr, "Error: %s didn't produce a schema, was it built with ARGPARSE_WITH_SCHEMA?\n", prog);
+			return -1;
+		}
+		
+		/* Subcommand handlers don't have to start a nested argparse block */
+		kjc_schema_writer_add_node(writer, name, parent, NULL, NULL, 0);
+		return 0;
+	}
+	
+	const struct kjc_schema_node* src = &node_schema.nodes[0];
+	uint32_t node = kjc_schema_writer_add_node(
+		writer,
+		name,
+		parent,
+		kjc_schema_string(&node_schema, src->positional_usage),
+		kjc_schema_string(&node_schema, src->long_prefix),
+		src->flags
+	);
+	
+	for(uint32_t i = 0; i < src->arg_count; i++) {
+		const struct kjc_schema_arg* arg = &node_schema.args[src->first_arg + i];
+		kjc_schema_writer_add_arg(
+			writer,
+			arg->short_name,
+			kjc_schema_string(&node_schema, arg->long_name),
+			kjc_schema_string(&node_schema, arg->description),
+			kjc_schema_string(&node_schema, arg->var_name),
+			arg->type
+		);
+		
+		for(uint32_t j = 0; j < arg->choice_count; j++) {
+			kjc_schema_writer_add_choice(writer, kjc_schema_choice(&node_schema, arg, j));
+		}
+	}
+	
+	/* Nodes must be contiguous in the writer, so only recurse after this node's args are all added */
+	int ret = 0;
+	for(uint32_t i = 0; i < src->arg_count && ret == 0; i++) {
+		const struct kjc_schema_arg* arg = &node_schema.args[src->first_arg + i];
+		if(arg->type != _kARG_TYPE_COMMAND) {
+			continue;
+		}
+		
+		if(depth >= SCHEMA_MAX_DEPTH) {
+			fprintf(stderr, "Error: Subcommands of %s are nested too deeply\n", prog);
+			ret = -1;
+			break;
+		}
+		
+		path[depth] = (char*)kjc_schema_string(&node_schema, arg->long_name);
+		ret = collect_node(writer, prog, path, depth + 1, node);
+	}
+	
+	free(blob);
+	return ret;
+}
+
+static int embed_schema(const char* prog) {
+	struct kjc_schema_writer writer;
+	char* path[SCHEMA_MAX_DEPTH];
+	
+	kjc_schema_writer_init(&writer);
+	if(collect_node(&writer, prog, path, 0, KJC_SCHEMA_NONE) != 0) {
+		size_t size;
+		free(kjc_schema_writer_finish(&writer, &size));
+		return -1;
+	}
+	
+	size_t size = 0;
+	void* blob = kjc_schema_writer_finish(&writer, &size);
+	
+	char tmp_path[4096];
+	int fd = make_temp_file(tmp_path, sizeof(tmp_path));
+	if(fd < 0) {
+		perror("mkstemp");
+		free(blob);
+		return -1;
+	}
+	
+	bool ok = write(fd, blob, size) == (ssize_t)size;
+	close(fd);
+	free(blob);
+	
+	int ret = -1;
+	if(ok) {
+		const char* objcopy = getenv("OBJCOPY");
+		if(!objcopy || *objcopy == '\0') {
+			objcopy = "objcopy";
+		}
+		
+		/* Replace any existing schema, and keep the section out of the loaded image */
+		char section_arg[4200];
+		snprintf(section_arg, sizeof(section_arg), "%s=%s", KJC_SCHEMA_SECTION, tmp_path);
+		char* objcopy_argv[] = {
+			(char*)objcopy,
+			"--remove-section", KJC_SCHEMA_SECTION,
+			"--add-section", section_arg,
+			"--set-section-flags", KJC_SCHEMA_SECTION "=contents,readonly",
+			(char*)prog,
+			NULL
+		};
+		
+		pid_t pid = fork();
+		if(pid == 0) {
+			execvp(objcopy, objcopy_argv);
+			_exit(127);
+		}
+		
+		int status = 0;
+		if(pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+			ret = 0;
+		}
+		else {
+			fprintf(stderr, "Error: %s failed to add the %s section to %s\n", objcopy, KJC_SCHEMA_SECTION, prog);
+		}
+	}
+	
+	unlink(tmp_path);
+	return ret;
+}
+
+static void dump_node(const struct kjc_schema* schema, uint32_t node_index, int depth) {
+	const struct kjc_schema_node* node = &schema->nodes[node_index];
+	const char* prefix = kjc_schema_string(schema, node->long_prefix);
+	const char* name = kjc_schema_string(schema, node->name);
+	const char* usage = kjc_schema_string(schema, node->positional_usage);
+	
+	printf("%*s%s", depth * 2, "", name ? name : "(root)");
+	if(usage) {
+		printf(" %s", usage);
+	}
+	printf("\n");
+	
+	for(uint32_t i = 0; i < node->arg_count; i++) {
+		const struct kjc_schema_arg* arg = &schema->args[node->first_arg + i];
+		const char* long_name = kjc_schema_string(schema, arg->long_name);
+		const char* var_name = kjc_schema_string(schema, arg->var_name);
+		const char* description = kjc_schema_string(schema, arg->description);
+		
+		if(arg->type == _kARG_TYPE_COMMAND) {
+			uint32_t child = kjc_schema_find_child(schema, node_index, long_name);
+			if(child != KJC_SCHEMA_NONE) {
+				dump_node(schema, child, depth + 1);
+			}
+			continue;
+		}
+		
+		printf("%*s", depth * 2 + 2, "");
+		if(arg->short_name != '\0') {
+			printf("-%c", arg->short_name);
+			if(long_name) {
+				printf(", ");
+			}
+		}
+		if(long_name) {
+			printf("%s%s", prefix ? prefix : "--", long_name);
+		}
+		if(var_name) {
+			printf(" <%s>", var_name);
+		}
+		if(description) {
+			printf("   %s", description);
+		}
+		printf("\n");
+		
+		if(arg->choice_count != 0) {
+			printf("%*s{", depth * 2 + 4, "");
+			for(uint32_t j = 0; j < arg->choice_count; j++) {
+				printf("%s%s", j ? ", " : "", kjc_schema_choice(schema, arg, j));
+			}
+			printf("}\n");
+		}
+	}
+}
+
+/* True if the option spelled as prefix followed by name could be what the partial word is becoming */
+static bool option_matches(const char* prefix, const char* name, const char* partial) {
+	size_t prefix_len = strlen(prefix);
+	size_t partial_len = strlen(partial);
+	
+	if(partial_len <= prefix_len) {
+		return strncmp(prefix, partial, partial_len) == 0;
+	}
+	
+	return strncmp(prefix, partial, prefix_len) == 0
+		&& strncmp(name, &partial[prefix_len], partial_len - prefix_len) == 0;
+}
+
+/* The ARG_CHOICE option of a node that's spelled exactly as word, or NULL */
+static const struct kjc_schema_arg* find_choice_option(
+	const struct kjc_schema* schema,
+	const struct kjc_schema_node* node,
+	const char* prefix,
+	const char* word
+) {
+	size_t prefix_len = strlen(prefix);
+	for(uint32_t i = 0; i < node->arg_count; i++) {
+		const struct kjc_schema_arg* arg = &schema->args[node->first_arg + i];
+		if(arg->type != _kARG_TYPE_CHOICE) {
+			continue;
+		}
+		
+		const char* long_name = kjc_schema_string(schema, arg->long_name);
+		if(
+			(long_name && strncmp(word, prefix, prefix_len) == 0 && strcmp(&word[prefix_len], long_name) == 0)
+			|| (arg->short_name != '\0' && word[0] == '-' && word[1] == arg->short_name && word[2] == '\0')
+		) {
+			return arg;
+		}
+	}
+	
+	return NULL;
+}
+
+static void complete_words(const struct kjc_schema* schema, char** words, int word_count) {
+	uint32_t node_index = 0;
+	const char* partial = word_count > 0 ? words[word_count - 1] : "";
+	
+	/* Every complete word that names a subcommand descends into it */
+	for(int i = 0; i < word_count - 1; i++) {
+		uint32_t child = kjc_schema_find_child(schema, node_index, words[i]);
+		if(child != KJC_SCHEMA_NONE) {
+			node_index = child;
+		}
+	}
+	
+	const struct kjc_schema_node* node = &schema->nodes[node_index];
+	const char* prefix = kjc_schema_string(schema, node->long_prefix);
+	if(!prefix) {
+		prefix = "--";
+	}
+	
+	/* The value of an ARG_CHOICE option is one of its choices */
+	const struct kjc_schema_arg* choice_arg = NULL;
+	if(word_count > 1) {
+		choice_arg = find_choice_option(schema, node, prefix, words[word_count - 2]);
+	}
+	if(choice_arg) {
+		for(uint32_t i = 0; i < choice_arg->choice_count; i++) {
+			const char* choice = kjc_schema_choice(schema, choice_arg, i);
+			if(option_matches("", choice, partial)) {
+				printf("%s\n", choice);
+			}
+		}
+		return;
+	}
+	
+	/* The automatic help option is only used when "help" isn't declared explicitly */
+	bool auto_help = !!(node->flags & KJC_SCHEMA_NODE_AUTO_HELP);
+	
+	for(uint32_t i = 0; i < node->arg_count; i++) {
+		const struct kjc_schema_arg* arg = &schema->args[node->first_arg + i];
+		const char* long_name = kjc_schema_string(schema, arg->long_name);
+		
+		if(arg->type == _kARG_TYPE_COMMAND) {
+			if(option_matches("", long_name, partial)) {
+				printf("%s\n", long_name);
+			}
+		}
+		else if(long_name) {
+			if(strcmp(long_name, "help") == 0) {
+				auto_help = false;
+			}
+			
+			if(option_matches(prefix, long_name, partial)) {
+				printf("%s%s\n", prefix, long_name);
+			}
+		}
+		else if(option_matches("-", (char[]){arg->short_name, '\0'}, partial)) {
+			printf("-%c\n", arg->short_name);
+		}
+	}
+	
+	if(auto_help && option_matches(prefix, "help", partial)) {
+		printf("%shelp\n", prefix);
+	}
+}
+
+static int open_schema(struct kjc_schema* schema, const char* prog) {
+	if(kjc_schema_open_elf(schema, prog) != 0) {
+		fprintf(stderr, "Error: %s doesn't contain a valid %s section\n", prog, KJC_SCHEMA_SECTION);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	int ret = EXIT_FAILURE;
+	
+	ARGPARSE(argc, argv) {
+		ARG_COMMAND("embed", "Collect a program's schema and store it in its .kjc_argparse section") {
+			ARGPARSE_NESTED {
+				ARG_POSITIONAL("program", prog) {
+					if(embed_schema(prog) == 0) {
+						ret = EXIT_SUCCESS;
+					}
+					break;
+				}
+				
+				ARG_END {
+					ARGPARSE_HELP();
+				}
+			}
+			break;
+		}
+		
+		ARG_COMMAND("dump", "Print the schema embedded in a program") {
+			ARGPARSE_NESTED {
+				ARG_POSITIONAL("program", prog) {
+					struct kjc_schema schema;
+					if(open_schema(&schema, prog) == 0) {
+						dump_node(&schema, 0, 0);
+						kjc_schema_close(&schema);
+						ret = EXIT_SUCCESS;
+					}
+					break;
+				}
+				
+				ARG_END {
+					ARGPARSE_HELP();
+				}
+			}
+			break;
+		}
+		
+		ARG_COMMAND("complete", "Print completion candidates for the last of the given words") {
+			ARGPARSE_NESTED {
+				ARGPARSE_CONFIG_DASHDASH(false);
+				
+				ARG_POSITIONAL("program [words...]", prog) {
+					/* Everything after the program is a word to complete, even if it looks like an option */
+					int first_word = ARGPARSE_INDEX() + 1;
+					struct kjc_schema schema;
+					if(open_schema(&schema, prog) == 0) {
+						complete_words(&schema, &argv[first_word], argc - first_word);
+						kjc_schema_close(&schema);
+						ret = EXIT_SUCCESS;
+					}
+					break;
+				}
+				
+				ARG_OTHER(arg) {
+					fprintf(stderr, "Error: Expected a program before \"%s\"\n", arg);
+					break;
+				}
+				
+				ARG_END {
+					ARGPARSE_HELP();
+				}
+			}
+			break;
+		}
+		
+		ARG_END {
+			ARGPARSE_HELP();
+		}
+	}
+	
+	return ret;
+}